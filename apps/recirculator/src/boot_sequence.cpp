@@ -0,0 +1,155 @@
+// boot_sequence.cpp
+// Boot Sequence Module
+// Purpose: Concurrent boot initialization and boot timing report
+// Architecture: runBootJobs() starts one short-lived task per initializer and joins them with an
+//               event group; phase/job/milestone timestamps are kept in static arrays and published
+//               once on the first MQTT connection
+// Thread-Safety: Phases and jobs are recorded during single-threaded init; milestones are single
+//                32-bit stores guarded by a "first write wins" check
+// Dependencies: mqtt_handler, ota_manager, device_id, FreeRTOS event groups
+
+#include "boot_sequence.h"
+
+// Project headers (alphabetically)
+#include "device_id.h"
+#include "mqtt_handler.h"
+#include "ota_manager.h"
+
+// Third-party libraries
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Log.h>
+
+// System headers
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+
+#define BOOT_JOB_STACK_SIZE 4096
+#define BOOT_JOB_PRIORITY 1
+
+// A job in flight; static so a timed-out job never writes to a dead stack frame
+typedef struct {
+    const BootJob *job;
+    EventGroupHandle_t done;
+    EventBits_t bit;
+    volatile bool ok;
+    uint32_t durationMs;
+} BootJobSlot;
+
+static const char *const PHASE_NAMES[BOOT_PHASE_COUNT] = {"core", "network", "drivers", "tasks"};
+static const char *const MILESTONE_NAMES[BOOT_MILESTONE_COUNT] = {"initDoneMs", "wifiConnectedMs", "mqttConnectedMs"};
+
+static uint32_t phaseStartMs[BOOT_PHASE_COUNT] = {0};
+static uint32_t phaseDurationMs[BOOT_PHASE_COUNT] = {0};
+static volatile uint32_t milestoneMs[BOOT_MILESTONE_COUNT] = {0};
+static BootJobSlot jobSlots[BOOT_MAX_JOBS];
+static size_t jobCount = 0;
+static bool reportPublished = false;
+
+void bootPhaseStart(BootPhase phase) {
+    if (phase >= BOOT_PHASE_COUNT) return;
+    phaseStartMs[phase] = millis();
+}
+
+void bootPhaseEnd(BootPhase phase) {
+    if (phase >= BOOT_PHASE_COUNT) return;
+    phaseDurationMs[phase] = millis() - phaseStartMs[phase];
+    Log::info("Boot phase '%s' took %lu ms.", PHASE_NAMES[phase], (unsigned long)phaseDurationMs[phase]);
+}
+
+static void bootJobTask(void *pvParameters) {
+    BootJobSlot *slot = (BootJobSlot*)pvParameters;
+    uint32_t start = millis();
+    slot->ok = slot->job->init();
+    slot->durationMs = millis() - start;
+    xEventGroupSetBits(slot->done, slot->bit);
+    vTaskDelete(NULL);
+}
+
+bool runBootJobs(const BootJob *jobs, size_t count, uint32_t timeoutMs) {
+    if (jobCount + count > BOOT_MAX_JOBS) {
+        Log::error("Too many boot jobs (%u).", (unsigned)(jobCount + count));
+        return false;
+    }
+    EventGroupHandle_t done = xEventGroupCreate();
+    if (done == NULL) {
+        Log::error("Failed to create boot job event group.");
+        return false;
+    }
+
+    BootJobSlot *slots = &jobSlots[jobCount];
+    EventBits_t allBits = 0;
+    for (size_t i = 0; i < count; i++) {
+        slots[i].job = &jobs[i];
+        slots[i].done = done;
+        slots[i].bit = (EventBits_t)1 << i;
+        slots[i].ok = false;
+        slots[i].durationMs = 0;
+        allBits |= slots[i].bit;
+        if (xTaskCreate(bootJobTask, jobs[i].name, BOOT_JOB_STACK_SIZE, &slots[i], BOOT_JOB_PRIORITY, NULL) != pdPASS) {
+            // Run it inline rather than failing the boot
+            Log::warn("Could not start boot job '%s' concurrently.", jobs[i].name);
+            uint32_t start = millis();
+            slots[i].ok = jobs[i].init();
+            slots[i].durationMs = millis() - start;
+            xEventGroupSetBits(done, slots[i].bit);
+        }
+    }
+    jobCount += count;
+
+    EventBits_t finished = xEventGroupWaitBits(done, allBits, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeoutMs));
+    bool ok = true;
+    for (size_t i = 0; i < count; i++) {
+        if (!(finished & slots[i].bit)) {
+            Log::error("Boot job '%s' timed out.", jobs[i].name);
+            ok = false;
+        } else if (!slots[i].ok) {
+            Log::error("Boot job '%s' failed.", jobs[i].name);
+            ok = false;
+        } else {
+            Log::info("Boot job '%s' took %lu ms.", jobs[i].name, (unsigned long)slots[i].durationMs);
+        }
+    }
+    // A timed-out job still holds the event group; only a clean join may free it
+    if (ok) {
+        vEventGroupDelete(done);
+    }
+    return ok;
+}
+
+void bootMilestone(BootMilestone milestone) {
+    if (milestone >= BOOT_MILESTONE_COUNT || milestoneMs[milestone] != 0) return;
+    milestoneMs[milestone] = millis();
+    Log::info("Boot milestone %s = %lu ms.", MILESTONE_NAMES[milestone], (unsigned long)milestoneMs[milestone]);
+}
+
+void publishBootReport() {
+    if (reportPublished) return;
+
+    DynamicJsonDocument doc(512);
+    doc["resetReason"] = (int)esp_reset_reason();
+    JsonObject phases = doc.createNestedObject("phases");
+    for (int p = 0; p < BOOT_PHASE_COUNT; p++) {
+        phases[PHASE_NAMES[p]] = phaseDurationMs[p];
+    }
+    JsonObject jobs = doc.createNestedObject("jobs");
+    for (size_t i = 0; i < jobCount; i++) {
+        jobs[jobSlots[i].job->name] = jobSlots[i].durationMs;
+    }
+    for (int m = 0; m < BOOT_MILESTONE_COUNT; m++) {
+        doc[MILESTONE_NAMES[m]] = milestoneMs[m];
+    }
+    char appSha256[65];
+    if (getRunningImageSha256(appSha256)) {
+        doc["appSha256"] = appSha256; // Lets the cloud pick a delta patch for this image
+    }
+
+    char payload[MQTT_PAYLOAD_MAX_LENGTH];
+    serializeJson(doc, payload, sizeof(payload));
+
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/telemetry/recirculator/%s/boot", getDeviceId().c_str());
+    reportPublished = mqttPublish(topic, payload, false); // retain = false
+}
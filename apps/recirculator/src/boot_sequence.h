@@ -0,0 +1,77 @@
+// boot_sequence.h
+#ifndef BOOT_SEQUENCE_H
+#define BOOT_SEQUENCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Boot Sequence Module
+// Purpose:
+// Boot orchestration helpers: runs independent driver/service initializers concurrently,
+// records the duration of each boot phase and job plus the time to network milestones,
+// and reports them once over MQTT.
+
+#define BOOT_MAX_JOBS 8
+
+/**
+ * @brief Sequential boot phases, timed from start to end.
+ */
+typedef enum {
+    BOOT_PHASE_CORE = 0,    // State mutex, EEPROM config, log system
+    BOOT_PHASE_NETWORK,     // WiFi driver and connect task (association continues in background)
+    BOOT_PHASE_DRIVERS,     // Concurrent driver/service initialization (wall time)
+    BOOT_PHASE_TASKS,       // Creation of the remaining tasks
+    BOOT_PHASE_COUNT
+} BootPhase;
+
+/**
+ * @brief Points in time measured from power-on (millis()).
+ */
+typedef enum {
+    BOOT_MILESTONE_INIT_DONE = 0,   // initializeSystemState() returned
+    BOOT_MILESTONE_WIFI_CONNECTED,  // First WiFi association
+    BOOT_MILESTONE_MQTT_CONNECTED,  // First MQTT connection
+    BOOT_MILESTONE_COUNT
+} BootMilestone;
+
+/**
+ * @brief One independent initializer run by runBootJobs().
+ */
+typedef struct {
+    const char *name;   // Short name used in logs and the boot report
+    bool (*init)();     // Returns false on a fatal error
+} BootJob;
+
+/**
+ * @brief Marks the start of a boot phase.
+ */
+void bootPhaseStart(BootPhase phase);
+
+/**
+ * @brief Marks the end of a boot phase and logs its duration.
+ */
+void bootPhaseEnd(BootPhase phase);
+
+/**
+ * @brief Runs initializers concurrently, one short-lived task each, and waits for all of them.
+ * Jobs must not depend on each other. Each job's duration is recorded.
+ * @param jobs Jobs to run (at most BOOT_MAX_JOBS in total across calls)
+ * @param count Number of jobs
+ * @param timeoutMs Maximum time to wait for all jobs
+ * @return true if every job finished in time and succeeded, false otherwise
+ */
+bool runBootJobs(const BootJob *jobs, size_t count, uint32_t timeoutMs);
+
+/**
+ * @brief Records the first occurrence of a milestone; later calls are ignored.
+ * @note Thread-safe: Can be called from any task
+ */
+void bootMilestone(BootMilestone milestone);
+
+/**
+ * @brief Publishes the boot report (phases, jobs, milestones, reset reason) once per boot.
+ * Must be called after MQTT connects.
+ */
+void publishBootReport();
+
+#endif // BOOT_SEQUENCE_H
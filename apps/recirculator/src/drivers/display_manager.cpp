@@ -1,34 +1,136 @@
 // display_manager.cpp
 // Display Manager Module
-// Purpose: Manages SSD1306 OLED display for showing temperature, system status, and configuration
-// Architecture: FreeRTOS task that updates display every 1 second
-// Thread-Safety: Reads temperature and relay state from thread-safe accessors
-// Dependencies: Adafruit_SSD1306, temperature_sensor, relay_controller, eeprom_config
+// Purpose: Manages SSD1306 OLED display: status, 1-hour sparkline, relay countdown, network and diagnostics pages
+// Architecture: FreeRTOS task woken by update notifications or the page's refresh period; each page
+//               collects a small data model, redraws only when it changed and flushes only dirty
+//               8-pixel pages over I2C at 400 kHz. A button double press cycles pages.
+//               Power: dims, then blanks (DISPLAYOFF, no I2C traffic) after inactivity; button and
+//               relay events wake it. Content is shifted by one pixel periodically against burn-in.
+// Thread-Safety: Reads temperature and relay state from thread-safe accessors; only this task touches I2C
+// Dependencies: Adafruit_SSD1306, temperature_sensor, temperature_history, relay_controller, eeprom_config,
+//               mqtt_handler, device_id, remote_config, system_state, WiFi
 
 #include "display_manager.h"
 
 // Project headers (alphabetically)
 #include "config.h"
+#include "device_id.h"
 #include "eeprom_config.h"
+#include "mqtt_handler.h"
+#include "relay_controller.h"
+#include "remote_config.h"
+#include "system_state.h"
+#include "temperature_history.h"
 #include "temperature_sensor.h"
 
 // Third-party libraries
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include <Arduino.h>
+#include <ArduinoJson.h>
 #include <Log.h>
+#include <WiFi.h>
 #include <Wire.h>
 
 // System headers
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <string.h>
 
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
+#define SCREEN_PAGES (SCREEN_HEIGHT / 8)
 #define OLED_RESET    -1
 #define SCREEN_ADDRESS 0x3C
+#define DISPLAY_I2C_CLOCK 400000UL          // SSD1306 fast-mode limit
+#define DISPLAY_I2C_CHUNK 64                // Data bytes per I2C transaction (fits the Wire buffer)
+#define DISPLAY_FALLBACK_REFRESH_MS 5000    // Safety refresh if a notification is missed
+#define SENSOR_ERROR_DECI INT16_MIN
+#define CONTENT_TOP 16                      // First row below the title separator
+#define CONTENT_PAGES_MASK 0xFC             // SSD1306 pages 2-7
+#define ALL_PAGES_MASK 0xFF
+#define SPARKLINE_POINTS 60                 // 1 hour of minute averages
+#define SPARKLINE_LEFT 4
+#define SPARKLINE_TOP 27
+#define SPARKLINE_BOTTOM 63
 
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+// Display power defaults (overridden by the settings stored in EEPROM)
+#define DISPLAY_DEFAULT_DIM_SECONDS 60
+#define DISPLAY_DEFAULT_OFF_SECONDS 600
+#define DISPLAY_DEFAULT_DIM_CONTRAST 0x01
+#define DISPLAY_DEFAULT_SHIFT_MINUTES 5
+#define DISPLAY_NORMAL_CONTRAST 0xCF        // Adafruit default for SSD1306_SWITCHCAPVCC
+#define DISPLAY_MAX_SHIFT_MINUTES 60
+#define DISPLAY_ACTIVITY_MASK (DISPLAY_UPDATE_WAKE | DISPLAY_UPDATE_RELAY | DISPLAY_UPDATE_NEXT_PAGE | DISPLAY_UPDATE_CONFIG)
+
+typedef enum {
+    DISPLAY_POWER_ON = 0,
+    DISPLAY_POWER_DIM,
+    DISPLAY_POWER_OFF
+} DisplayPower;
+
+// Pixel shift cycle: content walks a 2x2 square. X is applied while flushing, Y with the
+// SSD1306 display offset (row 0 is always blank, so the wrapped row is invisible).
+#define PIXEL_SHIFT_STEPS 4
+static const uint8_t PIXEL_SHIFT_X[PIXEL_SHIFT_STEPS] = {0, 1, 1, 0};
+static const uint8_t PIXEL_SHIFT_Y[PIXEL_SHIFT_STEPS] = {0, 0, 1, 1};
+
+// Per-page title and refresh period (how often data is re-collected while the page is shown)
+typedef struct {
+    const char *title;
+    uint32_t refreshMs;
+} DisplayPageInfo;
+
+static const DisplayPageInfo PAGE_INFO[DISPLAY_PAGE_COUNT] = {
+    {"Recirculador d'aigua", DISPLAY_FALLBACK_REFRESH_MS},
+    {"Historial 1h", 60000},
+    {"Temporitzador", 1000},
+    {"Xarxa", 2000},
+    {"Diagnosi", 2000},
+};
+
+// Status page: only fields that differ from what is shown get redrawn
+typedef struct {
+    int16_t temperatureDeci;       // Shown with 1 decimal, SENSOR_ERROR_DECI = sensor error
+    bool relayOn;
+    int16_t maxTemperatureCenti;   // Shown with 2 decimals
+} StatusPageModel;
+
+typedef struct {
+    int16_t avgCenti[SPARKLINE_POINTS];
+    uint8_t count;
+} HistoryPageModel;
+
+typedef struct {
+    bool relayOn;
+    uint32_t remainingSeconds;
+    uint32_t maxTimeSeconds;
+} RelayPageModel;
+
+typedef struct {
+    bool wifiConnected;
+    bool mqttConnected;
+    int8_t rssi;
+    uint32_t ip;
+    char ssid[33];
+} NetworkPageModel;
+
+typedef struct {
+    uint32_t freeHeapKb;
+    uint32_t minFreeHeapKb;
+    uint32_t largestBlockKb;
+    uint32_t taskCount;
+    uint32_t uptimeMinutes;
+} DiagnosticsPageModel;
+
+// Keep 400 kHz after each Adafruit transaction too, so raw page flushes run at full speed
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, DISPLAY_I2C_CLOCK, DISPLAY_I2C_CLOCK);
+
+static TaskHandle_t displayTaskHandle = NULL;
+static uint8_t pixelShiftX = 0;  // Columns the content is moved right by on flush
+
+// Internal Function Declarations
+static void handleDisplayCommand(const char* topic, const char* payload, unsigned int length);
 
 bool initializeDisplayManager() {
     Wire.begin(SDA_PIN, SCL_PIN);
@@ -45,49 +147,572 @@ bool initializeDisplayManager() {
     return true;
 }
 
-void displayManagerTask(void *pvParameters) {
+void initializeDisplayCommands() {
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/command/recirculator/%s/display", getDeviceId().c_str());
+    mqttSubscribe(topic, handleDisplayCommand);
+}
+
+void notifyDisplayUpdate(uint32_t reasons) {
+    if (displayTaskHandle != NULL) {
+        xTaskNotify(displayTaskHandle, reasons, eSetBits);
+    }
+}
+
+/** @brief Bitmask of the SSD1306 pages covered by rows [y, y + h). */
+static uint8_t pagesForRows(int16_t y, int16_t h) {
+    uint8_t mask = 0;
+    for (int16_t page = y / 8; page <= (y + h - 1) / 8 && page < SCREEN_PAGES; page++) {
+        mask |= (1 << page);
+    }
+    return mask;
+}
+
+/**
+ * @brief Sends only the selected pages of the framebuffer. Adjacent dirty pages are
+ *        sent as one window (PAGEADDR/COLUMNADDR) instead of the full 1 KB buffer.
+ */
+static void flushPages(uint8_t pageMask) {
+    const uint8_t *buffer = display.getBuffer();
+    uint8_t page = 0;
+    while (page < SCREEN_PAGES) {
+        if (!(pageMask & (1 << page))) {
+            page++;
+            continue;
+        }
+        uint8_t firstPage = page;
+        while (page < SCREEN_PAGES && (pageMask & (1 << page))) {
+            page++;
+        }
+        uint8_t lastPage = page - 1;
+
+        display.ssd1306_command(SSD1306_PAGEADDR);
+        display.ssd1306_command(firstPage);
+        display.ssd1306_command(lastPage);
+        display.ssd1306_command(SSD1306_COLUMNADDR);
+        display.ssd1306_command(0);
+        display.ssd1306_command(SCREEN_WIDTH - 1);
+
+        for (uint8_t row = firstPage; row <= lastPage; row++) {
+            // Horizontal pixel shift: blank leading columns, the rightmost ones drop off
+            uint8_t line[SCREEN_WIDTH];
+            memset(line, 0, pixelShiftX);
+            memcpy(line + pixelShiftX, buffer + row * SCREEN_WIDTH, SCREEN_WIDTH - pixelShiftX);
+            for (size_t offset = 0; offset < SCREEN_WIDTH; offset += DISPLAY_I2C_CHUNK) {
+                Wire.beginTransmission(SCREEN_ADDRESS);
+                Wire.write((uint8_t)0x40); // Control byte: data stream
+                Wire.write(line + offset, min((size_t)DISPLAY_I2C_CHUNK, SCREEN_WIDTH - offset));
+                Wire.endTransmission();
+            }
+        }
+    }
+}
+
+DisplaySettings getDisplaySettings() {
+    DisplaySettings settings;
+    if (!loadDisplaySettings(settings)) {
+        settings.dimAfterSeconds = DISPLAY_DEFAULT_DIM_SECONDS;
+        settings.offAfterSeconds = DISPLAY_DEFAULT_OFF_SECONDS;
+        settings.dimContrast = DISPLAY_DEFAULT_DIM_CONTRAST;
+        settings.shiftMinutes = DISPLAY_DEFAULT_SHIFT_MINUTES;
+    }
+    return settings;
+}
+
+/** @brief Power state for the given inactivity time. */
+static DisplayPower powerForIdle(uint32_t idleMs, const DisplaySettings &settings) {
+    if (settings.offAfterSeconds > 0 && idleMs >= settings.offAfterSeconds * 1000UL) return DISPLAY_POWER_OFF;
+    if (settings.dimAfterSeconds > 0 && idleMs >= settings.dimAfterSeconds * 1000UL) return DISPLAY_POWER_DIM;
+    return DISPLAY_POWER_ON;
+}
+
+/** @brief Milliseconds until the next dim/off transition, UINT32_MAX if none is pending. */
+static uint32_t msUntilPowerChange(uint32_t idleMs, const DisplaySettings &settings) {
+    uint32_t wait = UINT32_MAX;
+    uint32_t limits[] = {(uint32_t)settings.dimAfterSeconds * 1000, (uint32_t)settings.offAfterSeconds * 1000};
+    for (uint32_t limit : limits) {
+        if (limit > 0 && idleMs < limit) wait = min(wait, limit - idleMs);
+    }
+    return wait;
+}
+
+static void applyDisplayPower(DisplayPower power, const DisplaySettings &settings) {
+    if (power == DISPLAY_POWER_OFF) {
+        display.ssd1306_command(SSD1306_DISPLAYOFF);
+        return;
+    }
+    display.ssd1306_command(SSD1306_SETCONTRAST);
+    display.ssd1306_command(power == DISPLAY_POWER_DIM ? settings.dimContrast : DISPLAY_NORMAL_CONTRAST);
+    display.ssd1306_command(SSD1306_DISPLAYON);
+}
+
+static void applyPixelShift(uint8_t step) {
+    pixelShiftX = PIXEL_SHIFT_X[step];
+    display.ssd1306_command(SSD1306_SETDISPLAYOFFSET);
+    display.ssd1306_command(PIXEL_SHIFT_Y[step]);
+}
+
+static float loadMaxTemperatureSetting() {
     constexpr float DEFAULT_MAX_TEMPERATURE = 30.0f; // Default target temperature in Celsius
-    
-    while (true) {
-        float maxTemperature = getStoredMaxTemperature();
-        if (isnan(maxTemperature)) {
-            maxTemperature = DEFAULT_MAX_TEMPERATURE;
+    float maxTemperature = getStoredMaxTemperature();
+    return isnan(maxTemperature) ? DEFAULT_MAX_TEMPERATURE : maxTemperature;
+}
+
+static char connectivityGlyph(SystemState state) {
+    switch (state) {
+        case SYSTEM_STATE_CONNECTED_WIFI:
+        case SYSTEM_STATE_CONFIG_MQTT:   return 'w';
+        case SYSTEM_STATE_CONNECTED_MQTT: return 'M';
+        case SYSTEM_STATE_CONFIG_MODE:   return 'C';
+        case SYSTEM_STATE_OTA_UPDATE:    return 'U';
+        case SYSTEM_STATE_ERROR:         return '!';
+        default:                         return '.';
+    }
+}
+
+/** @brief Stores current into shown and returns true if they differ (or force is set). */
+static bool modelChanged(void *shown, const void *current, size_t size, bool force) {
+    if (!force && memcmp(shown, current, size) == 0) {
+        return false;
+    }
+    memcpy(shown, current, size);
+    return true;
+}
+
+/** @brief Page title and separator; redrawn only on page change. */
+static void drawTitleRow(DisplayPage page) {
+    display.fillRect(0, 0, SCREEN_WIDTH, CONTENT_TOP, SSD1306_BLACK);
+    // Title
+    display.setTextSize(1.8);
+    display.setTextColor(SSD1306_WHITE);
+    display.setCursor(0, 1);
+    display.println(PAGE_INFO[page].title);
+    // Separator line
+    display.drawLine(0, 15, SCREEN_WIDTH, 15, SSD1306_WHITE);
+}
+
+static uint8_t drawConnectivityGlyph(char glyph) {
+    display.fillRect(122, 0, 6, 9, SSD1306_BLACK);
+    display.setTextSize(1);
+    display.setCursor(122, 1);
+    display.print(glyph);
+    return pagesForRows(0, 9);
+}
+
+//------------------------------------------------------------------------------
+// Status page
+//------------------------------------------------------------------------------
+
+static void collectStatusPage(StatusPageModel &model, float maxTemperature) {
+    memset(&model, 0, sizeof(model));
+    float currentTemp = getLatestTemperature();
+    model.temperatureDeci = (currentTemp == -127.0f) ? SENSOR_ERROR_DECI : (int16_t)lroundf(currentTemp * 10.0f);
+    model.relayOn = isRelayActive();
+    model.maxTemperatureCenti = (int16_t)lroundf(maxTemperature * 100.0f);
+}
+
+static uint8_t drawTemperatureField(const StatusPageModel &model) {
+    // Temperature in large font
+    display.fillRect(0, 22, SCREEN_WIDTH, 16, SSD1306_BLACK);
+    display.setTextSize(2);
+    display.setCursor(0, 22);
+    display.print("T: ");
+    if (model.temperatureDeci == SENSOR_ERROR_DECI) {
+        display.print("ERROR");
+    } else {
+        display.print(model.temperatureDeci / 10.0f, 1);
+        display.print("C");
+    }
+    return pagesForRows(22, 16);
+}
+
+static uint8_t drawRelayField(const StatusPageModel &model) {
+    // System status below temperature
+    display.fillRect(0, 46, SCREEN_WIDTH, 8, SSD1306_BLACK);
+    display.setTextSize(1);
+    display.setCursor(0, 46);
+    display.println(model.relayOn ? "Sistema: ON" : "Sistema: OFF");
+    return pagesForRows(46, 8);
+}
+
+static uint8_t drawMaxTemperatureField(const StatusPageModel &model) {
+    display.fillRect(0, 56, SCREEN_WIDTH, 8, SSD1306_BLACK);
+    display.setTextSize(1);
+    display.setCursor(0, 56);
+    display.print("T.Max: ");
+    display.print(model.maxTemperatureCenti / 100.0f, 2);
+    return pagesForRows(56, 8);
+}
+
+static uint8_t renderStatusPage(float maxTemperature, bool force) {
+    static StatusPageModel shown;
+    StatusPageModel model;
+    collectStatusPage(model, maxTemperature);
+
+    uint8_t dirtyPages = 0;
+    if (force || model.temperatureDeci != shown.temperatureDeci) dirtyPages |= drawTemperatureField(model);
+    if (force || model.relayOn != shown.relayOn) dirtyPages |= drawRelayField(model);
+    if (force || model.maxTemperatureCenti != shown.maxTemperatureCenti) dirtyPages |= drawMaxTemperatureField(model);
+    shown = model;
+    return dirtyPages;
+}
+
+//------------------------------------------------------------------------------
+// History page - sparkline of the last hour of minute averages
+//------------------------------------------------------------------------------
+
+static void collectHistoryPage(HistoryPageModel &model) {
+    memset(&model, 0, sizeof(model));
+    HistoryEntry entries[SPARKLINE_POINTS];
+    size_t count = getTemperatureHistory(HISTORY_TIER_MINUTE, entries, SPARKLINE_POINTS);
+    for (size_t i = 0; i < count; i++) {
+        model.avgCenti[i] = entries[i].avgCenti;
+    }
+    model.count = (uint8_t)count;
+}
+
+static void drawHistoryPage(const HistoryPageModel &model) {
+    int16_t minCenti = INT16_MAX;
+    int16_t maxCenti = INT16_MIN;
+    for (uint8_t i = 0; i < model.count; i++) {
+        if (model.avgCenti[i] == HISTORY_GAP_VALUE) continue;
+        minCenti = min(minCenti, model.avgCenti[i]);
+        maxCenti = max(maxCenti, model.avgCenti[i]);
+    }
+
+    display.setTextSize(1);
+    display.setCursor(0, 17);
+    if (minCenti > maxCenti) {
+        display.print("Sense dades");
+        return;
+    }
+    display.print("Max ");
+    display.print(maxCenti / 100.0f, 1);
+    display.print("  Min ");
+    display.print(minCenti / 100.0f, 1);
+
+    // Scale to the visible range, at least 1 °C tall so sensor noise stays flat
+    int32_t span = max((int32_t)maxCenti - minCenti, (int32_t)100);
+    int16_t height = SPARKLINE_BOTTOM - SPARKLINE_TOP;
+    int16_t previousX = -1;
+    int16_t previousY = -1;
+    // Right-align so the newest minute is always at the right edge
+    int16_t startX = SPARKLINE_LEFT + (SPARKLINE_POINTS - model.count) * 2;
+    for (uint8_t i = 0; i < model.count; i++) {
+        if (model.avgCenti[i] == HISTORY_GAP_VALUE) {
+            previousX = -1;
+            continue;
         }
-        display.clearDisplay();
-        // Title
-        display.setTextSize(1.8);
-        display.setTextColor(SSD1306_WHITE);
-        display.setCursor(0, 1);
-        display.println("Recirculador d'aigua");
-        // Separator line
-        display.drawLine(0, 15, SCREEN_WIDTH, 15, SSD1306_WHITE);
-        // Temperature in large font 
-        display.setTextSize(2);
-        display.setCursor(0, 22);
-        display.print("T: ");
-        float currentTemp = getLatestTemperature();
-        if (currentTemp == -127.0f) {
-            display.print("ERROR");
+        int16_t x = startX + i * 2;
+        int16_t y = SPARKLINE_BOTTOM - (int16_t)(((int32_t)model.avgCenti[i] - minCenti) * height / span);
+        if (previousX >= 0) {
+            display.drawLine(previousX, previousY, x, y, SSD1306_WHITE);
         } else {
-            display.print(currentTemp, 1);
-            display.print("C");
+            display.drawPixel(x, y, SSD1306_WHITE);
+        }
+        previousX = x;
+        previousY = y;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Relay page - countdown to the safety timeout
+//------------------------------------------------------------------------------
+
+static void collectRelayPage(RelayPageModel &model) {
+    memset(&model, 0, sizeof(model));
+    model.relayOn = isRelayActive();
+    if (model.relayOn) {
+        model.remainingSeconds = getRelayRemainingSeconds();
+        model.maxTimeSeconds = getStoredMaxTime();
+    }
+}
+
+static void drawRelayPage(const RelayPageModel &model) {
+    display.setTextSize(2);
+    display.setCursor(0, 22);
+    if (!model.relayOn) {
+        display.print("Aturat");
+        return;
+    }
+    char text[12];
+    snprintf(text, sizeof(text), "%02lu:%02lu", model.remainingSeconds / 60, model.remainingSeconds % 60);
+    display.print(text);
+
+    display.setTextSize(1);
+    display.setCursor(0, 42);
+    snprintf(text, sizeof(text), "de %02lu:%02lu", model.maxTimeSeconds / 60, model.maxTimeSeconds % 60);
+    display.print(text);
+
+    // Progress bar of elapsed time
+    display.drawRect(0, 54, SCREEN_WIDTH, 8, SSD1306_WHITE);
+    if (model.maxTimeSeconds > 0) {
+        uint32_t elapsed = model.maxTimeSeconds - min(model.remainingSeconds, model.maxTimeSeconds);
+        display.fillRect(2, 56, (int16_t)((SCREEN_WIDTH - 4) * elapsed / model.maxTimeSeconds), 4, SSD1306_WHITE);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Network page
+//------------------------------------------------------------------------------
+
+static void collectNetworkPage(NetworkPageModel &model) {
+    memset(&model, 0, sizeof(model));
+    model.wifiConnected = WiFi.status() == WL_CONNECTED;
+    model.mqttConnected = isMqttConnected();
+    if (model.wifiConnected) {
+        model.rssi = WiFi.RSSI();
+        model.ip = (uint32_t)WiFi.localIP();
+        strncpy(model.ssid, WiFi.SSID().c_str(), sizeof(model.ssid) - 1);
+    }
+}
+
+static void drawNetworkPage(const NetworkPageModel &model) {
+    display.setTextSize(1);
+    display.setCursor(0, 18);
+    display.print("WiFi: ");
+    display.print(model.wifiConnected ? model.ssid : "desconnectat");
+    if (model.wifiConnected) {
+        display.setCursor(0, 30);
+        display.print("IP: ");
+        display.print(IPAddress(model.ip).toString());
+        display.setCursor(0, 42);
+        display.print("RSSI: ");
+        display.print(model.rssi);
+        display.print(" dBm");
+    }
+    display.setCursor(0, 54);
+    display.print("MQTT: ");
+    display.print(model.mqttConnected ? "connectat" : "desconnectat");
+}
+
+//------------------------------------------------------------------------------
+// Diagnostics page
+//------------------------------------------------------------------------------
+
+static void collectDiagnosticsPage(DiagnosticsPageModel &model) {
+    memset(&model, 0, sizeof(model));
+    model.freeHeapKb = ESP.getFreeHeap() / 1024;
+    model.minFreeHeapKb = ESP.getMinFreeHeap() / 1024;
+    model.largestBlockKb = ESP.getMaxAllocHeap() / 1024;
+    model.taskCount = uxTaskGetNumberOfTasks();
+    model.uptimeMinutes = millis() / 60000;
+}
+
+static void drawDiagnosticsPage(const DiagnosticsPageModel &model) {
+    char line[24];
+    display.setTextSize(1);
+    display.setCursor(0, 18);
+    snprintf(line, sizeof(line), "Heap: %lu KB (min %lu)", model.freeHeapKb, model.minFreeHeapKb);
+    display.print(line);
+    display.setCursor(0, 30);
+    snprintf(line, sizeof(line), "Bloc max: %lu KB", model.largestBlockKb);
+    display.print(line);
+    display.setCursor(0, 42);
+    snprintf(line, sizeof(line), "Tasques: %lu", model.taskCount);
+    display.print(line);
+    display.setCursor(0, 54);
+    snprintf(line, sizeof(line), "Uptime: %lud %02lu:%02lu", model.uptimeMinutes / 1440,
+             (model.uptimeMinutes / 60) % 24, model.uptimeMinutes % 60);
+    display.print(line);
+}
+
+/** @brief Collects the page data and redraws the content area if it changed. */
+static uint8_t renderDataPage(DisplayPage page, bool force) {
+    bool changed = false;
+    switch (page) {
+        case DISPLAY_PAGE_HISTORY: {
+            static HistoryPageModel shown;
+            HistoryPageModel model;
+            collectHistoryPage(model);
+            if ((changed = modelChanged(&shown, &model, sizeof(model), force))) {
+                display.fillRect(0, CONTENT_TOP, SCREEN_WIDTH, SCREEN_HEIGHT - CONTENT_TOP, SSD1306_BLACK);
+                drawHistoryPage(shown);
+            }
+            break;
+        }
+        case DISPLAY_PAGE_RELAY: {
+            static RelayPageModel shown;
+            RelayPageModel model;
+            collectRelayPage(model);
+            if ((changed = modelChanged(&shown, &model, sizeof(model), force))) {
+                display.fillRect(0, CONTENT_TOP, SCREEN_WIDTH, SCREEN_HEIGHT - CONTENT_TOP, SSD1306_BLACK);
+                drawRelayPage(shown);
+            }
+            break;
+        }
+        case DISPLAY_PAGE_NETWORK: {
+            static NetworkPageModel shown;
+            NetworkPageModel model;
+            collectNetworkPage(model);
+            if ((changed = modelChanged(&shown, &model, sizeof(model), force))) {
+                display.fillRect(0, CONTENT_TOP, SCREEN_WIDTH, SCREEN_HEIGHT - CONTENT_TOP, SSD1306_BLACK);
+                drawNetworkPage(shown);
+            }
+            break;
+        }
+        case DISPLAY_PAGE_DIAGNOSTICS: {
+            static DiagnosticsPageModel shown;
+            DiagnosticsPageModel model;
+            collectDiagnosticsPage(model);
+            if ((changed = modelChanged(&shown, &model, sizeof(model), force))) {
+                display.fillRect(0, CONTENT_TOP, SCREEN_WIDTH, SCREEN_HEIGHT - CONTENT_TOP, SSD1306_BLACK);
+                drawDiagnosticsPage(shown);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return changed ? CONTENT_PAGES_MASK : 0;
+}
+
+void displayManagerTask(void *pvParameters) {
+    displayTaskHandle = xTaskGetCurrentTaskHandle();
+
+    float maxTemperature = loadMaxTemperatureSetting();
+    DisplaySettings settings = getDisplaySettings();
+    DisplayPower power = DISPLAY_POWER_ON;
+    DisplayPage currentPage = DISPLAY_PAGE_STATUS;
+    bool pageChanged = true;
+    bool fullFlush = false;
+    char shownGlyph = 0;
+    uint8_t shiftStep = 0;
+    uint32_t lastActivityMs = millis();
+    uint32_t lastShiftMs = lastActivityMs;
+
+    applyDisplayPower(power, settings);
+
+    while (true) {
+        // Blanked: no rendering and no I2C until woken
+        if (power != DISPLAY_POWER_OFF) {
+            uint8_t dirtyPages = fullFlush ? ALL_PAGES_MASK : 0;
+            if (pageChanged) {
+                // Page switch: new title, cleared content, everything redrawn
+                display.clearDisplay();
+                drawTitleRow(currentPage);
+                shownGlyph = 0;
+                dirtyPages = ALL_PAGES_MASK;
+            }
+
+            char glyph = connectivityGlyph(getSystemState());
+            if (glyph != shownGlyph) {
+                dirtyPages |= drawConnectivityGlyph(glyph);
+                shownGlyph = glyph;
+            }
+
+            if (currentPage == DISPLAY_PAGE_STATUS) {
+                dirtyPages |= renderStatusPage(maxTemperature, pageChanged);
+            } else {
+                dirtyPages |= renderDataPage(currentPage, pageChanged);
+            }
+            pageChanged = false;
+            fullFlush = false;
+
+            if (dirtyPages != 0) {
+                flushPages(dirtyPages);
+            }
         }
 
-        // System status below temperature
-        display.setTextSize(1);
-        display.setCursor(0, 46);
-        if (digitalRead(RELAY_PIN) == HIGH) {
-            display.println("Sistema: ON");
+        // Sleep until notified, the page refresh, the next power transition or the next pixel shift
+        uint32_t now = millis();
+        uint32_t waitMs = msUntilPowerChange(now - lastActivityMs, settings);
+        if (power != DISPLAY_POWER_OFF) {
+            waitMs = min(waitMs, PAGE_INFO[currentPage].refreshMs);
+            if (settings.shiftMinutes > 0) {
+                uint32_t shiftPeriodMs = settings.shiftMinutes * 60000UL;
+                uint32_t sinceShift = now - lastShiftMs;
+                waitMs = min(waitMs, sinceShift < shiftPeriodMs ? shiftPeriodMs - sinceShift : 0);
+            }
+        }
+        TickType_t waitTicks = (waitMs == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(waitMs);
+
+        uint32_t reasons = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &reasons, waitTicks);
+        now = millis();
+
+        // EEPROM is only read when the setting actually changed
+        if (reasons & DISPLAY_UPDATE_CONFIG) {
+            maxTemperature = loadMaxTemperatureSetting();
+            settings = getDisplaySettings();
+        }
+
+        DisplayPower nextPower;
+        if (reasons & DISPLAY_ACTIVITY_MASK) {
+            // A double press on a blank screen only wakes it
+            if ((reasons & DISPLAY_UPDATE_NEXT_PAGE) && power != DISPLAY_POWER_OFF) {
+                currentPage = (DisplayPage)((currentPage + 1) % DISPLAY_PAGE_COUNT);
+                pageChanged = true;
+            }
+            lastActivityMs = now;
+            nextPower = DISPLAY_POWER_ON;
         } else {
-            display.println("Sistema: OFF");
+            nextPower = powerForIdle(now - lastActivityMs, settings);
+        }
+
+        if (nextPower != power || (reasons & DISPLAY_UPDATE_CONFIG)) {
+            if (power == DISPLAY_POWER_OFF && nextPower != DISPLAY_POWER_OFF) {
+                // Rendering was paused while blank
+                pageChanged = true;
+            }
+            if (nextPower != power) {
+                Log::info("Display %s.", nextPower == DISPLAY_POWER_ON ? "on" : nextPower == DISPLAY_POWER_DIM ? "dimmed" : "off");
+            }
+            power = nextPower;
+            applyDisplayPower(power, settings);
+        }
+
+        if (power != DISPLAY_POWER_OFF && settings.shiftMinutes > 0 &&
+            now - lastShiftMs >= settings.shiftMinutes * 60000UL) {
+            shiftStep = (shiftStep + 1) % PIXEL_SHIFT_STEPS;
+            applyPixelShift(shiftStep);
+            lastShiftMs = now;
+            fullFlush = true;
         }
+    }
+}
+
+const char *applyDisplaySettingsJson(JsonVariantConst json, DisplaySettings &settings) {
+    long dimSeconds = json["dimSeconds"] | (long)settings.dimAfterSeconds;
+    long offSeconds = json["offSeconds"] | (long)settings.offAfterSeconds;
+    long dimContrast = json["dimContrast"] | (long)settings.dimContrast;
+    long shiftMinutes = json["shiftMinutes"] | (long)settings.shiftMinutes;
 
-        // Brand and future pressure info
-        display.setCursor(0, 56);
-        display.print("T.Max: ");
-        display.print(maxTemperature, 2);
+    if (dimSeconds < 0 || dimSeconds > UINT16_MAX) return "dimSeconds out of range";
+    if (offSeconds < 0 || offSeconds > UINT16_MAX) return "offSeconds out of range";
+    if (dimContrast < 0 || dimContrast > UINT8_MAX) return "dimContrast out of range";
+    if (shiftMinutes < 0 || shiftMinutes > DISPLAY_MAX_SHIFT_MINUTES) return "shiftMinutes out of range";
+    if (offSeconds > 0 && dimSeconds > offSeconds) return "dimSeconds must not exceed offSeconds";
+
+    settings.dimAfterSeconds = (uint16_t)dimSeconds;
+    settings.offAfterSeconds = (uint16_t)offSeconds;
+    settings.dimContrast = (uint8_t)dimContrast;
+    settings.shiftMinutes = (uint8_t)shiftMinutes;
+    return NULL;
+}
+
+/** @brief Handles {"dimSeconds","offSeconds","dimContrast","shiftMinutes"}; omitted keys keep their value. */
+static void handleDisplayCommand(const char* topic, const char* payload, unsigned int length) {
+    StaticJsonDocument<192> doc;
+    DeserializationError err = deserializeJson(doc, payload, length);
+    if (err) {
+        Log::error("Failed to parse display command: %s", err.c_str());
+        return;
+    }
+
+    DisplaySettings settings = getDisplaySettings();
+    const char *error = applyDisplaySettingsJson(doc.as<JsonVariantConst>(), settings);
+    if (error != NULL) {
+        Log::error("Invalid display settings received via MQTT: %s", error);
+        return;
+    }
 
-        display.display();
-        vTaskDelay(pdMS_TO_TICKS(1000));
+    if (saveDisplaySettings(settings)) {
+        Log::info("Display settings received: dim %us, off %us, contrast %u, shift %u min.",
+                  settings.dimAfterSeconds, settings.offAfterSeconds, settings.dimContrast, settings.shiftMinutes);
+        notifyDisplayUpdate(DISPLAY_UPDATE_CONFIG);
+        publishReportedConfig("applied", NULL);
+    } else {
+        Log::error("Failed to save display settings from MQTT.");
     }
 }
@@ -1,10 +1,35 @@
 #ifndef DISPLAY_MANAGER_H
 #define DISPLAY_MANAGER_H
 
+#include "eeprom_config.h"
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+
 // Display Manager Module
 // Purpose:
 // Handles the initialization and management of the device display.
 
+// Display update reasons (task notification bits)
+#define DISPLAY_UPDATE_TEMPERATURE (1 << 0) // New temperature sample available
+#define DISPLAY_UPDATE_RELAY       (1 << 1) // Relay switched on or off
+#define DISPLAY_UPDATE_CONFIG      (1 << 2) // Stored settings changed (reloaded from EEPROM)
+#define DISPLAY_UPDATE_NETWORK     (1 << 3) // System/connectivity state changed
+#define DISPLAY_UPDATE_NEXT_PAGE   (1 << 4) // Cycle to the next page (button double press)
+#define DISPLAY_UPDATE_WAKE        (1 << 5) // User activity: wake the display, restart the inactivity timer
+
+/**
+ * @brief Display pages, cycled in order.
+ */
+typedef enum {
+    DISPLAY_PAGE_STATUS = 0,    // Temperature, relay state, max temperature
+    DISPLAY_PAGE_HISTORY,       // 1-hour temperature sparkline
+    DISPLAY_PAGE_RELAY,         // Relay countdown
+    DISPLAY_PAGE_NETWORK,       // WiFi/MQTT state, IP, RSSI
+    DISPLAY_PAGE_DIAGNOSTICS,   // Heap and task diagnostics
+    DISPLAY_PAGE_COUNT
+} DisplayPage;
+
 /**
  * @brief Initializes the display (sets up hardware, clears screen, etc).
  * @return true if initialization is successful, false otherwise.
@@ -13,9 +38,39 @@ bool initializeDisplayManager();
 
 /**
  * @brief FreeRTOS task to manage display updates.
- * - Updates display at regular intervals or on demand.
- * - Shows relevant system or telemetry data.
+ * - Sleeps until notified via notifyDisplayUpdate() (with a slow fallback refresh).
+ * - Shows one DisplayPage at a time, each with its own refresh period.
+ * - Redraws only when the page data changed and flushes only the dirty SSD1306 pages.
+ * - Dims, then blanks the panel after inactivity; button, relay and settings events wake it.
+ * - Shifts the content by one pixel every few minutes to limit OLED burn-in.
  */
 void displayManagerTask(void *pvParameters);
 
-#endif // DISPLAY_MANAGER_H
\ No newline at end of file
+/**
+ * @brief Registers the display settings MQTT command. Must be called after MQTT connects.
+ */
+void initializeDisplayCommands();
+
+/**
+ * @brief Effective display power settings: stored in EEPROM, or defaults if never configured.
+ * @note Thread-safe: Reads the config cache
+ */
+DisplaySettings getDisplaySettings();
+
+/**
+ * @brief Validates the keys present in a JSON object and applies them to settings.
+ * Keys: dimSeconds, offSeconds (0 = never), dimContrast (0-255), shiftMinutes (0-60); omitted keys are kept.
+ * @param json JSON object with the settings to change
+ * @param settings Settings to update; left untouched if any value is invalid
+ * @return NULL on success, otherwise a description of the first invalid value
+ */
+const char *applyDisplaySettingsJson(JsonVariantConst json, DisplaySettings &settings);
+
+/**
+ * @brief Wakes the display task to refresh the screen.
+ * @param reasons Bitmask of DISPLAY_UPDATE_* flags
+ * @note Thread-safe: Can be called from any task; ignored before the display task starts
+ */
+void notifyDisplayUpdate(uint32_t reasons);
+
+#endif // DISPLAY_MANAGER_H
@@ -9,10 +9,16 @@
 
 // Project headers (alphabetically)
 #include "config.h"
+#include "cycle_log.h"
 #include "device_id.h"
+#include "display_manager.h"
 #include "eeprom_config.h"
+#include "local_api.h"
 #include "mqtt_handler.h"
+#include "recirculation_scheduler.h"
+#include "remote_config.h"
 #include "system_state.h"
+#include "temperature_predictor.h"
 #include "temperature_sensor.h"
 
 // Third-party libraries
@@ -27,6 +33,28 @@
 
 // Static variables for relay state management
 static bool isRelayPhysicallyOn = false;
+static const char* lastStopReason = "manual"; // Reason passed to the last deactivateRelay()
+static const char* cycleSource = "manual";    // Source passed to the activateRelay() that started the cycle
+static uint32_t cycleStartMillis = 0;         // millis() when the relay was turned ON
+static volatile uint32_t cycleMaxTimeSeconds = 0; // Safety timeout of the running cycle
+static uint32_t cycleStartUtc = 0;            // Unix seconds when the relay was turned ON (0 if unsynced)
+static float cycleStartTemperature = 0.0f;    // Temperature when the relay was turned ON
+static bool cyclePredictedStop = false;       // Set by the controller task before a predictive stop
+
+// Per-cycle statistics, published once the post-stop overshoot window closes
+typedef struct {
+    bool tracking;            // Overshoot tracking in progress
+    const char* reason;       // Stop reason
+    bool predicted;           // Stopped by the slope projection before reaching the threshold
+    uint32_t runTimeSeconds;  // Pump run time
+    float startTemperature;   // Temperature when the pump started
+    float stopTemperature;    // Temperature when the pump stopped
+    float peakTemperature;    // Highest temperature seen after the stop
+    float maxTemperature;     // Threshold in force during the cycle
+    TickType_t stopTick;      // Tick count at stop
+} CycleStats;
+
+static CycleStats cycleStats = {};
 
 //------------------------------------------------------------------------------
 // MQTT Command Handlers - Called when messages arrive on subscribed topics
@@ -35,24 +63,36 @@ static bool isRelayPhysicallyOn = false;
 static void handleMaxTemperatureCommand(const char* topic, const char* payload, unsigned int length)
 {
     float temp = atof(payload);
-    if (saveMaxTemperature(temp))
+    if (!isnan(temp) && temp >= RELAY_MAX_TEMPERATURE_LOWEST && temp <= RELAY_MAX_TEMPERATURE_HIGHEST)
     {
-        Log::info("Temperature %.2f received and saved from MQTT.", temp);
+        if (saveMaxTemperature(temp))
+        {
+            Log::info("Temperature %.2f received and saved from MQTT.", temp);
+            notifyDisplayUpdate(DISPLAY_UPDATE_CONFIG);
+            publishReportedConfig("applied", NULL);
+        }
+        else
+        {
+            Log::error("Failed to save temperature from MQTT.");
+        }
     }
     else
     {
-        Log::error("Failed to save temperature from MQTT.");
+        Log::error("Invalid max temperature received via MQTT: %.2f (must be %.0f-%.0f °C)", temp,
+                   RELAY_MAX_TEMPERATURE_LOWEST, RELAY_MAX_TEMPERATURE_HIGHEST);
+        publishReportedConfig("rejected", "maxTemperature out of range");
     }
 }
 
 static void handleMaxTimeCommand(const char* topic, const char* payload, unsigned int length)
 {
     uint32_t maxTime = (uint32_t)atol(payload);
-    if (maxTime > 0 && maxTime <= 3600)
+    if (maxTime > 0 && maxTime <= RELAY_MAX_TIME_LIMIT_SECONDS)
     {
         if (saveMaxTime(maxTime))
         {
             Log::info("Max time %lu seconds received and saved from MQTT.", maxTime);
+            publishReportedConfig("applied", NULL);
         }
         else
         {
@@ -228,6 +268,57 @@ void playToneMaxPower(int pin, int frequency, int duration) {
     noTone(pin);
 }
 
+/**
+ * @brief Starts post-stop tracking for the cycle that just ended.
+ * The DS18B20 keeps rising after the pump stops; the peak seen during the
+ * overshoot window is what the predictive cutoff is trying to minimise.
+ */
+static void beginCycleStats(const char* reason, bool predicted, uint32_t runTimeSeconds,
+                            float startTemperature, float maxTemperature) {
+    float stopTemperature = getLatestTemperature();
+    cycleStats.tracking = true;
+    cycleStats.reason = reason;
+    cycleStats.predicted = predicted;
+    cycleStats.runTimeSeconds = runTimeSeconds;
+    cycleStats.startTemperature = startTemperature;
+    cycleStats.stopTemperature = stopTemperature;
+    cycleStats.peakTemperature = stopTemperature;
+    cycleStats.maxTemperature = maxTemperature;
+    cycleStats.stopTick = xTaskGetTickCount();
+}
+
+/**
+ * @brief Publishes the per-cycle run-time and overshoot statistics and ends tracking.
+ */
+static void publishCycleStats() {
+    cycleStats.tracking = false;
+
+    float overshoot = cycleStats.peakTemperature - cycleStats.maxTemperature;
+    Log::info("Cycle stats: reason=%s run=%lu s start=%.1f°C stop=%.1f°C peak=%.1f°C overshoot=%.2f°C%s",
+              cycleStats.reason, cycleStats.runTimeSeconds, cycleStats.startTemperature,
+              cycleStats.stopTemperature, cycleStats.peakTemperature, overshoot,
+              cycleStats.predicted ? " (predicted stop)" : "");
+
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/telemetry/recirculator/%s/cycle-stats", getDeviceId().c_str());
+
+    DynamicJsonDocument doc(384);
+    doc["deviceId"] = getDeviceId();
+    doc["reason"] = cycleStats.reason;
+    doc["predicted"] = cycleStats.predicted;
+    doc["runTime"] = cycleStats.runTimeSeconds;
+    doc["startTemperature"] = cycleStats.startTemperature;
+    doc["stopTemperature"] = cycleStats.stopTemperature;
+    doc["peakTemperature"] = cycleStats.peakTemperature;
+    doc["maxTemperature"] = cycleStats.maxTemperature;
+    doc["overshoot"] = overshoot;
+    doc["timestamp"] = millis();
+    String jsonString;
+    serializeJson(doc, jsonString);
+
+    mqttPublish(topic, jsonString.c_str(), false); // retain = false
+}
+
 /**
  * @brief Test del buzzer al inicio para verificar funcionamiento.
  * Ejecuta 5 pruebas con diferentes frecuencias.
@@ -271,7 +362,7 @@ void testBuzzer() {
  * @brief Activa el relay físicamente y publica el estado por MQTT.
  * Esta es la ÚNICA función centralizada para encender el relay.
  */
-bool activateRelay() {
+bool activateRelay(const char* source) {
     if (isRelayPhysicallyOn) {
         Log::debug("Relay already ON, ignoring duplicate activation.");
         return true;
@@ -279,7 +370,20 @@ bool activateRelay() {
     
     digitalWrite(RELAY_PIN, HIGH);
     isRelayPhysicallyOn = true;
-    Log::info("Relay turned ON.");
+    notifyDisplayUpdate(DISPLAY_UPDATE_RELAY);
+    cycleSource = source;
+    cycleStartMillis = millis();
+    cycleStartTemperature = getLatestTemperature();
+    requestTemperatureSample(); // Switch the sensor to the fast rate right away
+    cyclePredictedStop = false;
+    UtcClock &clock = getUtcClock();
+    cycleStartUtc = clock.isTimeValid() ? (uint32_t)(clock.getTime(0) / 1000ULL) : 0;
+    Log::info("Relay turned ON. Source: %s", source);
+
+    // User requests feed the demand histogram; scheduled pre-runs must not reinforce themselves
+    if (strcmp(source, "button") == 0 || strcmp(source, "command") == 0) {
+        recordRecirculationDemand();
+    }
     
     // Construct topic and payload for power state
     char topic[128];
@@ -292,8 +396,9 @@ bool activateRelay() {
     String jsonString;
     serializeJson(doc, jsonString);
     
-    // Publish using generic MQTT function
+    // Publish using generic MQTT function, mirrored to local WebSocket clients
     mqttPublish(topic, jsonString.c_str(), true); // retain = true
+    localApiBroadcast("power-state", jsonString.c_str());
     
     return true;
 }
@@ -310,7 +415,26 @@ bool deactivateRelay(const char* reason) {
     
     digitalWrite(RELAY_PIN, LOW);
     isRelayPhysicallyOn = false;
+    notifyDisplayUpdate(DISPLAY_UPDATE_RELAY);
+    lastStopReason = reason;
     Log::info("Relay turned OFF. Reason: %s", reason);
+
+    uint32_t runTimeSeconds = (millis() - cycleStartMillis) / 1000;
+    bool scheduled = strcmp(cycleSource, "schedule") == 0;
+    if (scheduled) {
+        recordScheduledRun(runTimeSeconds);
+    }
+
+    // Persist the cycle outcome for on-device rollups (queued; the flash append runs in the cycle log writer task)
+    CycleRecord record;
+    record.startUtc = cycleStartUtc;
+    record.durationSeconds = (uint16_t)min(runTimeSeconds, (uint32_t)UINT16_MAX);
+    record.startTempCenti = (int16_t)lroundf(cycleStartTemperature * 100.0f);
+    record.endTempCenti = (int16_t)lroundf(getLatestTemperature() * 100.0f);
+    record.energyCentiWh = (uint16_t)lroundf(PUMP_POWER_WATTS * runTimeSeconds / 36.0f);
+    record.stopReason = cycleStopReasonFromString(reason);
+    record.flags = (cyclePredictedStop ? CYCLE_FLAG_PREDICTED : 0) | (scheduled ? CYCLE_FLAG_SCHEDULED : 0);
+    appendCycleRecord(record);
     
     // Construct topic and payload for power state
     char topic[128];
@@ -323,8 +447,9 @@ bool deactivateRelay(const char* reason) {
     String jsonString;
     serializeJson(doc, jsonString);
     
-    // Publish using generic MQTT function
+    // Publish using generic MQTT function, mirrored to local WebSocket clients
     mqttPublish(topic, jsonString.c_str(), true); // retain = true
+    localApiBroadcast("power-state", jsonString.c_str());
     
     return true;
 }
@@ -336,15 +461,21 @@ bool isRelayActive() {
     return isRelayPhysicallyOn;
 }
 
+uint32_t getRelayRemainingSeconds() {
+    if (!isRelayPhysicallyOn) {
+        return 0;
+    }
+    uint32_t elapsedSeconds = (millis() - cycleStartMillis) / 1000;
+    uint32_t maxTime = cycleMaxTimeSeconds;
+    return (maxTime > elapsedSeconds) ? (maxTime - elapsedSeconds) : 0;
+}
+
 void relayControllerTask(void *pvParameters) {
     pinMode(RELAY_PIN, OUTPUT);
     pinMode(BUZZER_PIN, OUTPUT);
     digitalWrite(RELAY_PIN, LOW); // Ensure relay starts OFF
     Log::info("Relay controller task started on pin %d.", RELAY_PIN);
 
-    // Wait a bit for system to stabilize
-    vTaskDelay(pdMS_TO_TICKS(500));
-
     #ifdef ESP32_C3
       // Initialize LEDC for buzzer
       Log::info("Initializing LEDC for buzzer on GPIO %d", BUZZER_PIN);
@@ -359,18 +490,28 @@ void relayControllerTask(void *pvParameters) {
       ledcWrite(0, 0); // Start with buzzer OFF
     #endif
 
-    // Test buzzer at startup
-    testBuzzer();
+    // Optional buzzer test at startup (off by default: it holds the relay task for ~3 s)
+    if (BOOT_BUZZER_SELF_TEST) {
+        testBuzzer();
+    }
 
     // Default configuration constants
     constexpr uint32_t DEFAULT_MAX_TIME_SECONDS = 120; // Default: 2 minutes
     constexpr uint32_t STATUS_LOG_INTERVAL_SECONDS = 5; // Log status every 5 seconds
+    constexpr uint32_t SENSOR_LAG_MS = 10000;           // DS18B20 + pipe thermal lag compensated by the projection
+    constexpr float PREDICTION_MAX_LEAD_C = 5.0f;       // Ignore projections while still far below the threshold
+    constexpr uint32_t OVERSHOOT_WINDOW_SECONDS = 60;   // Peak tracking time after the pump stops
+    // relay-timer telemetry: the deadline (maxTime) is the reported value, so a running countdown
+    // publishes at start, on deadline change and as a 30 s heartbeat; the backend extrapolates
+    const MqttReportPolicy RELAY_TIMER_REPORT_POLICY = {1.0f, 1000, 30000};
     
     TickType_t startTime = 0;
     bool timerStarted = false;
     uint32_t maxTimeSeconds = DEFAULT_MAX_TIME_SECONDS;
     TickType_t maxRunTime = pdMS_TO_TICKS(maxTimeSeconds * 1000);
     uint32_t lastLoggedSecond = 0; // Track last logged interval to avoid duplicate logs
+    MqttReportChannel timerReport;
+    mqttInitReportChannel(timerReport, RELAY_TIMER_REPORT_POLICY);
     bool maxTempLoaded = false; // Flag to load max temp only once per relay activation
     float maxTemperature = 30.0f; // Default max temperature
 
@@ -380,13 +521,17 @@ void relayControllerTask(void *pvParameters) {
         if (relayState) {
             // Relay is ON - start timer if not started
             if (!timerStarted) {
+                if (cycleStats.tracking) {
+                    publishCycleStats(); // New cycle before the overshoot window closed
+                }
                 startTime = xTaskGetTickCount();
                 timerStarted = true;
                 lastLoggedSecond = 0;
+                mqttResetReportChannel(timerReport); // First countdown sample of a cycle always reports
                 maxTempLoaded = false; // Reset flag to load temp again
                 maxTimeSeconds = getStoredMaxTime(); // Load from EEPROM
+                cycleMaxTimeSeconds = maxTimeSeconds;
                 maxRunTime = pdMS_TO_TICKS(maxTimeSeconds * 1000);
-                activateRelay(); // Centralized function
                 Log::info("Max time: %lu seconds", maxTimeSeconds);
             }
 
@@ -397,13 +542,17 @@ void relayControllerTask(void *pvParameters) {
             uint32_t elapsedSeconds = elapsedTicks / pdMS_TO_TICKS(1000);
             uint32_t remainingSeconds = (maxTimeSeconds > elapsedSeconds) ? (maxTimeSeconds - elapsedSeconds) : 0;
             
-            // Log and publish status every STATUS_LOG_INTERVAL_SECONDS
+            // Log status every STATUS_LOG_INTERVAL_SECONDS
             uint32_t logInterval = elapsedSeconds / STATUS_LOG_INTERVAL_SECONDS; // Calculate which interval we're in
             if (logInterval > 0 && logInterval != lastLoggedSecond) {
                 Log::info("Relay ON: %lu/%lu s | Remaining: %lu s | Temp: %.1f°C", 
                           elapsedSeconds, maxTimeSeconds, remainingSeconds, temp);
-                
-                // Publish relay timer to MQTT (only when relay is active)
+                lastLoggedSecond = logInterval;
+            }
+
+            // Publish relay timer to MQTT by exception (only when relay is active)
+            uint32_t nowMs = millis();
+            if (mqttReportDue(timerReport, (float)maxTimeSeconds, 1, nowMs)) {
                 char timerTopic[128];
                 snprintf(timerTopic, sizeof(timerTopic), "mica/dev/telemetry/recirculator/%s/relay-timer", getDeviceId());
                 
@@ -416,15 +565,16 @@ void relayControllerTask(void *pvParameters) {
                 String timerJson;
                 serializeJson(timerDoc, timerJson);
                 
-                mqttPublish(timerTopic, timerJson.c_str(), false); // retain = false
-                
-                lastLoggedSecond = logInterval;
+                if (mqttPublish(timerTopic, timerJson.c_str(), false)) { // retain = false
+                    mqttReportSent(timerReport, (float)maxTimeSeconds, 1, nowMs);
+                }
             }
             
             // Check timeout
             if (elapsedTicks >= maxRunTime) {
                 deactivateRelay("timeout"); // Centralized function
                 timerStarted = false;
+                beginCycleStats("timeout", false, elapsedSeconds, cycleStartTemperature, maxTemperature);
                 Log::info("Timeout reached after %lu seconds.", maxTimeSeconds);
                 Log::info("Playing Game Over melody...");
                 
@@ -455,9 +605,26 @@ void relayControllerTask(void *pvParameters) {
                 Log::info("Max temperature threshold: %.1f°C", maxTemperature);
             }
             
-            if (temp > maxTemperature) {
+            // Project the temperature past the sensor lag: the water at the tap is already
+            // hotter than the DS18B20 reports, so waiting for the raw reading overshoots
+            bool predictedStop = false;
+            TemperatureProjection projection;
+            if (temp != -127.0f && temp <= maxTemperature &&
+                (maxTemperature - temp) <= PREDICTION_MAX_LEAD_C &&
+                predictTemperature(millis(), SENSOR_LAG_MS, projection)) {
+                predictedStop = projection.projectedTemperature > maxTemperature;
+                if (predictedStop) {
+                    Log::info("Projected %.2f°C in %lu ms (slope %.3f°C/s, %u samples) exceeds %.1f°C.",
+                              projection.projectedTemperature, SENSOR_LAG_MS, projection.slopePerSecond,
+                              projection.samplesUsed, maxTemperature);
+                }
+            }
+
+            if (temp > maxTemperature || predictedStop) {
+                cyclePredictedStop = predictedStop;
                 deactivateRelay("temperature"); // Centralized function
                 timerStarted = false;
+                beginCycleStats("temperature", predictedStop, elapsedSeconds, cycleStartTemperature, maxTemperature);
                 Log::info("Target temperature %.2f°C reached.", temp);
                 Log::info("Playing Success melody...");
                 
@@ -482,6 +649,19 @@ void relayControllerTask(void *pvParameters) {
                 deactivateRelay("manual"); // Centralized function
                 timerStarted = false;
                 maxTempLoaded = false; // Reset for next activation
+                uint32_t runTimeSeconds = (xTaskGetTickCount() - startTime) / pdMS_TO_TICKS(1000);
+                beginCycleStats(lastStopReason, false, runTimeSeconds, cycleStartTemperature, maxTemperature);
+            }
+
+            // Track the post-stop peak to measure overshoot
+            if (cycleStats.tracking) {
+                float temp = getLatestTemperature();
+                if (temp != -127.0f && temp > cycleStats.peakTemperature) {
+                    cycleStats.peakTemperature = temp;
+                }
+                if (xTaskGetTickCount() - cycleStats.stopTick >= pdMS_TO_TICKS(OVERSHOOT_WINDOW_SECONDS * 1000)) {
+                    publishCycleStats();
+                }
             }
         }
         
@@ -1,6 +1,12 @@
 #ifndef RELAY_CONTROLLER_H
 #define RELAY_CONTROLLER_H
 
+#include <stdint.h>
+
+#define RELAY_MAX_TIME_LIMIT_SECONDS 3600    // Longest safety timeout accepted
+#define RELAY_MAX_TEMPERATURE_LOWEST 10.0f   // Range accepted for the stop temperature, in °C
+#define RELAY_MAX_TEMPERATURE_HIGHEST 90.0f
+
 /**
  * @brief Initialize relay controller and register MQTT command subscriptions
  * Must be called after MQTT connection is established
@@ -11,6 +17,8 @@ void initializeRelayController();
  * @brief FreeRTOS task to control relay based on temperature.
  * - Monitors temperature and compares with max temperature from EEPROM.
  * - Automatically stops after 2 minutes or when max temperature is reached.
+ * - Stops early when the temperature projected past the sensor lag crosses the threshold.
+ * - Publishes per-cycle run time and overshoot statistics (cycle-stats topic).
  * - Plays buzzer melodies on stop conditions.
  */
 void relayControllerTask(void *pvParameters);
@@ -23,12 +31,14 @@ void relayControllerTask(void *pvParameters);
  * - Updates internal state flag
  * - Publishes power state to MQTT with retain=true
  * - Starts safety timer in relay controller task
+ * - Records user demand ("button"/"command") for the recirculation scheduler
  * 
+ * @param source Who requested the cycle: "button", "command", "schedule", "manual"
  * @return true if activated successfully, false if already active
  * @note Thread-safe: Can be called from any task
  * @note Idempotent: Multiple calls ignored if already active
  */
-bool activateRelay();
+bool activateRelay(const char* source);
 
 /**
  * @brief Deactivates the relay physically and publishes the state via MQTT.
@@ -54,4 +64,11 @@ bool deactivateRelay(const char* reason);
  */
 bool isRelayActive();
 
+/**
+ * @brief Seconds left before the safety timeout stops the current cycle.
+ * @return Remaining seconds, or 0 if the relay is off
+ * @note Thread-safe: Reads statics written by the relay task
+ */
+uint32_t getRelayRemainingSeconds();
+
 #endif
\ No newline at end of file
@@ -1,17 +1,27 @@
 // temperature_sensor.cpp
 // Temperature Sensor Module
-// Purpose: Reads DS18B20 temperature sensor and publishes telemetry via MQTT
-// Architecture: FreeRTOS task with mutex-protected state, publishes every 5 seconds
-// Thread-Safety: Uses temperatureMutex for thread-safe temperature access
-// Dependencies: DallasTemperature, OneWire, mqtt_handler, system_state
+// Purpose: Reads the DS18B20 sensors (outlet, return, tank) and publishes telemetry via MQTT
+// Architecture: FreeRTOS task with async conversion, 1 Hz while pumping / 0.1 Hz idle, report-by-exception telemetry.
+//               ROM addresses are discovered once, cached in NVS and read by address. Channels assigned
+//               in the config document ("sensors") take precedence over the bus-order cache.
+// Thread-Safety: Single writer (sensor task) publishes filtered samples through a per-channel
+//                seqlock; readers are lock-free and never block or see torn values
+// Dependencies: DallasTemperature, OneWire, Preferences, eeprom_config, mqtt_handler, system_state,
+//               temperature_predictor, temperature_history
 
 #include "temperature_sensor.h"
 
 // Project headers (alphabetically)
 #include "config.h"
 #include "device_id.h"
+#include "display_manager.h"
+#include "eeprom_config.h"
+#include "local_api.h"
 #include "mqtt_handler.h"
+#include "relay_controller.h"
 #include "system_state.h"
+#include "temperature_history.h"
+#include "temperature_predictor.h"
 
 // Third-party libraries
 #include <Arduino.h>
@@ -19,28 +29,272 @@
 #include <DallasTemperature.h>
 #include <Log.h>
 #include <OneWire.h>
+#include <Preferences.h>
 
 // System headers
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
+#include <atomic>
+#include <ctype.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
-const uint32_t TEMPERATURE_READ_INTERVAL = 5000; // ms - read every 5 seconds
+const uint32_t TEMPERATURE_ACTIVE_INTERVAL = 1000;   // ms - 1 Hz while the relay is active
+const uint32_t TEMPERATURE_IDLE_INTERVAL = 10000;    // ms - 0.1 Hz while idle
+
+// Report-by-exception telemetry: any channel moving by the deadband or changing quality
+// publishes (rate-limited), otherwise a heartbeat keeps the retained value fresh
+const MqttReportPolicy TEMPERATURE_REPORT_POLICY = {
+    0.3f,   // °C deadband
+    1000,   // ms minimum interval
+    300000  // ms heartbeat
+};
+
+// Filtering pipeline: CRC + plausibility -> median-of-N spike rejection -> EMA
+#define TEMPERATURE_MEDIAN_WINDOW 3                   // Samples; rejects single-sample spikes with 1 sample of lag
+const float TEMPERATURE_EMA_ALPHA = 0.4f;             // Weight of the newest median output
+const float TEMPERATURE_MIN_PLAUSIBLE = -10.0f;       // °C - below this the reading is rejected
+const float TEMPERATURE_MAX_PLAUSIBLE = 100.0f;       // °C - above this the reading is rejected
+const int16_t DS18B20_POWER_ON_RAW = 0x0550;          // 85 °C scratchpad reset value
+const float DS18B20_POWER_ON_MAX_JUMP = 5.0f;         // °C - an 85 °C jump larger than this is a reset
+const uint8_t TEMPERATURE_MAX_HELD_SAMPLES = 3;       // Rejected reads before the channel reports an error
 
 static OneWire oneWire(TEMPERATURE_SENSOR_PIN);
 static DallasTemperature sensors(&oneWire);
-static float latestTemperature = 0.0f;
-static SemaphoreHandle_t temperatureMutex = NULL;
+static const char *const CHANNEL_NAMES[TEMP_CHANNEL_COUNT] = {"outlet", "return", "tank"};
+
+static_assert(TEMP_CHANNEL_COUNT <= TEMP_OFFSET_CHANNELS, "EEPROM must hold an offset per channel");
+
+// ROM address cache persisted in NVS (namespace "ds18b20")
+struct SensorAddressCache
+{
+    uint8_t presentMask;                      // Bit n set = channel n has an address
+    DeviceAddress address[TEMP_CHANNEL_COUNT];
+};
+
+// Channel -> ROM mapping: written by discoverSensors() (init, then the sensor task) under channelMapMux
+static DeviceAddress channelAddress[TEMP_CHANNEL_COUNT];
+static bool channelPresent[TEMP_CHANNEL_COUNT] = {false};
+static bool channelAssigned[TEMP_CHANNEL_COUNT] = {false}; // Set by the config document, not bus order
+static portMUX_TYPE channelMapMux = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool channelReloadRequested = false;
+static volatile float channelOffset[TEMP_CHANNEL_COUNT] = {0.0f};
+
+// Per-channel filter state, owned by the sensor task
+struct ChannelFilter
+{
+    float window[TEMPERATURE_MEDIAN_WINDOW];
+    uint8_t count;
+    uint8_t next;
+    float ema;
+    uint8_t rejectedCount;
+    uint8_t lastReadStatus;
+    TemperatureSample lastGood;
+};
+static ChannelFilter channelFilters[TEMP_CHANNEL_COUNT];
+
+// Latest published sample per channel. Even sequence = stable, odd = write in progress.
+// Zero-initialized slots have no TEMP_QUALITY_VALID bit, so readers see an error, not 0 °C.
+struct SampleSlot
+{
+    std::atomic<uint32_t> sequence;
+    TemperatureSample sample;
+};
+static SampleSlot sampleSlots[TEMP_CHANNEL_COUNT];
+static portMUX_TYPE sampleSlotMux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t sampleRequestSemaphore = NULL; // Wakes the task for an immediate sample
+static uint8_t sensorResolution = TEMPERATURE_DEFAULT_RESOLUTION;
+static volatile uint8_t requestedResolution = TEMPERATURE_DEFAULT_RESOLUTION; // Applied by the task
+
+// A channel -> ROM mapping being built by discoverSensors()
+struct ChannelMap
+{
+    DeviceAddress address[TEMP_CHANNEL_COUNT];
+    bool present[TEMP_CHANNEL_COUNT];
+    bool assigned[TEMP_CHANNEL_COUNT];
+};
+
+static int findFreeChannel(const ChannelMap &map)
+{
+    for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+    {
+        if (!map.present[c])
+        {
+            return c;
+        }
+    }
+    return -1;
+}
+
+static bool isAddressMapped(const ChannelMap &map, const uint8_t *address)
+{
+    for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+    {
+        if (map.present[c] && memcmp(map.address[c], address, sizeof(DeviceAddress)) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void formatSensorAddress(const uint8_t *address, char hex[17])
+{
+    static const char digits[] = "0123456789ABCDEF";
+    for (int i = 0; i < 8; i++)
+    {
+        hex[2 * i] = digits[address[i] >> 4];
+        hex[2 * i + 1] = digits[address[i] & 0x0F];
+    }
+    hex[16] = '\0';
+}
+
+// Builds the channel -> ROM mapping. Addresses assigned in the config document win and are kept
+// even if the probe does not answer (it then reads as disconnected). Remaining channels are filled
+// provisionally: from the NVS cache, then by a bus scan in bus order. Only provisional mappings
+// are cached, so a later assignment never conflicts with them.
+static void discoverSensors()
+{
+    ChannelMap map;
+    memset(&map, 0, sizeof(map));
+
+    for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+    {
+        if (loadSensorAddress(c, map.address[c]))
+        {
+            map.present[c] = true;
+            map.assigned[c] = true;
+            if (!sensors.isConnected(map.address[c]))
+            {
+                Log::warn("Assigned %s sensor not responding.", CHANNEL_NAMES[c]);
+            }
+        }
+    }
+
+    SensorAddressCache cache;
+    memset(&cache, 0, sizeof(cache));
+    Preferences prefs;
+    prefs.begin("ds18b20", true);
+    size_t loaded = prefs.getBytes("roms", &cache, sizeof(cache));
+    prefs.end();
+
+    bool cacheChanged = (loaded != sizeof(cache));
+    int mapped = 0;
+    for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+    {
+        if (map.present[c])
+        {
+            mapped++;
+            continue;
+        }
+        if (cacheChanged || !(cache.presentMask & (1 << c)))
+        {
+            continue;
+        }
+        if (!isAddressMapped(map, cache.address[c]) && sensors.isConnected(cache.address[c]))
+        {
+            memcpy(map.address[c], cache.address[c], sizeof(DeviceAddress));
+            map.present[c] = true;
+            mapped++;
+        }
+        else
+        {
+            Log::warn("Cached %s sensor not responding or reassigned, rescanning bus.", CHANNEL_NAMES[c]);
+            cacheChanged = true;
+        }
+    }
+
+    int deviceCount = sensors.getDeviceCount();
+    if (cacheChanged || mapped < min(deviceCount, (int)TEMP_CHANNEL_COUNT))
+    {
+        DeviceAddress address;
+        for (int i = 0; i < deviceCount; i++)
+        {
+            if (!sensors.getAddress(address, i) || !sensors.validAddress(address) || isAddressMapped(map, address))
+            {
+                continue;
+            }
+            int channel = findFreeChannel(map);
+            if (channel < 0)
+            {
+                Log::warn("More DS18B20 sensors than channels, ignoring extra sensors.");
+                break;
+            }
+            memcpy(map.address[channel], address, sizeof(DeviceAddress));
+            map.present[channel] = true;
+            cacheChanged = true;
+        }
+    }
+
+    if (cacheChanged)
+    {
+        cache.presentMask = 0;
+        for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+        {
+            if (map.present[c] && !map.assigned[c])
+            {
+                cache.presentMask |= (1 << c);
+                memcpy(cache.address[c], map.address[c], sizeof(DeviceAddress));
+            }
+        }
+        prefs.begin("ds18b20", false);
+        if (prefs.putBytes("roms", &cache, sizeof(cache)) != sizeof(cache))
+        {
+            Log::error("Failed to persist DS18B20 address cache.");
+        }
+        prefs.end();
+    }
+
+    portENTER_CRITICAL(&channelMapMux);
+    memcpy(channelAddress, map.address, sizeof(channelAddress));
+    memcpy(channelPresent, map.present, sizeof(channelPresent));
+    memcpy(channelAssigned, map.assigned, sizeof(channelAssigned));
+    portEXIT_CRITICAL(&channelMapMux);
+
+    int provisional = 0;
+    for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+    {
+        if (!map.present[c])
+        {
+            continue;
+        }
+        provisional += map.assigned[c] ? 0 : 1;
+        char hex[17];
+        formatSensorAddress(map.address[c], hex);
+        Log::info("DS18B20 %s: %s%s", CHANNEL_NAMES[c], hex, map.assigned[c] ? "" : " (bus order)");
+    }
+    if (provisional >= 2)
+    {
+        Log::warn("%d DS18B20 sensors mapped in bus order: control uses the outlet channel until "
+                  "\"sensors\" is set in the config document.", provisional);
+    }
+}
 
 bool initializeTemperatureSensor()
 {
     sensors.begin();
     Log::info("Found %d DS18B20 devices", sensors.getDeviceCount());
-    temperatureMutex = xSemaphoreCreateMutex();
-    if (temperatureMutex == NULL)
+
+    discoverSensors();
+    reloadTemperatureOffsets();
+    uint8_t storedResolution;
+    if (loadTemperatureResolution(storedResolution) && storedResolution >= 9 && storedResolution <= 12)
+    {
+        sensorResolution = storedResolution;
+        requestedResolution = storedResolution;
+    }
+
+    // Async mode: requestTemperatures() only starts the conversion, the task
+    // sleeps for the conversion time instead of busy-waiting inside the library
+    sensors.setWaitForConversion(false);
+    sensors.setResolution(sensorResolution);
+
+    sampleRequestSemaphore = xSemaphoreCreateBinary();
+    if (sampleRequestSemaphore == NULL)
     {
-        Log::error("Failed to create temperature mutex.");
+        Log::error("Failed to create temperature sample semaphore.");
         for (int i = 0; i <= 3; i++)
         {
             digitalWrite(BUZZER_PIN, HIGH);
@@ -50,25 +304,357 @@ bool initializeTemperatureSensor()
         }
         return false;
     }
-    Log::info("DS18B20 temperature sensor initialized on pin %d.", TEMPERATURE_SENSOR_PIN);
+    Log::info("DS18B20 temperature sensor initialized on pin %d (%u-bit).", TEMPERATURE_SENSOR_PIN, sensorResolution);
+    return true;
+}
+
+bool setTemperatureResolution(uint8_t bits)
+{
+    if (bits < 9 || bits > 12)
+    {
+        Log::error("Invalid DS18B20 resolution: %u (must be 9-12 bits)", bits);
+        return false;
+    }
+    if (bits != requestedResolution)
+    {
+        requestedResolution = bits; // Applied between conversions to avoid bus contention
+        requestTemperatureSample();
+    }
+    return true;
+}
+
+bool setTemperatureOffset(TemperatureChannel channel, float offset)
+{
+    if (channel >= TEMP_CHANNEL_COUNT || isnan(offset) || fabsf(offset) > TEMPERATURE_MAX_OFFSET)
+    {
+        Log::error("Invalid temperature offset %.2f for channel %d", offset, (int)channel);
+        return false;
+    }
+    if (!saveTemperatureOffset(channel, offset))
+    {
+        return false;
+    }
+    channelOffset[channel] = offset; // 32-bit store, atomic on ESP32
+    return true;
+}
+
+void reloadTemperatureOffsets()
+{
+    for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+    {
+        float offset = 0.0f;
+        if (loadTemperatureOffset(c, offset) && !isnan(offset))
+        {
+            channelOffset[c] = offset; // 32-bit store, atomic on ESP32
+        }
+    }
+}
+
+const char *getTemperatureChannelName(TemperatureChannel channel)
+{
+    return (channel < TEMP_CHANNEL_COUNT) ? CHANNEL_NAMES[channel] : "unknown";
+}
+
+bool isTemperatureChannelPresent(TemperatureChannel channel)
+{
+    return channel < TEMP_CHANNEL_COUNT && channelPresent[channel];
+}
+
+TemperatureChannel getControlChannel()
+{
+    // The return line reaching temperature means the whole loop is hot. Only trusted once the
+    // installer assigned the return probe: a bus-order guess could stop the pump on any probe.
+    if (channelPresent[TEMP_CHANNEL_RETURN] && channelAssigned[TEMP_CHANNEL_RETURN])
+    {
+        return TEMP_CHANNEL_RETURN;
+    }
+    return TEMP_CHANNEL_OUTLET;
+}
+
+void reloadTemperatureChannels()
+{
+    channelReloadRequested = true; // Handled by the sensor task before its next conversion
+    requestTemperatureSample();
+}
+
+bool getTemperatureSensorAddress(TemperatureChannel channel, char hex[17])
+{
+    if (channel >= TEMP_CHANNEL_COUNT)
+    {
+        return false;
+    }
+    DeviceAddress address;
+    portENTER_CRITICAL(&channelMapMux);
+    bool present = channelPresent[channel];
+    memcpy(address, channelAddress[channel], sizeof(address));
+    portEXIT_CRITICAL(&channelMapMux);
+    if (!present)
+    {
+        return false;
+    }
+    formatSensorAddress(address, hex);
     return true;
 }
 
+bool parseTemperatureSensorAddress(const char *hex, uint8_t address[8])
+{
+    if (strlen(hex) != 16)
+    {
+        return false;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        if (!isxdigit((unsigned char)hex[2 * i]) || !isxdigit((unsigned char)hex[2 * i + 1]))
+        {
+            return false;
+        }
+        char byteHex[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+        address[i] = (uint8_t)strtoul(byteHex, NULL, 16);
+    }
+    return OneWire::crc8(address, 7) == address[7];
+}
+
+void requestTemperatureSample()
+{
+    if (sampleRequestSemaphore != NULL)
+    {
+        xSemaphoreGive(sampleRequestSemaphore);
+    }
+}
+
+// Writer side of the seqlock. The critical section keeps the update from being
+// preempted, so on the single-core ESP32-C3 readers never observe a write in
+// progress and their retry loop never spins.
+static void storeSample(int channel, const TemperatureSample &sample)
+{
+    SampleSlot &slot = sampleSlots[channel];
+    portENTER_CRITICAL(&sampleSlotMux);
+    uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.sample = sample;
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    portEXIT_CRITICAL(&sampleSlotMux);
+}
+
+// Reader side of the seqlock: retries only if a write overlapped the copy
+static TemperatureSample loadSample(int channel)
+{
+    const SampleSlot &slot = sampleSlots[channel];
+    TemperatureSample sample;
+    uint32_t before;
+    uint32_t after;
+    do
+    {
+        before = slot.sequence.load(std::memory_order_acquire);
+        sample = slot.sample;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = slot.sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return sample;
+}
+
+// Reads a scratchpad by address and converts it, rejecting CRC failures and
+// implausible values. Returns 0 on success or a TEMP_QUALITY_* error bit.
+static uint8_t readChannel(int channel, float &temperature)
+{
+    ScratchPad scratchPad;
+    if (!sensors.readScratchPad(channelAddress[channel], scratchPad))
+    {
+        return TEMP_QUALITY_DISCONNECTED;
+    }
+    if (OneWire::crc8(scratchPad, 8) != scratchPad[8])
+    {
+        return TEMP_QUALITY_CRC_ERROR;
+    }
+
+    int16_t raw = (int16_t)((scratchPad[1] << 8) | scratchPad[0]);
+    raw &= ~((1 << (12 - sensorResolution)) - 1); // Low bits are undefined below 12-bit resolution
+    temperature = raw * 0.0625f + channelOffset[channel];
+
+    // 85 °C is what the scratchpad holds after a power glitch, before any conversion
+    const TemperatureSample &lastGood = channelFilters[channel].lastGood;
+    if (raw == DS18B20_POWER_ON_RAW &&
+        (!(lastGood.quality & TEMP_QUALITY_VALID) || fabsf(temperature - lastGood.value) > DS18B20_POWER_ON_MAX_JUMP))
+    {
+        return TEMP_QUALITY_IMPLAUSIBLE;
+    }
+    if (temperature < TEMPERATURE_MIN_PLAUSIBLE || temperature > TEMPERATURE_MAX_PLAUSIBLE)
+    {
+        return TEMP_QUALITY_IMPLAUSIBLE;
+    }
+    return 0;
+}
+
+static float medianOfWindow(const ChannelFilter &filter)
+{
+    float sorted[TEMPERATURE_MEDIAN_WINDOW];
+    for (int i = 0; i < filter.count; i++)
+    {
+        // Insertion sort, tiny window
+        int j = i;
+        while (j > 0 && sorted[j - 1] > filter.window[i])
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = filter.window[i];
+    }
+    return sorted[filter.count / 2];
+}
+
+// Median + EMA stage. A rejected read holds the last good sample (keeping its
+// timestamp) for a few periods; persistent failures report the channel as failed.
+static TemperatureSample filterChannel(int channel, uint8_t readStatus, float temperature, uint32_t now, float &median)
+{
+    ChannelFilter &filter = channelFilters[channel];
+    if (readStatus != 0)
+    {
+        if (filter.rejectedCount < UINT8_MAX)
+        {
+            filter.rejectedCount++;
+        }
+        if ((filter.lastGood.quality & TEMP_QUALITY_VALID) && filter.rejectedCount <= TEMPERATURE_MAX_HELD_SAMPLES)
+        {
+            TemperatureSample held = filter.lastGood;
+            held.quality |= TEMP_QUALITY_HELD | readStatus;
+            return held;
+        }
+        // Restart the filter so recovery does not blend in stale values
+        filter.count = 0;
+        filter.next = 0;
+        filter.lastGood.quality = 0;
+        return {(float)DEVICE_DISCONNECTED_C, now, readStatus};
+    }
+
+    filter.rejectedCount = 0;
+    filter.window[filter.next] = temperature;
+    filter.next = (filter.next + 1) % TEMPERATURE_MEDIAN_WINDOW;
+    if (filter.count < TEMPERATURE_MEDIAN_WINDOW)
+    {
+        filter.count++;
+    }
+    median = medianOfWindow(filter);
+    filter.ema = (filter.lastGood.quality & TEMP_QUALITY_VALID)
+                     ? filter.ema + TEMPERATURE_EMA_ALPHA * (median - filter.ema)
+                     : median;
+    filter.lastGood = {filter.ema, now, TEMP_QUALITY_VALID};
+    return filter.lastGood;
+}
+
+// Audible alarm for a failed control sensor: at most 3 beeps, 1 per minute,
+// re-armed after 5 minutes without errors. Runs here so readers never block on it.
+static void updateSensorErrorAlarm(bool sensorError)
+{
+    static uint32_t lastBuzzerErrorTime = 0;
+    static int errorBuzzCount = 0;
+
+    uint32_t now = millis();
+    if (sensorError)
+    {
+        if (errorBuzzCount < 3 && (now - lastBuzzerErrorTime > 60000 || lastBuzzerErrorTime == 0))
+        {
+            digitalWrite(BUZZER_PIN, HIGH);
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            digitalWrite(BUZZER_PIN, LOW);
+            errorBuzzCount++;
+            lastBuzzerErrorTime = now;
+        }
+    }
+    else if (errorBuzzCount > 0 && (now - lastBuzzerErrorTime > 300000))
+    {
+        // If 5 minutes have passed without error, reset the counter
+        errorBuzzCount = 0;
+        lastBuzzerErrorTime = 0;
+    }
+}
+
 void temperatureSensorTask(void *pvParameters)
 {
     static float lastLoggedTemp = -999.0f;
     const float TEMP_CHANGE_THRESHOLD = 0.5f;
 
+    MqttReportChannel reportChannels[TEMP_CHANNEL_COUNT];
+    for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+    {
+        mqttInitReportChannel(reportChannels[c], TEMPERATURE_REPORT_POLICY);
+    }
+
     while (true)
     {
+        TickType_t cycleStart = xTaskGetTickCount();
+
+        if (channelReloadRequested)
+        {
+            channelReloadRequested = false;
+            sensors.begin(); // Re-enumerates the bus and resets the library's async/resolution state
+            discoverSensors();
+            sensors.setWaitForConversion(false);
+            sensors.setResolution(sensorResolution);
+            memset(channelFilters, 0, sizeof(channelFilters)); // A channel may now be another probe
+            for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+            {
+                storeSample(c, {(float)DEVICE_DISCONNECTED_C, (uint32_t)millis(), TEMP_QUALITY_DISCONNECTED});
+            }
+        }
+
+        if (requestedResolution != sensorResolution)
+        {
+            sensorResolution = requestedResolution;
+            sensors.setResolution(sensorResolution);
+            Log::info("DS18B20 resolution set to %u bits.", sensorResolution);
+        }
+
+        // Start the conversion on all sensors at once and block (not spin) until the
+        // scratchpads are ready: 94 ms at 9 bits up to 750 ms at 12 bits
         sensors.requestTemperatures();
-        float temp = sensors.getTempCByIndex(0);
-        if (xSemaphoreTake(temperatureMutex, pdMS_TO_TICKS(10)) == pdTRUE)
+        vTaskDelay(pdMS_TO_TICKS(sensors.millisToWaitForConversion(sensorResolution)));
+
+        // Read by cached ROM address (no bus search), filter and publish each channel
+        uint32_t sampleMs = millis();
+        TemperatureChannel controlChannel = getControlChannel();
+        float readings[TEMP_CHANNEL_COUNT];
+        uint8_t qualities[TEMP_CHANNEL_COUNT];
+        for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
         {
-            latestTemperature = temp;
-            xSemaphoreGive(temperatureMutex);
+            readings[c] = DEVICE_DISCONNECTED_C;
+            qualities[c] = TEMP_QUALITY_DISCONNECTED;
+            if (!channelPresent[c])
+            {
+                continue;
+            }
+
+            float raw = 0.0f;
+            float median = 0.0f;
+            uint8_t readStatus = readChannel(c, raw);
+            if (readStatus != 0 && channelFilters[c].lastReadStatus == 0)
+            {
+                Log::warn("DS18B20 %s read rejected (quality 0x%02X)", CHANNEL_NAMES[c], readStatus);
+            }
+            channelFilters[c].lastReadStatus = readStatus;
+
+            TemperatureSample sample = filterChannel(c, readStatus, raw, sampleMs, median);
+            storeSample(c, sample);
+            qualities[c] = sample.quality;
+            if (sample.quality & TEMP_QUALITY_VALID)
+            {
+                readings[c] = sample.value;
+            }
+            if (c == controlChannel)
+            {
+                if (readStatus == 0)
+                {
+                    // Slope estimator gets the median (spike-free, no EMA lag)
+                    recordTemperatureSample(median, sampleMs);
+                }
+            }
         }
 
+        float temp = readings[controlChannel];
+        recordTemperatureHistory(temp, sampleMs);
+        notifyDisplayUpdate(DISPLAY_UPDATE_TEMPERATURE);
+        updateSensorErrorAlarm(temp == -127.0f);
+
         if (temp == -127.0f)
         {
             // Sensor error - log it prominently
@@ -78,66 +664,89 @@ void temperatureSensorTask(void *pvParameters)
                 lastLoggedTemp = temp;
             }
         }
-        else if (abs(temp - lastLoggedTemp) >= TEMP_CHANGE_THRESHOLD)
+        else
         {
-            Log::info("Temperature: %.2f°C", temp);
-            lastLoggedTemp = temp;
+            if (abs(temp - lastLoggedTemp) >= TEMP_CHANGE_THRESHOLD)
+            {
+                Log::info("Temperature: %.2f°C", temp);
+                lastLoggedTemp = temp;
+            }
         }
 
-        // Publish temperature via MQTT if connected (including errors to notify backend)
+        // Publish temperature via MQTT if connected and any channel changed significantly
+        // (including errors to notify backend)
         SystemState currentState = getSystemState();
-        if (currentState == SYSTEM_STATE_CONNECTED_MQTT)
+        bool reportDue = false;
+        for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+        {
+            if (channelPresent[c] && mqttReportDue(reportChannels[c], readings[c], qualities[c], sampleMs))
+            {
+                reportDue = true;
+            }
+        }
+        if (reportDue)
         {
             // Construct topic: mica/dev/telemetry/recirculator/{deviceId}/temperature
             char topic[128];
             snprintf(topic, sizeof(topic), "mica/dev/telemetry/recirculator/%s/temperature", getDeviceId());
             
             // Construct JSON payload
-            DynamicJsonDocument doc(128);
+            DynamicJsonDocument doc(256);
             doc["deviceId"] = getDeviceId();
             doc["temperature"] = temp;
+            doc["controlChannel"] = CHANNEL_NAMES[controlChannel];
+            doc["quality"] = qualities[controlChannel];
+            JsonObject channels = doc.createNestedObject("channels");
+            for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+            {
+                if (channelPresent[c])
+                {
+                    channels[CHANNEL_NAMES[c]] = readings[c];
+                }
+            }
             doc["uptime"] = millis();
             String jsonString;
             serializeJson(doc, jsonString);
             
-            // Publish using generic MQTT function
-            mqttPublish(topic, jsonString.c_str(), true); // retain = true
+            // Local WebSocket clients get it even without the cloud
+            localApiBroadcast("temperature", jsonString.c_str());
+
+            // Publish using generic MQTT function; a dropped message is retried next sample
+            if (currentState == SYSTEM_STATE_CONNECTED_MQTT && mqttPublish(topic, jsonString.c_str(), true)) // retain = true
+            {
+                for (int c = 0; c < TEMP_CHANNEL_COUNT; c++)
+                {
+                    mqttReportSent(reportChannels[c], readings[c], qualities[c], sampleMs);
+                }
+            }
         }
 
-        vTaskDelay(pdMS_TO_TICKS(TEMPERATURE_READ_INTERVAL));
+        // Adaptive rate: fresh data while the pump runs, low bus/CPU time when idle.
+        // An activation wakes the task early through requestTemperatureSample().
+        uint32_t interval = isRelayActive() ? TEMPERATURE_ACTIVE_INTERVAL : TEMPERATURE_IDLE_INTERVAL;
+        TickType_t elapsed = xTaskGetTickCount() - cycleStart;
+        TickType_t wait = (pdMS_TO_TICKS(interval) > elapsed) ? pdMS_TO_TICKS(interval) - elapsed : 0;
+        xSemaphoreTake(sampleRequestSemaphore, wait);
     }
 }
 
-float getLatestTemperature()
+bool getTemperatureSample(TemperatureChannel channel, TemperatureSample &sample)
 {
-    static uint32_t lastBuzzerErrorTime = 0;
-    static int errorBuzzCount = 0;
-    float temp = 0.0f;
-
-    // Read temperature in a thread-safe manner
-    if (xSemaphoreTake(temperatureMutex, pdMS_TO_TICKS(10)) == pdTRUE)
+    if (channel >= TEMP_CHANNEL_COUNT)
     {
-        temp = latestTemperature;
-        if (temp == -127.0f)
-        {
-            uint32_t now = millis();
-            if (errorBuzzCount < 3 && (now - lastBuzzerErrorTime > 60000 || lastBuzzerErrorTime == 0))
-            {
-                digitalWrite(BUZZER_PIN, HIGH);
-                vTaskDelay(pdMS_TO_TICKS(1000));
-                digitalWrite(BUZZER_PIN, LOW);
-                errorBuzzCount++;
-                lastBuzzerErrorTime = now;
-            }
-        }
-        else if (errorBuzzCount > 0 && (millis() - lastBuzzerErrorTime > 300000))
-        {
-            // If 5 minutes have passed without error, reset the counter
-            errorBuzzCount = 0;
-            lastBuzzerErrorTime = 0;
-        }
-        xSemaphoreGive(temperatureMutex);
+        return false;
     }
+    sample = loadSample(channel);
+    return (sample.quality & TEMP_QUALITY_VALID) != 0;
+}
+
+float getChannelTemperature(TemperatureChannel channel)
+{
+    TemperatureSample sample;
+    return getTemperatureSample(channel, sample) ? sample.value : DEVICE_DISCONNECTED_C;
+}
 
-    return temp;
-}
\ No newline at end of file
+float getLatestTemperature()
+{
+    return getChannelTemperature(getControlChannel());
+}
@@ -3,7 +3,44 @@
 
 // Temperature Sensor Module
 // Purpose:
-// Handles the reading and processing of data from the temperature sensor.
+// Handles the reading and processing of data from the DS18B20 sensors on the 1-Wire bus.
+// Up to three sensors map to fixed channels (outlet, return line, tank).
+
+#include <stdint.h>
+
+#define TEMPERATURE_DEFAULT_RESOLUTION 12 // DS18B20 resolution in bits (9-12)
+#define TEMPERATURE_MAX_OFFSET 10.0f      // Largest calibration offset accepted, in °C
+
+// Sample quality flags
+#define TEMP_QUALITY_VALID 0x01        // Value is a filtered measurement
+#define TEMP_QUALITY_CRC_ERROR 0x02    // Last scratchpad read failed its CRC
+#define TEMP_QUALITY_IMPLAUSIBLE 0x04  // Last reading rejected (out of range or 85 °C reset value)
+#define TEMP_QUALITY_DISCONNECTED 0x08 // Sensor did not answer
+#define TEMP_QUALITY_HELD 0x10         // Last good value held after a rejected read
+
+/**
+ * @brief Latest filtered sample of a channel.
+ */
+struct TemperatureSample
+{
+    float value;          // °C (median + EMA filtered), -127.0 when not valid
+    uint32_t timestampMs; // millis() of the measurement (unchanged while held)
+    uint8_t quality;      // TEMP_QUALITY_* flags
+};
+
+/**
+ * @brief Logical sensor positions on the recirculation loop.
+ * @note Channels follow the ROM addresses assigned in the config document ("sensors"). Unassigned
+ *       probes fill the free channels in bus order (cached in NVS) and never replace the outlet
+ *       as control channel.
+ */
+enum TemperatureChannel : uint8_t
+{
+    TEMP_CHANNEL_OUTLET = 0, // Heater outlet
+    TEMP_CHANNEL_RETURN,     // Return line (stop signal once assigned)
+    TEMP_CHANNEL_TANK,       // Tank
+    TEMP_CHANNEL_COUNT
+};
 
 /**
  * @brief Initializes the temperature sensor (configura el pin, crea la cua, etc).
@@ -13,16 +50,94 @@ bool initializeTemperatureSensor();
 
 /**
  * @brief FreeRTOS task to process temperature readings.
- * - Reads temperature values at regular intervals.
- * - Buffers and sends temperature data to AWS IoT via MQTT.
+ * - Reads temperature values with async conversion: 1 Hz while the relay is active, 0.1 Hz when idle.
+ * - Sends temperature data to AWS IoT via MQTT by exception (deadband, quality change, heartbeat).
  */
 void temperatureSensorTask(void *pvParameters);
 
 /**
- * @brief Get the latest temperature value (thread-safe).
+ * @brief Sets the DS18B20 conversion resolution (not persisted; the stored value comes from the
+ * config document's temperatureResolution and is loaded at boot).
+ * @param bits Resolution in bits: 9 (0.5 °C, 94 ms) to 12 (0.0625 °C, 750 ms)
+ * @return true if the value is valid, false otherwise
+ * @note Applied by the sensor task before its next conversion
+ */
+bool setTemperatureResolution(uint8_t bits);
+
+/**
+ * @brief Sets and persists the calibration offset for a channel.
+ * @param channel Sensor channel
+ * @param offset Offset in °C added to raw readings (-10 to 10)
+ * @return true if saved successfully, false otherwise
+ */
+bool setTemperatureOffset(TemperatureChannel channel, float offset);
+
+/**
+ * @brief Re-reads all calibration offsets from the config store.
+ * @note Call after the offsets were changed through editConfig()
+ */
+void reloadTemperatureOffsets();
+
+/**
+ * @brief Returns the short name of a channel ("outlet", "return", "tank").
+ */
+const char *getTemperatureChannelName(TemperatureChannel channel);
+
+/**
+ * @brief Checks whether a sensor was discovered for a channel.
+ */
+bool isTemperatureChannelPresent(TemperatureChannel channel);
+
+/**
+ * @brief Returns the channel used for pump control: the return line if its probe was assigned
+ * explicitly and found, else the outlet.
+ */
+TemperatureChannel getControlChannel();
+
+/**
+ * @brief Re-maps the channels after the ROM assignment changed through editConfig().
+ * @note Applied by the sensor task before its next conversion; filters restart from scratch
+ */
+void reloadTemperatureChannels();
+
+/**
+ * @brief Formats the ROM address mapped to a channel as 16 uppercase hex characters.
+ * @return true if a sensor is mapped to the channel
+ */
+bool getTemperatureSensorAddress(TemperatureChannel channel, char hex[17]);
+
+/**
+ * @brief Parses a 16 hex character DS18B20 ROM address and checks its CRC.
+ * @return true if the address is well formed
+ */
+bool parseTemperatureSensorAddress(const char *hex, uint8_t address[8]);
+
+/**
+ * @brief Get the latest filtered sample of a channel.
+ * @param channel Sensor channel
+ * @param sample Receives value, timestamp and quality flags
+ * @return true if the sample carries TEMP_QUALITY_VALID
+ * @note Lock-free and non-blocking; safe from any task
+ */
+bool getTemperatureSample(TemperatureChannel channel, TemperatureSample &sample);
+
+/**
+ * @brief Get the latest calibrated temperature of a channel (lock-free).
+ * @param channel Sensor channel
+ * @return float Temperature in Celsius, or -127.0 if missing or in error
+ */
+float getChannelTemperature(TemperatureChannel channel);
+
+/**
+ * @brief Wakes the sensor task to take a sample now instead of waiting for the idle interval.
+ * @note Thread-safe: Can be called from any task
+ */
+void requestTemperatureSample();
+
+/**
+ * @brief Get the latest temperature of the control channel (thread-safe).
  * @return float Temperature in Celsius, or -127.0 if sensor error
- * @note Thread-safe: Uses temperatureMutex for protected access
- * @note Triggers buzzer alarm on first 3 sensor errors (max 1 per minute)
+ * @note Lock-free and non-blocking; never returns a fabricated value
  * @warning -127.0 indicates DS18B20 sensor disconnected or failed
  */
 float getLatestTemperature();
@@ -0,0 +1,253 @@
+// cycle_log.cpp
+// Cycle Log Module
+// Purpose: Persists every pump cycle and aggregates them on-device
+// Architecture: Fixed-size records appended to a LittleFS file, rotated into a single .old file.
+//               Records are queued by the relay path and written by cycleLogWriterTask, so a slow
+//               flash write never delays relay control or state handling.
+// Thread-Safety: cycleLogQueue hands records to the writer task; cycleLogMutex serializes file
+//                access (writer task appends, MQTT task reads)
+// Dependencies: LittleFS, mqtt_handler, device_id, UtcClock (via system_state)
+
+#include "cycle_log.h"
+
+// Project headers (alphabetically)
+#include "device_id.h"
+#include "mqtt_handler.h"
+#include "system_state.h"
+
+// Third-party libraries
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include <Log.h>
+
+// System headers
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <string.h>
+
+#define CYCLE_LOG_FILE "/cycles.log"
+#define CYCLE_LOG_OLD_FILE "/cycles.old"
+#define TREND_WEEKS 4                 // Weekly time-to-temperature trend length
+#define SECONDS_PER_DAY 86400UL
+#define CYCLE_LOG_QUEUE_LENGTH 8      // Records waiting for the writer task
+
+// Aggregates for one time window
+typedef struct {
+    uint32_t cycles;
+    uint32_t timeouts;
+    uint32_t temperatureStops;
+    uint32_t timeToTemperatureSum;  // Seconds, temperature stops only
+    uint32_t energyCentiWh;
+} CycleRollup;
+
+// Internal Variables
+static SemaphoreHandle_t cycleLogMutex = NULL;
+static QueueHandle_t cycleLogQueue = NULL;
+static uint32_t currentFileRecords = 0;
+static bool fsMounted = false;
+
+// Internal Function Declarations
+static void handleCycleSummaryCommand(const char* topic, const char* payload, unsigned int length);
+static bool writeCycleRecord(const CycleRecord &record);
+static void accumulateFile(const char* path, uint32_t nowUtc, CycleRollup &day, CycleRollup &week,
+                           CycleRollup trend[TREND_WEEKS]);
+static void addToRollup(CycleRollup &rollup, const CycleRecord &record);
+static void rollupToJson(JsonObject obj, const CycleRollup &rollup);
+
+bool initializeCycleLog() {
+    cycleLogMutex = xSemaphoreCreateMutex();
+    if (cycleLogMutex == NULL) {
+        Log::error("Failed to create cycle log mutex.");
+        return false;
+    }
+    cycleLogQueue = xQueueCreate(CYCLE_LOG_QUEUE_LENGTH, sizeof(CycleRecord));
+    if (cycleLogQueue == NULL) {
+        Log::error("Failed to create cycle log queue.");
+        return false;
+    }
+
+    // Format on first use: the partition ships empty
+    if (!LittleFS.begin(true)) {
+        Log::error("Failed to mount LittleFS. Cycle history disabled.");
+        return true; // Non-critical: the pump works without history
+    }
+    fsMounted = true;
+
+    File file = LittleFS.open(CYCLE_LOG_FILE, "r");
+    if (file) {
+        currentFileRecords = file.size() / sizeof(CycleRecord);
+        file.close();
+    }
+    Log::info("Cycle log ready (%lu records in current file).", currentFileRecords);
+    return true;
+}
+
+void initializeCycleLogCommands() {
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/command/recirculator/%s/cycle-summary", getDeviceId().c_str());
+    mqttSubscribe(topic, handleCycleSummaryCommand);
+}
+
+CycleStopReason cycleStopReasonFromString(const char* reason) {
+    if (strcmp(reason, "timeout") == 0) return CYCLE_STOP_TIMEOUT;
+    if (strcmp(reason, "temperature") == 0) return CYCLE_STOP_TEMPERATURE;
+    if (strcmp(reason, "button") == 0) return CYCLE_STOP_BUTTON;
+    if (strcmp(reason, "command") == 0) return CYCLE_STOP_COMMAND;
+    if (strcmp(reason, "manual") == 0) return CYCLE_STOP_MANUAL;
+    return CYCLE_STOP_OTHER;
+}
+
+bool appendCycleRecord(const CycleRecord &record) {
+    if (!fsMounted) return false;
+
+    if (xQueueSend(cycleLogQueue, &record, 0) != pdTRUE) {
+        Log::error("Cycle log queue full, dropping cycle record.");
+        return false;
+    }
+    return true;
+}
+
+void cycleLogWriterTask(void *pvParameters) {
+    CycleRecord record;
+    while (true) {
+        if (xQueueReceive(cycleLogQueue, &record, portMAX_DELAY) == pdTRUE) {
+            writeCycleRecord(record);
+        }
+    }
+}
+
+bool publishCycleSummary() {
+    if (!fsMounted) return false;
+
+    UtcClock &clock = getUtcClock();
+    if (!clock.isTimeValid()) {
+        Log::warn("Cycle summary requested before NTP sync.");
+        return false;
+    }
+    uint32_t nowUtc = (uint32_t)(clock.getTime(0) / 1000ULL);
+
+    CycleRollup day = {};
+    CycleRollup week = {};
+    CycleRollup trend[TREND_WEEKS] = {};
+
+    if (xSemaphoreTake(cycleLogMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        Log::error("Could not acquire cycle log mutex.");
+        return false;
+    }
+    accumulateFile(CYCLE_LOG_OLD_FILE, nowUtc, day, week, trend);
+    accumulateFile(CYCLE_LOG_FILE, nowUtc, day, week, trend);
+    xSemaphoreGive(cycleLogMutex);
+
+    DynamicJsonDocument doc(768);
+    doc["deviceId"] = getDeviceId();
+    rollupToJson(doc.createNestedObject("day"), day);
+    rollupToJson(doc.createNestedObject("week"), week);
+
+    // Mean time-to-temperature per week, most recent first: a rising trend
+    // points at a degrading heater or pump
+    JsonArray trendArray = doc.createNestedArray("timeToTemperatureTrend");
+    for (int i = 0; i < TREND_WEEKS; i++) {
+        if (trend[i].temperatureStops > 0) {
+            trendArray.add((float)trend[i].timeToTemperatureSum / trend[i].temperatureStops);
+        } else {
+            trendArray.add(nullptr);
+        }
+    }
+    doc["timestamp"] = nowUtc;
+
+    char payload[MQTT_PAYLOAD_MAX_LENGTH];
+    serializeJson(doc, payload, sizeof(payload));
+
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/telemetry/recirculator/%s/cycle-summary", getDeviceId().c_str());
+    return mqttPublish(topic, payload, false); // retain = false
+}
+
+static void handleCycleSummaryCommand(const char* topic, const char* payload, unsigned int length) {
+    Log::info("Cycle summary requested via MQTT.");
+    if (!publishCycleSummary()) {
+        Log::error("Failed to publish cycle summary.");
+    }
+}
+
+/** @brief Streams one log file and adds its records to the rollups. Caller holds cycleLogMutex. */
+static void accumulateFile(const char* path, uint32_t nowUtc, CycleRollup &day, CycleRollup &week,
+                           CycleRollup trend[TREND_WEEKS]) {
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        return;
+    }
+
+    CycleRecord records[32]; // Read in 448-byte chunks
+    size_t bytesRead;
+    while ((bytesRead = file.read((uint8_t*)records, sizeof(records))) >= sizeof(CycleRecord)) {
+        size_t count = bytesRead / sizeof(CycleRecord);
+        for (size_t i = 0; i < count; i++) {
+            const CycleRecord &record = records[i];
+            if (record.startUtc == 0 || record.startUtc > nowUtc) {
+                continue; // No valid timestamp
+            }
+            uint32_t age = nowUtc - record.startUtc;
+            if (age < SECONDS_PER_DAY) addToRollup(day, record);
+            if (age < 7 * SECONDS_PER_DAY) addToRollup(week, record);
+            uint32_t weekIndex = age / (7 * SECONDS_PER_DAY);
+            if (weekIndex < TREND_WEEKS) addToRollup(trend[weekIndex], record);
+        }
+    }
+    file.close();
+}
+
+static void addToRollup(CycleRollup &rollup, const CycleRecord &record) {
+    rollup.cycles++;
+    rollup.energyCentiWh += record.energyCentiWh;
+    if (record.stopReason == CYCLE_STOP_TIMEOUT) {
+        rollup.timeouts++;
+    } else if (record.stopReason == CYCLE_STOP_TEMPERATURE) {
+        rollup.temperatureStops++;
+        rollup.timeToTemperatureSum += record.durationSeconds;
+    }
+}
+
+static void rollupToJson(JsonObject obj, const CycleRollup &rollup) {
+    obj["cycles"] = rollup.cycles;
+    obj["timeouts"] = rollup.timeouts;
+    obj["timeoutRatio"] = rollup.cycles > 0 ? (float)rollup.timeouts / rollup.cycles : 0.0f;
+    if (rollup.temperatureStops > 0) {
+        obj["meanTimeToTemperature"] = (float)rollup.timeToTemperatureSum / rollup.temperatureStops;
+    }
+    obj["energyWh"] = rollup.energyCentiWh / 100.0f;
+}
+
+/** @brief Appends one record to the current file, rotating it when full. Runs in the writer task. */
+static bool writeCycleRecord(const CycleRecord &record) {
+    if (xSemaphoreTake(cycleLogMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        Log::error("Could not acquire cycle log mutex.");
+        return false;
+    }
+
+    // Rotate: keep exactly one previous file so flash usage is bounded
+    if (currentFileRecords >= CYCLE_LOG_MAX_RECORDS) {
+        LittleFS.remove(CYCLE_LOG_OLD_FILE);
+        LittleFS.rename(CYCLE_LOG_FILE, CYCLE_LOG_OLD_FILE);
+        currentFileRecords = 0;
+        Log::info("Cycle log rotated.");
+    }
+
+    bool ok = false;
+    File file = LittleFS.open(CYCLE_LOG_FILE, "a");
+    if (file) {
+        ok = file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+        file.close();
+    }
+    if (ok) {
+        currentFileRecords++;
+    } else {
+        Log::error("Failed to append cycle record.");
+    }
+
+    xSemaphoreGive(cycleLogMutex);
+    return ok;
+}
@@ -0,0 +1,77 @@
+// cycle_log.h
+#ifndef CYCLE_LOG_H
+#define CYCLE_LOG_H
+
+#include <stdint.h>
+
+// Cycle Log Module
+// Purpose:
+// Append-only flash log of pump cycles (start time, duration, temperatures, stop reason, energy)
+// with on-device rollups served over MQTT, so the backend doesn't need the raw streams.
+
+#define CYCLE_LOG_MAX_RECORDS 4096  // Records per file before rotating (~56 KB)
+
+/**
+ * @brief Stop reasons as stored in flash (one byte).
+ */
+typedef enum {
+    CYCLE_STOP_TIMEOUT = 0,
+    CYCLE_STOP_TEMPERATURE,
+    CYCLE_STOP_BUTTON,
+    CYCLE_STOP_COMMAND,
+    CYCLE_STOP_MANUAL,
+    CYCLE_STOP_OTHER
+} CycleStopReason;
+
+#define CYCLE_FLAG_PREDICTED 0x01   // Stopped by the slope projection
+#define CYCLE_FLAG_SCHEDULED 0x02   // Started by the recirculation scheduler
+
+/**
+ * @brief One pump cycle as stored in flash (14 bytes).
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t startUtc;          // Unix seconds, 0 if NTP was not synchronized
+    uint16_t durationSeconds;   // Pump run time
+    int16_t startTempCenti;     // Start temperature (0.01 °C)
+    int16_t endTempCenti;       // End temperature (0.01 °C)
+    uint16_t energyCentiWh;     // Estimated energy (0.01 Wh)
+    uint8_t stopReason;         // CycleStopReason
+    uint8_t flags;              // CYCLE_FLAG_*
+} CycleRecord;
+
+/**
+ * @brief Mounts the filesystem and counts existing records.
+ * @return true if initialization is successful, false otherwise.
+ */
+bool initializeCycleLog();
+
+/**
+ * @brief Registers the cycle-summary MQTT command. Must be called after MQTT connects.
+ */
+void initializeCycleLogCommands();
+
+/**
+ * @brief Maps a deactivateRelay() reason string to its stored code.
+ */
+CycleStopReason cycleStopReasonFromString(const char* reason);
+
+/**
+ * @brief Queues a cycle record for cycleLogWriterTask to append to flash.
+ * @param record Record to append
+ * @return true if queued, false if the log is unavailable or the queue is full
+ * @note Thread-safe and non-blocking; safe on the relay control path
+ */
+bool appendCycleRecord(const CycleRecord &record);
+
+/**
+ * @brief FreeRTOS task that appends queued cycle records to flash.
+ */
+void cycleLogWriterTask(void *pvParameters);
+
+/**
+ * @brief Computes daily/weekly rollups and publishes them on the cycle-summary topic.
+ * @return true if the summary was queued for publishing
+ */
+bool publishCycleSummary();
+
+#endif // CYCLE_LOG_H
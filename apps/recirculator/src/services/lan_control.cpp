@@ -0,0 +1,314 @@
+// lan_control.cpp
+// LAN Control Module
+// Purpose: mDNS announcement and authenticated UDP commands on the local network
+// Architecture: AsyncUDP listener on LAN_CONTROL_PORT. A verified request is queued and
+//               lanControlTask maps it onto its MQTT command topic and runs it through
+//               mqttDispatchCommand(), so the handlers, validation and reported topics are shared with
+//               the cloud path. Handlers never run on the small AsyncUDP task stack.
+//               Datagrams (lan_frame) are signed with a dedicated LAN key, provisioned over MQTT only
+//               and never sent over HTTP like the local API token, and bound to a boot nonce; a
+//               sliding sequence window rejects replays. OTA and the commands carrying secrets
+//               (local-api, lan-control, wifi-profile) are not reachable.
+// Thread-Safety: Packets are handled one at a time in the AsyncUDP task; the replay window is only
+//                touched there. lanControlTask owns its request buffer; the queue copies between them.
+//                The key is copied under keyMux. Handlers are serialized with the MQTT task by mqtt_handler.
+// Dependencies: AsyncUDP, ESPmDNS, Preferences, ArduinoJson, FreeRTOS queues, lan_frame, mqtt_handler,
+//               device_id
+
+#include "lan_control.h"
+
+// Project headers (alphabetically)
+#include "config.h"
+#include "device_id.h"
+#include "lan_frame.h"
+#include "mqtt_handler.h"
+
+// Third-party libraries
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <AsyncUDP.h>
+#include <ESPmDNS.h>
+#include <Log.h>
+#include <Preferences.h>
+
+// System headers
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <string.h>
+
+#define LAN_CONTROL_REPLAY_WINDOW 64
+#define LAN_CONTROL_QUEUE_LENGTH 4      // Requests waiting for the dispatch task; more get ERR busy
+
+// A verified request waiting for lanControlTask
+typedef struct {
+    char command[LAN_FRAME_MAX_FIELD + 1];
+    char payload[LAN_FRAME_MAX_LENGTH + 1];     // NUL-terminated
+    size_t payloadLength;
+    uint32_t sequence;
+    IPAddress address;
+    uint16_t port;
+} LanRequest;
+
+// Internal Variables
+static AsyncUDP lanSocket;
+static QueueHandle_t lanRequestQueue = NULL;
+static char bootNonce[LAN_FRAME_NONCE_LENGTH + 1] = "";
+static uint32_t highestSequence = 0;
+static uint64_t replayWindow = 0;       // Bit n set: highestSequence - n already seen
+static LanRequest pendingRequest;       // AsyncUDP task only, copied into the queue
+static uint8_t lanKey[LAN_FRAME_KEY_LENGTH];
+static bool lanKeySet = false;
+static portMUX_TYPE keyMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Internal Function Declarations
+static void handlePacket(AsyncUDPPacket &packet);
+static bool isValidCommand(const char *command);
+static bool acceptSequence(uint32_t sequence);
+static bool copyLanKey(uint8_t key[LAN_FRAME_KEY_LENGTH]);
+static void sendReply(const IPAddress &address, uint16_t port, uint32_t sequence, bool ok, const char *detail);
+static void handleLanControlCommand(const char* topic, const char* payload, unsigned int length);
+static void publishLanControlReported(const char *result, const char *error);
+
+bool initializeLanControl() {
+    snprintf(bootNonce, sizeof(bootNonce), "%08x", (unsigned int)esp_random());
+
+    Preferences prefs;
+    prefs.begin("lanctl", true);
+    uint8_t key[LAN_FRAME_KEY_LENGTH];
+    bool stored = prefs.getBytes("key", key, sizeof(key)) == sizeof(key);
+    prefs.end();
+    portENTER_CRITICAL(&keyMux);
+    memcpy(lanKey, key, sizeof(lanKey));
+    lanKeySet = stored;
+    portEXIT_CRITICAL(&keyMux);
+    memset(key, 0, sizeof(key));
+
+    lanRequestQueue = xQueueCreate(LAN_CONTROL_QUEUE_LENGTH, sizeof(LanRequest));
+    if (lanRequestQueue == NULL) {
+        Log::error("Failed to create LAN request queue.");
+        return false;
+    }
+
+    if (!lanSocket.listen(LAN_CONTROL_PORT)) {
+        Log::error("Failed to listen on UDP port %u.", LAN_CONTROL_PORT);
+        return false;
+    }
+    lanSocket.onPacket(handlePacket);
+
+    // mDNS answers on whichever interface is up (STA, or the AP in config mode)
+    String deviceId = getDeviceId();
+    String hostname = "mica-" + deviceId;
+    hostname.toLowerCase();
+    char udpPort[6];
+    snprintf(udpPort, sizeof(udpPort), "%u", LAN_CONTROL_PORT);
+    if (MDNS.begin(hostname.c_str())) {
+        MDNS.setInstanceName("MICA Recirculator " + deviceId);
+        MDNS.addService("mica", "tcp", LOCAL_API_PORT);
+        MDNS.addServiceTxt("mica", "tcp", "id", deviceId.c_str());
+        MDNS.addServiceTxt("mica", "tcp", "type", "recirculator");
+        MDNS.addServiceTxt("mica", "tcp", "udp", udpPort);
+        MDNS.addServiceTxt("mica", "tcp", "proto", "2");
+        MDNS.addServiceTxt("mica", "tcp", "nonce", bootNonce);
+    } else {
+        Log::warn("mDNS failed to start; LAN clients need the device address.");
+    }
+
+    Log::info("LAN control on UDP %u, mDNS %s.local (%s).", LAN_CONTROL_PORT, hostname.c_str(),
+              stored ? "key set" : "no key yet, disabled");
+    return true;
+}
+
+void initializeLanControlCommands() {
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/command/recirculator/%s/lan-control", getDeviceId().c_str());
+    mqttSubscribe(topic, handleLanControlCommand);
+}
+
+void publishLanControlState() {
+    publishLanControlReported("current", NULL);
+}
+
+void lanControlTask(void *pvParameters) {
+    static LanRequest request; // Too large for the stack; only this task uses it
+    char topic[128];
+    for (;;) {
+        if (xQueueReceive(lanRequestQueue, &request, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        snprintf(topic, sizeof(topic), "mica/dev/command/recirculator/%s/%s", getDeviceId().c_str(), request.command);
+        if (!mqttDispatchCommand(topic, request.payload, request.payloadLength)) {
+            sendReply(request.address, request.port, request.sequence, false, "unknown-command");
+            continue;
+        }
+        Log::info("LAN command %s from %s.", request.command, request.address.toString().c_str());
+        sendReply(request.address, request.port, request.sequence, true, "accepted");
+    }
+}
+
+/** @brief Parses and authenticates one request datagram, then queues it for lanControlTask. */
+static void handlePacket(AsyncUDPPacket &packet) {
+    LanFrame frame;
+    if (!lanFrameParse((const char*)packet.data(), packet.length(), frame)) {
+        return;
+    }
+
+    uint8_t key[LAN_FRAME_KEY_LENGTH];
+    if (!copyLanKey(key)) {
+        sendReply(packet.remoteIP(), packet.remotePort(), frame.sequence, false, "no key provisioned");
+        return;
+    }
+    bool authentic = lanFrameVerify(key, frame);
+    memset(key, 0, sizeof(key));
+    if (!authentic) {
+        Log::debug("LAN request with a bad MAC from %s ignored.", packet.remoteIP().toString().c_str());
+        return;
+    }
+    if (strcmp(frame.nonce, bootNonce) != 0) {
+        // The reply carries the current nonce
+        sendReply(packet.remoteIP(), packet.remotePort(), frame.sequence, false, "stale-nonce");
+        return;
+    }
+    if (!acceptSequence(frame.sequence)) {
+        char detail[24];
+        snprintf(detail, sizeof(detail), "replayed %lu", (unsigned long)highestSequence); // Lets the client resync
+        sendReply(packet.remoteIP(), packet.remotePort(), frame.sequence, false, detail);
+        return;
+    }
+    if (!isValidCommand(frame.field)) {
+        sendReply(packet.remoteIP(), packet.remotePort(), frame.sequence, false, "unknown-command");
+        return;
+    }
+
+    strcpy(pendingRequest.command, frame.field);
+    memcpy(pendingRequest.payload, frame.body, frame.bodyLength);
+    pendingRequest.payload[frame.bodyLength] = '\0';
+    pendingRequest.payloadLength = frame.bodyLength;
+    pendingRequest.sequence = frame.sequence;
+    pendingRequest.address = packet.remoteIP();
+    pendingRequest.port = packet.remotePort();
+    if (xQueueSend(lanRequestQueue, &pendingRequest, 0) != pdTRUE) {
+        sendReply(packet.remoteIP(), packet.remotePort(), frame.sequence, false, "busy");
+    }
+}
+
+/** @brief Lowercase letters, digits and dashes; commands carrying secrets stay cloud-only. */
+static bool isValidCommand(const char *command) {
+    for (const char *c = command; *c != '\0'; c++) {
+        if (!((*c >= 'a' && *c <= 'z') || (*c >= '0' && *c <= '9') || *c == '-')) {
+            return false;
+        }
+    }
+    return strcmp(command, "local-api") != 0 && strcmp(command, "lan-control") != 0 &&
+           strcmp(command, "wifi-profile") != 0;
+}
+
+/** @brief Sliding window anti-replay (as in IPsec/DTLS), for several clients sharing the key. */
+static bool acceptSequence(uint32_t sequence) {
+    if (sequence == 0) {
+        return false;
+    }
+    if (sequence > highestSequence) {
+        uint32_t shift = sequence - highestSequence;
+        replayWindow = (shift >= LAN_CONTROL_REPLAY_WINDOW) ? 0 : (replayWindow << shift);
+        replayWindow |= 1;
+        highestSequence = sequence;
+        return true;
+    }
+    uint32_t offset = highestSequence - sequence;
+    if (offset >= LAN_CONTROL_REPLAY_WINDOW || (replayWindow & (1ULL << offset))) {
+        return false;
+    }
+    replayWindow |= (1ULL << offset);
+    return true;
+}
+
+/** @brief Snapshot of the LAN key; false if none is provisioned. */
+static bool copyLanKey(uint8_t key[LAN_FRAME_KEY_LENGTH]) {
+    portENTER_CRITICAL(&keyMux);
+    bool set = lanKeySet;
+    memcpy(key, lanKey, LAN_FRAME_KEY_LENGTH);
+    portEXIT_CRITICAL(&keyMux);
+    return set;
+}
+
+/** @brief Signed reply with the current nonce; unsigned ("-") only when there is no key. */
+static void sendReply(const IPAddress &address, uint16_t port, uint32_t sequence, bool ok, const char *detail) {
+    uint8_t key[LAN_FRAME_KEY_LENGTH];
+    bool signReply = copyLanKey(key);
+    char reply[160];
+    int length = lanFrameBuild(signReply ? key : NULL, bootNonce, sequence, ok ? "OK" : "ERR", detail,
+                               strlen(detail), reply, sizeof(reply));
+    memset(key, 0, sizeof(key));
+    if (length > 0) {
+        lanSocket.writeTo((const uint8_t*)reply, length, address, port);
+    }
+}
+
+/**
+ * @brief Sets or clears the LAN key: {"key":"<64 hex characters>"} or {"key":""}.
+ * Only reachable from the cloud (TLS); the app fetches the same key from the backend.
+ */
+static void handleLanControlCommand(const char* topic, const char* payload, unsigned int length) {
+    StaticJsonDocument<160> doc;
+    DeserializationError err = deserializeJson(doc, payload, length);
+    if (err) {
+        Log::error("Failed to parse lan-control command: %s", err.c_str());
+        publishLanControlReported("rejected", err.c_str());
+        return;
+    }
+    if (!doc["key"].is<const char*>()) {
+        publishLanControlReported("rejected", "key missing");
+        return;
+    }
+    const char *hex = doc["key"];
+    uint8_t key[LAN_FRAME_KEY_LENGTH] = {0};
+    bool set = hex[0] != '\0';
+    if (set && !lanFrameParseKey(hex, key)) {
+        publishLanControlReported("rejected", "key must be 64 hex characters");
+        return;
+    }
+
+    Preferences prefs;
+    prefs.begin("lanctl", false);
+    bool stored;
+    if (set) {
+        stored = prefs.putBytes("key", key, sizeof(key)) == sizeof(key);
+    } else {
+        prefs.remove("key");
+        stored = !prefs.isKey("key");
+    }
+    prefs.end();
+    if (!stored) {
+        memset(key, 0, sizeof(key));
+        publishLanControlReported("rejected", "storage error");
+        return;
+    }
+
+    portENTER_CRITICAL(&keyMux);
+    memcpy(lanKey, key, sizeof(lanKey));
+    lanKeySet = set;
+    portEXIT_CRITICAL(&keyMux);
+    memset(key, 0, sizeof(key));
+    Log::info("LAN control key %s.", set ? "updated" : "cleared");
+    publishLanControlReported("applied", NULL);
+}
+
+/** @brief Retained endpoint description for the app; never includes the key. */
+static void publishLanControlReported(const char *result, const char *error) {
+    StaticJsonDocument<160> doc;
+    doc["port"] = LAN_CONTROL_PORT;
+    portENTER_CRITICAL(&keyMux);
+    bool set = lanKeySet;
+    portEXIT_CRITICAL(&keyMux);
+    doc["keySet"] = set;
+    doc["result"] = result;
+    if (error != NULL) {
+        doc["error"] = error;
+    }
+    char payload[160];
+    serializeJson(doc, payload, sizeof(payload));
+
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/telemetry/recirculator/%s/lan-control/reported", getDeviceId().c_str());
+    mqttPublish(topic, payload, true); // retain = true
+}
@@ -0,0 +1,62 @@
+// lan_control.h
+#ifndef LAN_CONTROL_H
+#define LAN_CONTROL_H
+
+// LAN Control Module
+// Purpose:
+// Announces the device over mDNS and accepts authenticated UDP commands on the local network, so
+// the app can switch the pump with LAN latency and without the broker (internet outages included).
+// UDP commands run the same handlers as the MQTT command topics.
+//
+// mDNS: host mica-<deviceid>.local, service _mica._tcp on LOCAL_API_PORT with TXT records
+//   id=<deviceId> type=recirculator udp=<LAN_CONTROL_PORT> proto=2 nonce=<boot nonce>
+//
+// Key: 32 random bytes chosen by the backend and set with the lan-control command
+// {"key":"<64 hex characters>"} ({"key":""} clears it); stored in NVS, never reported. It is separate
+// from the local API token, which travels in plain HTTP. lan-control/reported (retained) carries the
+// port and whether a key is set. tools/lan_client.py is a reference client.
+//
+// UDP request (one datagram, port LAN_CONTROL_PORT; frame format in lan_frame.h):
+//   MICA1 <nonce> <seq> <command> <mac>\n<payload>
+//     nonce    8 hex characters, changes at every boot (TXT record, or the ERR stale-nonce reply)
+//     seq      1..4294967295; a sequence number is accepted once, up to 64 behind the highest seen
+//              (the ERR "replayed <highest>" reply tells a client where to continue)
+//     command  Command topic suffix, e.g. power-state, max-temperature, display, config; local-api,
+//              lan-control and wifi-profile carry secrets and are cloud-only
+//     mac      64 hex characters: HMAC-SHA256 keyed with the LAN key over
+//              "MICA1 <nonce> <seq> <command>\n<payload>"
+//     payload  Same payload as the MQTT command (may be empty)
+//
+// UDP reply (to the sender):
+//   MICA1 <nonce> <seq> OK|ERR <mac>\n<detail>     mac as above, over "MICA1 <nonce> <seq> <status>\n<detail>"
+//   OK means the command handler ran; results are published like MQTT commands (and on the local API).
+//   ERR busy means LAN_CONTROL_QUEUE_LENGTH requests were already waiting; retry with a new seq.
+//   Requests with a bad MAC get no reply. Without a key the reply is "... ERR -\nno key provisioned".
+//
+// Latency is dominated by the modem sleep of the power profile: "performance" answers within a few ms.
+
+/**
+ * @brief Starts mDNS and the UDP command listener.
+ * Must be called after the WiFi driver is started and the command handlers are registered.
+ * @return true if started, false otherwise
+ */
+bool initializeLanControl();
+
+/**
+ * @brief Registers the lan-control MQTT command (key provisioning).
+ * Call at boot with the other command handlers.
+ */
+void initializeLanControlCommands();
+
+/**
+ * @brief Publishes lan-control/reported with result "current". Call after every MQTT connect.
+ */
+void publishLanControlState();
+
+/**
+ * @brief FreeRTOS task that runs queued LAN requests through the MQTT command handlers and replies.
+ * Create it once initializeLanControl() succeeded; handlers need a full task stack (see system_state).
+ */
+void lanControlTask(void *pvParameters);
+
+#endif // LAN_CONTROL_H
@@ -0,0 +1,180 @@
+// lan_frame.cpp
+// LAN Frame Module
+// Purpose: Parse, sign and verify LAN control datagrams
+// Architecture: Pure functions over caller buffers. The first line is parsed into fixed fields and
+//               must be in canonical form (single spaces, no leading zeros), so exactly one byte string
+//               is signed for each request. The MAC is computed incrementally over the header and the
+//               body, so no contiguous copy of the signed data is needed.
+// Thread-Safety: Reentrant (no shared state)
+// Dependencies: mbedtls
+
+#include "lan_frame.h"
+
+// System headers
+#include <ctype.h>
+#include <mbedtls/md.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// "MICA1 <nonce> <seq> <field> <mac>"
+#define LAN_FRAME_MAX_LINE (5 + 1 + LAN_FRAME_NONCE_LENGTH + 1 + 10 + 1 + LAN_FRAME_MAX_FIELD + 1 + LAN_FRAME_MAC_HEX)
+
+// Internal Function Declarations
+static bool computeMac(const uint8_t *key, const char *header, size_t headerLength, const char *body,
+                       size_t bodyLength, uint8_t mac[32]);
+static bool parseSequence(const char *text, uint32_t &sequence);
+static void toHex(const uint8_t *data, size_t length, char *hex);
+static int hexValue(char c);
+
+bool lanFrameParse(const char *data, size_t length, LanFrame &frame) {
+    if (length == 0 || length > LAN_FRAME_MAX_LENGTH) {
+        return false;
+    }
+    const char *newline = (const char*)memchr(data, '\n', length);
+    if (newline == NULL || (size_t)(newline - data) > LAN_FRAME_MAX_LINE) {
+        return false;
+    }
+    size_t lineLength = newline - data;
+    char line[LAN_FRAME_MAX_LINE + 1];
+    memcpy(line, data, lineLength);
+    line[lineLength] = '\0';
+
+    char magic[8];
+    char sequenceText[12];
+    if (sscanf(line, "%7s %8s %11s %32s %64s", magic, frame.nonce, sequenceText, frame.field, frame.mac) != 5 ||
+        strcmp(magic, LAN_FRAME_MAGIC) != 0 || strlen(frame.nonce) != LAN_FRAME_NONCE_LENGTH ||
+        !parseSequence(sequenceText, frame.sequence)) {
+        return false;
+    }
+    size_t macLength = strlen(frame.mac);
+    if (macLength != LAN_FRAME_MAC_HEX && strcmp(frame.mac, "-") != 0) {
+        return false;
+    }
+
+    // Reject anything sscanf tolerated (extra spaces, trailing fields, leading zeros)
+    char canonical[LAN_FRAME_MAX_LINE + 1];
+    int canonicalLength = snprintf(canonical, sizeof(canonical), LAN_FRAME_MAGIC " %s %lu %s %s", frame.nonce,
+                                   (unsigned long)frame.sequence, frame.field, frame.mac);
+    if (canonicalLength != (int)lineLength || memcmp(canonical, line, lineLength) != 0) {
+        return false;
+    }
+
+    frame.header = data;
+    frame.headerLength = lineLength - macLength - 1;
+    frame.body = newline + 1;
+    frame.bodyLength = length - lineLength - 1;
+    return true;
+}
+
+bool lanFrameVerify(const uint8_t key[LAN_FRAME_KEY_LENGTH], const LanFrame &frame) {
+    if (strlen(frame.mac) != LAN_FRAME_MAC_HEX) {
+        return false;
+    }
+    uint8_t mac[32];
+    if (!computeMac(key, frame.header, frame.headerLength, frame.body, frame.bodyLength, mac)) {
+        return false;
+    }
+    char expected[LAN_FRAME_MAC_HEX + 1];
+    toHex(mac, sizeof(mac), expected);
+    uint8_t diff = 0;
+    for (int i = 0; i < LAN_FRAME_MAC_HEX; i++) {
+        diff |= (uint8_t)(expected[i] ^ tolower((unsigned char)frame.mac[i]));
+    }
+    return diff == 0;
+}
+
+int lanFrameBuild(const uint8_t *key, const char *nonce, uint32_t sequence, const char *field,
+                  const char *body, size_t bodyLength, char *out, size_t capacity) {
+    int headerLength = snprintf(out, capacity, LAN_FRAME_MAGIC " %s %lu %s", nonce, (unsigned long)sequence, field);
+    if (headerLength < 0 || (size_t)headerLength >= capacity) {
+        return -1;
+    }
+
+    char macHex[LAN_FRAME_MAC_HEX + 1] = "-";
+    if (key != NULL) {
+        uint8_t mac[32];
+        if (!computeMac(key, out, headerLength, body, bodyLength, mac)) {
+            return -1;
+        }
+        toHex(mac, sizeof(mac), macHex);
+    }
+
+    size_t macLength = strlen(macHex);
+    size_t total = headerLength + 1 + macLength + 1 + bodyLength;
+    if (total > capacity) {
+        return -1;
+    }
+    char *cursor = out + headerLength;
+    *cursor++ = ' ';
+    memcpy(cursor, macHex, macLength);
+    cursor += macLength;
+    *cursor++ = '\n';
+    memcpy(cursor, body, bodyLength);
+    return (int)total;
+}
+
+bool lanFrameParseKey(const char *hex, uint8_t key[LAN_FRAME_KEY_LENGTH]) {
+    if (strlen(hex) != 2 * LAN_FRAME_KEY_LENGTH) {
+        return false;
+    }
+    for (int i = 0; i < LAN_FRAME_KEY_LENGTH; i++) {
+        int high = hexValue(hex[2 * i]);
+        int low = hexValue(hex[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        key[i] = (uint8_t)((high << 4) | low);
+    }
+    return true;
+}
+
+/** @brief HMAC-SHA256 over header, "\n" and body. */
+static bool computeMac(const uint8_t *key, const char *header, size_t headerLength, const char *body,
+                       size_t bodyLength, uint8_t mac[32]) {
+    mbedtls_md_context_t context;
+    mbedtls_md_init(&context);
+    bool ok = mbedtls_md_setup(&context, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) == 0 &&
+              mbedtls_md_hmac_starts(&context, key, LAN_FRAME_KEY_LENGTH) == 0 &&
+              mbedtls_md_hmac_update(&context, (const unsigned char*)header, headerLength) == 0 &&
+              mbedtls_md_hmac_update(&context, (const unsigned char*)"\n", 1) == 0 &&
+              mbedtls_md_hmac_update(&context, (const unsigned char*)body, bodyLength) == 0 &&
+              mbedtls_md_hmac_finish(&context, mac) == 0;
+    mbedtls_md_free(&context);
+    return ok;
+}
+
+/** @brief Decimal 0..4294967295 (the canonical form check rejects leading zeros). */
+static bool parseSequence(const char *text, uint32_t &sequence) {
+    size_t length = strlen(text);
+    if (length == 0 || length > 10) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (!isdigit((unsigned char)text[i])) {
+            return false;
+        }
+    }
+    unsigned long long value = strtoull(text, NULL, 10);
+    if (value > 0xFFFFFFFFULL) {
+        return false;
+    }
+    sequence = (uint32_t)value;
+    return true;
+}
+
+static void toHex(const uint8_t *data, size_t length, char *hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < length; i++) {
+        hex[2 * i] = digits[data[i] >> 4];
+        hex[2 * i + 1] = digits[data[i] & 0x0F];
+    }
+    hex[2 * length] = '\0';
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
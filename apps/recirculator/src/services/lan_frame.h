@@ -0,0 +1,70 @@
+// lan_frame.h
+#ifndef LAN_FRAME_H
+#define LAN_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// LAN Frame Module
+// Purpose:
+// Wire format of LAN control datagrams (protocol in lan_control.h). Free of Arduino and FreeRTOS so
+// the host tests and tools/lan_client.py are checked against the code the device runs.
+//
+//   MICA1 <nonce> <seq> <field> <mac>\n<body>
+//     field  Command topic suffix in requests, OK or ERR in replies
+//     mac    HMAC-SHA256 with the 32-byte LAN key over "MICA1 <nonce> <seq> <field>\n<body>",
+//            64 lowercase hex characters, or "-" for an unsigned reply
+
+#define LAN_FRAME_MAGIC "MICA1"
+#define LAN_FRAME_MAX_LENGTH 640        // Header plus a config document
+#define LAN_FRAME_MAX_FIELD 32
+#define LAN_FRAME_NONCE_LENGTH 8
+#define LAN_FRAME_KEY_LENGTH 32
+#define LAN_FRAME_MAC_HEX 64
+
+/**
+ * @brief One parsed datagram. Pointers refer to the parsed buffer.
+ */
+typedef struct {
+    char nonce[LAN_FRAME_NONCE_LENGTH + 1];
+    uint32_t sequence;
+    char field[LAN_FRAME_MAX_FIELD + 1];
+    char mac[LAN_FRAME_MAC_HEX + 1];    // Hex as received, or "-"
+    const char *header;                 // Signed part of the first line: "MICA1 <nonce> <seq> <field>"
+    size_t headerLength;
+    const char *body;                   // May contain NUL bytes (MessagePack)
+    size_t bodyLength;
+} LanFrame;
+
+/**
+ * @brief Splits a datagram into its fields. Does not check the MAC.
+ * @param data Datagram bytes
+ * @param length Datagram size (at most LAN_FRAME_MAX_LENGTH)
+ * @param frame Receives the fields; header and body point into data
+ * @return true if the datagram is well-formed, false otherwise
+ */
+bool lanFrameParse(const char *data, size_t length, LanFrame &frame);
+
+/**
+ * @brief Checks the frame's MAC in constant time.
+ * @return true if the MAC was made with key, false otherwise (always false for "-")
+ */
+bool lanFrameVerify(const uint8_t key[LAN_FRAME_KEY_LENGTH], const LanFrame &frame);
+
+/**
+ * @brief Writes a complete datagram.
+ * @param key LAN key, or NULL for an unsigned frame (mac "-")
+ * @param out Destination (not NUL-terminated)
+ * @param capacity Size of out
+ * @return Datagram length, or -1 if it does not fit or signing failed
+ */
+int lanFrameBuild(const uint8_t *key, const char *nonce, uint32_t sequence, const char *field,
+                  const char *body, size_t bodyLength, char *out, size_t capacity);
+
+/**
+ * @brief Parses a key given as 64 hex characters (either case).
+ * @return true if hex is a valid key, false otherwise
+ */
+bool lanFrameParseKey(const char *hex, uint8_t key[LAN_FRAME_KEY_LENGTH]);
+
+#endif // LAN_FRAME_H
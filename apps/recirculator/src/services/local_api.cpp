@@ -0,0 +1,415 @@
+// local_api.cpp
+// Local API Module
+// Purpose: Always-available REST API and WebSocket telemetry on the local network
+// Architecture: Own AsyncWebServer on LOCAL_API_PORT (the config portal keeps port 80 on the AP).
+//               Handlers run in the async TCP task and never block it: relay commands go through the
+//               system state notifications like MQTT commands; config documents are queued for
+//               localApiConfigTask, which applies them through remote_config under the MQTT command
+//               dispatch lock (EEPROM and the reported publish included) and pushes the outcome to
+//               the WebSocket. Drivers mirror their telemetry into localApiBroadcast(), so WebSocket
+//               clients get the same events as MQTT.
+// Thread-Safety: The token is guarded by tokenMutex (written by the MQTT task, read by handlers);
+//                pendingConfig is only touched by the async TCP task, the queue copies it
+// Dependencies: ESPAsyncWebServer, ArduinoJson, Preferences, FreeRTOS queues, remote_config,
+//               relay_controller, temperature_sensor, mqtt_handler, wifi_connect, power_manager, system_state
+
+#include "local_api.h"
+
+// Project headers (alphabetically)
+#include "config.h"
+#include "device_id.h"
+#include "mqtt_handler.h"
+#include "power_manager.h"
+#include "relay_controller.h"
+#include "remote_config.h"
+#include "system_state.h"
+#include "temperature_sensor.h"
+#include "wifi_connect.h"
+
+// Third-party libraries
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <Log.h>
+#include <Preferences.h>
+#include <WiFi.h>
+
+// System headers
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <string.h>
+
+#define LOCAL_API_TOKEN_MIN_LENGTH 16
+#define LOCAL_API_TOKEN_MAX_LENGTH 64
+#define LOCAL_API_MAX_BODY 768          // Same bound as a config document
+#define LOCAL_API_MAX_WS_CLIENTS 4
+#define LOCAL_API_MAX_EVENT_LENGTH 512
+#define LOCAL_API_CONFIG_QUEUE_LENGTH 2 // Documents waiting for localApiConfigTask; more get 503
+
+// Internal Variables
+static AsyncWebServer apiServer(LOCAL_API_PORT);
+static AsyncWebSocket apiSocket("/api/ws");
+static SemaphoreHandle_t tokenMutex = NULL;
+static char apiToken[LOCAL_API_TOKEN_MAX_LENGTH + 1] = "";
+static bool apiStarted = false;
+static QueueHandle_t configQueue = NULL;
+
+// A POSTed config document waiting for localApiConfigTask
+typedef struct {
+    char body[LOCAL_API_MAX_BODY + 1];  // NUL-terminated
+} ConfigRequest;
+
+static ConfigRequest pendingConfig;     // Async TCP task only, copied into the queue
+
+// A config document being applied under the command dispatch lock
+typedef struct {
+    const char *body;
+    const char *result;
+    const char *error;
+} ConfigSubmission;
+
+// Internal Function Declarations
+static bool isAuthorized(AsyncWebServerRequest *request);
+static bool checkRequest(AsyncWebServerRequest *request);
+static void sendJson(AsyncWebServerRequest *request, int code, JsonDocument &doc);
+static void collectBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+static void handleStatus(AsyncWebServerRequest *request);
+static void handleTemperature(AsyncWebServerRequest *request);
+static void handleGetConfig(AsyncWebServerRequest *request);
+static void handlePostConfig(AsyncWebServerRequest *request);
+static void submitConfigSerialized(void *context);
+static void handleRelay(AsyncWebServerRequest *request);
+static void onSocketEvent(AsyncWebSocket *socket, AsyncWebSocketClient *client, AwsEventType type,
+                          void *arg, uint8_t *data, size_t len);
+static void handleLocalApiCommand(const char* topic, const char* payload, unsigned int length);
+static void publishLocalApiReported(const char *result, const char *error);
+
+bool initializeLocalApi() {
+    tokenMutex = xSemaphoreCreateMutex();
+    if (tokenMutex == NULL) {
+        Log::error("Failed to create local API mutex.");
+        return false;
+    }
+    configQueue = xQueueCreate(LOCAL_API_CONFIG_QUEUE_LENGTH, sizeof(ConfigRequest));
+    if (configQueue == NULL) {
+        Log::error("Failed to create local API config queue.");
+        return false;
+    }
+
+    Preferences prefs;
+    prefs.begin("localapi", true);
+    prefs.getString("token", apiToken, sizeof(apiToken));
+    prefs.end();
+
+    // The WebSocket handshake is a GET; reject it before the upgrade if the token is wrong
+    apiSocket.setFilter(isAuthorized);
+    apiSocket.onEvent(onSocketEvent);
+    apiServer.addHandler(&apiSocket);
+
+    apiServer.on("/api/status", HTTP_GET, handleStatus);
+    apiServer.on("/api/temperature", HTTP_GET, handleTemperature);
+    apiServer.on("/api/config", HTTP_GET, handleGetConfig);
+    apiServer.on("/api/config", HTTP_POST, handlePostConfig, NULL, collectBody);
+    apiServer.on("/api/relay", HTTP_POST, handleRelay, NULL, collectBody);
+    apiServer.onNotFound([](AsyncWebServerRequest *request) {
+        request->send(404, "application/json", "{\"error\":\"not found\"}");
+    });
+    apiServer.begin();
+    apiStarted = true;
+
+    Log::info("Local API listening on port %u (%s).", LOCAL_API_PORT,
+              apiToken[0] != '\0' ? "token set" : "no token yet, disabled");
+    return true;
+}
+
+void initializeLocalApiCommands() {
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/command/recirculator/%s/local-api", getDeviceId().c_str());
+    mqttSubscribe(topic, handleLocalApiCommand);
+}
+
+void publishLocalApiState() {
+    publishLocalApiReported("current", NULL);
+}
+
+void localApiConfigTask(void *pvParameters) {
+    static ConfigRequest request; // Too large for the stack; only this task uses it
+    for (;;) {
+        if (xQueueReceive(configQueue, &request, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        ConfigSubmission submission = {request.body, "rejected", "busy"};
+        mqttRunSerialized(submitConfigSerialized, &submission);
+
+        StaticJsonDocument<128> doc;
+        doc["result"] = submission.result;
+        if (submission.error != NULL) {
+            doc["error"] = submission.error;
+        }
+        char json[128];
+        serializeJson(doc, json, sizeof(json));
+        localApiBroadcast("config", json);
+    }
+}
+
+void localApiBroadcast(const char *event, const char *json) {
+    if (!apiStarted || apiSocket.count() == 0) {
+        return;
+    }
+    apiSocket.cleanupClients(LOCAL_API_MAX_WS_CLIENTS);
+    if (!apiSocket.availableForWriteAll()) {
+        return; // A slow client would only queue stale readings
+    }
+
+    char message[LOCAL_API_MAX_EVENT_LENGTH];
+    int length = snprintf(message, sizeof(message), "{\"event\":\"%s\",\"data\":%s}", event, json);
+    if (length < 0 || length >= (int)sizeof(message)) {
+        Log::warn("Local API event %s too large, dropped.", event);
+        return;
+    }
+    apiSocket.textAll(message);
+}
+
+/** @brief Token from the Authorization header or the token query parameter (constant-time compare). */
+static bool isAuthorized(AsyncWebServerRequest *request) {
+    String presented;
+    if (request->hasHeader("Authorization")) {
+        const String &header = request->getHeader("Authorization")->value();
+        if (header.startsWith("Bearer ")) {
+            presented = header.substring(7);
+        }
+    } else if (request->hasParam("token")) {
+        presented = request->getParam("token")->value();
+    }
+
+    bool match = false;
+    if (xSemaphoreTake(tokenMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        size_t length = strlen(apiToken);
+        if (length > 0 && presented.length() == length) {
+            uint8_t diff = 0;
+            for (size_t i = 0; i < length; i++) {
+                diff |= (uint8_t)(apiToken[i] ^ presented[i]);
+            }
+            match = (diff == 0);
+        }
+        xSemaphoreGive(tokenMutex);
+    }
+    return match;
+}
+
+/** @brief Sends the error response itself when the request may not proceed. */
+static bool checkRequest(AsyncWebServerRequest *request) {
+    if (apiToken[0] == '\0') {
+        request->send(503, "application/json", "{\"error\":\"no token provisioned\"}");
+        return false;
+    }
+    if (!isAuthorized(request)) {
+        request->send(401, "application/json", "{\"error\":\"unauthorized\"}");
+        return false;
+    }
+    return true;
+}
+
+static void sendJson(AsyncWebServerRequest *request, int code, JsonDocument &doc) {
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->setCode(code);
+    serializeJson(doc, *response);
+    request->send(response);
+}
+
+/** @brief Buffers a request body in _tempObject (freed with the request); oversized bodies are dropped. */
+static void collectBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    if (total > LOCAL_API_MAX_BODY) {
+        return;
+    }
+    if (index == 0) {
+        request->_tempObject = malloc(total + 1);
+    }
+    if (request->_tempObject == NULL) {
+        return;
+    }
+    memcpy((uint8_t*)request->_tempObject + index, data, len);
+    if (index + len == total) {
+        ((char*)request->_tempObject)[total] = '\0';
+    }
+}
+
+static void handleStatus(AsyncWebServerRequest *request) {
+    if (!checkRequest(request)) return;
+
+    StaticJsonDocument<384> doc;
+    doc["deviceId"] = getDeviceId();
+    doc["state"] = (int)getSystemState();
+    JsonObject relay = doc.createNestedObject("relay");
+    relay["state"] = isRelayActive() ? "ON" : "OFF";
+    relay["remainingTime"] = getRelayRemainingSeconds();
+    doc["uptime"] = millis();
+    doc["rssi"] = isWiFiConnected() ? WiFi.RSSI() : 0;
+    doc["mqtt"] = isMqttConnected();
+    doc["powerProfile"] = getPowerProfileInfo().name;
+    sendJson(request, 200, doc);
+}
+
+static void handleTemperature(AsyncWebServerRequest *request) {
+    if (!checkRequest(request)) return;
+
+    StaticJsonDocument<384> doc;
+    TemperatureChannel control = getControlChannel();
+    doc["controlChannel"] = getTemperatureChannelName(control);
+    doc["temperature"] = getLatestTemperature();
+    JsonObject channels = doc.createNestedObject("channels");
+    for (int c = 0; c < TEMP_CHANNEL_COUNT; c++) {
+        TemperatureSample sample;
+        if (isTemperatureChannelPresent((TemperatureChannel)c) && getTemperatureSample((TemperatureChannel)c, sample)) {
+            JsonObject channel = channels.createNestedObject(getTemperatureChannelName((TemperatureChannel)c));
+            channel["temperature"] = sample.value;
+            channel["quality"] = sample.quality;
+            channel["ageMs"] = millis() - sample.timestampMs;
+        }
+    }
+    sendJson(request, 200, doc);
+}
+
+static void handleGetConfig(AsyncWebServerRequest *request) {
+    if (!checkRequest(request)) return;
+
+    DynamicJsonDocument doc(768);
+    if (!getConfigDocument(doc.to<JsonObject>())) {
+        request->send(500, "application/json", "{\"error\":\"storage error\"}");
+        return;
+    }
+    sendJson(request, 200, doc);
+}
+
+static void handlePostConfig(AsyncWebServerRequest *request) {
+    if (!checkRequest(request)) return;
+
+    const char *body = (const char*)request->_tempObject;
+    if (body == NULL) {
+        request->send(400, "application/json", "{\"error\":\"missing or oversized body\"}");
+        return;
+    }
+    // Applying takes the dispatch lock, EEPROM and an MQTT publish: never on the async TCP task
+    strcpy(pendingConfig.body, body);
+    if (xQueueSend(configQueue, &pendingConfig, 0) != pdTRUE) {
+        request->send(503, "application/json", "{\"error\":\"busy\"}");
+        return;
+    }
+    request->send(202, "application/json", "{\"result\":\"queued\"}");
+}
+
+/** @brief Applies a queued document like the MQTT config command (under the command dispatch lock). */
+static void submitConfigSerialized(void *context) {
+    ConfigSubmission *submission = (ConfigSubmission*)context;
+    submission->result = submitConfigDocument(submission->body, strlen(submission->body), &submission->error);
+}
+
+/** @brief Relay requests take the same path as MQTT commands (state task, "command" source). */
+static void handleRelay(AsyncWebServerRequest *request) {
+    if (!checkRequest(request)) return;
+
+    const char *body = (const char*)request->_tempObject;
+    const char *state = NULL;
+    StaticJsonDocument<64> json;
+    if (body != NULL && body[0] == '{') {
+        if (!deserializeJson(json, body)) {
+            state = json["state"] | "";
+        }
+    } else {
+        state = body;
+    }
+
+    if (state != NULL && strcmp(state, "ON") == 0) {
+        notifySystemState(EVENT_RELAY_ON);
+    } else if (state != NULL && strcmp(state, "OFF") == 0) {
+        notifySystemState(EVENT_RELAY_OFF);
+    } else {
+        request->send(400, "application/json", "{\"error\":\"state must be ON or OFF\"}");
+        return;
+    }
+    Log::info("Power state set to %s via local API", state);
+
+    StaticJsonDocument<64> doc;
+    doc["requested"] = state;
+    sendJson(request, 202, doc);
+}
+
+/** @brief Limits concurrent clients and greets new ones with the current relay state. */
+static void onSocketEvent(AsyncWebSocket *socket, AsyncWebSocketClient *client, AwsEventType type,
+                          void *arg, uint8_t *data, size_t len) {
+    if (type != WS_EVT_CONNECT) {
+        return;
+    }
+    if (socket->count() > LOCAL_API_MAX_WS_CLIENTS) {
+        client->close(1013, "too many clients");
+        return;
+    }
+    char message[96];
+    snprintf(message, sizeof(message), "{\"event\":\"power-state\",\"data\":{\"state\":\"%s\",\"remainingTime\":%lu}}",
+             isRelayActive() ? "ON" : "OFF", (unsigned long)getRelayRemainingSeconds());
+    client->text(message);
+}
+
+/** @brief {"token":"..."} stores a new token (16-64 printable characters); {"token":""} disables the API. */
+static void handleLocalApiCommand(const char* topic, const char* payload, unsigned int length) {
+    StaticJsonDocument<192> doc;
+    DeserializationError err = deserializeJson(doc, payload, length);
+    if (err) {
+        Log::error("Failed to parse local-api command: %s", err.c_str());
+        publishLocalApiReported("rejected", err.c_str());
+        return;
+    }
+    if (!doc["token"].is<const char*>()) {
+        publishLocalApiReported("rejected", "token missing");
+        return;
+    }
+    const char *token = doc["token"];
+    size_t tokenLength = strlen(token);
+    if (tokenLength != 0 && (tokenLength < LOCAL_API_TOKEN_MIN_LENGTH || tokenLength > LOCAL_API_TOKEN_MAX_LENGTH)) {
+        publishLocalApiReported("rejected", "token length");
+        return;
+    }
+    for (size_t i = 0; i < tokenLength; i++) {
+        if (token[i] <= ' ' || token[i] > '~') {
+            publishLocalApiReported("rejected", "token characters");
+            return;
+        }
+    }
+
+    Preferences prefs;
+    prefs.begin("localapi", false);
+    size_t written = prefs.putString("token", token);
+    prefs.end();
+    if (written != tokenLength) {
+        publishLocalApiReported("rejected", "storage error");
+        return;
+    }
+
+    if (xSemaphoreTake(tokenMutex, portMAX_DELAY) == pdTRUE) {
+        strncpy(apiToken, token, LOCAL_API_TOKEN_MAX_LENGTH);
+        apiToken[LOCAL_API_TOKEN_MAX_LENGTH] = '\0';
+        xSemaphoreGive(tokenMutex);
+    }
+    apiSocket.closeAll(1008, "token changed"); // Sessions opened with the old token end
+    Log::info("Local API token %s.", tokenLength > 0 ? "updated" : "cleared");
+    publishLocalApiReported("applied", NULL);
+}
+
+/** @brief Retained endpoint description for the app; never includes the token. */
+static void publishLocalApiReported(const char *result, const char *error) {
+    StaticJsonDocument<192> doc;
+    doc["port"] = LOCAL_API_PORT;
+    doc["ip"] = WiFi.localIP().toString();
+    doc["tokenSet"] = apiToken[0] != '\0';
+    doc["result"] = result;
+    if (error != NULL) {
+        doc["error"] = error;
+    }
+    char payload[192];
+    serializeJson(doc, payload, sizeof(payload));
+
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/telemetry/recirculator/%s/local-api/reported", getDeviceId().c_str());
+    mqttPublish(topic, payload, true); // retain = true
+}
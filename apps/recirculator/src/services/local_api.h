@@ -0,0 +1,59 @@
+// local_api.h
+#ifndef LOCAL_API_H
+#define LOCAL_API_H
+
+// Local API Module
+// Purpose:
+// HTTP REST API and WebSocket live telemetry on the local network (port LOCAL_API_PORT), so the
+// app can control the pump with LAN latency and keeps working when the cloud is unreachable.
+//
+// Every request needs the device token, as "Authorization: Bearer <token>" or "?token=<token>"
+// (the WebSocket handshake can only use the query form). The token is set from the cloud with the
+// local-api command {"token":"<16-64 characters>"} and stored in NVS; until then the API answers 503.
+//
+//   GET  /api/status       {"deviceId","state","relay":{"state","remainingTime"},"uptime","rssi","mqtt","powerProfile"}
+//   GET  /api/temperature  {"controlChannel","temperature","channels":{"outlet":{"temperature","quality"},...}}
+//   GET  /api/config       Effective config document (see remote_config.h)
+//   POST /api/relay        "ON" | "OFF" | {"state":"ON"}     -> 202 {"requested":"ON"}
+//   POST /api/config       Config document                   -> 202 {"result":"queued"}; 503 if
+//                          two documents are already waiting. The outcome is pushed to the WebSocket
+//                          as a "config" event {"result","error"} and to config/reported
+//   WS   /api/ws           Pushes {"event":"temperature"|"power-state"|"config","data":{...}}
+//
+// local-api/reported (retained) carries the port, the STA address and whether a token is set.
+
+/**
+ * @brief Loads the token and starts the HTTP server and WebSocket.
+ * Must be called after the WiFi driver is started; handlers use the relay and sensor modules.
+ * @return true if started, false otherwise
+ */
+bool initializeLocalApi();
+
+/**
+ * @brief FreeRTOS task that applies POSTed config documents (queued by the HTTP handler).
+ * Create it once initializeLocalApi() succeeded; it runs the config handlers, so it needs a full
+ * task stack (see system_state).
+ */
+void localApiConfigTask(void *pvParameters);
+
+/**
+ * @brief Registers the local-api MQTT command.
+ * Call at boot with the other command handlers; subscriptions are (re)made on every connect.
+ */
+void initializeLocalApiCommands();
+
+/**
+ * @brief Publishes local-api/reported with result "current". Call after every MQTT connect.
+ */
+void publishLocalApiState();
+
+/**
+ * @brief Pushes an event to every connected WebSocket client.
+ * @param event Event name ("temperature", "power-state")
+ * @param json Event data, a serialized JSON object
+ * @note Thread-safe: Can be called from any task; dropped when no client is connected or a client
+ *       is not keeping up
+ */
+void localApiBroadcast(const char *event, const char *json);
+
+#endif // LOCAL_API_H
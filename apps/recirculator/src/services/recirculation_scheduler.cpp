@@ -0,0 +1,256 @@
+// recirculation_scheduler.cpp
+// Recirculation Scheduler Module
+// Purpose: Pre-heats the hot water loop before learned demand windows
+// Architecture: 7x24 demand histogram in NVS, evaluated once a minute by a FreeRTOS task. Demands are
+//               counted in RAM by the caller (relay activation) and persisted by the scheduler task.
+//               Pre-runs are requested from the state manager (EVENT_RELAY_SCHEDULED), which owns the relay.
+// Thread-Safety: schedulerMutex protects the histogram and energy accounting
+// Dependencies: Preferences, UtcClock (via system_state), relay_controller, eeprom_config
+//
+// Bins are indexed in UTC. The histogram only has to be consistent with itself,
+// so no timezone is needed (DST shifts the learned pattern by one hour twice a year).
+
+#include "recirculation_scheduler.h"
+
+// Project headers (alphabetically)
+#include "config.h"
+#include "eeprom_config.h"
+#include "relay_controller.h"
+#include "system_state.h"
+
+// Third-party libraries
+#include <Arduino.h>
+#include <Log.h>
+#include <Preferences.h>
+
+// System headers
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <time.h>
+
+#define SCHEDULER_DAYS 7
+#define SCHEDULER_HOURS 24
+#define SECONDS_PER_DAY 86400UL
+
+// Persisted learning state (NVS blob)
+typedef struct {
+    uint8_t demandCount[SCHEDULER_DAYS][SCHEDULER_HOURS]; // Days with demand, per weekday/hour
+    uint32_t firstDay;                                   // Day number (UTC) learning started
+} DemandHistogram;
+
+// Internal Variables
+static DemandHistogram histogram = {};
+static SemaphoreHandle_t schedulerMutex = NULL;
+static uint32_t lastDemandDay = 0;      // Deduplicates demands within the same bin/day
+static int lastDemandBin = -1;
+static uint32_t lastPreRunDay = 0;      // Avoids pre-running the same bin twice a day
+static int lastPreRunBin = -1;
+static uint32_t budgetDay = 0;          // Day the energy budget applies to
+static float scheduledEnergyTodayWh = 0.0f;
+static bool histogramDirty = false;     // Counted but not yet written to NVS
+
+// Internal Function Declarations
+static void saveHistogramIfDirty();
+static void ageHistogram(uint32_t today);
+static uint32_t weeksObserved(uint32_t today);
+static bool getUtcSeconds(time_t &seconds);
+
+bool initializeRecirculationScheduler() {
+    schedulerMutex = xSemaphoreCreateMutex();
+    if (schedulerMutex == NULL) {
+        Log::error("Failed to create scheduler mutex.");
+        return false;
+    }
+
+    Preferences prefs;
+    prefs.begin("scheduler", true);
+    size_t loaded = prefs.getBytes("histogram", &histogram, sizeof(histogram));
+    prefs.end();
+
+    if (loaded != sizeof(histogram)) {
+        memset(&histogram, 0, sizeof(histogram));
+        Log::info("Scheduler: no demand history, learning from scratch.");
+    } else {
+        Log::info("Scheduler: demand history loaded (learning since day %lu).", histogram.firstDay);
+    }
+    return true;
+}
+
+void recordRecirculationDemand() {
+    if (schedulerMutex == NULL) return;
+
+    time_t now;
+    if (!getUtcSeconds(now)) {
+        return;
+    }
+
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    uint32_t today = now / SECONDS_PER_DAY;
+    int bin = utc.tm_wday * SCHEDULER_HOURS + utc.tm_hour;
+
+    if (xSemaphoreTake(schedulerMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        Log::error("Scheduler: could not acquire mutex to record demand.");
+        return;
+    }
+
+    if (today == lastDemandDay && bin == lastDemandBin) {
+        xSemaphoreGive(schedulerMutex);
+        return; // Already counted this hour today
+    }
+    lastDemandDay = today;
+    lastDemandBin = bin;
+
+    if (histogram.firstDay == 0) {
+        histogram.firstDay = today;
+    }
+    ageHistogram(today);
+
+    uint8_t &count = histogram.demandCount[utc.tm_wday][utc.tm_hour];
+    if (count < UINT8_MAX) {
+        count++;
+    }
+    histogramDirty = true; // Written by the scheduler task, not on the relay path
+    uint8_t newCount = count;
+    xSemaphoreGive(schedulerMutex);
+    Log::info("Scheduler: demand recorded (weekday %d, %02d:00 UTC, count %u).",
+              utc.tm_wday, utc.tm_hour, newCount);
+}
+
+void recordScheduledRun(uint32_t runTimeSeconds) {
+    if (schedulerMutex == NULL) return;
+
+    if (xSemaphoreTake(schedulerMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        scheduledEnergyTodayWh += PUMP_POWER_WATTS * runTimeSeconds / 3600.0f;
+        Log::info("Scheduler: pre-run used %.2f Wh today (budget %.2f Wh).",
+                  scheduledEnergyTodayWh, SCHEDULER_DAILY_ENERGY_BUDGET_WH);
+        xSemaphoreGive(schedulerMutex);
+    }
+}
+
+void recirculationSchedulerTask(void *pvParameters) {
+    constexpr uint32_t EVALUATION_INTERVAL_MS = 60000;
+
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(EVALUATION_INTERVAL_MS));
+        saveHistogramIfDirty();
+
+        time_t now;
+        if (!getUtcSeconds(now) || isRelayActive()) {
+            continue;
+        }
+
+        // Look ahead so the loop is hot when the demand hour starts
+        time_t target = now + SCHEDULER_LEAD_SECONDS;
+        struct tm targetUtc;
+        gmtime_r(&target, &targetUtc);
+        uint32_t today = now / SECONDS_PER_DAY;
+        uint32_t targetDay = target / SECONDS_PER_DAY;
+        int bin = targetUtc.tm_wday * SCHEDULER_HOURS + targetUtc.tm_hour;
+
+        // Only the first minutes of the lead window trigger, later ones mean we missed it
+        if (targetUtc.tm_min * 60 + targetUtc.tm_sec >= SCHEDULER_LEAD_SECONDS) {
+            continue;
+        }
+
+        if (xSemaphoreTake(schedulerMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+            continue;
+        }
+
+        if (budgetDay != today) {
+            budgetDay = today;
+            scheduledEnergyTodayWh = 0.0f;
+        }
+
+        bool alreadyRun = (lastPreRunDay == targetDay && lastPreRunBin == bin);
+        uint32_t weeks = weeksObserved(today);
+        float confidence = (weeks > 0)
+            ? (float)histogram.demandCount[targetUtc.tm_wday][targetUtc.tm_hour] / weeks
+            : 0.0f;
+        float estimatedRunWh = PUMP_POWER_WATTS * getStoredMaxTime() / 3600.0f;
+        bool withinBudget = scheduledEnergyTodayWh + estimatedRunWh <= SCHEDULER_DAILY_ENERGY_BUDGET_WH;
+
+        bool shouldRun = !alreadyRun && weeks >= SCHEDULER_MIN_WEEKS &&
+                         confidence >= SCHEDULER_CONFIDENCE_THRESHOLD;
+        if (shouldRun) {
+            lastPreRunDay = targetDay; // Also when over budget, so the warning is logged once
+            lastPreRunBin = bin;
+        }
+        xSemaphoreGive(schedulerMutex);
+
+        if (!shouldRun) {
+            continue;
+        }
+        if (!withinBudget) {
+            Log::warn("Scheduler: pre-run for %02d:00 UTC skipped, daily energy budget exhausted.",
+                      targetUtc.tm_hour);
+            continue;
+        }
+
+        Log::info("Scheduler: pre-heating for %02d:00 UTC (confidence %.2f over %lu weeks).",
+                  targetUtc.tm_hour, confidence, weeks);
+        notifySystemState(EVENT_RELAY_SCHEDULED); // The state manager owns relay activation
+    }
+}
+
+/** @brief Persists the histogram to NVS when demands were counted since the last save.
+ * The NVS write runs on a snapshot, outside schedulerMutex.
+ */
+static void saveHistogramIfDirty() {
+    DemandHistogram snapshot;
+    if (xSemaphoreTake(schedulerMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    bool dirty = histogramDirty;
+    snapshot = histogram;
+    histogramDirty = false;
+    xSemaphoreGive(schedulerMutex);
+    if (!dirty) {
+        return;
+    }
+
+    Preferences prefs;
+    prefs.begin("scheduler", false);
+    if (prefs.putBytes("histogram", &snapshot, sizeof(snapshot)) != sizeof(snapshot)) {
+        Log::error("Scheduler: failed to save demand history.");
+        if (xSemaphoreTake(schedulerMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+            histogramDirty = true; // Retried at the next evaluation
+            xSemaphoreGive(schedulerMutex);
+        }
+    }
+    prefs.end();
+}
+
+/** @brief Halves old history once it spans more than SCHEDULER_MEMORY_WEEKS so habits can change.
+ * @note Caller must hold schedulerMutex.
+ */
+static void ageHistogram(uint32_t today) {
+    if (weeksObserved(today) <= SCHEDULER_MEMORY_WEEKS) {
+        return;
+    }
+    for (int d = 0; d < SCHEDULER_DAYS; d++) {
+        for (int h = 0; h < SCHEDULER_HOURS; h++) {
+            histogram.demandCount[d][h] /= 2;
+        }
+    }
+    histogram.firstDay += (SCHEDULER_MEMORY_WEEKS / 2) * 7;
+    Log::info("Scheduler: demand history aged.");
+}
+
+/** @brief Number of (partial) weeks covered by the histogram. */
+static uint32_t weeksObserved(uint32_t today) {
+    if (histogram.firstDay == 0 || today < histogram.firstDay) {
+        return 0;
+    }
+    return (today - histogram.firstDay) / 7 + 1;
+}
+
+static bool getUtcSeconds(time_t &seconds) {
+    UtcClock &clock = getUtcClock();
+    if (!clock.isTimeValid()) {
+        return false;
+    }
+    seconds = (time_t)(clock.getTime(0) / 1000ULL);
+    return true;
+}
@@ -0,0 +1,43 @@
+// recirculation_scheduler.h
+#ifndef RECIRCULATION_SCHEDULER_H
+#define RECIRCULATION_SCHEDULER_H
+
+#include <stdint.h>
+
+// Recirculation Scheduler Module
+// Purpose:
+// Learns when hot water is requested (per weekday and hour) and pre-runs the
+// recirculation cycle shortly before the predicted demand, within a daily energy budget.
+
+#define SCHEDULER_LEAD_SECONDS 600               // Pre-run this long before the demand hour starts
+#define SCHEDULER_CONFIDENCE_THRESHOLD 0.6f      // Fraction of observed weeks with demand in the bin
+#define SCHEDULER_MIN_WEEKS 2                    // Weeks of history required before pre-running
+#define SCHEDULER_MEMORY_WEEKS 8                 // Older history is aged out (counts halved)
+#define SCHEDULER_DAILY_ENERGY_BUDGET_WH 8.0f    // Max energy spent on scheduled pre-runs per day
+
+/**
+ * @brief Loads the demand histogram from NVS.
+ * @return true if initialization is successful, false otherwise.
+ */
+bool initializeRecirculationScheduler();
+
+/**
+ * @brief Records a user demand (button or remote command) in the weekday/hour histogram.
+ * @note Counted at most once per bin per day; only updates RAM, the scheduler task writes NVS within a minute
+ * @note Does nothing until NTP time is valid
+ */
+void recordRecirculationDemand();
+
+/**
+ * @brief Accounts the energy of a completed scheduled pre-run against today's budget.
+ * @param runTimeSeconds Pump run time of the scheduled cycle
+ */
+void recordScheduledRun(uint32_t runTimeSeconds);
+
+/**
+ * @brief FreeRTOS task that evaluates the histogram once a minute and starts pre-runs.
+ * @param pvParameters Task parameters (not used).
+ */
+void recirculationSchedulerTask(void *pvParameters);
+
+#endif // RECIRCULATION_SCHEDULER_H
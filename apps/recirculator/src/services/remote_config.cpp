@@ -0,0 +1,447 @@
+// remote_config.cpp
+// Remote Config Module
+// Purpose: Versioned bulk configuration document over MQTT with validate-all, atomic apply and a
+//          retained reported state
+// Architecture: The handler validates every key into a draft inside editConfig(), so the document is
+//               merged with the current config under the store lock and stored as one write-behind
+//               commit; a concurrent setter can neither be reverted nor interleave.
+//               Live modules are refreshed afterwards (sensor offsets, resolution and channel
+//               assignment, display settings).
+//               Backup WiFi profiles have their own command since they carry secrets that must
+//               never appear in the retained reported document. The power benchmark is a runtime
+//               switch and is not stored.
+// Thread-Safety: Handlers are serialized by the MQTT command dispatch (the local API takes the same
+//                lock); config store and MQTT queue are thread-safe
+// Dependencies: eeprom_config, mqtt_handler, device_id, power_manager, temperature_sensor, display_manager,
+//               relay_controller
+
+#include "remote_config.h"
+
+// Project headers (alphabetically)
+#include "device_id.h"
+#include "display_manager.h"
+#include "eeprom_config.h"
+#include "mqtt_handler.h"
+#include "power_manager.h"
+#include "relay_controller.h"
+#include "temperature_sensor.h"
+
+// Third-party libraries
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Log.h>
+
+// System headers
+#include <rom/crc.h>
+#include <string.h>
+
+#define CONFIG_DOCUMENT_CAPACITY 1024
+
+// Top-level keys accepted in a config document
+static const char *const DOCUMENT_KEYS[] = {"version", "maxTemperature", "maxTime", "temperatureOffsets", "display",
+                                             "powerProfile", "temperatureResolution", "sensors"};
+
+// A config document being applied through editConfig()
+typedef struct {
+    JsonObjectConst document;
+    const char *error;      // First validation error, or NULL
+    uint8_t powerProfile;   // Resulting profile and resolution, applied once the edit is stored
+    uint8_t temperatureResolution;
+    bool sensorsChanged;    // Sensor ROM assignment differs from the stored one
+} ConfigDocumentEdit;
+
+// Internal Function Declarations
+static void handleConfigCommand(const char* topic, const char* payload, unsigned int length);
+static bool applyConfigDocumentEdit(DeviceConfig &draft, void *context);
+static const char *applyConfigDocument(JsonObjectConst document, DeviceConfig &draft);
+static const char *applySensorAssignment(JsonObjectConst sensors, DeviceConfig &draft);
+static void configToJson(JsonObject json, const DeviceConfig &config);
+static void handleWiFiProfileCommand(const char* topic, const char* payload, unsigned int length);
+static void publishWiFiProfiles(const char *result, const char *error);
+static void handlePowerBenchmarkCommand(const char* topic, const char* payload, unsigned int length);
+
+void initializeRemoteConfigCommands() {
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/command/recirculator/%s/config", getDeviceId().c_str());
+    mqttSubscribe(topic, handleConfigCommand);
+    snprintf(topic, sizeof(topic), "mica/dev/command/recirculator/%s/wifi-profile", getDeviceId().c_str());
+    mqttSubscribe(topic, handleWiFiProfileCommand);
+    snprintf(topic, sizeof(topic), "mica/dev/command/recirculator/%s/power-benchmark", getDeviceId().c_str());
+    mqttSubscribe(topic, handlePowerBenchmarkCommand);
+}
+
+void publishRemoteConfigState() {
+    publishReportedConfig("current", NULL);
+    publishWiFiProfiles("current", NULL);
+}
+
+bool publishReportedConfig(const char *result, const char *error) {
+    DeviceConfig config;
+    if (!loadConfig(config)) {
+        return false;
+    }
+
+    DynamicJsonDocument doc(CONFIG_DOCUMENT_CAPACITY);
+    configToJson(doc.to<JsonObject>(), config);
+
+    // Hash the canonical serialization of the tunables only, so it changes exactly when they do
+    char payload[MQTT_PAYLOAD_MAX_LENGTH];
+    size_t length = serializeJson(doc, payload, sizeof(payload));
+    char hash[9];
+    snprintf(hash, sizeof(hash), "%08lx", (unsigned long)crc32_le(0, (const uint8_t*)payload, length));
+
+    doc["hash"] = hash;
+    doc["result"] = result;
+    if (error != NULL) {
+        doc["error"] = error;
+    }
+    // Probes found on the bus, so an installer can pick the addresses to assign
+    JsonObject probes = doc.createNestedObject("probes");
+    for (int c = 0; c < TEMP_CHANNEL_COUNT; c++) {
+        char hex[17];
+        if (getTemperatureSensorAddress((TemperatureChannel)c, hex)) {
+            probes[getTemperatureChannelName((TemperatureChannel)c)] = hex;
+        }
+    }
+    if (measureJson(doc) >= sizeof(payload)) {
+        doc.remove("probes"); // Never truncate the document itself
+    }
+    serializeJson(doc, payload, sizeof(payload));
+
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/telemetry/recirculator/%s/config/reported", getDeviceId().c_str());
+    return mqttPublish(topic, payload, true); // retain = true
+}
+
+bool getConfigDocument(JsonObject json) {
+    DeviceConfig config;
+    if (!loadConfig(config)) {
+        return false;
+    }
+    configToJson(json, config);
+    return true;
+}
+
+const char *submitConfigDocument(const char *payload, unsigned int length, const char **error) {
+    const char *result = "rejected";
+    *error = NULL;
+
+    DynamicJsonDocument doc(CONFIG_DOCUMENT_CAPACITY);
+    // JSON documents are objects; anything else is taken as MessagePack
+    DeserializationError err = (length > 0 && payload[0] == '{')
+        ? deserializeJson(doc, payload, length)
+        : deserializeMsgPack(doc, payload, length);
+    if (err) {
+        Log::error("Failed to parse config document: %s", err.c_str());
+        *error = err.c_str();
+        publishReportedConfig(result, *error);
+        return result;
+    }
+
+    ConfigDocumentEdit edit = {doc.as<JsonObjectConst>(), NULL, 0, 0, false};
+    switch (editConfig(applyConfigDocumentEdit, &edit)) {
+        case CONFIG_EDIT_APPLIED:
+            // Modules that cache settings outside the config store
+            reloadTemperatureOffsets();
+            notifyDisplayUpdate(DISPLAY_UPDATE_CONFIG);
+            setPowerProfile((PowerProfile)edit.powerProfile);
+            setTemperatureResolution(edit.temperatureResolution != 0 ? edit.temperatureResolution
+                                                                     : TEMPERATURE_DEFAULT_RESOLUTION);
+            if (edit.sensorsChanged) {
+                reloadTemperatureChannels();
+            }
+            Log::info("Config document applied.");
+            result = "applied";
+            break;
+        case CONFIG_EDIT_UNCHANGED:
+            Log::info("Config document matches the current configuration.");
+            result = "unchanged";
+            break;
+        case CONFIG_EDIT_REJECTED:
+            Log::error("Config document rejected: %s", edit.error);
+            *error = edit.error;
+            break;
+        case CONFIG_EDIT_FAILED:
+            *error = "storage error";
+            break;
+    }
+
+    publishReportedConfig(result, *error);
+    return result;
+}
+
+/** @brief MQTT entry point; the outcome goes to the retained config/reported topic. */
+static void handleConfigCommand(const char* topic, const char* payload, unsigned int length) {
+    const char *error;
+    submitConfigDocument(payload, length, &error);
+}
+
+/** @brief editConfig() callback: applies the document to the locked draft. */
+static bool applyConfigDocumentEdit(DeviceConfig &draft, void *context) {
+    ConfigDocumentEdit *edit = (ConfigDocumentEdit*)context;
+    uint8_t sensorAddress[TEMP_OFFSET_CHANNELS][8];
+    memcpy(sensorAddress, draft.sensorAddress, sizeof(sensorAddress));
+    edit->error = applyConfigDocument(edit->document, draft);
+    edit->powerProfile = draft.powerProfile;
+    edit->temperatureResolution = draft.temperatureResolution;
+    edit->sensorsChanged = memcmp(sensorAddress, draft.sensorAddress, sizeof(sensorAddress)) != 0;
+    return edit->error == NULL;
+}
+
+/**
+ * @brief Validates every key of the document into draft.
+ * @return NULL if the whole document is valid, otherwise the first error (draft is then discarded)
+ */
+static const char *applyConfigDocument(JsonObjectConst document, DeviceConfig &draft) {
+    if (document.isNull()) {
+        return "document must be an object";
+    }
+    if (document["version"].isNull()) {
+        return "version missing";
+    }
+    if (document["version"].as<int>() != CONFIG_DOCUMENT_VERSION) {
+        return "unsupported version";
+    }
+
+    // Reject typos instead of silently ignoring them
+    for (JsonPairConst entry : document) {
+        bool known = false;
+        for (const char *key : DOCUMENT_KEYS) {
+            if (strcmp(entry.key().c_str(), key) == 0) known = true;
+        }
+        if (!known) {
+            return "unknown key";
+        }
+    }
+
+    JsonVariantConst maxTemperature = document["maxTemperature"];
+    if (!maxTemperature.isNull()) {
+        if (!maxTemperature.is<float>()) return "maxTemperature must be a number";
+        float value = maxTemperature.as<float>();
+        if (isnan(value) || value < RELAY_MAX_TEMPERATURE_LOWEST || value > RELAY_MAX_TEMPERATURE_HIGHEST) {
+            return "maxTemperature out of range";
+        }
+        draft.maxTemperature = value;
+        draft.validMask |= CONFIG_FIELD_MAX_TEMPERATURE;
+    }
+
+    JsonVariantConst maxTime = document["maxTime"];
+    if (!maxTime.isNull()) {
+        if (!maxTime.is<long>()) return "maxTime must be an integer";
+        long value = maxTime.as<long>();
+        if (value <= 0 || value > RELAY_MAX_TIME_LIMIT_SECONDS) return "maxTime out of range";
+        draft.maxTimeSeconds = (uint32_t)value;
+        draft.validMask |= CONFIG_FIELD_MAX_TIME;
+    }
+
+    JsonVariantConst offsets = document["temperatureOffsets"];
+    if (!offsets.isNull()) {
+        if (!offsets.is<JsonObjectConst>()) return "temperatureOffsets must be an object";
+        for (JsonPairConst entry : offsets.as<JsonObjectConst>()) {
+            int channel = -1;
+            for (int c = 0; c < TEMP_CHANNEL_COUNT; c++) {
+                if (strcmp(entry.key().c_str(), getTemperatureChannelName((TemperatureChannel)c)) == 0) channel = c;
+            }
+            if (channel < 0) return "unknown temperature channel";
+            if (!entry.value().is<float>()) return "temperature offset must be a number";
+            float value = entry.value().as<float>();
+            if (isnan(value) || fabsf(value) > TEMPERATURE_MAX_OFFSET) return "temperature offset out of range";
+            draft.temperatureOffset[channel] = value;
+        }
+        draft.validMask |= CONFIG_FIELD_TEMP_OFFSETS;
+    }
+
+    JsonVariantConst display = document["display"];
+    if (!display.isNull()) {
+        if (!display.is<JsonObjectConst>()) return "display must be an object";
+        DisplaySettings settings = (draft.validMask & CONFIG_FIELD_DISPLAY) ? draft.display : getDisplaySettings();
+        const char *error = applyDisplaySettingsJson(display, settings);
+        if (error != NULL) return error;
+        draft.display = settings;
+        draft.validMask |= CONFIG_FIELD_DISPLAY;
+    }
+
+    JsonVariantConst powerProfile = document["powerProfile"];
+    if (!powerProfile.isNull()) {
+        if (!powerProfile.is<const char*>()) return "powerProfile must be a string";
+        PowerProfile profile;
+        if (!parsePowerProfile(powerProfile.as<const char*>(), profile)) return "unknown powerProfile";
+        draft.powerProfile = (uint8_t)profile;
+    }
+
+    JsonVariantConst resolution = document["temperatureResolution"];
+    if (!resolution.isNull()) {
+        if (!resolution.is<int>()) return "temperatureResolution must be an integer";
+        int bits = resolution.as<int>();
+        if (bits < 9 || bits > 12) return "temperatureResolution out of range";
+        draft.temperatureResolution = (uint8_t)bits;
+    }
+
+    JsonVariantConst sensors = document["sensors"];
+    if (!sensors.isNull()) {
+        if (!sensors.is<JsonObjectConst>()) return "sensors must be an object";
+        const char *error = applySensorAssignment(sensors.as<JsonObjectConst>(), draft);
+        if (error != NULL) return error;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Assigns DS18B20 ROM addresses to channels: {"return":"28FF4A1B62180334","tank":""}.
+ * Channels not listed keep their assignment; "" returns a channel to bus order.
+ */
+static const char *applySensorAssignment(JsonObjectConst sensors, DeviceConfig &draft) {
+    static const uint8_t UNASSIGNED[8] = {0};
+    for (JsonPairConst entry : sensors) {
+        int channel = -1;
+        for (int c = 0; c < TEMP_CHANNEL_COUNT; c++) {
+            if (strcmp(entry.key().c_str(), getTemperatureChannelName((TemperatureChannel)c)) == 0) channel = c;
+        }
+        if (channel < 0) return "unknown temperature channel";
+        if (!entry.value().is<const char*>()) return "sensor address must be a string";
+        const char *hex = entry.value().as<const char*>();
+        if (hex[0] == '\0') {
+            memset(draft.sensorAddress[channel], 0, sizeof(draft.sensorAddress[channel]));
+        } else if (!parseTemperatureSensorAddress(hex, draft.sensorAddress[channel])) {
+            return "invalid sensor address";
+        }
+    }
+
+    // One probe cannot serve two channels
+    for (int a = 0; a < TEMP_CHANNEL_COUNT; a++) {
+        if (memcmp(draft.sensorAddress[a], UNASSIGNED, sizeof(UNASSIGNED)) == 0) continue;
+        for (int b = a + 1; b < TEMP_CHANNEL_COUNT; b++) {
+            if (memcmp(draft.sensorAddress[a], draft.sensorAddress[b], sizeof(UNASSIGNED)) == 0) {
+                return "sensor address assigned twice";
+            }
+        }
+    }
+    return NULL;
+}
+
+/** @brief Effective tunables in document form (same keys as the command). */
+static void configToJson(JsonObject json, const DeviceConfig &config) {
+    json["version"] = CONFIG_DOCUMENT_VERSION;
+    if (config.validMask & CONFIG_FIELD_MAX_TEMPERATURE) {
+        json["maxTemperature"] = config.maxTemperature;
+    }
+    json["maxTime"] = getStoredMaxTime();
+
+    JsonObject offsets = json.createNestedObject("temperatureOffsets");
+    for (int c = 0; c < TEMP_CHANNEL_COUNT; c++) {
+        offsets[getTemperatureChannelName((TemperatureChannel)c)] =
+            (config.validMask & CONFIG_FIELD_TEMP_OFFSETS) ? config.temperatureOffset[c] : 0.0f;
+    }
+
+    DisplaySettings settings = getDisplaySettings();
+    JsonObject display = json.createNestedObject("display");
+    display["dimSeconds"] = settings.dimAfterSeconds;
+    display["offSeconds"] = settings.offAfterSeconds;
+    display["dimContrast"] = settings.dimContrast;
+    display["shiftMinutes"] = settings.shiftMinutes;
+
+    json["powerProfile"] = getPowerProfileInfo().name;
+    json["temperatureResolution"] = config.temperatureResolution != 0 ? config.temperatureResolution
+                                                                       : TEMPERATURE_DEFAULT_RESOLUTION;
+
+    // Assigned channels only; the others follow bus order and never become the control channel
+    JsonObject sensors = json.createNestedObject("sensors");
+    static const uint8_t UNASSIGNED[8] = {0};
+    for (int c = 0; c < TEMP_CHANNEL_COUNT; c++) {
+        const uint8_t *address = config.sensorAddress[c];
+        if (memcmp(address, UNASSIGNED, sizeof(UNASSIGNED)) != 0) {
+            char hex[17];
+            for (int i = 0; i < 8; i++) {
+                snprintf(hex + 2 * i, 3, "%02X", address[i]);
+            }
+            sensors[getTemperatureChannelName((TemperatureChannel)c)] = hex;
+        }
+    }
+}
+
+/**
+ * @brief Stores or clears one backup WiFi profile (slots 1 and up; the primary is set by the portal).
+ * {"slot":1,"ssid":"Backup","password":"secret","priority":2} or {"slot":1,"clear":true}
+ */
+static void handleWiFiProfileCommand(const char* topic, const char* payload, unsigned int length) {
+    StaticJsonDocument<256> doc;
+    DeserializationError err = deserializeJson(doc, payload, length);
+    if (err) {
+        Log::error("Failed to parse wifi-profile command: %s", err.c_str());
+        publishWiFiProfiles("rejected", err.c_str());
+        return;
+    }
+
+    int slot = doc["slot"] | -1;
+    if (slot < 1 || slot >= WIFI_MAX_PROFILES) {
+        publishWiFiProfiles("rejected", "slot out of range");
+        return;
+    }
+
+    WiFiProfile profile;
+    memset(&profile, 0, sizeof(WiFiProfile));
+    if (!(doc["clear"] | false)) {
+        const char *ssid = doc["ssid"] | "";
+        const char *password = doc["password"] | "";
+        int priority = doc["priority"] | 0;
+        if (ssid[0] == '\0' || strlen(ssid) > WIFI_SSID_LENGTH) {
+            publishWiFiProfiles("rejected", "invalid ssid");
+            return;
+        }
+        if (strlen(password) > MAX_CRED_LENGTH) {
+            publishWiFiProfiles("rejected", "invalid password");
+            return;
+        }
+        if (priority < 0 || priority > WIFI_PROFILE_MAX_PRIORITY) {
+            publishWiFiProfiles("rejected", "priority out of range");
+            return;
+        }
+        strncpy(profile.ssid, ssid, WIFI_SSID_LENGTH);
+        strncpy(profile.password, password, MAX_CRED_LENGTH);
+        profile.priority = (uint8_t)priority;
+    }
+
+    if (!saveWiFiProfile((uint8_t)slot, profile)) {
+        publishWiFiProfiles("rejected", "storage error");
+        return;
+    }
+    publishWiFiProfiles("applied", NULL);
+}
+
+/** @brief Retained list of profile slots: SSID and priority only, never passwords. */
+static void publishWiFiProfiles(const char *result, const char *error) {
+    WiFiProfile profiles[WIFI_MAX_PROFILES];
+    loadWiFiProfiles(profiles);
+
+    DynamicJsonDocument doc(512);
+    JsonArray slots = doc.createNestedArray("profiles");
+    for (int p = 0; p < WIFI_MAX_PROFILES; p++) {
+        JsonObject entry = slots.createNestedObject();
+        entry["slot"] = p;
+        entry["ssid"] = profiles[p].ssid;
+        entry["priority"] = profiles[p].priority;
+    }
+    doc["result"] = result;
+    if (error != NULL) {
+        doc["error"] = error;
+    }
+
+    char payload[MQTT_PAYLOAD_MAX_LENGTH];
+    serializeJson(doc, payload, sizeof(payload));
+
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/telemetry/recirculator/%s/wifi-profile/reported", getDeviceId().c_str());
+    mqttPublish(topic, payload, true); // retain = true
+}
+
+/** @brief "ON" starts a power benchmark window (LED off, stats in the healthcheck), "OFF" ends it. */
+static void handlePowerBenchmarkCommand(const char* topic, const char* payload, unsigned int length) {
+    if (strcmp(payload, "ON") == 0) {
+        setPowerBenchmark(true);
+    } else if (strcmp(payload, "OFF") == 0) {
+        setPowerBenchmark(false);
+    } else {
+        Log::error("Invalid power-benchmark command received via MQTT: %s", payload);
+    }
+}
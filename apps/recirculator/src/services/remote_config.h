@@ -0,0 +1,73 @@
+// remote_config.h
+#ifndef REMOTE_CONFIG_H
+#define REMOTE_CONFIG_H
+
+#include <ArduinoJson.h>
+
+// Remote Config Module
+// Purpose:
+// Bulk configuration over MQTT: one versioned document carries every tunable, is validated as a
+// whole and applied atomically (single config store update, single flash commit). The effective
+// configuration is reported back as a retained document with a hash for fleet-wide drift checks.
+//
+// Command (JSON or MessagePack), omitted keys keep their value, unknown keys are rejected:
+//   {"version":1, "maxTemperature":35.0, "maxTime":120,
+//    "temperatureOffsets":{"outlet":0.0,"return":0.2,"tank":0.0},
+//    "display":{"dimSeconds":60,"offSeconds":600,"dimContrast":1,"shiftMinutes":5},
+//    "powerProfile":"balanced",  (standard, performance, balanced or low-power; see power_manager.h)
+//    "temperatureResolution":12, (DS18B20 bits, 9-12: 0.5 °C in 94 ms to 0.0625 °C in 750 ms)
+//    "sensors":{"outlet":"28FF4A1B62180334","return":"28FF0C2D71160421"}}
+// "sensors" assigns DS18B20 ROM addresses to channels ("" unassigns). Unassigned probes fill the
+// free channels in bus order and the pump is controlled on the outlet until "return" is assigned.
+// Reported (retained): the same keys plus "hash", "result", "probes" (ROM address found on each
+// channel) and, if rejected, "error".
+//
+// Backup WiFi profiles (slots 1-3, the primary comes from the config portal) use the wifi-profile
+// command: {"slot":1,"ssid":"Backup","password":"secret","priority":2} or {"slot":1,"clear":true}.
+// wifi-profile/reported (retained) lists every slot's SSID and priority, never the passwords.
+//
+// power-benchmark ("ON"/"OFF") turns the status LED off and adds wake counts and idle time to
+// each healthcheck, for current measurements of a power profile.
+
+#define CONFIG_DOCUMENT_VERSION 1
+
+/**
+ * @brief Registers the config, wifi-profile and power-benchmark MQTT commands.
+ * Call at boot with the other command handlers; subscriptions are (re)made on every connect.
+ */
+void initializeRemoteConfigCommands();
+
+/**
+ * @brief Publishes config/reported and wifi-profile/reported with result "current".
+ * Call after every MQTT connect.
+ */
+void publishRemoteConfigState();
+
+/**
+ * @brief Publishes the effective configuration on the retained config/reported topic.
+ * @param result Outcome of the last change: "current", "applied", "unchanged" or "rejected"
+ * @param error Reason for a rejection, or NULL
+ * @return true if the message was queued, false otherwise
+ * @note Thread-safe: Reads the config cache; publishes through the MQTT queue
+ */
+bool publishReportedConfig(const char *result, const char *error);
+
+/**
+ * @brief Validates and applies a config document (same format as the MQTT command), then publishes
+ * the reported state. Used by the MQTT command and the local API.
+ * @param payload JSON object or MessagePack document
+ * @param length Payload size in bytes
+ * @param error Set to the rejection reason, or NULL
+ * @return "applied", "unchanged" or "rejected"
+ * @note Thread-safe: The document is merged under the config store lock, so fields it omits keep
+ *       changes made concurrently by other setters
+ */
+const char *submitConfigDocument(const char *payload, unsigned int length, const char **error);
+
+/**
+ * @brief Writes the effective configuration in document form (without hash/result).
+ * @return true on success, false if the config store is not initialized
+ */
+bool getConfigDocument(JsonObject json);
+
+#endif // REMOTE_CONFIG_H
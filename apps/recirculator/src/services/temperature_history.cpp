@@ -0,0 +1,421 @@
+// temperature_history.cpp
+// Temperature History Module
+// Purpose: Multi-resolution in-RAM temperature history with on-demand binary export over MQTT
+// Architecture: Three static rings (1 s / 1 min / 15 min) fed by a per-second cursor; each
+//               completed minute folds into the minute ring and every 15 minutes into the quarter ring
+// Thread-Safety: historyMutex guards rings and accumulators (sensor task writes, MQTT/display tasks read)
+// Dependencies: mqtt_handler, device_id, UtcClock (via system_state)
+
+#include "temperature_history.h"
+
+// Project headers (alphabetically)
+#include "device_id.h"
+#include "mqtt_handler.h"
+#include "system_state.h"
+
+// Third-party libraries
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Log.h>
+
+// System headers
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Binary blob layout (little-endian), version 1:
+//   header: u8 version, u8 tier, u8 fieldCount, u8 reserved, u16 count, u16 periodSeconds, u32 newestUtc
+//   then fieldCount columns (raw: avg; aggregates: min, max, avg) of count values each.
+//   Each value is a delta from the previous non-gap value of the column (starting at 0):
+//   one int8 byte when it fits in [-127, 127], otherwise 0x80 followed by the absolute int16.
+//   Gaps are encoded as 0x80 + INT16_MIN.
+// MQTT chunks carry a 4-byte prefix: u8 tier, u8 chunkIndex, u8 chunkCount, u8 reserved.
+#define HISTORY_BLOB_VERSION 1
+#define HISTORY_BLOB_HEADER_SIZE 12
+#define HISTORY_DELTA_ESCAPE 0x80
+#define HISTORY_CHUNK_PREFIX_SIZE 4
+#define HISTORY_CHUNK_DATA_SIZE (MQTT_PAYLOAD_MAX_LENGTH - 1 - HISTORY_CHUNK_PREFIX_SIZE)
+#define HISTORY_MAX_CHUNKS (MQTT_PUBLISH_QUEUE_SIZE / 2) // Leave queue room for regular telemetry
+#define SECONDS_PER_MINUTE 60
+#define MINUTES_PER_QUARTER 15
+#define HISTORY_MAX_FILL_SECONDS (7UL * 24UL * 3600UL) // Longer gaps reset the history
+
+// Ring bookkeeping shared by the three tiers
+typedef struct {
+    uint16_t head;      // Next write index
+    uint16_t count;     // Valid entries
+    uint16_t capacity;
+} HistoryRing;
+
+// Running min/max/avg of the interval being built
+typedef struct {
+    int16_t minCenti;
+    int16_t maxCenti;
+    int32_t sumCenti;
+    uint16_t validCount;
+    uint16_t slots;     // Seconds (minute tier) or minutes (quarter tier) seen, including gaps
+} HistoryAccumulator;
+
+// Internal Variables
+static SemaphoreHandle_t historyMutex = NULL;
+static int16_t rawValues[HISTORY_RAW_SAMPLES];
+static HistoryEntry minuteEntries[HISTORY_MINUTE_SAMPLES];
+static HistoryEntry quarterEntries[HISTORY_QUARTER_SAMPLES];
+static HistoryRing rings[HISTORY_TIER_COUNT] = {
+    {0, 0, HISTORY_RAW_SAMPLES},
+    {0, 0, HISTORY_MINUTE_SAMPLES},
+    {0, 0, HISTORY_QUARTER_SAMPLES},
+};
+static const uint16_t TIER_PERIOD_SECONDS[HISTORY_TIER_COUNT] = {1, SECONDS_PER_MINUTE, SECONDS_PER_MINUTE * MINUTES_PER_QUARTER};
+static const char *const TIER_NAMES[HISTORY_TIER_COUNT] = {"raw", "minute", "quarter"};
+static HistoryAccumulator minuteAccumulator;
+static HistoryAccumulator quarterAccumulator;
+static bool historyStarted = false;
+static uint32_t lastSampleSecond = 0;           // Uptime second of the newest raw entry
+static int16_t lastSampleCenti = HISTORY_GAP_VALUE;
+static uint32_t tierNewestSecond[HISTORY_TIER_COUNT] = {0}; // Uptime second closing the newest entry
+
+// Internal Function Declarations
+static void handleHistoryCommand(const char* topic, const char* payload, unsigned int length);
+static void resetHistory();
+static void pushSecond(int16_t valueCenti, uint32_t second);
+static void pushGapSeconds(uint32_t first, uint32_t count);
+static void skipGapEntries(HistoryTier tier, uint32_t count);
+static uint16_t ringPush(HistoryRing &ring);
+static void accumulate(HistoryAccumulator &acc, int16_t minCenti, int16_t maxCenti, int16_t avgCenti);
+static HistoryEntry finishAccumulator(HistoryAccumulator &acc);
+static size_t copyTier(HistoryTier tier, HistoryEntry *out, size_t maxCount);
+static size_t encodeBlob(HistoryTier tier, const HistoryEntry *entries, size_t count, uint32_t newestUtc,
+                         uint8_t *buffer, size_t bufferSize);
+
+bool initializeTemperatureHistory() {
+    historyMutex = xSemaphoreCreateMutex();
+    if (historyMutex == NULL) {
+        Log::error("Failed to create temperature history mutex.");
+        return false;
+    }
+    resetHistory();
+    Log::info("Temperature history ready (%u/%u/%u entries).",
+              HISTORY_RAW_SAMPLES, HISTORY_MINUTE_SAMPLES, HISTORY_QUARTER_SAMPLES);
+    return true;
+}
+
+void initializeTemperatureHistoryCommands() {
+    char topic[128];
+    snprintf(topic, sizeof(topic), "mica/dev/command/recirculator/%s/history", getDeviceId().c_str());
+    mqttSubscribe(topic, handleHistoryCommand);
+}
+
+void recordTemperatureHistory(float temperature, uint32_t nowMs) {
+    if (historyMutex == NULL) return;
+
+    int16_t valueCenti = HISTORY_GAP_VALUE;
+    if (temperature != -127.0f) {
+        long centi = lroundf(temperature * 100.0f);
+        valueCenti = (int16_t)((centi <= INT16_MIN) ? INT16_MIN + 1 : (centi > INT16_MAX) ? INT16_MAX : centi);
+    }
+    uint32_t second = nowMs / 1000;
+
+    if (xSemaphoreTake(historyMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        Log::warn("Could not acquire temperature history mutex.");
+        return;
+    }
+
+    if (!historyStarted) {
+        historyStarted = true;
+        lastSampleSecond = second - 1;
+    } else if (second <= lastSampleSecond) {
+        // Early wake-up within the same second: the second is already recorded
+        xSemaphoreGive(historyMutex);
+        return;
+    } else if (second - lastSampleSecond > HISTORY_MAX_FILL_SECONDS) {
+        resetHistory();
+        historyStarted = true;
+        lastSampleSecond = second - 1;
+    }
+
+    // Sample-and-hold across the idle sampling interval; longer gaps are marked as such
+    uint32_t holdEnd = min(second, lastSampleSecond + 1 + HISTORY_HOLD_SECONDS);
+    for (uint32_t s = lastSampleSecond + 1; s < holdEnd; s++) {
+        pushSecond(lastSampleCenti, s);
+    }
+    if (holdEnd < second) {
+        pushGapSeconds(holdEnd, second - holdEnd);
+    }
+    pushSecond(valueCenti, second);
+    lastSampleSecond = second;
+    lastSampleCenti = valueCenti;
+
+    xSemaphoreGive(historyMutex);
+}
+
+size_t getTemperatureHistory(HistoryTier tier, HistoryEntry *out, size_t maxCount) {
+    if (historyMutex == NULL || tier >= HISTORY_TIER_COUNT) return 0;
+
+    if (xSemaphoreTake(historyMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        Log::warn("Could not acquire temperature history mutex.");
+        return 0;
+    }
+    size_t count = copyTier(tier, out, maxCount);
+    xSemaphoreGive(historyMutex);
+    return count;
+}
+
+/** @brief Handles {"tier":"raw|minute|quarter","count":N}; replies with chunked binary blobs. */
+static void handleHistoryCommand(const char* topic, const char* payload, unsigned int length) {
+    StaticJsonDocument<128> doc;
+    DeserializationError err = deserializeJson(doc, payload, length);
+    if (err) {
+        Log::error("Failed to parse history command: %s", err.c_str());
+        return;
+    }
+
+    const char* tierName = doc["tier"] | "minute";
+    int tier = -1;
+    for (int t = 0; t < HISTORY_TIER_COUNT; t++) {
+        if (strcmp(tierName, TIER_NAMES[t]) == 0) tier = t;
+    }
+    if (tier < 0) {
+        Log::error("Unknown history tier: %s", tierName);
+        return;
+    }
+    size_t requested = doc["count"] | (uint32_t)rings[tier].capacity;
+    requested = min(requested, (size_t)rings[tier].capacity);
+
+    // Copy out under the mutex, encode without it
+    HistoryEntry *entries = (HistoryEntry*)malloc(requested * sizeof(HistoryEntry));
+    size_t blobCapacity = HISTORY_BLOB_HEADER_SIZE + requested * 3 * 3;
+    uint8_t *blob = (uint8_t*)malloc(blobCapacity);
+    if (entries == NULL || blob == NULL) {
+        Log::error("Not enough memory for history export.");
+        free(entries);
+        free(blob);
+        return;
+    }
+
+    uint32_t newestSecond = 0;
+    size_t count = 0;
+    if (xSemaphoreTake(historyMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        count = copyTier((HistoryTier)tier, entries, requested);
+        newestSecond = tierNewestSecond[tier];
+        xSemaphoreGive(historyMutex);
+    }
+
+    UtcClock &clock = getUtcClock();
+    uint32_t newestUtc = (clock.isTimeValid() && count > 0)
+                             ? (uint32_t)(clock.getTime((uint64_t)newestSecond * 1000ULL) / 1000ULL)
+                             : 0;
+
+    // Drop the oldest entries until the blob fits the chunk budget
+    size_t blobSize = encodeBlob((HistoryTier)tier, entries, count, newestUtc, blob, blobCapacity);
+    while (blobSize > (size_t)HISTORY_MAX_CHUNKS * HISTORY_CHUNK_DATA_SIZE && count > 1) {
+        size_t keep = count / 2;
+        memmove(entries, entries + (count - keep), keep * sizeof(HistoryEntry));
+        count = keep;
+        blobSize = encodeBlob((HistoryTier)tier, entries, count, newestUtc, blob, blobCapacity);
+    }
+
+    char responseTopic[128];
+    snprintf(responseTopic, sizeof(responseTopic), "mica/dev/telemetry/recirculator/%s/history", getDeviceId().c_str());
+    uint8_t chunkCount = (uint8_t)((blobSize + HISTORY_CHUNK_DATA_SIZE - 1) / HISTORY_CHUNK_DATA_SIZE);
+    uint8_t chunk[HISTORY_CHUNK_PREFIX_SIZE + HISTORY_CHUNK_DATA_SIZE];
+    for (uint8_t i = 0; i < chunkCount; i++) {
+        size_t offset = (size_t)i * HISTORY_CHUNK_DATA_SIZE;
+        size_t chunkSize = min((size_t)HISTORY_CHUNK_DATA_SIZE, blobSize - offset);
+        chunk[0] = (uint8_t)tier;
+        chunk[1] = i;
+        chunk[2] = chunkCount;
+        chunk[3] = 0;
+        memcpy(chunk + HISTORY_CHUNK_PREFIX_SIZE, blob + offset, chunkSize);
+        if (!mqttPublishBinary(responseTopic, chunk, HISTORY_CHUNK_PREFIX_SIZE + chunkSize, false)) {
+            Log::error("History export aborted at chunk %u/%u.", i + 1, chunkCount);
+            break;
+        }
+    }
+    Log::info("History export: tier %s, %u entries, %u bytes in %u chunks.",
+              TIER_NAMES[tier], (unsigned)count, (unsigned)blobSize, chunkCount);
+
+    free(entries);
+    free(blob);
+}
+
+/** @brief Clears all tiers. Caller holds historyMutex (or runs before tasks start). */
+static void resetHistory() {
+    for (int t = 0; t < HISTORY_TIER_COUNT; t++) {
+        rings[t].head = 0;
+        rings[t].count = 0;
+        tierNewestSecond[t] = 0;
+    }
+    memset(&minuteAccumulator, 0, sizeof(minuteAccumulator));
+    memset(&quarterAccumulator, 0, sizeof(quarterAccumulator));
+    historyStarted = false;
+    lastSampleCenti = HISTORY_GAP_VALUE;
+}
+
+/** @brief Appends one second to the raw tier and folds completed minutes/quarters. Caller holds historyMutex. */
+static void pushSecond(int16_t valueCenti, uint32_t second) {
+    rawValues[ringPush(rings[HISTORY_TIER_RAW])] = valueCenti;
+    tierNewestSecond[HISTORY_TIER_RAW] = second;
+
+    accumulate(minuteAccumulator, valueCenti, valueCenti, valueCenti);
+    if (minuteAccumulator.slots < SECONDS_PER_MINUTE) return;
+
+    HistoryEntry minute = finishAccumulator(minuteAccumulator);
+    minuteEntries[ringPush(rings[HISTORY_TIER_MINUTE])] = minute;
+    tierNewestSecond[HISTORY_TIER_MINUTE] = second;
+
+    accumulate(quarterAccumulator, minute.minCenti, minute.maxCenti, minute.avgCenti);
+    if (quarterAccumulator.slots < MINUTES_PER_QUARTER) return;
+
+    quarterEntries[ringPush(rings[HISTORY_TIER_QUARTER])] = finishAccumulator(quarterAccumulator);
+    tierNewestSecond[HISTORY_TIER_QUARTER] = second;
+}
+
+/**
+ * @brief Records count gap seconds starting at first, with the same result as count pushSecond() calls.
+ * Whole minutes and quarters are written to each tier directly, so the cost is bounded by the ring
+ * sizes rather than the gap length. Caller holds historyMutex.
+ */
+static void pushGapSeconds(uint32_t first, uint32_t count) {
+    uint32_t second = first;
+    uint32_t end = first + count;
+
+    // Finish the minute in progress second by second
+    while (second < end && minuteAccumulator.slots != 0) {
+        pushSecond(HISTORY_GAP_VALUE, second++);
+    }
+
+    while (end - second >= SECONDS_PER_MINUTE) {
+        const uint32_t quarterSeconds = SECONDS_PER_MINUTE * MINUTES_PER_QUARTER;
+        if (quarterAccumulator.slots == 0 && end - second >= quarterSeconds) {
+            // Whole quarters: every tier gets gap entries, both accumulators stay empty
+            uint32_t quarters = (end - second) / quarterSeconds;
+            skipGapEntries(HISTORY_TIER_RAW, quarters * quarterSeconds);
+            skipGapEntries(HISTORY_TIER_MINUTE, quarters * MINUTES_PER_QUARTER);
+            skipGapEntries(HISTORY_TIER_QUARTER, quarters);
+            second += quarters * quarterSeconds;
+            tierNewestSecond[HISTORY_TIER_QUARTER] = second - 1;
+        } else {
+            // One whole minute, folded into the quarter in progress
+            skipGapEntries(HISTORY_TIER_RAW, SECONDS_PER_MINUTE);
+            skipGapEntries(HISTORY_TIER_MINUTE, 1);
+            second += SECONDS_PER_MINUTE;
+            accumulate(quarterAccumulator, HISTORY_GAP_VALUE, HISTORY_GAP_VALUE, HISTORY_GAP_VALUE);
+            if (quarterAccumulator.slots >= MINUTES_PER_QUARTER) {
+                quarterEntries[ringPush(rings[HISTORY_TIER_QUARTER])] = finishAccumulator(quarterAccumulator);
+                tierNewestSecond[HISTORY_TIER_QUARTER] = second - 1;
+            }
+        }
+        tierNewestSecond[HISTORY_TIER_RAW] = second - 1;
+        tierNewestSecond[HISTORY_TIER_MINUTE] = second - 1;
+    }
+
+    while (second < end) {
+        pushSecond(HISTORY_GAP_VALUE, second++);
+    }
+}
+
+/** @brief Appends count gap entries to a tier's ring; past a full ring only the head moves. */
+static void skipGapEntries(HistoryTier tier, uint32_t count) {
+    HistoryRing &ring = rings[tier];
+    uint32_t written = min(count, (uint32_t)ring.capacity);
+    for (uint32_t i = 0; i < written; i++) {
+        uint16_t index = ringPush(ring);
+        if (tier == HISTORY_TIER_RAW) {
+            rawValues[index] = HISTORY_GAP_VALUE;
+        } else {
+            HistoryEntry &entry = (tier == HISTORY_TIER_MINUTE) ? minuteEntries[index] : quarterEntries[index];
+            entry = {HISTORY_GAP_VALUE, HISTORY_GAP_VALUE, HISTORY_GAP_VALUE};
+        }
+    }
+    // The ring is all gaps now, so skipping the remaining slots only has to keep the phase
+    ring.head = (ring.head + (count - written) % ring.capacity) % ring.capacity;
+}
+
+/** @brief Reserves the next slot of a ring, evicting the oldest when full. */
+static uint16_t ringPush(HistoryRing &ring) {
+    uint16_t index = ring.head;
+    ring.head = (ring.head + 1) % ring.capacity;
+    if (ring.count < ring.capacity) ring.count++;
+    return index;
+}
+
+static void accumulate(HistoryAccumulator &acc, int16_t minCenti, int16_t maxCenti, int16_t avgCenti) {
+    acc.slots++;
+    if (avgCenti == HISTORY_GAP_VALUE) return;
+    if (acc.validCount == 0 || minCenti < acc.minCenti) acc.minCenti = minCenti;
+    if (acc.validCount == 0 || maxCenti > acc.maxCenti) acc.maxCenti = maxCenti;
+    acc.sumCenti += avgCenti;
+    acc.validCount++;
+}
+
+/** @brief Closes an interval; an interval without any valid value becomes a gap. */
+static HistoryEntry finishAccumulator(HistoryAccumulator &acc) {
+    HistoryEntry entry = {HISTORY_GAP_VALUE, HISTORY_GAP_VALUE, HISTORY_GAP_VALUE};
+    if (acc.validCount > 0) {
+        entry.minCenti = acc.minCenti;
+        entry.maxCenti = acc.maxCenti;
+        entry.avgCenti = (int16_t)(acc.sumCenti / acc.validCount);
+    }
+    memset(&acc, 0, sizeof(acc));
+    return entry;
+}
+
+/** @brief Copies the newest maxCount entries, oldest first. Caller holds historyMutex. */
+static size_t copyTier(HistoryTier tier, HistoryEntry *out, size_t maxCount) {
+    const HistoryRing &ring = rings[tier];
+    size_t count = min((size_t)ring.count, maxCount);
+    size_t start = (ring.head + ring.capacity - count) % ring.capacity;
+    for (size_t i = 0; i < count; i++) {
+        size_t index = (start + i) % ring.capacity;
+        if (tier == HISTORY_TIER_RAW) {
+            int16_t value = rawValues[index];
+            out[i] = {value, value, value};
+        } else {
+            out[i] = (tier == HISTORY_TIER_MINUTE) ? minuteEntries[index] : quarterEntries[index];
+        }
+    }
+    return count;
+}
+
+static size_t encodeBlob(HistoryTier tier, const HistoryEntry *entries, size_t count, uint32_t newestUtc,
+                         uint8_t *buffer, size_t bufferSize) {
+    uint8_t fieldCount = (tier == HISTORY_TIER_RAW) ? 1 : 3;
+    if (bufferSize < HISTORY_BLOB_HEADER_SIZE + count * fieldCount * 3) return 0;
+
+    uint16_t period = TIER_PERIOD_SECONDS[tier];
+    buffer[0] = HISTORY_BLOB_VERSION;
+    buffer[1] = (uint8_t)tier;
+    buffer[2] = fieldCount;
+    buffer[3] = 0;
+    buffer[4] = count & 0xFF;
+    buffer[5] = (count >> 8) & 0xFF;
+    buffer[6] = period & 0xFF;
+    buffer[7] = (period >> 8) & 0xFF;
+    for (int i = 0; i < 4; i++) {
+        buffer[8 + i] = (newestUtc >> (8 * i)) & 0xFF;
+    }
+
+    size_t pos = HISTORY_BLOB_HEADER_SIZE;
+    for (uint8_t field = 0; field < fieldCount; field++) {
+        int16_t previous = 0;
+        for (size_t i = 0; i < count; i++) {
+            const HistoryEntry &entry = entries[i];
+            int16_t value = (fieldCount == 1) ? entry.avgCenti
+                          : (field == 0)      ? entry.minCenti
+                          : (field == 1)      ? entry.maxCenti
+                                              : entry.avgCenti;
+            int32_t delta = (int32_t)value - previous;
+            if (value != HISTORY_GAP_VALUE && delta >= -127 && delta <= 127) {
+                buffer[pos++] = (uint8_t)(int8_t)delta;
+            } else {
+                buffer[pos++] = HISTORY_DELTA_ESCAPE;
+                buffer[pos++] = (uint16_t)value & 0xFF;
+                buffer[pos++] = ((uint16_t)value >> 8) & 0xFF;
+            }
+            if (value != HISTORY_GAP_VALUE) previous = value;
+        }
+    }
+    return pos;
+}
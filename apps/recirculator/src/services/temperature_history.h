@@ -0,0 +1,68 @@
+// temperature_history.h
+#ifndef TEMPERATURE_HISTORY_H
+#define TEMPERATURE_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Temperature History Module
+// Purpose:
+// In-RAM multi-resolution history of the control temperature: 1 s samples for 10 minutes,
+// 1-minute min/max/avg for 24 hours and 15-minute min/max/avg for 7 days.
+// Any tier can be requested over MQTT as a compact delta-encoded binary blob.
+
+#define HISTORY_RAW_SAMPLES 600       // 1 s resolution, 10 minutes
+#define HISTORY_MINUTE_SAMPLES 1440   // 1 min resolution, 24 hours
+#define HISTORY_QUARTER_SAMPLES 672   // 15 min resolution, 7 days
+#define HISTORY_HOLD_SECONDS 30       // Longest gap between sensor samples filled by holding the last value
+#define HISTORY_GAP_VALUE INT16_MIN   // Marks seconds/intervals without a valid reading
+
+/**
+ * @brief Resolution tiers.
+ */
+typedef enum {
+    HISTORY_TIER_RAW = 0,   // 1 s, single value per entry
+    HISTORY_TIER_MINUTE,    // 1 min, min/max/avg
+    HISTORY_TIER_QUARTER,   // 15 min, min/max/avg
+    HISTORY_TIER_COUNT
+} HistoryTier;
+
+/**
+ * @brief One history entry in centi-degrees (0.01 °C). Raw entries have min = max = avg.
+ */
+typedef struct {
+    int16_t minCenti;
+    int16_t maxCenti;
+    int16_t avgCenti;
+} HistoryEntry;
+
+/**
+ * @brief Creates the history mutex. The rings live in static RAM (~14 KB).
+ * @return true if initialization is successful, false otherwise.
+ */
+bool initializeTemperatureHistory();
+
+/**
+ * @brief Registers the history MQTT command. Must be called after MQTT connects.
+ */
+void initializeTemperatureHistoryCommands();
+
+/**
+ * @brief Records a sensor sample; fills the seconds since the previous one.
+ * @param temperature Temperature in °C, -127.0 for a sensor error
+ * @param nowMs millis() of the sample
+ * @note Thread-safe; called by the temperature sensor task at its sampling rate
+ */
+void recordTemperatureHistory(float temperature, uint32_t nowMs);
+
+/**
+ * @brief Copies the newest entries of a tier, oldest first.
+ * @param tier Resolution tier
+ * @param out Destination array
+ * @param maxCount Capacity of out
+ * @return Number of entries copied
+ * @note Thread-safe: Can be called from any task
+ */
+size_t getTemperatureHistory(HistoryTier tier, HistoryEntry *out, size_t maxCount);
+
+#endif // TEMPERATURE_HISTORY_H
@@ -0,0 +1,122 @@
+// temperature_predictor.cpp
+// Temperature Predictor Module
+// Purpose: Sliding-window slope estimation used by the relay controller to stop the pump before overshoot
+// Architecture: Ring buffer fed by the sensor task, least-squares fit computed on demand by the relay task
+// Thread-Safety: predictorMutex protects the ring buffer
+// Dependencies: FreeRTOS semaphores, Log
+
+#include "temperature_predictor.h"
+
+// Third-party libraries
+#include <Log.h>
+
+// System headers
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stdint.h>
+
+// Internal Variables
+static float sampleTemperature[PREDICTOR_MAX_SAMPLES];
+static uint32_t sampleTimestampMs[PREDICTOR_MAX_SAMPLES];
+static uint8_t sampleHead = 0;  // Next slot to write
+static uint8_t sampleCount = 0; // Valid samples in the ring
+static SemaphoreHandle_t predictorMutex = NULL;
+
+// Internal Function Declarations
+static bool fitLinearTrend(uint32_t nowMs, float &latest, float &slopePerSecond, uint8_t &used);
+
+bool initializeTemperaturePredictor() {
+    predictorMutex = xSemaphoreCreateMutex();
+    if (predictorMutex == NULL) {
+        Log::error("Failed to create predictor mutex.");
+        return false;
+    }
+    sampleHead = 0;
+    sampleCount = 0;
+    return true;
+}
+
+void recordTemperatureSample(float temperature, uint32_t timestampMs) {
+    if (predictorMutex == NULL) return;
+
+    if (xSemaphoreTake(predictorMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        sampleTemperature[sampleHead] = temperature;
+        sampleTimestampMs[sampleHead] = timestampMs;
+        sampleHead = (sampleHead + 1) % PREDICTOR_MAX_SAMPLES;
+        if (sampleCount < PREDICTOR_MAX_SAMPLES) {
+            sampleCount++;
+        }
+        xSemaphoreGive(predictorMutex);
+    }
+}
+
+bool predictTemperature(uint32_t nowMs, uint32_t horizonMs, TemperatureProjection &projection) {
+    if (predictorMutex == NULL) return false;
+
+    float latest = 0.0f;
+    float slope = 0.0f;
+    uint8_t used = 0;
+    bool fitted = false;
+
+    if (xSemaphoreTake(predictorMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        fitted = fitLinearTrend(nowMs, latest, slope, used);
+        xSemaphoreGive(predictorMutex);
+    }
+
+    if (!fitted) {
+        return false;
+    }
+
+    projection.latestTemperature = latest;
+    projection.slopePerSecond = slope;
+    projection.samplesUsed = used;
+    // Only a rising trend is extrapolated; cooling never produces an early stop
+    projection.projectedTemperature = (slope > 0.0f) ? latest + slope * (horizonMs / 1000.0f) : latest;
+    return true;
+}
+
+/** @brief Least-squares line over the samples inside PREDICTOR_WINDOW_MS.
+ * Time is measured relative to the newest sample so the intercept is the fitted
+ * "now" value and the float sums stay well conditioned.
+ * @note Caller must hold predictorMutex.
+ */
+static bool fitLinearTrend(uint32_t nowMs, float &latest, float &slopePerSecond, uint8_t &used) {
+    if (sampleCount < PREDICTOR_MIN_SAMPLES) {
+        return false;
+    }
+
+    uint8_t newest = (sampleHead + PREDICTOR_MAX_SAMPLES - 1) % PREDICTOR_MAX_SAMPLES;
+    uint32_t newestMs = sampleTimestampMs[newest];
+
+    float sumT = 0.0f, sumY = 0.0f, sumTT = 0.0f, sumTY = 0.0f;
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < sampleCount; i++) {
+        uint8_t idx = (newest + PREDICTOR_MAX_SAMPLES - i) % PREDICTOR_MAX_SAMPLES;
+        if (nowMs - sampleTimestampMs[idx] > PREDICTOR_WINDOW_MS) {
+            break; // Older samples are outside the window
+        }
+        float t = -(float)(newestMs - sampleTimestampMs[idx]) / 1000.0f; // seconds, <= 0
+        float y = sampleTemperature[idx];
+        sumT += t;
+        sumY += y;
+        sumTT += t * t;
+        sumTY += t * y;
+        n++;
+    }
+
+    if (n < PREDICTOR_MIN_SAMPLES) {
+        return false;
+    }
+
+    float denominator = n * sumTT - sumT * sumT;
+    if (denominator <= 0.0f) {
+        return false; // All samples share the same timestamp
+    }
+
+    slopePerSecond = (n * sumTY - sumT * sumY) / denominator;
+    float intercept = (sumY - slopePerSecond * sumT) / n;
+    // Extrapolate from the newest sample to "now" so stale samples don't hide the rise
+    latest = intercept + slopePerSecond * ((nowMs - newestMs) / 1000.0f);
+    used = n;
+    return true;
+}
@@ -0,0 +1,52 @@
+// temperature_predictor.h
+#ifndef TEMPERATURE_PREDICTOR_H
+#define TEMPERATURE_PREDICTOR_H
+
+#include <stdint.h>
+
+// Temperature Predictor Module
+// Purpose:
+// Keeps a sliding window of recent temperature samples, fits the temperature rise with a
+// least-squares line and projects it forward to compensate the DS18B20 thermal lag.
+
+#define PREDICTOR_MAX_SAMPLES 32        // Ring buffer capacity (twice the window at the 1 Hz active rate)
+#define PREDICTOR_WINDOW_MS 15000       // Only samples newer than this are used for the fit; longer
+                                        // windows keep the flat lead-in and miss a steep front
+#define PREDICTOR_MIN_SAMPLES 3         // Minimum samples inside the window to trust the fit
+
+/**
+ * @brief Result of a temperature projection.
+ */
+typedef struct {
+    float latestTemperature;   // Most recent sample (°C)
+    float projectedTemperature; // Temperature expected at now + horizon (°C)
+    float slopePerSecond;      // Fitted slope (°C/s)
+    uint8_t samplesUsed;       // Samples that contributed to the fit
+} TemperatureProjection;
+
+/**
+ * @brief Initializes the predictor (creates the mutex and clears the window).
+ * @return true if initialization is successful, false otherwise.
+ */
+bool initializeTemperaturePredictor();
+
+/**
+ * @brief Adds a valid temperature sample to the sliding window.
+ * @param temperature Temperature in Celsius (sensor errors must be filtered by the caller)
+ * @param timestampMs Sample time in milliseconds (millis())
+ * @note Thread-safe: Called from the temperature sensor task
+ */
+void recordTemperatureSample(float temperature, uint32_t timestampMs);
+
+/**
+ * @brief Projects the temperature forward using the slope fitted over the window.
+ * @param nowMs Current time in milliseconds (millis())
+ * @param horizonMs Time to project beyond now (typically the sensor lag)
+ * @param projection Output projection
+ * @return true if enough recent samples exist for a fit, false otherwise
+ * @note Thread-safe: Called from the relay controller task
+ * @note A falling or flat trend never projects above the latest sample
+ */
+bool predictTemperature(uint32_t nowMs, uint32_t horizonMs, TemperatureProjection &projection);
+
+#endif // TEMPERATURE_PREDICTOR_H
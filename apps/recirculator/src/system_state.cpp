@@ -8,15 +8,24 @@
 #include "system_state.h"
 
 // Project headers (alphabetically)
+#include "boot_sequence.h"
 #include "button_manager.h"
 #include "config.h"
+#include "cycle_log.h"
 #include "device_id.h"
 #include "display_manager.h"
 #include "eeprom_config.h"
+#include "lan_control.h"
 #include "led_manager.h"
+#include "local_api.h"
 #include "mqtt_handler.h"
 #include "ota_manager.h"
+#include "power_manager.h"
+#include "recirculation_scheduler.h"
 #include "relay_controller.h"
+#include "remote_config.h"
+#include "temperature_history.h"
+#include "temperature_predictor.h"
 #include "temperature_sensor.h"
 #include "wifi_config_mode.h"
 #include "wifi_connect.h"
@@ -36,6 +45,7 @@ volatile SystemState g_systemState = SYSTEM_STATE_CONNECTING; // Initial system
 static SemaphoreHandle_t g_stateMutex = NULL;                 // Mutex to protect the system state
 static TaskHandle_t g_stateManagerTaskHandle = NULL;          // Handle for the state management task
 static SystemState lastLoggedState = SYSTEM_STATE_ERROR;      // Last logged state
+static UtcClock g_utcClock("pool.ntp.org", "time.google.com"); // Shared NTP clock
 
 // Task Handles
 static TaskHandle_t g_wifiConnectTaskHandle = NULL;    // WiFi connection task
@@ -48,22 +58,68 @@ static TaskHandle_t g_otaTaskHandle = NULL;            // OTA update task
 static TaskHandle_t g_displayManagerTaskHandle = NULL; // Display manager task
 static TaskHandle_t g_temperatureSensorTaskHandle = NULL; // Temperature sensor task
 static TaskHandle_t g_relayTaskHandle = NULL;          // Relay controller task
+static TaskHandle_t g_schedulerTaskHandle = NULL;      // Recirculation scheduler task
+static TaskHandle_t g_configWriterTaskHandle = NULL;   // EEPROM config write-behind task
+static TaskHandle_t g_cycleLogWriterTaskHandle = NULL; // Cycle log flash append task
+static TaskHandle_t g_lanControlTaskHandle = NULL;     // LAN control command dispatch task
+static TaskHandle_t g_localApiConfigTaskHandle = NULL; // Local API config document task
 
 void setOtaTaskHandle(TaskHandle_t handle) {
     g_otaTaskHandle = handle;
 }
 
+UtcClock& getUtcClock() {
+    return g_utcClock;
+}
+
 // Internal Function Declarations
 static void stateManagementTask(void *pvParameters);   // Main state management task
 static void handleStateTransitions();                  // Handles state transitions based on events
 static void handleStateActions();                      // Executes actions corresponding to the current state
 static bool initializeLogSystem();                     // Initializes the logging system
 static void logTask(void *pvParameters);               // Task that processes log messages
+static bool initializeSensorServices();                // Boot job: sensors, predictor, history
+static bool initializeStorageServices();               // Boot job: cycle log, scheduler
 
 //------------------------------------------------------------------------------
 // System Initialization
 //------------------------------------------------------------------------------
+/** @brief Boot job: temperature sensors and the services fed by them (1-Wire bus). */
+static bool initializeSensorServices() {
+    if (!initializeTemperatureSensor()) {
+        Log::error("Failed to initialize Temperature Sensor.");
+        return false;
+    }
+
+    if (!initializeTemperaturePredictor()) {
+        Log::error("Failed to initialize Temperature Predictor.");
+        return false;
+    }
+
+    if (!initializeTemperatureHistory()) {
+        Log::error("Failed to initialize Temperature History.");
+        return false;
+    }
+    return true;
+}
+
+/** @brief Boot job: services restoring persisted data (LittleFS and NVS share the flash). */
+static bool initializeStorageServices() {
+    if (!initializeCycleLog()) {
+        Log::error("Failed to initialize Cycle Log.");
+        return false;
+    }
+
+    if (!initializeRecirculationScheduler()) {
+        Log::error("Failed to initialize Recirculation Scheduler.");
+        return false;
+    }
+    return true;
+}
+
 bool initializeSystemState() {
+    bootPhaseStart(BOOT_PHASE_CORE);
+
     // Create mutex to protect the system state
     g_stateMutex = xSemaphoreCreateMutex();
     if (g_stateMutex == NULL) {
@@ -82,39 +138,63 @@ bool initializeSystemState() {
         return false;
     }
 
-    initializeLedManager();
-    initializeButtonManager();
+    // Create State Management Task FIRST to avoid NULL handle errors; every task handle it
+    // suspends/resumes is NULL-checked, so tasks created later are picked up on its next cycle
+    if (xTaskCreate(stateManagementTask, "State Management Task", 4096, NULL, 3, &g_stateManagerTaskHandle) != pdPASS) {
+        Log::error("Failed to create State Management Task.");
+        return false;
+    }
+    bootPhaseEnd(BOOT_PHASE_CORE);
 
+    // Start WiFi association before anything else: it is the longest path to MQTT
+    // and runs in the background while the drivers initialize
+    bootPhaseStart(BOOT_PHASE_NETWORK);
     if (!initializeWiFiConnection()) {
         return false;
     }
+    initializePowerManager(); // Needs the WiFi driver; on failure the device just runs at full power
 
-    if (!initializeDisplayManager()) {
-        Log::error("Failed to initialize Display Manager.");
+    if (xTaskCreate(wifiConnectTask, "WiFi Connect Task", 4096, NULL, 2, &g_wifiConnectTaskHandle) != pdPASS) {
+        Log::error("Failed to create WiFi Connect Task.");
         return false;
-    } // Inicialitza la display OLED
+    }
 
-    initializeOTAManager();
+    // SNTP needs the network interface created by initializeWiFiConnection()
+    g_utcClock.init();
+    bootPhaseEnd(BOOT_PHASE_NETWORK);
 
-    if (!initializeTemperatureSensor()) {
-        Log::error("Failed to initialize Temperature Sensor.");
-        return false;
-    }
+    // Independent drivers/services run concurrently (I2C display, 1-Wire sensors, flash storage)
+    bootPhaseStart(BOOT_PHASE_DRIVERS);
+    initializeLedManager();     // LED self-test runs later in ledTask
+    initializeButtonManager();
+    initializeOTAManager();
 
-    // Create State Management Task FIRST to avoid NULL handle errors
-    if (xTaskCreate(stateManagementTask, "State Management Task", 4096, NULL, 3, &g_stateManagerTaskHandle) != pdPASS) {
-        Log::error("Failed to create State Management Task.");
+    static const BootJob driverJobs[] = {
+        {"display", initializeDisplayManager},
+        {"sensors", initializeSensorServices},
+        {"storage", initializeStorageServices},
+    };
+    if (!runBootJobs(driverJobs, sizeof(driverJobs) / sizeof(driverJobs[0]), BOOT_DRIVER_INIT_TIMEOUT_MS)) {
+        Log::error("Failed to initialize drivers.");
         return false;
     }
-    
-    // Give state manager time to initialize
-    vTaskDelay(pdMS_TO_TICKS(100));
+    bootPhaseEnd(BOOT_PHASE_DRIVERS);
 
     // Create System Tasks with logs and verify their creation
-    if (xTaskCreate(wifiConnectTask, "WiFi Connect Task", 4096, NULL, 2, &g_wifiConnectTaskHandle) != pdPASS) {
-        Log::error("Failed to create WiFi Connect Task.");
+    bootPhaseStart(BOOT_PHASE_TASKS);
+
+    // Command handlers are registered before the broker is reachable: LAN control runs them offline.
+    // Modules with a reported state publish it on every MQTT connect.
+    if (!initializeMQTTQueues()) {
         return false;
     }
+    initializeRelayController();
+    initializeCycleLogCommands();
+    initializeTemperatureHistoryCommands();
+    initializeDisplayCommands();
+    initializeRemoteConfigCommands();
+    initializeLocalApiCommands();
+    initializeLanControlCommands();
 
     if (xTaskCreate(wifiConfigModeTask, "WiFi Config Mode Task", 4096, NULL, 2, &g_wifiConfigTaskHandle) != pdPASS) {
         Log::error("Failed to create WiFi Config Mode Task.");
@@ -151,12 +231,45 @@ bool initializeSystemState() {
         return false;
     }
 
-    // Create relay controller task (always active)
-    if (xTaskCreate(relayControllerTask, "Relay Task", 2048, NULL, 1, &g_relayTaskHandle) != pdPASS) {
+    // Create relay controller task (always active). Stopping a cycle appends to LittleFS and builds
+    // the cycle JSON on this stack, like the state manager does for button and command stops.
+    if (xTaskCreate(relayControllerTask, "Relay Task", 4096, NULL, 1, &g_relayTaskHandle) != pdPASS) {
         Log::error("Failed to create Relay Task.");
         return false;
     }
 
+    if (xTaskCreate(recirculationSchedulerTask, "Scheduler Task", 3072, NULL, 1, &g_schedulerTaskHandle) != pdPASS) {
+        Log::error("Failed to create Scheduler Task.");
+        return false;
+    }
+
+    if (xTaskCreate(configWriterTask, "Config Writer Task", 3072, NULL, 1, &g_configWriterTaskHandle) != pdPASS) {
+        Log::error("Failed to create Config Writer Task.");
+        return false;
+    }
+
+    if (xTaskCreate(cycleLogWriterTask, "Cycle Log Writer Task", 3072, NULL, 1, &g_cycleLogWriterTaskHandle) != pdPASS) {
+        Log::error("Failed to create Cycle Log Writer Task.");
+        return false;
+    }
+
+    // Local API and LAN control last: their handlers use the drivers above; they work without the cloud
+    // Non-fatal: the device is still controllable over MQTT. Config documents are applied on their
+    // own task so the async TCP task never waits for the dispatch lock, EEPROM or a publish.
+    if (initializeLocalApi() &&
+        xTaskCreate(localApiConfigTask, "Local API Config Task", 6144, NULL, 1, &g_localApiConfigTaskHandle) != pdPASS) {
+        Log::error("Failed to create Local API Config Task.");
+    }
+    // Non-fatal, as above. LAN commands run the MQTT handlers (JSON documents, NVS writes, logging),
+    // so they get their own stack instead of the AsyncUDP task's.
+    if (initializeLanControl() &&
+        xTaskCreate(lanControlTask, "LAN Control Task", 6144, NULL, 2, &g_lanControlTaskHandle) != pdPASS) {
+        Log::error("Failed to create LAN Control Task.");
+    }
+
+    bootPhaseEnd(BOOT_PHASE_TASKS);
+    bootMilestone(BOOT_MILESTONE_INIT_DONE);
+
     Log::info("System Initialization completed successfully.\n");
     return true;
 }
@@ -167,6 +280,7 @@ void setSystemState(SystemState state) {
         g_systemState = state;
         xSemaphoreGive(g_stateMutex);
     }
+    notifyDisplayUpdate(DISPLAY_UPDATE_NETWORK);
 }
 
 SystemState getSystemState() {
@@ -258,33 +372,47 @@ static TaskNotificationEvent receiveSystemStateNotification(TickType_t waitTime)
 /** @brief Handles system state transitions when an event is received.
  */
 static void handleStateTransitions() {
-    TaskNotificationEvent event = receiveSystemStateNotification(pdMS_TO_TICKS(50));
+    TaskNotificationEvent event = receiveSystemStateNotification(pdMS_TO_TICKS(getPowerProfileInfo().idleWaitMs));
 
     if (event == 0) return;
 
     // Handle button events globally, in any state
+    if (event & (EVENT_SHORT_PRESS_BUTTON | EVENT_DOUBLE_PRESS_BUTTON | EVENT_LONG_PRESS_BUTTON)) {
+        notifyDisplayUpdate(DISPLAY_UPDATE_WAKE);
+    }
+
     if (event & EVENT_LONG_PRESS_BUTTON) {
         Log::info("Long press button event received. Transitioning to CONFIG_MODE.");
         setSystemState(SYSTEM_STATE_CONFIG_MODE);
         return; // Process this event exclusively
     }
     
+    if (event & EVENT_DOUBLE_PRESS_BUTTON) {
+        Log::info("Double press button event received. Showing next display page.");
+        notifyDisplayUpdate(DISPLAY_UPDATE_NEXT_PAGE);
+    }
+
     if (event & EVENT_SHORT_PRESS_BUTTON) {
         Log::info("Short press button event received. Toggling relay.");
         // Toggle relay: if active, deactivate; if inactive, activate
         if (isRelayActive()) {
             deactivateRelay("button");
         } else {
-            activateRelay();
+            activateRelay("button");
         }
     }
 
     // Handle relay events globally, in any state
     if (event & EVENT_RELAY_ON) {
         Log::info("EVENT_RELAY_ON received. Activating relay.");
-        activateRelay(); // Call centralized function directly
+        activateRelay("command"); // Call centralized function directly
     }
     
+    if (event & EVENT_RELAY_SCHEDULED) {
+        Log::info("EVENT_RELAY_SCHEDULED received. Activating relay.");
+        activateRelay("schedule");
+    }
+
     if (event & EVENT_RELAY_OFF) {
         Log::info("EVENT_RELAY_OFF received. Deactivating relay.");
         deactivateRelay("command"); // Call centralized function directly
@@ -299,6 +427,7 @@ static void handleStateTransitions() {
     switch (currentState) {
         case SYSTEM_STATE_CONNECTING:
             if (event & EVENT_WIFI_CONNECTED) {
+                bootMilestone(BOOT_MILESTONE_WIFI_CONNECTED);
                 Log::info("WiFi connected. Transitioning to CONNECTED_WIFI.");
                 setSystemState(SYSTEM_STATE_CONFIG_MQTT);
             }
@@ -322,8 +451,16 @@ static void handleStateTransitions() {
             if (event & EVENT_MQTT_CONNECTED) {
                 Log::info("MQTT connected. Transitioning to CONNECTED_MQTT.");
                 setSystemState(SYSTEM_STATE_CONNECTED_MQTT);
-                // Initialize relay controller MQTT subscriptions after connection
-                initializeRelayController();
+                // Command handlers are registered at boot; only the reported state is sent here
+                publishRemoteConfigState();
+                publishLocalApiState();
+                publishLanControlState();
+                bootMilestone(BOOT_MILESTONE_MQTT_CONNECTED);
+                publishBootReport();
+                if (isOTAPending()) {
+                    Log::info("Resuming interrupted OTA update.");
+                    notifySystemState(EVENT_OTA_UPDATE);
+                }
             }
             break;
 
@@ -335,6 +472,11 @@ static void handleStateTransitions() {
             if (event & EVENT_WIFI_DISCONNECTED) {
                 Log::warn("WiFi disconnected. Downgrading to CONNECTING.");
                 setSystemState(SYSTEM_STATE_CONNECTING);
+                // CONNECTED is sent once per GOT_IP: if it was coalesced with this event, the
+                // reconnect already happened and nothing else would leave CONNECTING
+                if (isWiFiConnected()) {
+                    notifySystemState(EVENT_WIFI_CONNECTED);
+                }
             }
             if (event & EVENT_OTA_UPDATE) {
                 Log::info("OTA update event received. Transitioning to OTA_UPDATE state.");
@@ -343,9 +485,14 @@ static void handleStateTransitions() {
             break;
 
         case SYSTEM_STATE_CONFIG_MODE:
-            if (event & EVENT_WIFI_CONNECTED) {
-                Log::info("Connected to wifi while in SYSTEM_STATE_CONFIG_MODE.");
-                setSystemState(SYSTEM_STATE_CONFIG_MQTT);
+            // EVENT_WIFI_CONNECTED here is the config portal testing submitted credentials;
+            // the portal reports EVENT_WIFI_CONFIG_SAVED once they are stored and the AP is down
+            if (event & EVENT_WIFI_CONFIG_SAVED) {
+                Log::info("New WiFi credentials applied. Transitioning to CONNECTING.");
+                setSystemState(SYSTEM_STATE_CONNECTING);
+                if (isWiFiConnected()) {
+                    notifySystemState(EVENT_WIFI_CONNECTED); // Already associated: continue to MQTT
+                }
             }
             // NOTE: A long press in this mode will just re-trigger the same state.
             break;
@@ -376,6 +523,7 @@ static void handleStateActions() {
             if (g_displayManagerTaskHandle) vTaskResume(g_displayManagerTaskHandle);
             if (g_temperatureSensorTaskHandle) vTaskResume(g_temperatureSensorTaskHandle);
             if (g_buttonTaskHandle) vTaskResume(g_buttonTaskHandle);
+            if (g_schedulerTaskHandle) vTaskResume(g_schedulerTaskHandle);
             break;
 
         case SYSTEM_STATE_CONNECTED_WIFI:
@@ -386,6 +534,7 @@ static void handleStateActions() {
             if (g_displayManagerTaskHandle) vTaskResume(g_displayManagerTaskHandle);
             if (g_temperatureSensorTaskHandle) vTaskResume(g_temperatureSensorTaskHandle);
             if (g_buttonTaskHandle) vTaskResume(g_buttonTaskHandle);
+            if (g_schedulerTaskHandle) vTaskResume(g_schedulerTaskHandle);
             break;
 
         case SYSTEM_STATE_CONFIG_MQTT:
@@ -396,6 +545,7 @@ static void handleStateActions() {
             if (g_displayManagerTaskHandle) vTaskResume(g_displayManagerTaskHandle);
             if (g_temperatureSensorTaskHandle) vTaskResume(g_temperatureSensorTaskHandle);
             if (g_buttonTaskHandle) vTaskResume(g_buttonTaskHandle);
+            if (g_schedulerTaskHandle) vTaskResume(g_schedulerTaskHandle);
             break;
 
         case SYSTEM_STATE_CONNECTED_MQTT:
@@ -406,6 +556,7 @@ static void handleStateActions() {
             if (g_displayManagerTaskHandle) vTaskResume(g_displayManagerTaskHandle);
             if (g_temperatureSensorTaskHandle) vTaskResume(g_temperatureSensorTaskHandle);
             if (g_buttonTaskHandle) vTaskResume(g_buttonTaskHandle);
+            if (g_schedulerTaskHandle) vTaskResume(g_schedulerTaskHandle);
             break;
 
         case SYSTEM_STATE_CONFIG_MODE:
@@ -416,18 +567,20 @@ static void handleStateActions() {
             if (g_displayManagerTaskHandle) vTaskResume(g_displayManagerTaskHandle);
             if (g_temperatureSensorTaskHandle) vTaskResume(g_temperatureSensorTaskHandle);
             if (g_buttonTaskHandle) vTaskResume(g_buttonTaskHandle);
+            if (g_schedulerTaskHandle) vTaskResume(g_schedulerTaskHandle);
             break;
 
         case SYSTEM_STATE_OTA_UPDATE:
             if (g_otaTaskHandle == NULL) {
-                if (g_wifiConnectTaskHandle) vTaskSuspend(g_wifiConnectTaskHandle);
+                // The WiFi task keeps running: it reconnects while the download waits, then resumes
                 if (g_mqttConnectTaskHandle) vTaskSuspend(g_mqttConnectTaskHandle);
                 if (g_mqttTaskHandle) vTaskSuspend(g_mqttTaskHandle);
                 if (g_displayManagerTaskHandle) vTaskSuspend(g_displayManagerTaskHandle);
                 if (g_temperatureSensorTaskHandle) vTaskSuspend(g_temperatureSensorTaskHandle);
                 if (g_buttonTaskHandle) vTaskSuspend(g_buttonTaskHandle);
+                if (g_schedulerTaskHandle) vTaskSuspend(g_schedulerTaskHandle);
 
-                if (xTaskCreate(otaTask, "OTA Task", 4096, NULL, 3, &g_otaTaskHandle) != pdPASS) {
+                if (xTaskCreate(otaTask, "OTA Task", 8192, NULL, 3, &g_otaTaskHandle) != pdPASS) {
                     Log::error("Failed to create OTA Task.");
                     setSystemState(SYSTEM_STATE_ERROR);
                 }
@@ -442,8 +595,10 @@ static void handleStateActions() {
             if (g_displayManagerTaskHandle) vTaskSuspend(g_displayManagerTaskHandle);
             if (g_temperatureSensorTaskHandle) vTaskSuspend(g_temperatureSensorTaskHandle);
             if (g_buttonTaskHandle) vTaskSuspend(g_buttonTaskHandle);
+            if (g_schedulerTaskHandle) vTaskSuspend(g_schedulerTaskHandle);
 
             vTaskDelay(pdMS_TO_TICKS(5000));
+            flushConfig(); // Don't lose settings still waiting for the write-behind commit
             ESP.restart();
             break;
 
@@ -4,6 +4,7 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <UtcClock.h>
 
 // System State Management Module
 // Purpose:
@@ -36,12 +37,14 @@ typedef enum {
     EVENT_MQTT_DISCONNECTED     = (1 << 11), // MQTT disconnected
     EVENT_LONG_PRESS_BUTTON     = (1 << 12), // Long button press (5 seconds)
     EVENT_SHORT_PRESS_BUTTON    = (1 << 13), // Short button press
+    EVENT_DOUBLE_PRESS_BUTTON   = (1 << 14), // Two short presses in quick succession
     EVENT_WIFI_DISCONNECTED     = (1 << 15), // WiFi disconnected
     EVENT_OTA_UPDATE            = (1 << 16), // OTA update event
     EVENT_MQTT_AWS_CREDENTIALS  = (1 << 17), // AWS credentials received
     EVENT_RELAY_ON              = (1 << 18), // Request to turn relay ON
     EVENT_RELAY_OFF             = (1 << 19), // Request to turn relay OFF
-    EVENT_RELAY_STOPPED         = (1 << 20)  // Relay stopped automatically (timeout/max temp)
+    EVENT_RELAY_STOPPED         = (1 << 20), // Relay stopped automatically (timeout/max temp)
+    EVENT_RELAY_SCHEDULED       = (1 << 21)  // Request to turn relay ON for a scheduled pre-run
 } TaskNotificationEvent;
 
 /**
@@ -80,6 +83,13 @@ void notifySystemState(TaskNotificationEvent event);
  */
 void setOtaTaskHandle(TaskHandle_t handle);
 
+/**
+ * @brief Gets the shared NTP-backed UTC clock.
+ * @return Reference to the system UtcClock instance
+ * @note Initialized during initializeSystemState(); valid time requires WiFi + NTP
+ */
+UtcClock& getUtcClock();
+
 // Note: Relay control functions (activateRelay/deactivateRelay) are in relay_controller.h
 
 #endif
\ No newline at end of file
@@ -45,7 +45,30 @@ constexpr char AP_PASSWORD[] = "12345678";
     #define BLUE_LED_PIN 15
 #endif
 
+// Pump Constants
+constexpr float PUMP_POWER_WATTS = 45.0f;  // Nominal recirculation pump draw (energy estimates)
+
+// Boot Constants
+constexpr bool BOOT_LED_SELF_TEST = true;     // Color sweep when the LED task starts (runs after boot, not during it)
+constexpr bool BOOT_BUZZER_SELF_TEST = false; // ~3 s buzzer test when the relay task starts
+constexpr uint32_t BOOT_DRIVER_INIT_TIMEOUT_MS = 10000; // Upper bound for the concurrent driver init phase
+
+// WiFi Constants
+// Reuse the last DHCP lease as a static IP on fast reconnects (skips DHCP). Only safe when the
+// router keeps leases stable (e.g. DHCP reservation); otherwise the address may collide.
+constexpr bool WIFI_REUSE_DHCP_LEASE = false;
+
+// Local API Constants
+constexpr uint16_t LOCAL_API_PORT = 8080; // REST + WebSocket on the LAN (port 80 belongs to the config portal)
+constexpr uint16_t LAN_CONTROL_PORT = 4210; // Signed UDP commands, announced over mDNS (_mica._tcp)
+
 // OTA Constants
 constexpr char firmwareUrl[] = "https://ota.mica.eco/firmware.bin";
+constexpr uint32_t OTA_CHUNK_SIZE = 64 * 1024;       // Range request size; progress is stored after each chunk
+constexpr uint8_t OTA_CHUNK_RETRIES = 4;             // Attempts per chunk before the session ends
+constexpr uint32_t OTA_READ_TIMEOUT_MS = 15000;      // No data for this long aborts the chunk
+constexpr uint32_t OTA_WIFI_WAIT_MS = 60000;         // Wait for a WiFi reconnect between chunk attempts
+constexpr uint8_t OTA_MAX_STALLED_SESSIONS = 5;      // Sessions without progress before the update is dropped
+constexpr uint8_t OTA_DELTA_ATTEMPTS = 2;            // Interrupted delta sessions before using the full image
 
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+// button_gesture.cpp
+// Button Gesture Module
+// Purpose: Short, double and long press detection from polled button levels
+// Architecture: Pure state machine over ButtonGestureState; buttonTask polls the pin and maps the
+//               returned gestures to system state events
+// Thread-Safety: Reentrant (state lives in the caller)
+// Dependencies: None
+
+#include "button_gesture.h"
+
+uint8_t buttonGestureUpdate(ButtonGestureState &state, bool pressed, unsigned long nowMs) {
+    uint8_t gestures = 0;
+
+    if (pressed) {
+        if (state.pressStartMs == 0) {
+            state.pressStartMs = nowMs;
+            state.longPressSent = false;
+        }
+        if (!state.longPressSent && nowMs - state.pressStartMs >= BUTTON_LONG_PRESS_MS) {
+            if (state.shortReleaseMs != 0) {
+                // The press before this one was short; it is not dropped for the long press
+                gestures |= BUTTON_GESTURE_SHORT;
+                state.shortReleaseMs = 0;
+            }
+            gestures |= BUTTON_GESTURE_LONG;
+            state.longPressSent = true; // Once per press
+        }
+        return gestures;
+    }
+
+    if (state.pressStartMs != 0 && !state.longPressSent) {
+        if (state.shortReleaseMs != 0) {
+            gestures |= BUTTON_GESTURE_DOUBLE; // Second short press inside the window
+            state.shortReleaseMs = 0;
+        } else {
+            state.shortReleaseMs = nowMs; // Decide once the window expires
+        }
+    }
+    state.pressStartMs = 0;
+    state.longPressSent = false;
+
+    if (state.shortReleaseMs != 0 && nowMs - state.shortReleaseMs >= BUTTON_DOUBLE_PRESS_WINDOW_MS) {
+        gestures |= BUTTON_GESTURE_SHORT;
+        state.shortReleaseMs = 0;
+    }
+    return gestures;
+}
@@ -0,0 +1,39 @@
+// button_gesture.h
+#ifndef BUTTON_GESTURE_H
+#define BUTTON_GESTURE_H
+
+#include <stdint.h>
+
+// Button Gesture Module
+// Purpose:
+// Turns polled button levels into short, double and long presses. Free of Arduino so the host
+// tests replay press/release sequences through the same logic as buttonTask.
+
+#define BUTTON_LONG_PRESS_MS 5000       // Hold time of a long press
+#define BUTTON_DOUBLE_PRESS_WINDOW_MS 350 // Max gap between two short presses
+
+// Gestures reported by one update; when several are set they happened in this bit order
+#define BUTTON_GESTURE_SHORT (1 << 0)
+#define BUTTON_GESTURE_DOUBLE (1 << 1)
+#define BUTTON_GESTURE_LONG (1 << 2)
+
+/**
+ * @brief Gesture detector state; zero-initialize before the first update.
+ */
+typedef struct {
+    unsigned long pressStartMs;         // Start of the current press (0: released)
+    unsigned long shortReleaseMs;       // Release of a short press waiting for a second one (0: none)
+    bool longPressSent;                 // The current press was already reported as long
+} ButtonGestureState;
+
+/**
+ * @brief Advances the detector by one poll.
+ * A short press is held back for BUTTON_DOUBLE_PRESS_WINDOW_MS; if a second press follows and
+ * becomes a long press, the held short press is reported first.
+ * @param pressed Button level at this poll
+ * @param nowMs Poll time in milliseconds (millis())
+ * @return BUTTON_GESTURE_* bits detected at this poll (0: none)
+ */
+uint8_t buttonGestureUpdate(ButtonGestureState &state, bool pressed, unsigned long nowMs);
+
+#endif // BUTTON_GESTURE_H
@@ -1,12 +1,13 @@
 // button_manager.cpp
 // Button Manager Module
-// Purpose: Generic button handler with debouncing and long-press detection
-// Architecture: FreeRTOS task polls button state, sends events to system_state
+// Purpose: Generic button handler with debouncing, double-press and long-press detection
+// Architecture: FreeRTOS task polls button state, button_gesture classifies it, events go to system_state
 // Thread-Safety: ISR-safe, uses task notifications for event communication
-// Dependencies: system_state (for event notifications only)
+// Dependencies: button_gesture, system_state (for event notifications only)
 
 #include "button_manager.h"
 
+#include "button_gesture.h"
 #include "config.h"
 #include "system_state.h"
 #include <Arduino.h>
@@ -15,7 +16,6 @@
 #include <Log.h>
 
 // Constants
-const unsigned long LONG_PRESS_TIME = 5000;  // Time to consider a long press (ms)
 const unsigned long DEBOUNCE_TIME = 50;      // Minimum time to avoid bounces (ms)
 
 // Global Variables
@@ -40,39 +40,26 @@ void initializeButtonManager() {
 
 // Button Task
 void buttonTask(void *pvParameters) {
-    bool longPressSent = false; // Avoid multiple long press notifications
-    unsigned long pressStartTime = 0;
+    ButtonGestureState gestureState = {0, 0, false};
 
     while (true) {
-        unsigned long currentMillis = millis();
+        // Button is pressed when LOW (pull-up)
+        uint8_t gestures = buttonGestureUpdate(gestureState, digitalRead(BUTTON_PIN) == LOW, millis());
 
-        // Read button state
-        int buttonState = digitalRead(BUTTON_PIN);
-
-        // Button is pressed (LOW due to pull-up)
-        if (buttonState == LOW) {
-            if (pressStartTime == 0) {
-                pressStartTime = currentMillis; // Save press start time
-                longPressSent = false; // Reset long press detection
-                Log::debug("Button press detected. Waiting to verify long press...");
-            }
-
-            // Check if long press time has passed and hasn't been sent yet
-            if (!longPressSent && (currentMillis - pressStartTime >= LONG_PRESS_TIME)) {
-                Log::info("Long button press detected (5 seconds).");
-                notifySystemState(EVENT_LONG_PRESS_BUTTON);
-                longPressSent = true; // Avoid repeated sends
-            }
-        } else { // Button released
-            if (pressStartTime != 0 && !longPressSent) {
-                // Short press detected - notify system
-                Log::info("Short button press detected.");
-                notifySystemState(EVENT_SHORT_PRESS_BUTTON);
-            }
-            pressStartTime = 0; // Reset press time
-            longPressSent = false; // Reset for next press
+        // A short press held for the double-press window is reported before a long press that follows it
+        if (gestures & BUTTON_GESTURE_SHORT) {
+            Log::info("Short button press detected.");
+            notifySystemState(EVENT_SHORT_PRESS_BUTTON);
+        }
+        if (gestures & BUTTON_GESTURE_DOUBLE) {
+            Log::info("Double button press detected.");
+            notifySystemState(EVENT_DOUBLE_PRESS_BUTTON);
         }
-        
+        if (gestures & BUTTON_GESTURE_LONG) {
+            Log::info("Long button press detected (5 seconds).");
+            notifySystemState(EVENT_LONG_PRESS_BUTTON);
+        }
+
         vTaskDelay(pdMS_TO_TICKS(50)); // Small delay to avoid excessive CPU usage
     }
-}
\ No newline at end of file
+}
@@ -5,6 +5,8 @@
 // Button Manager Module
 // Purpose:
 // Detects button presses and provides logic for handling long presses to trigger configuration mode.
+// Two short presses within BUTTON_DOUBLE_PRESS_WINDOW_MS are reported as a double press instead
+// (see button_gesture.h).
 
 /**
  * @brief Initializes the button manager, configures the button pin, and attaches the interrupt.
@@ -12,7 +14,7 @@
 void initializeButtonManager();
 
 /**
- * @brief FreeRTOS task to manage button presses, handling short and long presses.
+ * @brief FreeRTOS task to manage button presses, handling short, double and long presses.
  * @param pvParameters Task parameters (not used).
  */
 void buttonTask(void *pvParameters);
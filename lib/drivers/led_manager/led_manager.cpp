@@ -8,6 +8,7 @@
 #include "led_manager.h"
 
 #include "config.h"
+#include "power_manager.h"
 #include "system_state.h"
 #include <Adafruit_NeoPixel.h>
 #include <Arduino.h>
@@ -35,16 +36,6 @@ void initializeLedManager() {
     strip.setBrightness(NEOPIXEL_BRIGHTNESS);
     strip.show(); // Initialize all pixels to 'off'
     
-    // Test sequence for NeoPixel
-    constexpr uint32_t LED_TEST_DELAY_MS = 500;
-    setNeoPixelColor(255, 0, 0); // Red
-    vTaskDelay(pdMS_TO_TICKS(LED_TEST_DELAY_MS));
-    setNeoPixelColor(0, 255, 0); // Green
-    vTaskDelay(pdMS_TO_TICKS(LED_TEST_DELAY_MS));
-    setNeoPixelColor(0, 0, 255); // Blue
-    vTaskDelay(pdMS_TO_TICKS(LED_TEST_DELAY_MS));
-    setNeoPixelColor(0, 0, 0); // Off
-    
     Log::info("LED Manager initialized with NeoPixel (ESP32-C3).");
     //! LogMessage(LOG_LEVEL_INFO, "LED Manager initialized with NeoPixel (ESP32-C3).");
 #else
@@ -57,9 +48,29 @@ void initializeLedManager() {
     digitalWrite(RED_LED_PIN, LOW);
     digitalWrite(BLUE_LED_PIN, LOW);
 
-    Log::info("LED Manager initialized. LEDs turned ON for verification.");
-    vTaskDelay(pdMS_TO_TICKS(2000));
+    Log::info("LED Manager initialized.");
+#endif
+}
 
+/**
+ * @brief Cosmetic LED check, run from ledTask so it never delays boot.
+ */
+static void runLedSelfTest() {
+    constexpr uint32_t LED_TEST_DELAY_MS = 500;
+#ifdef ESP32_C3
+    setNeoPixelColor(255, 0, 0); // Red
+    vTaskDelay(pdMS_TO_TICKS(LED_TEST_DELAY_MS));
+    setNeoPixelColor(0, 255, 0); // Green
+    vTaskDelay(pdMS_TO_TICKS(LED_TEST_DELAY_MS));
+    setNeoPixelColor(0, 0, 255); // Blue
+    vTaskDelay(pdMS_TO_TICKS(LED_TEST_DELAY_MS));
+    setNeoPixelColor(0, 0, 0); // Off
+#else
+    // LEDs are active-low: LOW turns them on
+    digitalWrite(GREEN_LED_PIN, LOW);
+    digitalWrite(RED_LED_PIN, LOW);
+    digitalWrite(BLUE_LED_PIN, LOW);
+    vTaskDelay(pdMS_TO_TICKS(LED_TEST_DELAY_MS * 4));
     digitalWrite(GREEN_LED_PIN, HIGH);
     digitalWrite(RED_LED_PIN, HIGH);
     digitalWrite(BLUE_LED_PIN, HIGH);
@@ -69,11 +80,27 @@ void initializeLedManager() {
 void ledTask(void *pvParameters) {
     Log::info("LED Task started.");
 
+    if (BOOT_LED_SELF_TEST) {
+        runLedSelfTest();
+    }
+
     SystemState currentState = getSystemState();
     SystemState previousState = SYSTEM_STATE_ERROR;
     bool ledState = false; // For blinking effects
 
     while (true) {
+        // Benchmark mode: LED off so it doesn't skew current measurements
+        if (isPowerBenchmarkEnabled()) {
+#ifdef ESP32_C3
+            setNeoPixelColor(0, 0, 0);
+#else
+            digitalWrite(GREEN_LED_PIN, HIGH);
+            digitalWrite(RED_LED_PIN, HIGH);
+#endif
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            continue;
+        }
+
         switch (currentState) {
             case SYSTEM_STATE_CONNECTING:
                 // Red LED blinks slowly to indicate a connecting attempt
@@ -1,9 +1,14 @@
 // eeprom_config.cpp
 // EEPROM Configuration Module
-// Purpose: Persistent storage for WiFi credentials, temperature/time configuration
-// Architecture: Mutex-protected EEPROM access with validation flags
-// Thread-Safety: Uses eepromMutex for all read/write operations
-// Dependencies: EEPROM library, FreeRTOS semaphores
+// Purpose: Persistent storage for WiFi credentials and profiles, temperature/time configuration, sensor calibration
+// Architecture: One versioned, CRC32-protected DeviceConfig record at CONFIG_RECORD_ADDR, mirrored in a
+//               RAM cache. Getters read the cache; setters and editConfig() edit a copy under the mutex,
+//               drop it if unchanged, and publish it to the cache. configWriterTask commits staged changes
+//               write-behind (debounced, rate-limited). The legacy fixed-offset layout is migrated once at boot,
+//               only when no record exists; an existing record is never rewritten unless it was decoded
+//               or the user saves a change.
+// Thread-Safety: eepromMutex serializes writers; readers copy the cache through a seqlock (lock-free)
+// Dependencies: EEPROM library, FreeRTOS semaphores and task notifications
 
 #include "eeprom_config.h"
 
@@ -15,12 +20,265 @@
 // System headers
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
 #include <stdint.h>
 #include <string.h>
 
+#define DEFAULT_MAX_TIME_SECONDS 120 // 2 minutes
+
+// Stored in front of the DeviceConfig bytes
+typedef struct {
+    uint32_t magic;     // CONFIG_RECORD_MAGIC
+    uint16_t version;   // CONFIG_SCHEMA_VERSION that wrote the record
+    uint16_t length;    // sizeof(DeviceConfig) of that version
+    uint32_t crc;       // CRC32 over version, length and the config bytes
+} ConfigRecordHeader;
+
+static_assert(sizeof(WiFiProfile) == WIFI_SSID_LENGTH + 1 + MAX_CRED_LENGTH + 1 + 2, "WiFiProfile must not contain padding");
+static_assert(sizeof(DeviceConfig) == 4 + 2 * (MAX_CRED_LENGTH + 1) + sizeof(DisplaySettings) + 8 +
+              TEMP_OFFSET_CHANNELS * sizeof(float) + 4 + (WIFI_MAX_PROFILES - 1) * sizeof(WiFiProfile) + 4 +
+              TEMP_OFFSET_CHANNELS * 8,
+              "DeviceConfig must not contain padding");
+static_assert(CONFIG_RECORD_ADDR + sizeof(ConfigRecordHeader) + sizeof(DeviceConfig) <= EEPROM_SIZE,
+              "Config record does not fit in EEPROM_SIZE");
+
 // Mutex to protect EEPROM access
 SemaphoreHandle_t eepromMutex = NULL;
 
+// RAM copy of the stored record. Even sequence = stable, odd = write in progress.
+static DeviceConfig configCache;
+static std::atomic<uint32_t> configSequence(0);
+static portMUX_TYPE configCacheMux = portMUX_INITIALIZER_UNLOCKED;
+static bool configLoaded = false;
+
+// Write-behind state (written under eepromMutex)
+static TaskHandle_t configWriterTaskHandle = NULL;
+static volatile bool configDirty = false;       // Cache differs from the stored record
+static volatile TickType_t firstChangeTick = 0; // First staged change since the last commit
+static volatile TickType_t lastChangeTick = 0;  // Most recent staged change
+static volatile TickType_t lastCommitTick = 0;
+static bool hasCommitted = false;
+
+//------------------------------------------------------------------------------
+// Record helpers
+//------------------------------------------------------------------------------
+
+// Bitwise CRC-32 (IEEE 802.3, reflected); the record is small and rarely written
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t recordCrc(uint16_t version, uint16_t length, const uint8_t *config) {
+    uint32_t crc = crc32Update(0, (const uint8_t*)&version, sizeof(version));
+    crc = crc32Update(crc, (const uint8_t*)&length, sizeof(length));
+    return crc32Update(crc, config, length);
+}
+
+// Writer side of the seqlock; the critical section keeps the copy from being preempted
+static void publishConfig(const DeviceConfig &config) {
+    portENTER_CRITICAL(&configCacheMux);
+    uint32_t sequence = configSequence.load(std::memory_order_relaxed);
+    configSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&configCache, &config, sizeof(DeviceConfig));
+    configSequence.store(sequence + 2, std::memory_order_release);
+    portEXIT_CRITICAL(&configCacheMux);
+}
+
+// Reader side of the seqlock: retries only if a write overlapped the copy
+static void readConfigCache(DeviceConfig &config) {
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = configSequence.load(std::memory_order_acquire);
+        memcpy(&config, &configCache, sizeof(DeviceConfig));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = configSequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+// Writes header + config with a bumped commit counter and commits once. Caller holds eepromMutex.
+static bool writeRecordLocked(const DeviceConfig &current) {
+    DeviceConfig config;
+    memcpy(&config, &current, sizeof(DeviceConfig));
+    config.commitCount++;
+
+    ConfigRecordHeader header;
+    header.magic = CONFIG_RECORD_MAGIC;
+    header.version = CONFIG_SCHEMA_VERSION;
+    header.length = sizeof(DeviceConfig);
+    header.crc = recordCrc(header.version, header.length, (const uint8_t*)&config);
+
+    EEPROM.put(CONFIG_RECORD_ADDR, header);
+    EEPROM.put(CONFIG_RECORD_ADDR + sizeof(ConfigRecordHeader), config);
+    if (!EEPROM.commit()) {
+        return false;
+    }
+    publishConfig(config);
+    lastCommitTick = xTaskGetTickCount();
+    hasCommitted = true;
+    return true;
+}
+
+// Commits the cache if it has staged changes. Caller holds eepromMutex.
+static bool commitPendingLocked() {
+    if (!configDirty) {
+        return true;
+    }
+    if (!writeRecordLocked(configCache)) {
+        Log::error("Failed to commit config to EEPROM.");
+        return false;
+    }
+    configDirty = false;
+    Log::info("Config committed to EEPROM (commit #%lu).", (unsigned long)configCache.commitCount);
+    return true;
+}
+
+// Guarantees NUL-terminated strings whatever the stored bytes are
+static void terminateStrings(DeviceConfig &config) {
+    config.ssid[MAX_CRED_LENGTH] = '\0';
+    config.password[MAX_CRED_LENGTH] = '\0';
+    for (int i = 0; i < WIFI_MAX_PROFILES - 1; i++) {
+        config.wifiBackups[i].ssid[WIFI_SSID_LENGTH] = '\0';
+        config.wifiBackups[i].password[MAX_CRED_LENGTH] = '\0';
+    }
+}
+
+// Outcome of reading the stored record
+typedef enum {
+    RECORD_LOADED,      // Decoded into the config
+    RECORD_ABSENT,      // No record magic: the legacy layout (or nothing) is stored
+    RECORD_UNREADABLE   // A record exists but could not be decoded (corrupt or half-written)
+} RecordStatus;
+
+// Reads and validates the stored record. Older (shorter) records load with new fields zeroed; newer
+// (longer) ones, e.g. after an OTA rollback, load the fields this schema knows and drop the rest.
+static RecordStatus readRecord(DeviceConfig &config) {
+    ConfigRecordHeader header;
+    EEPROM.get(CONFIG_RECORD_ADDR, header);
+    if (header.magic != CONFIG_RECORD_MAGIC) {
+        return RECORD_ABSENT;
+    }
+    if (header.length == 0 || CONFIG_RECORD_ADDR + sizeof(ConfigRecordHeader) + header.length > EEPROM_SIZE) {
+        Log::error("Invalid config record length (schema %u, %u bytes).", header.version, header.length);
+        return RECORD_UNREADABLE;
+    }
+
+    // The CRC covers the whole stored record, including fields of a newer schema
+    memset(&config, 0, sizeof(DeviceConfig));
+    uint8_t *bytes = (uint8_t*)&config;
+    uint32_t crc = crc32Update(0, (const uint8_t*)&header.version, sizeof(header.version));
+    crc = crc32Update(crc, (const uint8_t*)&header.length, sizeof(header.length));
+    for (uint16_t i = 0; i < header.length; i++) {
+        uint8_t value = EEPROM.read(CONFIG_RECORD_ADDR + sizeof(ConfigRecordHeader) + i);
+        crc = crc32Update(crc, &value, 1);
+        if (i < sizeof(DeviceConfig)) {
+            bytes[i] = value;
+        }
+    }
+    if (crc != header.crc) {
+        Log::error("Config record CRC mismatch: ignoring corrupt or half-written record.");
+        return RECORD_UNREADABLE;
+    }
+    if (header.version > CONFIG_SCHEMA_VERSION) {
+        Log::warn("Config record has newer schema %u; loading the schema %u fields.", header.version,
+                  CONFIG_SCHEMA_VERSION);
+    }
+    terminateStrings(config);
+    return RECORD_LOADED;
+}
+
+// Builds a config from the schema 0 fixed-offset layout
+static void readLegacyLayout(DeviceConfig &config) {
+    memset(&config, 0, sizeof(DeviceConfig));
+
+    if (EEPROM.read(FLAG_ADDR) == FLAG_VALID) {
+        for (int i = 0; i < MAX_CRED_LENGTH; ++i) {
+            config.ssid[i] = EEPROM.read(SSID_ADDR + i);
+            config.password[i] = EEPROM.read(PASS_ADDR + i);
+        }
+        config.validMask |= CONFIG_FIELD_CREDENTIALS;
+    }
+    if (EEPROM.read(FLAG_TEMP_ADDR) == FLAG_TEMP_VALID) {
+        EEPROM.get(TEMP_ADDR, config.maxTemperature);
+        config.validMask |= CONFIG_FIELD_MAX_TEMPERATURE;
+    }
+    if (EEPROM.read(FLAG_MAX_TIME_ADDR) == FLAG_MAX_TIME_VALID) {
+        EEPROM.get(MAX_TIME_ADDR, config.maxTimeSeconds);
+        config.validMask |= CONFIG_FIELD_MAX_TIME;
+    }
+    if (EEPROM.read(FLAG_TEMP_OFFSET_ADDR) == FLAG_TEMP_OFFSET_VALID) {
+        for (int c = 0; c < TEMP_OFFSET_CHANNELS; ++c) {
+            EEPROM.get(TEMP_OFFSET_ADDR + c * sizeof(float), config.temperatureOffset[c]);
+        }
+        config.validMask |= CONFIG_FIELD_TEMP_OFFSETS;
+    }
+    if (EEPROM.read(FLAG_DISPLAY_SETTINGS_ADDR) == FLAG_DISPLAY_SETTINGS_VALID) {
+        EEPROM.get(DISPLAY_SETTINGS_ADDR, config.display);
+        config.validMask |= CONFIG_FIELD_DISPLAY;
+    }
+}
+
+/**
+ * @brief Takes the EEPROM mutex and copies the cache into draft.
+ * Must be paired with endConfigEdit().
+ */
+static bool beginConfigEdit(DeviceConfig &draft) {
+    if (eepromMutex == NULL || !configLoaded) {
+        Log::error("EEPROM mutex not initialized.");
+        return false;
+    }
+    if (xSemaphoreTake(eepromMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        Log::error("Could not acquire EEPROM mutex.");
+        return false;
+    }
+    memcpy(&draft, &configCache, sizeof(DeviceConfig)); // Only writers change the cache
+    return true;
+}
+
+/**
+ * @brief Stages the draft and releases the mutex. Unchanged drafts are dropped; changed ones
+ *        are visible to readers at once and committed by the writer task (or now if immediate).
+ */
+static bool endConfigEdit(DeviceConfig &draft, bool immediate = false, bool *changed = NULL) {
+    draft.commitCount = configCache.commitCount;
+    bool ok = true;
+    bool differs = memcmp(&draft, &configCache, sizeof(DeviceConfig)) != 0;
+    if (changed != NULL) {
+        *changed = differs;
+    }
+    if (differs) {
+        publishConfig(draft);
+        TickType_t now = xTaskGetTickCount();
+        if (!configDirty) {
+            firstChangeTick = now;
+            configDirty = true;
+        }
+        lastChangeTick = now;
+        if (immediate || configWriterTaskHandle == NULL) {
+            ok = commitPendingLocked();
+        } else {
+            xTaskNotifyGive(configWriterTaskHandle);
+        }
+    } else {
+        Log::debug("Config unchanged; nothing to write.");
+    }
+    xSemaphoreGive(eepromMutex);
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// Public API
+//------------------------------------------------------------------------------
+
 // Initialize EEPROM
 bool eepromInitialize() {
     if (!validateEEPROMSize()) {
@@ -38,6 +296,29 @@ bool eepromInitialize() {
         return false;
     }
 
+    DeviceConfig config;
+    switch (readRecord(config)) {
+        case RECORD_LOADED:
+            publishConfig(config);
+            break;
+        case RECORD_ABSENT:
+            // No record yet: carry over whatever the legacy layout holds
+            readLegacyLayout(config);
+            if (!writeRecordLocked(config)) {
+                Log::error("Failed to write migrated config record.");
+                publishConfig(config); // Still usable from RAM for this boot
+            }
+            Log::info("Config migrated to schema %u (fields 0x%02lX).", CONFIG_SCHEMA_VERSION, (unsigned long)config.validMask);
+            break;
+        case RECORD_UNREADABLE:
+            // Run on defaults but leave the stored bytes alone: only an explicit change overwrites them
+            memset(&config, 0, sizeof(DeviceConfig));
+            publishConfig(config);
+            Log::error("Config record unreadable; running on defaults until the next change is saved.");
+            break;
+    }
+    configLoaded = true;
+
     Serial.println("[INFO] EEPROM initialized successfully."); // LogMessage still not initialized
     return true;
 }
@@ -45,14 +326,14 @@ bool eepromInitialize() {
 uint32_t getStoredMaxTime() {
     uint32_t maxTime = 0;
     if (!loadMaxTime(maxTime)) {
-        return 120; // Default: 120 seconds (2 minutes)
+        return DEFAULT_MAX_TIME_SECONDS;
     }
     return maxTime;
 }
 
 // Validate EEPROM Size
 bool validateEEPROMSize() {
-    int requiredSize = FLAG_ADDR + 1; // Last used address
+    int requiredSize = CONFIG_RECORD_ADDR + sizeof(ConfigRecordHeader) + sizeof(DeviceConfig); // Last used address
 
     if (EEPROM_SIZE < requiredSize) {
         Log::error("EEPROM_SIZE (%d) is insufficient. Required: %d\n", EEPROM_SIZE, requiredSize);
@@ -63,131 +344,235 @@ bool validateEEPROMSize() {
     return true;
 }
 
-// Save Credentials
-bool saveCredentials(const String &ssid, const String &password) {
+bool loadConfig(DeviceConfig &config) {
+    if (!configLoaded) {
+        return false;
+    }
+    readConfigCache(config);
+    return true;
+}
+
+ConfigEditResult editConfig(ConfigEditor editor, void *context) {
+    DeviceConfig draft;
+    if (!beginConfigEdit(draft)) {
+        return CONFIG_EDIT_FAILED;
+    }
+    if (!editor(draft, context)) {
+        xSemaphoreGive(eepromMutex);
+        return CONFIG_EDIT_REJECTED;
+    }
+    terminateStrings(draft);
+    bool changed = false;
+    if (!endConfigEdit(draft, false, &changed)) {
+        return CONFIG_EDIT_FAILED;
+    }
+    return changed ? CONFIG_EDIT_APPLIED : CONFIG_EDIT_UNCHANGED;
+}
+
+bool flushConfig() {
     if (eepromMutex == NULL) {
         Log::error("EEPROM mutex not initialized.");
         return false;
     }
+    if (xSemaphoreTake(eepromMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        Log::error("Could not acquire EEPROM mutex.");
+        return false;
+    }
+    bool ok = commitPendingLocked();
+    xSemaphoreGive(eepromMutex);
+    return ok;
+}
 
-    if (xSemaphoreTake(eepromMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        Log::info("Attempting to save credentials: SSID=%s, Password=%s", ssid.c_str(), password.c_str());
+uint32_t getConfigCommitCount() {
+    DeviceConfig config;
+    if (!loadConfig(config)) {
+        return 0;
+    }
+    return config.commitCount;
+}
 
-        if (ssid.length() > MAX_CRED_LENGTH || password.length() > MAX_CRED_LENGTH) {
-            Log::error("Credentials exceed maximum length.");
-            xSemaphoreGive(eepromMutex);
-            return false;
-        }
+bool isConfigCommitPending() {
+    return configDirty;
+}
 
-        EEPROM.write(FLAG_ADDR, FLAG_VALID);
-        for (int i = 0; i < MAX_CRED_LENGTH; ++i) {
-            EEPROM.write(SSID_ADDR + i, (i < ssid.length()) ? ssid[i] : 0);
-            EEPROM.write(PASS_ADDR + i, (i < password.length()) ? password[i] : 0);
+void configWriterTask(void *pvParameters) {
+    configWriterTaskHandle = xTaskGetCurrentTaskHandle();
+    const TickType_t debounceTicks = pdMS_TO_TICKS(CONFIG_COMMIT_DEBOUNCE_MS);
+    const TickType_t maxDelayTicks = pdMS_TO_TICKS(CONFIG_COMMIT_MAX_DELAY_MS);
+    const TickType_t minIntervalTicks = pdMS_TO_TICKS(CONFIG_COMMIT_MIN_INTERVAL_MS);
+
+    while (true) {
+        // Sleep until the first change of a burst
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (configDirty) {
+            TickType_t now = xTaskGetTickCount();
+            TickType_t sinceChange = now - lastChangeTick;
+            TickType_t sinceFirst = now - firstChangeTick;
+
+            // Due when the burst went quiet or has been pending too long...
+            TickType_t wait = min(sinceChange < debounceTicks ? debounceTicks - sinceChange : 0,
+                                  sinceFirst < maxDelayTicks ? maxDelayTicks - sinceFirst : 0);
+            // ...but never sooner than the minimum interval after the previous commit
+            if (hasCommitted) {
+                TickType_t sinceCommit = now - lastCommitTick;
+                wait = max(wait, sinceCommit < minIntervalTicks ? minIntervalTicks - sinceCommit : 0);
+            }
+
+            if (wait > 0) {
+                ulTaskNotifyTake(pdTRUE, wait); // Further changes just re-evaluate the deadline
+                continue;
+            }
+            if (!flushConfig()) {
+                vTaskDelay(debounceTicks); // Retry a failed commit later
+            }
         }
+    }
+}
 
-        if (EEPROM.commit()) {
-            Log::info("Credentials saved successfully in EEPROM.");
-            xSemaphoreGive(eepromMutex);
-            return true;
-        } else {
-            Log::error("Failed to commit changes to EEPROM.");
-            xSemaphoreGive(eepromMutex);
-            return false;
-        }
+// Save Credentials
+bool saveCredentials(const String &ssid, const String &password) {
+    Log::info("Attempting to save credentials: SSID=%s, Password=%s", ssid.c_str(), password.c_str());
+
+    if (ssid.length() > MAX_CRED_LENGTH || password.length() > MAX_CRED_LENGTH) {
+        Log::error("Credentials exceed maximum length.");
+        return false;
+    }
+
+    DeviceConfig draft;
+    if (!beginConfigEdit(draft)) {
+        return false;
+    }
+    memset(draft.ssid, 0, sizeof(draft.ssid));
+    memset(draft.password, 0, sizeof(draft.password));
+    memcpy(draft.ssid, ssid.c_str(), ssid.length());
+    memcpy(draft.password, password.c_str(), password.length());
+    draft.validMask |= CONFIG_FIELD_CREDENTIALS;
+
+    if (endConfigEdit(draft, true)) {
+        Log::info("Credentials saved successfully in EEPROM.");
+        return true;
     } else {
-        Log::error("Could not acquire EEPROM mutex.");
+        Log::error("Failed to commit changes to EEPROM.");
         return false;
     }
 }
 
 bool loadCredentials(String &ssid, String &password) {
-    if (eepromMutex == NULL) {
+    DeviceConfig config;
+    if (!loadConfig(config)) {
         Log::error("EEPROM mutex not initialized.");
         return false;
     }
-
-    if (xSemaphoreTake(eepromMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        if (EEPROM.read(FLAG_ADDR) != FLAG_VALID) {
-            Log::warn("No valid credentials found in EEPROM.");
-            xSemaphoreGive(eepromMutex);
-            return false;
-        }
-
-        char ssidBuffer[MAX_CRED_LENGTH + 1];
-        char passBuffer[MAX_CRED_LENGTH + 1];
-        for (int i = 0; i < MAX_CRED_LENGTH; ++i) {
-            ssidBuffer[i] = EEPROM.read(SSID_ADDR + i);
-            passBuffer[i] = EEPROM.read(PASS_ADDR + i);
-        }
-        ssidBuffer[MAX_CRED_LENGTH] = '\0';
-        passBuffer[MAX_CRED_LENGTH] = '\0';
-
-        ssid = String(ssidBuffer);
-        password = String(passBuffer);
-
-        Log::info("Loaded credentials: SSID=%s, Password=%s", ssid.c_str(), password.c_str());
-        xSemaphoreGive(eepromMutex);
-        return true;
-    } else {
-        Log::error("Could not acquire EEPROM mutex.");
+    if (!(config.validMask & CONFIG_FIELD_CREDENTIALS)) {
+        Log::warn("No valid credentials found in EEPROM.");
         return false;
     }
+
+    ssid = String(config.ssid);
+    password = String(config.password);
+
+    Log::info("Loaded credentials: SSID=%s, Password=%s", ssid.c_str(), password.c_str());
+    return true;
 }
 
 // Clear Credentials
 void clearCredentials() {
-    if (eepromMutex == NULL) {
-        Log::error("EEPROM mutex not initialized.");
+    DeviceConfig draft;
+    if (!beginConfigEdit(draft)) {
         return;
     }
+    memset(draft.ssid, 0, sizeof(draft.ssid));
+    memset(draft.password, 0, sizeof(draft.password));
+    draft.validMask &= ~CONFIG_FIELD_CREDENTIALS;
+    endConfigEdit(draft, true);
+    Log::info("Credentials cleared in EEPROM.");
+}
+
+size_t loadWiFiProfiles(WiFiProfile profiles[WIFI_MAX_PROFILES]) {
+    memset(profiles, 0, WIFI_MAX_PROFILES * sizeof(WiFiProfile));
+    DeviceConfig config;
+    if (!loadConfig(config)) {
+        return 0;
+    }
 
-    if (xSemaphoreTake(eepromMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        EEPROM.write(FLAG_ADDR, 0xFF);
-        for (int i = 0; i < MAX_CRED_LENGTH; ++i) {
-            EEPROM.write(SSID_ADDR + i, 0);
-            EEPROM.write(PASS_ADDR + i, 0);
+    size_t count = 0;
+    // The primary keeps its original rule: both SSID and password are required
+    if ((config.validMask & CONFIG_FIELD_CREDENTIALS) && config.ssid[0] != '\0' && config.password[0] != '\0') {
+        strncpy(profiles[0].ssid, config.ssid, WIFI_SSID_LENGTH);
+        strncpy(profiles[0].password, config.password, MAX_CRED_LENGTH);
+        profiles[0].priority = config.wifiPrimaryPriority;
+        count++;
+    }
+    for (int i = 0; i < WIFI_MAX_PROFILES - 1; i++) {
+        if (config.wifiBackups[i].ssid[0] != '\0') {
+            memcpy(&profiles[i + 1], &config.wifiBackups[i], sizeof(WiFiProfile));
+            count++;
         }
-        EEPROM.commit();
-        Log::info("Credentials cleared in EEPROM.");
-        xSemaphoreGive(eepromMutex);
+    }
+    return count;
+}
+
+bool saveWiFiProfile(uint8_t slot, const WiFiProfile &profile) {
+    if (slot >= WIFI_MAX_PROFILES || profile.priority > WIFI_PROFILE_MAX_PRIORITY ||
+        strnlen(profile.ssid, sizeof(profile.ssid)) > WIFI_SSID_LENGTH ||
+        strnlen(profile.password, sizeof(profile.password)) > MAX_CRED_LENGTH) {
+        Log::error("Invalid WiFi profile for slot %u.", slot);
+        return false;
+    }
+    if (slot == 0) {
+        if (profile.ssid[0] == '\0') {
+            clearCredentials();
+            return true;
+        }
+        DeviceConfig draft;
+        if (!beginConfigEdit(draft)) {
+            return false;
+        }
+        draft.wifiPrimaryPriority = profile.priority;
+        endConfigEdit(draft);
+        return saveCredentials(String(profile.ssid), String(profile.password));
+    }
+
+    DeviceConfig draft;
+    if (!beginConfigEdit(draft)) {
+        return false;
+    }
+    WiFiProfile &stored = draft.wifiBackups[slot - 1];
+    memset(&stored, 0, sizeof(WiFiProfile));
+    if (profile.ssid[0] != '\0') {
+        strncpy(stored.ssid, profile.ssid, WIFI_SSID_LENGTH);
+        strncpy(stored.password, profile.password, MAX_CRED_LENGTH);
+        stored.priority = profile.priority;
+    }
+    bool ok = endConfigEdit(draft);
+    if (ok) {
+        Log::info("WiFi profile %u %s.", slot, profile.ssid[0] != '\0' ? "saved" : "cleared");
     } else {
-        Log::error("Could not acquire EEPROM mutex.");
+        Log::error("Failed to store WiFi profile %u.", slot);
     }
+    return ok;
 }
 
 // Print EEPROM Contents
 void printEEPROMContents() {
-    if (eepromMutex == NULL) {
+    DeviceConfig config;
+    if (!loadConfig(config)) {
         Log::error("EEPROM mutex not initialized.");
         return;
     }
 
-    if (xSemaphoreTake(eepromMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        Log::info("EEPROM Contents:");
-        Log::info("  FLAG_ADDR: %02X", EEPROM.read(FLAG_ADDR));
-
-        char ssidBuffer[MAX_CRED_LENGTH + 1];
-        for (int i = 0; i < MAX_CRED_LENGTH; ++i) {
-            char c = EEPROM.read(SSID_ADDR + i);
-            if (c == 0) break;
-            ssidBuffer[i] = c;
+    Log::info("EEPROM Contents (schema %u):", CONFIG_SCHEMA_VERSION);
+    Log::info("  Fields: %02lX", (unsigned long)config.validMask);
+    Log::info("  SSID: %s", config.ssid);
+    Log::info("  Password: %u chars", (unsigned)strlen(config.password));
+    for (int i = 0; i < WIFI_MAX_PROFILES - 1; i++) {
+        if (config.wifiBackups[i].ssid[0] != '\0') {
+            Log::info("  Backup SSID %d: %s (priority %u)", i + 1, config.wifiBackups[i].ssid, config.wifiBackups[i].priority);
         }
-        ssidBuffer[MAX_CRED_LENGTH] = '\0';
-        Log::info("  SSID: %s", ssidBuffer);
-
-        char passBuffer[MAX_CRED_LENGTH + 1];
-        for (int i = 0; i < MAX_CRED_LENGTH; ++i) {
-            char c = EEPROM.read(PASS_ADDR + i);
-            if (c == 0) break;
-            passBuffer[i] = c;
-        }
-        passBuffer[MAX_CRED_LENGTH] = '\0';
-        Log::info("\nPassword: %s", passBuffer);
-
-        xSemaphoreGive(eepromMutex);
-    } else {
-        Log::error("Could not acquire EEPROM mutex.");
     }
+    Log::info("  Max temperature: %.2f, max time: %lu s", config.maxTemperature, (unsigned long)config.maxTimeSeconds);
+    Log::info("  Commits: %lu%s", (unsigned long)config.commitCount, configDirty ? " (changes pending)" : "");
 }
 
 float getStoredMaxTemperature() {
@@ -198,101 +583,131 @@ float getStoredMaxTemperature() {
 
 // Save temperature to EEPROM
 bool saveMaxTemperature(float temperature) {
-    if (eepromMutex == NULL) {
-        Log::error("EEPROM mutex not initialized.");
+    DeviceConfig draft;
+    if (!beginConfigEdit(draft)) {
         return false;
     }
-    if (xSemaphoreTake(eepromMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        EEPROM.write(FLAG_TEMP_ADDR, FLAG_TEMP_VALID);
-        byte *tempPtr = (byte*)&temperature;
-        for (int i = 0; i < sizeof(float); ++i) {
-            EEPROM.write(TEMP_ADDR + i, tempPtr[i]);
-        }
-        bool ok = EEPROM.commit();
-        xSemaphoreGive(eepromMutex);
-        if (ok) {
-            Log::info("Temperature %.2f saved to EEPROM.", temperature);
-        } else {
-            Log::error("Failed to commit temperature to EEPROM.");
-        }
-        return ok;
+    draft.maxTemperature = temperature;
+    draft.validMask |= CONFIG_FIELD_MAX_TEMPERATURE;
+    bool ok = endConfigEdit(draft);
+    if (ok) {
+        Log::info("Temperature %.2f saved to EEPROM.", temperature);
     } else {
-        Log::error("Could not acquire EEPROM mutex.");
-        return false;
+        Log::error("Failed to store temperature.");
     }
+    return ok;
 }
 
-// Read temperature from EEPROM
+// Read temperature from the cache
 bool loadMaxTemperature(float &temperature) {
-    if (eepromMutex == NULL) {
-        Log::error("EEPROM mutex not initialized.");
+    DeviceConfig config;
+    if (!loadConfig(config) || !(config.validMask & CONFIG_FIELD_MAX_TEMPERATURE)) {
         return false;
     }
-    if (xSemaphoreTake(eepromMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        if (EEPROM.read(FLAG_TEMP_ADDR) != FLAG_TEMP_VALID) {
-            xSemaphoreGive(eepromMutex);
-            return false;
-        }
-        byte tempBytes[sizeof(float)];
-        for (int i = 0; i < sizeof(float); ++i) {
-            tempBytes[i] = EEPROM.read(TEMP_ADDR + i);
-        }
-        memcpy(&temperature, tempBytes, sizeof(float));
-        xSemaphoreGive(eepromMutex);
-        // Log::debug("Loaded temperature from EEPROM: %.2f", temperature);
-        return true;
+    temperature = config.maxTemperature;
+    return true;
+}
+
+// Save max time to EEPROM
+bool saveMaxTime(uint32_t maxTimeSeconds) {
+    DeviceConfig draft;
+    if (!beginConfigEdit(draft)) {
+        return false;
+    }
+    draft.maxTimeSeconds = maxTimeSeconds;
+    draft.validMask |= CONFIG_FIELD_MAX_TIME;
+    bool ok = endConfigEdit(draft);
+    if (ok) {
+        Log::info("Max time %lu seconds saved to EEPROM.", maxTimeSeconds);
     } else {
-        Log::error("Could not acquire EEPROM mutex.");
+        Log::error("Failed to store max time.");
+    }
+    return ok;
+}
+
+// Read max time from the cache
+bool loadMaxTime(uint32_t &maxTimeSeconds) {
+    DeviceConfig config;
+    if (!loadConfig(config) || !(config.validMask & CONFIG_FIELD_MAX_TIME)) {
         return false;
     }
+    maxTimeSeconds = config.maxTimeSeconds;
+    return true;
 }
 
-// Save max time to EEPROM
-bool saveMaxTime(uint32_t maxTimeSeconds) {
-    if (eepromMutex == NULL) {
-        Log::error("EEPROM mutex not initialized.");
+// Save a per-channel temperature calibration offset to EEPROM
+bool saveTemperatureOffset(uint8_t channel, float offset) {
+    if (channel >= TEMP_OFFSET_CHANNELS) {
+        Log::error("Invalid temperature offset channel: %u", channel);
         return false;
     }
-    if (xSemaphoreTake(eepromMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        EEPROM.write(FLAG_MAX_TIME_ADDR, FLAG_MAX_TIME_VALID);
-        byte *timePtr = (byte*)&maxTimeSeconds;
-        for (int i = 0; i < sizeof(uint32_t); ++i) {
-            EEPROM.write(MAX_TIME_ADDR + i, timePtr[i]);
-        }
-        bool ok = EEPROM.commit();
-        xSemaphoreGive(eepromMutex);
-        if (ok) {
-            Log::info("Max time %lu seconds saved to EEPROM.", maxTimeSeconds);
-        } else {
-            Log::error("Failed to commit max time to EEPROM.");
-        }
-        return ok;
+    DeviceConfig draft;
+    if (!beginConfigEdit(draft)) {
+        return false;
+    }
+    // Channels never calibrated stay at 0 (zeroed by migration)
+    draft.temperatureOffset[channel] = offset;
+    draft.validMask |= CONFIG_FIELD_TEMP_OFFSETS;
+    bool ok = endConfigEdit(draft);
+    if (ok) {
+        Log::info("Temperature offset %.2f for channel %u saved to EEPROM.", offset, channel);
     } else {
-        Log::error("Could not acquire EEPROM mutex.");
+        Log::error("Failed to store temperature offset.");
+    }
+    return ok;
+}
+
+// Read a per-channel temperature calibration offset from the cache
+bool loadTemperatureOffset(uint8_t channel, float &offset) {
+    DeviceConfig config;
+    if (channel >= TEMP_OFFSET_CHANNELS || !loadConfig(config) || !(config.validMask & CONFIG_FIELD_TEMP_OFFSETS)) {
         return false;
     }
+    offset = config.temperatureOffset[channel];
+    return true;
 }
 
-// Read max time from EEPROM
-bool loadMaxTime(uint32_t &maxTimeSeconds) {
-    if (eepromMutex == NULL) {
-        Log::error("EEPROM mutex not initialized.");
+bool saveDisplaySettings(const DisplaySettings &settings) {
+    DeviceConfig draft;
+    if (!beginConfigEdit(draft)) {
         return false;
     }
-    if (xSemaphoreTake(eepromMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        if (EEPROM.read(FLAG_MAX_TIME_ADDR) != FLAG_MAX_TIME_VALID) {
-            xSemaphoreGive(eepromMutex);
-            return false;
-        }
-        byte timeBytes[sizeof(uint32_t)];
-        for (int i = 0; i < sizeof(uint32_t); ++i) {
-            timeBytes[i] = EEPROM.read(MAX_TIME_ADDR + i);
-        }
-        memcpy(&maxTimeSeconds, timeBytes, sizeof(uint32_t));
-        xSemaphoreGive(eepromMutex);
-        return true;
+    draft.display = settings;
+    draft.validMask |= CONFIG_FIELD_DISPLAY;
+    bool ok = endConfigEdit(draft);
+    if (ok) {
+        Log::info("Display settings saved to EEPROM.");
     } else {
-        Log::error("Could not acquire EEPROM mutex.");
+        Log::error("Failed to store display settings.");
+    }
+    return ok;
+}
+
+bool loadDisplaySettings(DisplaySettings &settings) {
+    DeviceConfig config;
+    if (!loadConfig(config) || !(config.validMask & CONFIG_FIELD_DISPLAY)) {
         return false;
     }
-}
\ No newline at end of file
+    settings = config.display;
+    return true;
+}
+
+bool loadTemperatureResolution(uint8_t &bits) {
+    DeviceConfig config;
+    if (!loadConfig(config) || config.temperatureResolution == 0) {
+        return false;
+    }
+    bits = config.temperatureResolution;
+    return true;
+}
+
+bool loadSensorAddress(uint8_t channel, uint8_t address[8]) {
+    static const uint8_t UNASSIGNED[8] = {0};
+    DeviceConfig config;
+    if (channel >= TEMP_OFFSET_CHANNELS || !loadConfig(config) ||
+        memcmp(config.sensorAddress[channel], UNASSIGNED, sizeof(UNASSIGNED)) == 0) {
+        return false;
+    }
+    memcpy(address, config.sensorAddress[channel], 8);
+    return true;
+}
@@ -7,31 +7,109 @@
 
 // EEPROM Configuration Module
 // Purpose:
-// Handles storage and retrieval of Wi-Fi credentials in EEPROM.
-// Provides functions for saving, loading, clearing, and validating credentials.
+// Typed, versioned configuration store in EEPROM: Wi-Fi credentials and backup network profiles,
+// temperature/time limits, sensor calibration and display settings. The record is CRC32-protected and cached in RAM,
+// so getters never touch flash. Saves are write-behind: unchanged values are ignored and a
+// burst of changes is coalesced into one commit by configWriterTask.
 
 // Constants
-#define EEPROM_SIZE 512         // Total EEPROM size
+#define EEPROM_SIZE 1024        // Total EEPROM size
+#define MAX_CRED_LENGTH 64      // Maximum length for SSID and Password
+#define TEMP_OFFSET_CHANNELS 3  // Number of calibration offsets stored
+#define WIFI_MAX_PROFILES 4     // Slot 0 = primary credentials, slots 1-3 = backup networks
+#define WIFI_SSID_LENGTH 32     // 802.11 maximum
+#define WIFI_PROFILE_MAX_PRIORITY 5
+
+// Config record: ConfigRecordHeader followed by DeviceConfig
+#define CONFIG_RECORD_ADDR 256          // Above the legacy layout, which is left intact
+#define CONFIG_RECORD_MAGIC 0x4D494341  // "MICA"
+#define CONFIG_SCHEMA_VERSION 4
+
+// Write-behind: commit once changes stop for CONFIG_COMMIT_DEBOUNCE_MS (or have been pending for
+// CONFIG_COMMIT_MAX_DELAY_MS), but never sooner than CONFIG_COMMIT_MIN_INTERVAL_MS after the last one
+#define CONFIG_COMMIT_DEBOUNCE_MS 2000
+#define CONFIG_COMMIT_MAX_DELAY_MS 60000
+#define CONFIG_COMMIT_MIN_INTERVAL_MS 60000
+
+// Legacy layout (schema 0): fixed offsets with per-field flags, only read once for migration
 #define SSID_ADDR 0             // Address for SSID storage
 #define PASS_ADDR 64            // Address for Password storage
 #define FLAG_ADDR 128           // Address for validation flag
 #define FLAG_VALID 0xA5         // Validation flag value
-#define MAX_CRED_LENGTH 64      // Maximum length for SSID and Password
 #define TEMP_ADDR 200            // Address for storing max temperature
 #define FLAG_TEMP_ADDR 204       // Address for temperature validation flag
 #define FLAG_TEMP_VALID 0xB5     // Validation flag for temperature
 #define MAX_TIME_ADDR 208        // Address for storing max time (in seconds)
 #define FLAG_MAX_TIME_ADDR 212   // Address for max time validation flag
 #define FLAG_MAX_TIME_VALID 0xC5 // Validation flag for max time
+#define TEMP_OFFSET_ADDR 216     // Address for per-channel temperature calibration offsets (floats)
+#define FLAG_TEMP_OFFSET_ADDR 228   // Address for calibration offsets validation flag
+#define FLAG_TEMP_OFFSET_VALID 0xD5 // Validation flag for calibration offsets
+#define DISPLAY_SETTINGS_ADDR 232   // Address for display power settings (DisplaySettings)
+#define FLAG_DISPLAY_SETTINGS_ADDR 240   // Address for display settings validation flag
+#define FLAG_DISPLAY_SETTINGS_VALID 0xE5 // Validation flag for display settings
+
+// DeviceConfig::validMask bits: set once a field has been configured
+#define CONFIG_FIELD_CREDENTIALS (1 << 0)
+#define CONFIG_FIELD_MAX_TEMPERATURE (1 << 1)
+#define CONFIG_FIELD_MAX_TIME (1 << 2)
+#define CONFIG_FIELD_TEMP_OFFSETS (1 << 3)
+#define CONFIG_FIELD_DISPLAY (1 << 4)
+
+/**
+ * @brief Display power and burn-in settings.
+ */
+typedef struct {
+    uint16_t dimAfterSeconds;   // Inactivity before dimming (0 = never)
+    uint16_t offAfterSeconds;   // Inactivity before blanking (0 = never)
+    uint8_t dimContrast;        // SSD1306 contrast while dimmed (0-255)
+    uint8_t shiftMinutes;       // Pixel shift period (0 = disabled)
+} DisplaySettings;
 
-// Get stored maximum temperature from EEPROM
+/**
+ * @brief One WiFi network the device may join.
+ * An empty ssid marks an unused slot. Priority (0 to WIFI_PROFILE_MAX_PRIORITY) biases selection
+ * towards preferred networks; among equal priorities the strongest signal wins.
+ */
+typedef struct {
+    char ssid[WIFI_SSID_LENGTH + 1];        // NUL-terminated
+    char password[MAX_CRED_LENGTH + 1];     // NUL-terminated, empty for open networks
+    uint8_t priority;
+    uint8_t reserved;
+} WiFiProfile;
+
+/**
+ * @brief Complete device configuration as stored in EEPROM.
+ * Fields are ordered so the struct has no padding (the CRC covers its raw bytes).
+ * New fields go at the end; older, shorter records load with the new fields zeroed.
+ */
+typedef struct {
+    uint32_t validMask;                         // CONFIG_FIELD_* bits
+    char ssid[MAX_CRED_LENGTH + 1];             // NUL-terminated
+    char password[MAX_CRED_LENGTH + 1];         // NUL-terminated
+    DisplaySettings display;
+    float maxTemperature;                       // °C
+    uint32_t maxTimeSeconds;
+    float temperatureOffset[TEMP_OFFSET_CHANNELS]; // °C added to each sensor channel
+    uint32_t commitCount;                       // Lifetime commits of the record (schema 2+), managed by the store
+    WiFiProfile wifiBackups[WIFI_MAX_PROFILES - 1]; // Profile slots 1.. (schema 3+)
+    uint8_t wifiPrimaryPriority;                // Priority of the primary credentials (profile slot 0)
+    uint8_t powerProfile;                       // PowerProfile (0 = standard)
+    uint8_t temperatureResolution;              // DS18B20 resolution in bits (9-12), 0 = driver default
+    uint8_t reserved;
+    uint8_t sensorAddress[TEMP_OFFSET_CHANNELS][8]; // DS18B20 ROM per channel (schema 4+), all zero = unassigned
+} DeviceConfig;
+
+// Get stored maximum temperature (NAN if never configured)
 float getStoredMaxTemperature();
 
-// Get stored maximum operation time from EEPROM
+// Get stored maximum operation time (120 s if never configured)
 uint32_t getStoredMaxTime();
 
 /**
- * @brief Initializes EEPROM and the associated mutex.
+ * @brief Initializes EEPROM and the associated mutex, then loads the config record into RAM.
+ * Migrates the legacy layout only if no record exists. A record of a newer schema loads the fields
+ * this schema knows; an unreadable one is left untouched and the device runs on defaults.
  * @return true if initialization is successful, false otherwise.
  */
 bool eepromInitialize();
@@ -43,7 +121,70 @@ bool eepromInitialize();
 bool validateEEPROMSize();
 
 /**
- * @brief Saves Wi-Fi credentials to EEPROM.
+ * @brief Copies the cached configuration.
+ * @param config Destination
+ * @return true if the store is initialized, false otherwise
+ * @note Thread-safe and lock-free: Can be called from any task
+ */
+bool loadConfig(DeviceConfig &config);
+
+/**
+ * @brief Outcome of editConfig().
+ */
+typedef enum {
+    CONFIG_EDIT_APPLIED,    // Draft differed from the stored config and was staged
+    CONFIG_EDIT_UNCHANGED,  // Draft matched the stored config; nothing to write
+    CONFIG_EDIT_REJECTED,   // Editor returned false; draft discarded
+    CONFIG_EDIT_FAILED      // Store not initialized, mutex timeout or commit error
+} ConfigEditResult;
+
+/**
+ * @brief Changes a draft of the current configuration in place.
+ * @param draft Copy of the current configuration (commitCount is managed by the store)
+ * @param context Caller data passed through editConfig()
+ * @return true to store the draft, false to discard it
+ */
+typedef bool (*ConfigEditor)(DeviceConfig &draft, void *context);
+
+/**
+ * @brief Atomic read-modify-write of several fields; committed by the writer task like any other save.
+ * The editor runs under the EEPROM mutex on a copy of the current config, so no other setter can
+ * run between the read and the write: fields the editor leaves alone keep concurrent changes.
+ * @param editor Applies the changes; must not call other config setters (the mutex is not recursive)
+ * @param context Passed to the editor
+ * @return CONFIG_EDIT_* outcome
+ * @note Thread-safe: Serialized by the EEPROM mutex
+ */
+ConfigEditResult editConfig(ConfigEditor editor, void *context);
+
+/**
+ * @brief Commits pending changes now. Call before restarting the device.
+ * @return true if nothing was pending or the commit succeeded, false otherwise
+ */
+bool flushConfig();
+
+/**
+ * @brief Lifetime number of EEPROM commits of the config record (flash wear indicator).
+ * @note Thread-safe and lock-free
+ */
+uint32_t getConfigCommitCount();
+
+/**
+ * @brief Whether changes are waiting for the writer task.
+ */
+bool isConfigCommitPending();
+
+/**
+ * @brief FreeRTOS task that commits staged config changes (write-behind).
+ * - Sleeps until a change is staged.
+ * - Debounces bursts and rate-limits commits (CONFIG_COMMIT_* timings).
+ */
+void configWriterTask(void *pvParameters);
+
+/**
+ * @brief Saves Wi-Fi credentials to EEPROM. Committed immediately, bypassing write-behind: the
+ * portal and profile paths switch to the new network right away (no restart follows), and credentials
+ * lost to a power cut before the commit would leave the device unable to join any network.
  * @param ssid The SSID to save.
  * @param password The password to save.
  * @return true if credentials are saved successfully, false otherwise.
@@ -63,6 +204,22 @@ bool loadCredentials(String &ssid, String &password);
  */
 void clearCredentials();
 
+/**
+ * @brief Loads every WiFi profile slot. Slot 0 mirrors the primary credentials.
+ * @param profiles Destination, WIFI_MAX_PROFILES entries; unused slots have an empty ssid
+ * @return Number of usable profiles (0 if none or the store is not initialized)
+ * @note Thread-safe and lock-free: Reads the config cache
+ */
+size_t loadWiFiProfiles(WiFiProfile profiles[WIFI_MAX_PROFILES]);
+
+/**
+ * @brief Stores a WiFi profile. Slot 0 replaces the primary credentials (committed immediately).
+ * @param slot 0 to WIFI_MAX_PROFILES - 1
+ * @param profile Profile to store; an empty ssid clears the slot
+ * @return true if saved successfully, false otherwise
+ */
+bool saveWiFiProfile(uint8_t slot, const WiFiProfile &profile);
+
 /**
  * @brief Prints the contents of EEPROM.
  */
@@ -83,17 +240,62 @@ bool saveMaxTemperature(float temperature);
 bool loadMaxTemperature(float &temperature);
 
 /**
- * @brief Save maximum time to EEPROM.
- * @param maxTimeSeconds Maximum time in seconds (uint32_t)
+ * @brief Save maximum operation time to EEPROM.
+ * @param maxTimeSeconds Maximum time in seconds
  * @return true if saved successfully, false otherwise
  */
 bool saveMaxTime(uint32_t maxTimeSeconds);
 
 /**
- * @brief Load maximum time from EEPROM.
+ * @brief Load maximum operation time from EEPROM.
  * @param maxTimeSeconds Variable where the time will be stored
  * @return true if loaded successfully, false otherwise
  */
 bool loadMaxTime(uint32_t &maxTimeSeconds);
 
-#endif
\ No newline at end of file
+/**
+ * @brief Save a temperature sensor calibration offset to EEPROM.
+ * @param channel Sensor channel index (0 to TEMP_OFFSET_CHANNELS - 1)
+ * @param offset Offset in °C added to the raw reading
+ * @return true if saved successfully, false otherwise
+ */
+bool saveTemperatureOffset(uint8_t channel, float offset);
+
+/**
+ * @brief Load a temperature sensor calibration offset from EEPROM.
+ * @param channel Sensor channel index (0 to TEMP_OFFSET_CHANNELS - 1)
+ * @param offset Variable where the offset will be stored
+ * @return true if loaded successfully, false otherwise
+ */
+bool loadTemperatureOffset(uint8_t channel, float &offset);
+
+/**
+ * @brief Save the display power settings to EEPROM.
+ * @param settings Settings to store
+ * @return true if saved successfully, false otherwise
+ */
+bool saveDisplaySettings(const DisplaySettings &settings);
+
+/**
+ * @brief Load the display power settings from EEPROM.
+ * @param settings Variable where the settings will be stored
+ * @return true if loaded successfully, false if never saved
+ */
+bool loadDisplaySettings(DisplaySettings &settings);
+
+/**
+ * @brief Load the DS18B20 resolution set through the config document.
+ * @param bits Variable where the resolution (9-12) will be stored
+ * @return true if loaded successfully, false if never set
+ */
+bool loadTemperatureResolution(uint8_t &bits);
+
+/**
+ * @brief Load the DS18B20 ROM address assigned to a sensor channel through the config document.
+ * @param channel Sensor channel index (0 to TEMP_OFFSET_CHANNELS - 1)
+ * @param address Receives the 8-byte ROM address
+ * @return true if an address is assigned, false if the channel follows bus order
+ */
+bool loadSensorAddress(uint8_t channel, uint8_t address[8]);
+
+#endif
@@ -2,8 +2,9 @@
 // MQTT Handler Module
 // Purpose: Generic MQTT communication layer for AWS IoT Core with device provisioning
 // Architecture: Queue-based pub/sub with callback registration, automatic credential provisioning
-// Thread-Safety: FreeRTOS queues for publish, mutex for subscriptions, PubSubClient internal locking
-// Dependencies: PubSubClient, WiFiClientSecure, ArduinoJson, HTTPClient, system_state
+// Thread-Safety: FreeRTOS queues for publish, mutex for subscriptions, PubSubClient internal locking;
+//                command handlers are serialized by dispatchMutex (MQTT task, LAN control, local API)
+// Dependencies: PubSubClient, WiFiClientSecure, ArduinoJson, HTTPClient, system_state, ota_manager
 
 #include "mqtt_handler.h"
 
@@ -11,8 +12,11 @@
 #include "config.h"
 #include "device_id.h"
 #include "eeprom_config.h"
+#include "ota_manager.h"
+#include "power_manager.h"
 #include "secrets.h"
 #include "system_state.h"
+#include "wifi_connect.h"
 
 // Third-party libraries
 #include <Arduino.h>
@@ -31,7 +35,7 @@
 #include <freertos/task.h>
 
 const int MQTT_MAX_MESSAGE_SIZE = 8192;
-const int MAX_MQTT_SUBSCRIPTIONS = 10;
+const int MAX_MQTT_SUBSCRIPTIONS = 16;
 
 WiFiClientSecure net;
 PubSubClient mqttClient(net);
@@ -46,6 +50,9 @@ QueueHandle_t mqttPublishQueue = NULL;
 // Mutex for subscription registration (thread-safe subscribe)
 SemaphoreHandle_t subscriptionMutex = NULL;
 
+// Handlers were written for a single caller; dispatch from other transports is serialized
+static SemaphoreHandle_t dispatchMutex = NULL;
+
 // Callback registration system
 struct MqttSubscription {
     String topic;
@@ -55,6 +62,9 @@ struct MqttSubscription {
 static MqttSubscription subscriptions[MAX_MQTT_SUBSCRIPTIONS];
 static int subscriptionCount = 0;
 
+// Incremented on every successful broker connection; report channels re-publish after a reconnect
+static volatile uint32_t connectionGeneration = 0;
+
 // Internal: load cert and key from flash
 bool loadDeviceCredentialsFromFlash()
 {
@@ -113,32 +123,46 @@ bool requestDeviceCredentialsFromAPI()
 String OTA_TOPIC;
 String HEALTH_CHECK_TOPIC;
 
-void initializeMQTTHandler(const char* deviceType, const char* deviceId)
+bool initializeMQTTQueues()
 {
-    String devType = String(deviceType);
-    String devId = String(deviceId);
-    
-    // Only initialize system-level topics (healthcheck, OTA)
-    HEALTH_CHECK_TOPIC = "mica/dev/status/" + devType + "/" + devId + "/healthcheck";
-    OTA_TOPIC = "mica/dev/command/" + devType + "/" + devId + "/ota";
-    
     // Create publish queue (if not already created)
     if (mqttPublishQueue == NULL) {
         mqttPublishQueue = xQueueCreate(MQTT_PUBLISH_QUEUE_SIZE, sizeof(MqttPublishMessage));
         if (mqttPublishQueue == NULL) {
             Log::error("Failed to create MQTT publish queue");
-        } else {
-            Log::info("MQTT publish queue created (size: %d)", MQTT_PUBLISH_QUEUE_SIZE);
+            return false;
         }
+        Log::info("MQTT publish queue created (size: %d)", MQTT_PUBLISH_QUEUE_SIZE);
     }
     
-    // Create subscription mutex (if not already created)
+    // Create subscription and dispatch mutexes (if not already created)
     if (subscriptionMutex == NULL) {
         subscriptionMutex = xSemaphoreCreateMutex();
         if (subscriptionMutex == NULL) {
             Log::error("Failed to create subscription mutex");
+            return false;
         }
     }
+    if (dispatchMutex == NULL) {
+        dispatchMutex = xSemaphoreCreateMutex();
+        if (dispatchMutex == NULL) {
+            Log::error("Failed to create dispatch mutex");
+            return false;
+        }
+    }
+    return true;
+}
+
+void initializeMQTTHandler(const char* deviceType, const char* deviceId)
+{
+    String devType = String(deviceType);
+    String devId = String(deviceId);
+    
+    // Only initialize system-level topics (healthcheck, OTA)
+    HEALTH_CHECK_TOPIC = "mica/dev/status/" + devType + "/" + devId + "/healthcheck";
+    OTA_TOPIC = "mica/dev/command/" + devType + "/" + devId + "/ota";
+    
+    initializeMQTTQueues();
     
     net.setCACert(AWS_CERT_CA);
     net.setCertificate(deviceCert.c_str());
@@ -147,8 +171,7 @@ void initializeMQTTHandler(const char* deviceType, const char* deviceId)
     mqttClient.setCallback(mqttMessageCallback);
     mqttClient.setBufferSize(MQTT_MAX_MESSAGE_SIZE);
     
-    // Reset subscription list
-    subscriptionCount = 0;
+    // Registered handlers are kept across reconnects: LAN control still uses them while the broker is away
     
     Log::info("MQTT Handler initialized for device type '%s' with ID: %s", deviceType, deviceId);
 }
@@ -176,55 +199,76 @@ void mqttMessageCallback(char *topic, byte *payload, unsigned int length)
     if (strcmp(topic, OTA_TOPIC.c_str()) == 0)
     {
         Log::info("OTA update command received via dedicated topic.");
-        StaticJsonDocument<2048> doc;
-        DeserializationError err = deserializeJson(doc, message);
-        if (err)
+        if (storeOTAManifest(message, length))
         {
-            Log::error("Failed to parse OTA JSON: %s", err.c_str());
-            return;
+            notifySystemState(EVENT_OTA_UPDATE);
         }
-        String jsonPretty;
-        serializeJsonPretty(doc, jsonPretty);
-        Log::debug("Full parsed JSON (pretty):\n%s", jsonPretty.c_str());
-        const char *firmwareUrl = doc["firmwareUrl"];
-        if (!firmwareUrl || strlen(firmwareUrl) == 0)
-        {
-            Log::error("No firmwareUrl in OTA message.");
-            return;
-        }
-        Preferences preferences;
-        preferences.begin("ota", false);
-        preferences.putString("url", firmwareUrl);
-        preferences.end();
-        Log::info("Firmware URL length: %d", strlen(firmwareUrl));
-        Log::info("Stored firmwareUrl to EEPROM: %s", firmwareUrl);
-        notifySystemState(EVENT_OTA_UPDATE);
         return;
     }
 
     // Route to registered handlers
-    bool handlerFound = false;
-    for (int i = 0; i < subscriptionCount; i++)
+    if (!mqttDispatchCommand(topic, message, length))
     {
-        if (strcmp(topic, subscriptions[i].topic.c_str()) == 0)
+        Log::warn("No handler registered for topic: %s", topic);
+    }
+}
+
+bool mqttDispatchCommand(const char* topic, const char* payload, unsigned int length)
+{
+    if (subscriptionMutex == NULL || dispatchMutex == NULL)
+    {
+        return false;
+    }
+
+    MqttMessageHandler handler = NULL;
+    if (xSemaphoreTake(subscriptionMutex, pdMS_TO_TICKS(1000)) == pdTRUE)
+    {
+        for (int i = 0; i < subscriptionCount; i++)
         {
-            subscriptions[i].handler(topic, message, length);
-            handlerFound = true;
-            break;
+            if (strcmp(topic, subscriptions[i].topic.c_str()) == 0)
+            {
+                handler = subscriptions[i].handler;
+                break;
+            }
         }
+        xSemaphoreGive(subscriptionMutex);
+    }
+    if (handler == NULL)
+    {
+        return false;
     }
 
-    if (!handlerFound)
+    if (xSemaphoreTake(dispatchMutex, pdMS_TO_TICKS(1000)) != pdTRUE)
     {
-        Log::warn("No handler registered for topic: %s", topic);
+        Log::error("Command handler busy, dropped: %s", topic);
+        return true;
+    }
+    handler(topic, payload, length);
+    xSemaphoreGive(dispatchMutex);
+    return true;
+}
+
+bool mqttRunSerialized(void (*work)(void *context), void *context)
+{
+    if (dispatchMutex == NULL || xSemaphoreTake(dispatchMutex, pdMS_TO_TICKS(1000)) != pdTRUE)
+    {
+        Log::error("Command handler busy, request dropped");
+        return false;
     }
+    work(context);
+    xSemaphoreGive(dispatchMutex);
+    return true;
 }
 
 bool connectMQTTClient(String deviceId)
 {
     initializeMQTTHandler("recirculator", deviceId.c_str());
+    // Longer keepalives let the radio stay in modem sleep between DTIM beacons
+    mqttClient.setKeepAlive(getPowerProfileInfo().mqttKeepAliveSeconds);
     if (mqttClient.connect(deviceId.c_str()))
     {
+        connectionGeneration++;
+
         // Subscribe to OTA topic (temporary - will be moved to ota_manager)
         if (mqttClient.subscribe(OTA_TOPIC.c_str()))
         {
@@ -370,12 +414,14 @@ void mqttPublishTask(void *pvParameters)
             continue;
         }
 
-        // Case 3: Process queued publish messages
-        if (xQueueReceive(mqttPublishQueue, &msg, pdMS_TO_TICKS(100)) == pdTRUE)
+        // Case 3: Process queued publish messages (the wait is the idle period of the power profile)
+        bool processed = false;
+        if (xQueueReceive(mqttPublishQueue, &msg, pdMS_TO_TICKS(getPowerProfileInfo().idleWaitMs)) == pdTRUE)
         {
+            processed = true;
             if (mqttClient.connected())
             {
-                bool published = mqttClient.publish(msg.topic, msg.payload, msg.retain);
+                bool published = mqttClient.publish(msg.topic, (const uint8_t*)msg.payload, msg.payloadLength, msg.retain);
                 if (!published)
                 {
                     Log::error("Failed to publish to %s. MQTT State: %d", msg.topic, mqttClient.state());
@@ -396,8 +442,11 @@ void mqttPublishTask(void *pvParameters)
             lastHealthCheck = now;
         }
 
-        // Small delay to prevent task starvation (only if queue was empty)
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // Small delay to prevent task starvation (the queue wait already blocked if it was empty)
+        if (processed)
+        {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
     }
 }
 
@@ -408,10 +457,31 @@ void mqttPublishTask(void *pvParameters)
  */
 bool publishHealthCheck(uint64_t uptime)
 {
-    const size_t capacity = 256;
+    const size_t capacity = 512;
     DynamicJsonDocument doc(capacity);
     doc["uptime"] = uptime;
     doc["freeHeap"] = ESP.getFreeHeap();
+    doc["configCommits"] = getConfigCommitCount(); // Lifetime EEPROM commits (flash wear)
+    doc["configPending"] = isConfigCommitPending();
+
+    WiFiStats wifi;
+    getWiFiStats(wifi);
+    doc["rssi"] = wifi.rssi;
+    doc["wifiDisconnects"] = wifi.disconnectCount;
+    doc["wifiRoams"] = wifi.roamCount;
+    doc["wifiLastReason"] = wifi.lastDisconnectReason;
+    doc["wifiLastRssi"] = wifi.lastDisconnectRssi;
+    doc["wifiLastOutageMs"] = wifi.lastOutageMs;
+
+    doc["powerProfile"] = getPowerProfileInfo().name;
+    if (isPowerBenchmarkEnabled())
+    {
+        PowerStats power;
+        takePowerStats(power); // One window per healthcheck interval
+        doc["powerWindowMs"] = power.windowMs;
+        doc["powerWakes"] = power.wakes;
+        doc["powerIdleMs"] = power.idleMs;
+    }
     String jsonString;
     serializeJson(doc, jsonString);
 
@@ -424,6 +494,11 @@ bool publishHealthCheck(uint64_t uptime)
 //------------------------------------------------------------------------------
 
 bool mqttPublish(const char* topic, const char* payload, bool retain)
+{
+    return mqttPublishBinary(topic, (const uint8_t*)payload, strlen(payload), retain);
+}
+
+bool mqttPublishBinary(const char* topic, const uint8_t* data, size_t length, bool retain)
 {
     if (mqttPublishQueue == NULL)
     {
@@ -437,9 +512,9 @@ bool mqttPublish(const char* topic, const char* payload, bool retain)
         Log::error("Topic too long (%d bytes): %s", strlen(topic), topic);
         return false;
     }
-    if (strlen(payload) >= MQTT_PAYLOAD_MAX_LENGTH)
+    if (length >= MQTT_PAYLOAD_MAX_LENGTH)
     {
-        Log::error("Payload too long (%d bytes) for topic: %s", strlen(payload), topic);
+        Log::error("Payload too long (%d bytes) for topic: %s", length, topic);
         return false;
     }
 
@@ -447,8 +522,9 @@ bool mqttPublish(const char* topic, const char* payload, bool retain)
     MqttPublishMessage msg;
     strncpy(msg.topic, topic, MQTT_TOPIC_MAX_LENGTH - 1);
     msg.topic[MQTT_TOPIC_MAX_LENGTH - 1] = '\0';
-    strncpy(msg.payload, payload, MQTT_PAYLOAD_MAX_LENGTH - 1);
-    msg.payload[MQTT_PAYLOAD_MAX_LENGTH - 1] = '\0';
+    memcpy(msg.payload, data, length);
+    msg.payload[length] = '\0';
+    msg.payloadLength = (uint16_t)length;
     msg.retain = retain;
 
     // Enqueue message (wait up to 100ms if queue is full)
@@ -480,24 +556,24 @@ bool mqttSubscribe(const char* topic, MqttMessageHandler handler)
 
     bool result = false;
 
-    if (subscriptionCount >= MAX_MQTT_SUBSCRIPTIONS)
-    {
-        Log::error("Maximum MQTT subscriptions (%d) reached. Cannot subscribe to: %s", 
-                   MAX_MQTT_SUBSCRIPTIONS, topic);
-        goto cleanup;
-    }
-
-    // Check if already subscribed
+    // Check if already subscribed (before the capacity check, so a full table still accepts it)
     for (int i = 0; i < subscriptionCount; i++)
     {
         if (subscriptions[i].topic == topic)
         {
-            Log::warn("Already subscribed to: %s", topic);
+            Log::debug("Already subscribed to: %s", topic);
             result = true;
             goto cleanup;
         }
     }
 
+    if (subscriptionCount >= MAX_MQTT_SUBSCRIPTIONS)
+    {
+        Log::error("Maximum MQTT subscriptions (%d) reached. Cannot subscribe to: %s", 
+                   MAX_MQTT_SUBSCRIPTIONS, topic);
+        goto cleanup;
+    }
+
     // Register subscription
     subscriptions[subscriptionCount].topic = String(topic);
     subscriptions[subscriptionCount].handler = handler;
@@ -533,4 +609,52 @@ cleanup:
 bool isMqttConnected()
 {
     return mqttClient.connected();
-}
\ No newline at end of file
+}
+
+//------------------------------------------------------------------------------
+// Report-by-exception - publish only on significant change, state change or heartbeat
+//------------------------------------------------------------------------------
+
+void mqttInitReportChannel(MqttReportChannel &channel, const MqttReportPolicy &policy)
+{
+    channel.policy = policy;
+    mqttResetReportChannel(channel);
+}
+
+bool mqttReportDue(const MqttReportChannel &channel, float value, uint8_t quality, uint32_t nowMs)
+{
+    if (!channel.hasReported || channel.connectionGeneration != connectionGeneration)
+    {
+        return true;
+    }
+    if (quality != channel.lastQuality)
+    {
+        return true;
+    }
+
+    uint32_t sinceLast = nowMs - channel.lastReportMs;
+    if (channel.policy.maxIntervalMs > 0 && sinceLast >= channel.policy.maxIntervalMs)
+    {
+        return true;
+    }
+    if (sinceLast < channel.policy.minIntervalMs)
+    {
+        return false;
+    }
+    return fabsf(value - channel.lastValue) >= channel.policy.deadband;
+}
+
+void mqttReportSent(MqttReportChannel &channel, float value, uint8_t quality, uint32_t nowMs)
+{
+    channel.lastValue = value;
+    channel.lastQuality = quality;
+    channel.lastReportMs = nowMs;
+    channel.connectionGeneration = connectionGeneration;
+    channel.hasReported = true;
+}
+
+void mqttResetReportChannel(MqttReportChannel &channel)
+{
+    channel.hasReported = false;
+    channel.lastReportMs = 0;
+}
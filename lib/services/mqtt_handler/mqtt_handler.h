@@ -17,6 +17,7 @@
 // 4. mqttPublishTask() dequeues and publishes to broker
 // 5. Modules register callbacks via mqttSubscribe(topic, handler) to receive commands
 // 6. mqttMessageCallback() routes incoming messages to registered handlers
+// 7. Periodic telemetry uses report-by-exception: mqttReportDue() decides, mqttReportSent() commits
 
 // Maximum message sizes
 #define MQTT_TOPIC_MAX_LENGTH 128
@@ -29,9 +30,31 @@
 typedef struct {
     char topic[MQTT_TOPIC_MAX_LENGTH];
     char payload[MQTT_PAYLOAD_MAX_LENGTH];
+    uint16_t payloadLength;     // Bytes used in payload (binary-safe)
     bool retain;
 } MqttPublishMessage;
 
+/**
+ * @brief Report-by-exception policy for a sampled value
+ */
+typedef struct {
+    float deadband;             // Report when |value - last reported| >= deadband
+    uint32_t minIntervalMs;     // Rate limit between reports (quality changes bypass it)
+    uint32_t maxIntervalMs;     // Heartbeat: report at least this often (0 = no heartbeat)
+} MqttReportPolicy;
+
+/**
+ * @brief Per-value report-by-exception state. Initialize with mqttInitReportChannel().
+ */
+typedef struct {
+    MqttReportPolicy policy;
+    float lastValue;
+    uint8_t lastQuality;
+    uint32_t lastReportMs;
+    uint32_t connectionGeneration;  // Connection the last report went out on
+    bool hasReported;
+} MqttReportChannel;
+
 /**
  * @brief Callback function type for MQTT message handlers
  * @param topic The message topic
@@ -40,6 +63,13 @@ typedef struct {
  */
 typedef void (*MqttMessageHandler)(const char* topic, const char* payload, unsigned int length);
 
+/**
+ * @brief Creates the publish queue and the handler table locks (idempotent).
+ * Called at boot so handlers can be registered, and messages queued, before the broker is reachable.
+ * @return true on success, false if a queue or mutex could not be created
+ */
+bool initializeMQTTQueues();
+
 /**
  * @brief Initializes the MQTT handler with secure client settings for AWS IoT.
  * @param deviceType Type of device (e.g., "recirculator", "gateway", "sensor")
@@ -61,6 +91,27 @@ bool connectMQTT();
  */
 void mqttMessageCallback(char* topic, byte* payload, unsigned int length);
 
+/**
+ * @brief Runs the handler registered for a command topic, as if the message came from the broker.
+ * Lets other transports (LAN control) reuse the MQTT command handlers.
+ * @param topic Full command topic (exact match)
+ * @param payload NUL-terminated payload
+ * @param length Payload length
+ * @return true if a handler was found, false otherwise
+ * @note Thread-safe: Handlers never run concurrently
+ */
+bool mqttDispatchCommand(const char* topic, const char* payload, unsigned int length);
+
+/**
+ * @brief Runs work under the same lock as the command handlers.
+ * For transports that call module APIs directly but need the result (local API).
+ * @param work Function to run; must not dispatch commands itself
+ * @param context Passed to work
+ * @return true if work ran, false if the handlers stayed busy (1 s) or the queues are not initialized
+ * @note Thread-safe: Never runs concurrently with a command handler
+ */
+bool mqttRunSerialized(void (*work)(void *context), void *context);
+
 void mqttConnectTask(void *pvParameters);
 
 /**
@@ -81,17 +132,60 @@ void mqttPublishTask(void *pvParameters);
  */
 bool mqttPublish(const char* topic, const char* payload, bool retain = false);
 
+/**
+ * @brief Binary-safe publish for payloads that may contain NUL bytes
+ * @param topic Full MQTT topic string
+ * @param data Payload bytes
+ * @param length Payload length (must be less than MQTT_PAYLOAD_MAX_LENGTH)
+ * @param retain Whether to retain the message on the broker
+ * @return true if the message was queued, false otherwise
+ *
+ * @note Thread-safe: Can be called from any task
+ * @note Larger payloads must be split by the caller
+ */
+bool mqttPublishBinary(const char* topic, const uint8_t* data, size_t length, bool retain = false);
+
 /**
  * @brief Subscribe to an MQTT topic with a callback handler
  * @param topic Full MQTT topic string to subscribe to (exact match, no wildcards)
  * @param handler Callback function invoked when message received on this topic
  * @return true if subscription succeeds, false otherwise
  * 
- * @note Must be called after MQTT connection is established
- * @note Maximum 10 topic subscriptions supported
+ * @note Needs initializeMQTTQueues(); before the first connection the topic is subscribed on connect
+ * @note Maximum 16 topic subscriptions supported
  */
 bool mqttSubscribe(const char* topic, MqttMessageHandler handler);
 
+/**
+ * @brief Initializes a report-by-exception channel.
+ * @param channel Channel state (owned by the caller)
+ * @param policy Deadband and interval limits
+ */
+void mqttInitReportChannel(MqttReportChannel &channel, const MqttReportPolicy &policy);
+
+/**
+ * @brief Decides whether a new sample must be reported.
+ * @param channel Channel state
+ * @param value Current value
+ * @param quality Caller-defined quality/state code; any change reports immediately
+ * @param nowMs Current millis()
+ * @return true on first sample, reconnect, quality change, heartbeat expiry, or a
+ *         deadband violation once minIntervalMs has elapsed
+ * @note Does not modify the channel; call mqttReportSent() after publishing
+ */
+bool mqttReportDue(const MqttReportChannel &channel, float value, uint8_t quality, uint32_t nowMs);
+
+/**
+ * @brief Records that a sample was published.
+ * @note Only call when mqttPublish() succeeded, so dropped messages are retried
+ */
+void mqttReportSent(MqttReportChannel &channel, float value, uint8_t quality, uint32_t nowMs);
+
+/**
+ * @brief Forces the next sample of a channel to be reported.
+ */
+void mqttResetReportChannel(MqttReportChannel &channel);
+
 /**
  * @brief Check if MQTT client is connected
  * @return true if connected, false otherwise
@@ -105,6 +199,8 @@ bool isMqttConnected();
  * 
  * @note This is a system-level function (not device-specific)
  * @note Topic: mica/dev/status/{deviceType}/{deviceId}/healthcheck
+ * @note Payload: uptime, freeHeap, configCommits (lifetime EEPROM commits), configPending,
+ *       rssi and WiFi link stats (disconnects, roams, last reason, RSSI before loss, last outage)
  */
 bool publishHealthCheck(uint64_t uptime);
 
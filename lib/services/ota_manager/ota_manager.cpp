@@ -1,87 +1,654 @@
 // ota_manager.cpp
 // OTA Manager Module
 // Purpose: Manages over-the-air firmware updates via HTTPS
-// Architecture: FreeRTOS task triggered by MQTT command, reads URL from preferences
-// Thread-Safety: Single-shot task, suspends other tasks during update
-// Dependencies: HTTPUpdate, WiFiClientSecure, Preferences, system_state
+// Architecture: FreeRTOS task triggered by MQTT command (or by a pending job after reconnecting).
+//               The manifest and the download offset live in Preferences ("ota"). The image is
+//               fetched in Range chunks of OTA_CHUNK_SIZE straight into the inactive OTA partition,
+//               one flash sector at a time, and hashed on the way; a resumed download re-hashes
+//               what is already in flash. Only after the SHA-256 and the signature match the
+//               manifest is the boot partition switched.
+//               A manifest may also reference a delta patch against the running image: it is inflated
+//               (ROM miniz) and applied as a stream by ota_patch into the same partition, reading the
+//               source bytes from the running partition; the result goes through the same hash and
+//               signature check.
+//               A patch that does not apply, or keeps getting interrupted, falls back to the full image.
+// Thread-Safety: Single-shot task, suspends other tasks during update (WiFi reconnection keeps running)
+// Dependencies: HTTPClient, WiFiClientSecure, Preferences, ArduinoJson, esp_ota_ops, mbedtls, miniz (ROM),
+//               ota_patch, system_state, eeprom_config, wifi_connect
 
 #include "ota_manager.h"
 
 // Project headers (alphabetically)
+#include "config.h"
+#include "eeprom_config.h"
+#include "ota_patch.h"
 #include "secrets.h"
 #include "system_state.h"
+#include "wifi_connect.h"
 
 // Third-party libraries
 #include <Arduino.h>
-#include <HTTPUpdate.h>
+#include <ArduinoJson.h>
+#include <HTTPClient.h>
 #include <Log.h>
 #include <Preferences.h>
 #include <WiFiClientSecure.h>
 
 // System headers
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <mbedtls/base64.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+#include <rom/miniz.h>
+
+#define OTA_SECTOR_SIZE 4096            // Flash erase unit; the download buffer holds one sector
+#define OTA_MAX_URL_LENGTH 256
+#define OTA_MAX_SIGNATURE_LENGTH 160    // Base64 of a DER ECDSA signature (P-256: <= 72 bytes, P-384: <= 104)
+#define OTA_NET_BUFFER_SIZE 1024
+
+/**
+ * @brief Stored manifest and download progress.
+ */
+typedef struct {
+    char url[OTA_MAX_URL_LENGTH];
+    uint32_t size;
+    char sha256[65];
+    char signature[OTA_MAX_SIGNATURE_LENGTH];
+    uint32_t offset;                    // Bytes written and hashed, a multiple of OTA_CHUNK_SIZE
+    uint8_t stalledSessions;            // Consecutive sessions that ended without progress
+    char partition[17];                 // Label of the partition the bytes were written to
+    char patchUrl[OTA_MAX_URL_LENGTH];  // Empty: full image only
+    uint32_t patchSize;
+    char patchSource[65];               // SHA-256 of the image the patch applies to
+    bool deltaFailed;                   // The patch did not apply: use the full image
+} OtaJob;
+
+typedef enum {
+    OTA_FETCH_OK,
+    OTA_FETCH_NETWORK,                  // Connection lost or stalled: worth retrying
+    OTA_FETCH_REJECTED                  // The data itself is unusable (flash error, corrupt patch)
+} OtaFetchResult;
+
+/**
+ * @brief Consumer of downloaded bytes; returns false to reject the data.
+ */
+typedef bool (*OtaSink)(const uint8_t *data, size_t length, void *context);
+
+/**
+ * @brief Sequential writer into the update partition: erases, writes and hashes whole sectors.
+ */
+typedef struct {
+    const esp_partition_t *partition;
+    uint32_t position;                  // Offset of the sector in sectorBuffer
+    size_t filled;                      // Bytes waiting in sectorBuffer
+    mbedtls_sha256_context *sha;
+} ImageWriter;
+
+/**
+ * @brief Streaming state of a delta patch: inflater window plus the patch decoder.
+ */
+typedef struct {
+    ImageWriter *writer;
+    const esp_partition_t *source;      // Running partition
+    tinfl_decompressor *inflater;
+    uint8_t *window;                    // TINFL_LZ_DICT_SIZE circular output buffer of the inflater
+    size_t windowOffset;
+    bool inflated;                      // End of the zlib stream reached
+    OtaPatchDecoder decoder;
+} PatchState;
 
 // Global secure client instance
 WiFiClientSecure secureClient;
 
+// Internal Variables
+static uint8_t sectorBuffer[OTA_SECTOR_SIZE];
+static uint8_t netBuffer[OTA_NET_BUFFER_SIZE];
+
+// Internal Function Declarations
+static bool loadJob(OtaJob &job);
+static void saveProgress(const OtaJob &job);
+static void clearJob();
+static bool hashWritten(const esp_partition_t *partition, uint32_t length, mbedtls_sha256_context *sha);
+static OtaFetchResult downloadImage(OtaJob &job, const esp_partition_t *partition, uint8_t digest[32]);
+static bool isPatchUsable(const OtaJob &job);
+static OtaFetchResult applyPatch(const OtaJob &job, const esp_partition_t *partition, uint8_t digest[32]);
+static bool consumePatch(const uint8_t *data, size_t length, void *context);
+static bool readRunningImage(uint32_t offset, uint8_t *out, size_t length, void *context);
+static bool writePatchedImage(const uint8_t *data, size_t length, void *context);
+static bool writeImage(const uint8_t *data, size_t length, void *context);
+static bool flushImage(ImageWriter *writer);
+static OtaFetchResult fetchWithRetries(const char *url, uint32_t &position, uint32_t end, OtaSink sink, void *context);
+static OtaFetchResult fetchRange(const char *url, uint32_t &position, uint32_t end, OtaSink sink, void *context);
+static bool waitForWiFi();
+static bool verifyImage(const OtaJob &job, const uint8_t digest[32]);
+static bool parseHex(const char *hex, uint8_t *out, size_t length);
+static void toHex(const uint8_t *data, size_t length, char *hex);
+
 void initializeOTAManager() {
-    // secureClient.setCACert(AWS_CERT_CA);
+    // Images are authenticated by their signature; TLS only protects the transfer
     secureClient.setInsecure();
+    OtaJob job;
+    if (loadJob(job)) {
+        Log::info("Interrupted OTA update at %u/%u bytes; resuming after connecting.",
+                  (unsigned)job.offset, (unsigned)job.size);
+    }
     Log::info("OTA Manager initialized successfully.");
 }
 
+bool storeOTAManifest(const char *payload, unsigned int length) {
+    StaticJsonDocument<768> doc;
+    DeserializationError err = deserializeJson(doc, payload, length);
+    if (err) {
+        Log::error("Failed to parse OTA JSON: %s", err.c_str());
+        return false;
+    }
+    const char *url = doc["firmwareUrl"] | "";
+    const char *sha256 = doc["sha256"] | "";
+    const char *signature = doc["signature"] | "";
+    uint32_t size = doc["size"] | 0;
+    uint8_t digest[32];
+    if (strlen(url) == 0 || strlen(url) >= OTA_MAX_URL_LENGTH) {
+        Log::error("No valid firmwareUrl in OTA message.");
+        return false;
+    }
+    if (size == 0 || !parseHex(sha256, digest, sizeof(digest)) ||
+        strlen(signature) == 0 || strlen(signature) >= OTA_MAX_SIGNATURE_LENGTH) {
+        Log::error("OTA message without size, sha256 and signature; unsigned images are refused.");
+        return false;
+    }
+
+    // Optional delta patch; an unusable one only means the full image is downloaded
+    const char *patchUrl = doc["patch"]["url"] | "";
+    const char *patchSource = doc["patch"]["source"] | "";
+    uint32_t patchSize = doc["patch"]["size"] | 0;
+    bool hasPatch = strlen(patchUrl) > 0;
+    if (hasPatch && (strlen(patchUrl) >= OTA_MAX_URL_LENGTH || patchSize == 0 ||
+                     !parseHex(patchSource, digest, sizeof(digest)))) {
+        Log::warn("OTA patch needs url, size and source; using the full image.");
+        hasPatch = false;
+    }
+
+    // The same image again (e.g. the cloud re-sent the command) continues where it stopped
+    OtaJob current;
+    bool sameImage = loadJob(current) && strcasecmp(current.sha256, sha256) == 0 && current.size == size;
+
+    Preferences preferences;
+    preferences.begin("ota", false);
+    preferences.putString("url", url); // A new URL for the same image is fine (e.g. re-signed link)
+    if (!sameImage) {
+        preferences.putUInt("size", size);
+        preferences.putString("sha256", sha256);
+        preferences.putString("sig", signature);
+        preferences.putUInt("offset", 0);
+        preferences.putUChar("stalls", 0);
+        preferences.remove("part");
+        preferences.remove("nodelta");
+    }
+    preferences.putString("purl", hasPatch ? patchUrl : "");
+    preferences.putUInt("psize", hasPatch ? patchSize : 0);
+    preferences.putString("psrc", hasPatch ? patchSource : "");
+    preferences.end();
+    Log::info("OTA manifest stored: %u bytes from %s (%s%s).", (unsigned)size, url,
+              sameImage ? "resuming" : "new image", hasPatch ? ", delta patch" : "");
+    return true;
+}
+
+bool isOTAPending() {
+    OtaJob job;
+    return loadJob(job);
+}
+
+bool getRunningImageSha256(char *hex) {
+    uint8_t digest[32];
+    if (esp_partition_get_sha256(esp_ota_get_running_partition(), digest) != ESP_OK) {
+        return false;
+    }
+    toHex(digest, sizeof(digest), hex);
+    return true;
+}
+
 void otaTask(void *pvParameters) {
     triggerOTAUpdate();
 
     if (getSystemState() == SYSTEM_STATE_ERROR) {
-        Log::error("OTA update failed critically. Restarting device...");
+        Log::error("OTA update interrupted. Restarting device; the download resumes after reconnecting...");
         vTaskDelay(pdMS_TO_TICKS(1000));  // Allow log messages to be sent.
+        flushConfig();
         ESP.restart();
     }
 
-    // If no update was available (non-critical case), simply log and clean up.
-    Log::info("OTA update task completed (no update available). Returning to normal operation.");
+    // The image was rejected or dropped (non-critical case): the running firmware stays.
+    Log::info("OTA update task completed without an update. Returning to normal operation.");
     setSystemState(SYSTEM_STATE_CONNECTED_MQTT);
     setOtaTaskHandle(NULL);
     vTaskDelete(NULL);  // Cleanly delete this task.
 }
 
 void triggerOTAUpdate() {
-    Preferences preferences;
-    preferences.begin("ota", true); 
-    String firmwareUrl = preferences.getString("url", "");
-    preferences.end();
-    if (firmwareUrl.length() == 0) {
-        Log::error("No firmware URL found in EEPROM.");
-        setSystemState(SYSTEM_STATE_ERROR);
+    OtaJob job;
+    if (!loadJob(job)) {
+        Log::error("No OTA manifest stored.");
+        setSystemState(SYSTEM_STATE_CONNECTED_MQTT);
+        return;
+    }
+
+    const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+    if (partition == NULL || job.size > partition->size) {
+        Log::error("OTA image of %u bytes does not fit the update partition.", (unsigned)job.size);
+        clearJob();
+        setSystemState(SYSTEM_STATE_CONNECTED_MQTT);
         return;
     }
-    Log::info("Retrieved firmwareUrl length: %d", firmwareUrl.length());
-    Log::info("Starting OTA update from URL: %s", firmwareUrl.c_str());
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    t_httpUpdate_return ret = httpUpdate.update(secureClient, firmwareUrl);
-    switch(ret) {
-        case HTTP_UPDATE_FAILED:
-            Log::error("OTA update failed. Error (%d): %s", 
-                       httpUpdate.getLastError(),
-                       httpUpdate.getLastErrorString().c_str());
+    if (strcmp(job.partition, partition->label) != 0) {
+        job.offset = 0; // Booted from the other slot since, or first session
+        strncpy(job.partition, partition->label, sizeof(job.partition) - 1);
+        job.partition[sizeof(job.partition) - 1] = '\0';
+    }
+    if (job.stalledSessions >= OTA_MAX_STALLED_SESSIONS) {
+        Log::error("OTA update made no progress in %u sessions; dropped.", job.stalledSessions);
+        clearJob();
+        setSystemState(SYSTEM_STATE_CONNECTED_MQTT);
+        return;
+    }
+    job.stalledSessions++;
+    saveProgress(job);
+
+    flushConfig(); // The update reboots on success; commit pending settings first
+
+    uint8_t digest[32];
+    bool imageReady = false;
+    if (job.offset == 0 && isPatchUsable(job)) {
+        Log::info("Starting delta OTA update from URL: %s (%u byte patch)", job.patchUrl, (unsigned)job.patchSize);
+        OtaFetchResult result = applyPatch(job, partition, digest);
+        if (result == OTA_FETCH_NETWORK && job.stalledSessions < OTA_DELTA_ATTEMPTS) {
+            Log::error("Delta OTA download interrupted.");
             setSystemState(SYSTEM_STATE_ERROR);
-            break;
+            return;
+        }
+        imageReady = (result == OTA_FETCH_OK) && verifyImage(job, digest);
+        if (!imageReady) {
+            Log::warn("Delta OTA update failed; falling back to the full image.");
+            job.deltaFailed = true;
+            saveProgress(job);
+        }
+    }
 
-        case HTTP_UPDATE_NO_UPDATES:
-            Log::info("OTA update: No updates available.");
+    if (!imageReady) {
+        OtaFetchResult result = downloadImage(job, partition, digest);
+        if (result == OTA_FETCH_NETWORK) {
+            setSystemState(SYSTEM_STATE_ERROR);
+            return;
+        }
+        if (result == OTA_FETCH_REJECTED || !verifyImage(job, digest)) {
+            clearJob(); // Downloading the same bytes again would fail the same way
             setSystemState(SYSTEM_STATE_CONNECTED_MQTT);
-            break;
+            return;
+        }
+    }
+    esp_err_t err = esp_ota_set_boot_partition(partition); // Also validates the image headers
+    if (err != ESP_OK) {
+        Log::error("Failed to switch boot partition: %s", esp_err_to_name(err));
+        clearJob();
+        setSystemState(SYSTEM_STATE_CONNECTED_MQTT);
+        return;
+    }
 
-        case HTTP_UPDATE_OK:
-            Log::info("OTA update successful but device did not reboot automatically. Restarting manually...");
-            ESP.restart();
-            break;
+    clearJob();
+    Log::info("OTA update verified and installed. Restarting...");
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    ESP.restart();
+}
 
-        default:
-            Log::error("OTA update returned unknown status: %d", ret);
-            setSystemState(SYSTEM_STATE_ERROR);
+/** @brief Loads the stored manifest and progress; false if there is none. */
+static bool loadJob(OtaJob &job) {
+    Preferences preferences;
+    preferences.begin("ota", true);
+    preferences.getString("url", job.url, sizeof(job.url));
+    job.size = preferences.getUInt("size", 0);
+    job.sha256[0] = '\0';
+    job.signature[0] = '\0';
+    job.partition[0] = '\0';
+    preferences.getString("sha256", job.sha256, sizeof(job.sha256));
+    preferences.getString("sig", job.signature, sizeof(job.signature));
+    preferences.getString("part", job.partition, sizeof(job.partition));
+    job.offset = preferences.getUInt("offset", 0);
+    job.stalledSessions = preferences.getUChar("stalls", 0);
+    job.patchUrl[0] = '\0';
+    job.patchSource[0] = '\0';
+    preferences.getString("purl", job.patchUrl, sizeof(job.patchUrl));
+    preferences.getString("psrc", job.patchSource, sizeof(job.patchSource));
+    job.patchSize = preferences.getUInt("psize", 0);
+    job.deltaFailed = preferences.getBool("nodelta", false);
+    preferences.end();
+    return job.size > 0 && job.sha256[0] != '\0';
+}
+
+static void saveProgress(const OtaJob &job) {
+    Preferences preferences;
+    preferences.begin("ota", false);
+    preferences.putUInt("offset", job.offset);
+    preferences.putUChar("stalls", job.stalledSessions);
+    preferences.putString("part", job.partition);
+    preferences.putBool("nodelta", job.deltaFailed);
+    preferences.end();
+}
+
+static void clearJob() {
+    Preferences preferences;
+    preferences.begin("ota", false);
+    preferences.clear();
+    preferences.end();
+}
+
+/** @brief Feeds the bytes already in the partition to the hash (resume after a reboot). */
+static bool hashWritten(const esp_partition_t *partition, uint32_t length, mbedtls_sha256_context *sha) {
+    for (uint32_t position = 0; position < length; position += OTA_SECTOR_SIZE) {
+        uint32_t block = min((uint32_t)OTA_SECTOR_SIZE, length - position);
+        if (esp_partition_read(partition, position, sectorBuffer, block) != ESP_OK) {
+            Log::error("Failed to read back OTA partition; restarting the download.");
+            return false;
+        }
+        mbedtls_sha256_update_ret(sha, sectorBuffer, block);
+    }
+    return true;
+}
+
+/** @brief Downloads the full image in Range chunks, storing progress after each chunk. */
+static OtaFetchResult downloadImage(OtaJob &job, const esp_partition_t *partition, uint8_t digest[32]) {
+    Log::info("Starting OTA update from URL: %s (%u/%u bytes done)", job.url,
+              (unsigned)job.offset, (unsigned)job.size);
+
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    if (job.offset > 0 && !hashWritten(partition, job.offset, &sha)) {
+        job.offset = 0;
+        mbedtls_sha256_starts_ret(&sha, 0);
+    }
+
+    ImageWriter writer = {partition, job.offset, 0, &sha};
+    OtaFetchResult result = OTA_FETCH_OK;
+    while (job.offset < job.size && result == OTA_FETCH_OK) {
+        uint32_t end = min(job.offset + OTA_CHUNK_SIZE, job.size);
+        uint32_t position = job.offset;
+        result = fetchWithRetries(job.url, position, end, writeImage, &writer);
+        if (result == OTA_FETCH_OK && end == job.size && !flushImage(&writer)) {
+            result = OTA_FETCH_REJECTED;
+        }
+        if (result == OTA_FETCH_OK) {
+            job.offset = end; // Chunks end on sector boundaries: everything up to here is in flash
+            job.stalledSessions = 0;
+            saveProgress(job);
+            Log::info("OTA progress: %u/%u bytes", (unsigned)job.offset, (unsigned)job.size);
+        }
+    }
+    if (result == OTA_FETCH_NETWORK) {
+        Log::error("OTA download interrupted at %u/%u bytes.", (unsigned)job.offset, (unsigned)job.size);
+    }
+
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    return result;
+}
+
+/** @brief A patch is used when it was not rejected before and applies to the running image. */
+static bool isPatchUsable(const OtaJob &job) {
+    if (job.patchUrl[0] == '\0' || job.deltaFailed) {
+        return false;
+    }
+    char running[65];
+    if (!getRunningImageSha256(running) || strcasecmp(running, job.patchSource) != 0) {
+        Log::info("OTA patch is for another firmware (running %s); using the full image.", running);
+        return false;
+    }
+    return true;
+}
+
+/** @brief Downloads and applies the delta patch. The patch is not resumable: it starts over each session. */
+static OtaFetchResult applyPatch(const OtaJob &job, const esp_partition_t *partition, uint8_t digest[32]) {
+    // About 43 KB while the patch is applied: the inflater and its 32 KB window
+    PatchState patch = {};
+    patch.inflater = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    patch.window = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+    if (patch.inflater == NULL || patch.window == NULL) {
+        Log::error("Not enough memory for a delta update.");
+        free(patch.inflater);
+        free(patch.window);
+        return OTA_FETCH_REJECTED;
+    }
+    tinfl_init(patch.inflater);
+
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    ImageWriter writer = {partition, 0, 0, &sha};
+    patch.writer = &writer;
+    patch.source = esp_ota_get_running_partition();
+    otaPatchInit(patch.decoder, job.size, patch.source->size, readRunningImage, writePatchedImage, &patch);
+
+    OtaFetchResult result = OTA_FETCH_OK;
+    uint32_t position = 0;
+    while (position < job.patchSize && result == OTA_FETCH_OK) {
+        uint32_t end = min(position + OTA_CHUNK_SIZE, job.patchSize);
+        result = fetchWithRetries(job.patchUrl, position, end, consumePatch, &patch);
+    }
+    if (result == OTA_FETCH_OK && !(patch.inflated && otaPatchComplete(patch.decoder) && flushImage(&writer))) {
+        Log::error("Delta patch ended before the target image was complete.");
+        result = OTA_FETCH_REJECTED;
+    }
+
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    free(patch.inflater);
+    free(patch.window);
+    return result;
+}
+
+/** @brief Sink for patch bytes: inflates them and applies whatever came out. */
+static bool consumePatch(const uint8_t *data, size_t length, void *context) {
+    PatchState *patch = (PatchState*)context;
+    while (!patch->inflated) {
+        size_t inSize = length;
+        size_t outSize = TINFL_LZ_DICT_SIZE - patch->windowOffset;
+        tinfl_status status = tinfl_decompress(patch->inflater, data, &inSize, patch->window,
+                                               patch->window + patch->windowOffset, &outSize,
+                                               TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+        data += inSize;
+        length -= inSize;
+        if (outSize > 0 && !otaPatchDecode(patch->decoder, patch->window + patch->windowOffset, outSize)) {
+            Log::error("Delta patch rejected: %s.", patch->decoder.error);
+            return false;
+        }
+        patch->windowOffset = (patch->windowOffset + outSize) & (TINFL_LZ_DICT_SIZE - 1);
+
+        if (status < TINFL_STATUS_DONE) {
+            Log::error("Delta patch is not a valid zlib stream (%d).", (int)status);
+            return false;
+        }
+        if (status == TINFL_STATUS_DONE) {
+            patch->inflated = true;
+        } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && length == 0) {
             break;
+        }
+    }
+    return true;
+}
+
+/** @brief Source reader of the patch decoder: the running image. */
+static bool readRunningImage(uint32_t offset, uint8_t *out, size_t length, void *context) {
+    PatchState *patch = (PatchState*)context;
+    return esp_partition_read(patch->source, offset, out, length) == ESP_OK;
+}
+
+/** @brief Target writer of the patch decoder: the update partition. */
+static bool writePatchedImage(const uint8_t *data, size_t length, void *context) {
+    return writeImage(data, length, ((PatchState*)context)->writer);
+}
+
+/** @brief Sink for image bytes: buffers one sector, then erases, writes and hashes it. */
+static bool writeImage(const uint8_t *data, size_t length, void *context) {
+    ImageWriter *writer = (ImageWriter*)context;
+    while (length > 0) {
+        size_t take = min(length, (size_t)OTA_SECTOR_SIZE - writer->filled);
+        memcpy(sectorBuffer + writer->filled, data, take);
+        writer->filled += take;
+        data += take;
+        length -= take;
+        if (writer->filled == OTA_SECTOR_SIZE && !flushImage(writer)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** @brief Writes the buffered sector (a partial one only at the end of the image). */
+static bool flushImage(ImageWriter *writer) {
+    if (writer->filled == 0) {
+        return true;
+    }
+    if (esp_partition_erase_range(writer->partition, writer->position, OTA_SECTOR_SIZE) != ESP_OK ||
+        esp_partition_write(writer->partition, writer->position, sectorBuffer, writer->filled) != ESP_OK) {
+        Log::error("Failed to write OTA partition at %u.", (unsigned)writer->position);
+        return false;
+    }
+    mbedtls_sha256_update_ret(writer->sha, sectorBuffer, writer->filled);
+    writer->position += writer->filled;
+    writer->filled = 0;
+    return true;
+}
+
+/** @brief Fetches [position, end), continuing where a dropped attempt stopped. */
+static OtaFetchResult fetchWithRetries(const char *url, uint32_t &position, uint32_t end, OtaSink sink, void *context) {
+    OtaFetchResult result = OTA_FETCH_NETWORK;
+    for (uint8_t attempt = 0; attempt < OTA_CHUNK_RETRIES && result == OTA_FETCH_NETWORK; attempt++) {
+        if (attempt > 0) {
+            vTaskDelay(pdMS_TO_TICKS(1000 << attempt));
+        }
+        if (waitForWiFi()) {
+            result = fetchRange(url, position, end, sink, context);
+        }
+    }
+    return result;
+}
+
+/** @brief One Range request for [position, end); position advances by the bytes the sink accepted. */
+static OtaFetchResult fetchRange(const char *url, uint32_t &position, uint32_t end, OtaSink sink, void *context) {
+    HTTPClient http;
+    if (!http.begin(secureClient, url)) {
+        return OTA_FETCH_NETWORK;
+    }
+    char range[40];
+    snprintf(range, sizeof(range), "bytes=%u-%u", (unsigned)position, (unsigned)(end - 1));
+    http.addHeader("Range", range);
+    http.setTimeout(OTA_READ_TIMEOUT_MS);
+
+    int code = http.GET();
+    if (code != HTTP_CODE_PARTIAL_CONTENT && code != HTTP_CODE_OK) {
+        Log::error("OTA chunk request failed: HTTP %d", code);
+        http.end();
+        return OTA_FETCH_NETWORK;
+    }
+
+    WiFiClient *stream = http.getStreamPtr();
+    uint32_t lastData = millis();
+    // A server without Range support answers 200 with the whole file: skip what is already done
+    uint32_t skip = (code == HTTP_CODE_OK) ? position : 0;
+    while (position < end) {
+        size_t available = stream->available();
+        if (available == 0) {
+            if (!http.connected() || millis() - lastData > OTA_READ_TIMEOUT_MS) {
+                Log::error("OTA chunk stalled at %u bytes.", (unsigned)position);
+                http.end();
+                return OTA_FETCH_NETWORK;
+            }
+            vTaskDelay(pdMS_TO_TICKS(5));
+            continue;
+        }
+        uint32_t wanted = (skip > 0) ? skip : end - position;
+        size_t received = stream->readBytes(netBuffer, min(available, (size_t)min(wanted, (uint32_t)sizeof(netBuffer))));
+        lastData = millis();
+        if (skip > 0) {
+            skip -= received;
+            continue;
+        }
+        if (!sink(netBuffer, received, context)) {
+            http.end();
+            return OTA_FETCH_REJECTED;
+        }
+        position += received;
+    }
+    http.end();
+    return OTA_FETCH_OK;
+}
+
+/** @brief Blocks until the WiFi task has reconnected (it keeps running during the update). */
+static bool waitForWiFi() {
+    uint32_t start = millis();
+    while (!isWiFiConnected()) {
+        if (millis() - start > OTA_WIFI_WAIT_MS) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(500));
     }
-}
\ No newline at end of file
+    return true;
+}
+
+/** @brief Checks the image hash against the manifest and the manifest signature against the key. */
+static bool verifyImage(const OtaJob &job, const uint8_t digest[32]) {
+    uint8_t expected[32];
+    if (!parseHex(job.sha256, expected, sizeof(expected)) || memcmp(expected, digest, sizeof(expected)) != 0) {
+        Log::error("OTA image SHA-256 mismatch; image rejected.");
+        return false;
+    }
+
+    uint8_t signature[OTA_MAX_SIGNATURE_LENGTH / 4 * 3]; // Anything the manifest check let through
+    size_t signatureLength = 0;
+    if (mbedtls_base64_decode(signature, sizeof(signature), &signatureLength,
+                              (const uint8_t*)job.signature, strlen(job.signature)) != 0) {
+        Log::error("OTA signature is not valid base64; image rejected.");
+        return false;
+    }
+
+    mbedtls_pk_context key;
+    mbedtls_pk_init(&key);
+    int ret = mbedtls_pk_parse_public_key(&key, (const uint8_t*)OTA_SIGNING_PUBLIC_KEY,
+                                          sizeof(OTA_SIGNING_PUBLIC_KEY));
+    if (ret == 0) {
+        ret = mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, digest, 32, signature, signatureLength);
+        if (ret != 0) {
+            Log::error("OTA signature verification failed (-0x%04x); image rejected.", -ret);
+        }
+    } else {
+        Log::error("OTA signing key not configured (-0x%04x); image rejected.", -ret);
+    }
+    mbedtls_pk_free(&key);
+    return ret == 0;
+}
+
+static bool parseHex(const char *hex, uint8_t *out, size_t length) {
+    if (strlen(hex) != length * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < length * 2; i++) {
+        char c = hex[i];
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else return false;
+        out[i / 2] = (i % 2 == 0) ? (nibble << 4) : (out[i / 2] | nibble);
+    }
+    return true;
+}
+
+static void toHex(const uint8_t *data, size_t length, char *hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < length; i++) {
+        hex[2 * i] = digits[data[i] >> 4];
+        hex[2 * i + 1] = digits[data[i] & 0x0F];
+    }
+    hex[2 * length] = '\0';
+}
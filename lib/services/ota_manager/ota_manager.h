@@ -3,30 +3,69 @@
 #ifndef OTA_MANAGER_H
 #define OTA_MANAGER_H
 
+// OTA manifest (MQTT ota command):
+//   {"firmwareUrl":"https://...","size":1048576,"sha256":"<64 hex>","signature":"<base64>"}
+// signature is the DER ECDSA signature (P-256 or P-384; RSA signatures do not fit) of the image
+// SHA-256 with the key matching OTA_SIGNING_PUBLIC_KEY (secrets.h), i.e. the output of
+//   openssl dgst -sha256 -sign ota_key.pem firmware.bin | base64 -w0
+// The image is fetched in HTTP Range chunks; progress survives reboots and WiFi drops.
+//
+// Delta updates: the manifest may add
+//   "patch":{"url":"https://...","size":N,"source":"<64 hex>"}
+// source is the SHA-256 of the image the patch was made against, as reported by
+// getRunningImageSha256() (the hash esptool appends to the image). The patch file is a zlib stream of
+// the format in ota_patch.h, a bsdiff-like interleaving of control records, diff and literal bytes;
+//   tools/ota_delta.py old.bin new.bin new.patch
+// makes one and prints these manifest fields. The result must match size, sha256 and signature like
+// a full image. A patch for another source, or one that fails, falls back to firmwareUrl.
+
 /**
  * @brief Initializes the OTA Manager.
  *
- * This function sets up the secure client for HTTPS OTA updates using certificate
- * fingerprint verification.
+ * Sets up the HTTPS client and reports an interrupted download that will be resumed.
  */
 void initializeOTAManager();
 
+/**
+ * @brief Validates and stores an OTA manifest.
+ * A manifest for the image already being downloaded keeps its progress; any other starts over.
+ * @param payload Manifest JSON
+ * @param length Payload length
+ * @return true if stored (the caller starts the update), false if rejected
+ */
+bool storeOTAManifest(const char *payload, unsigned int length);
+
+/**
+ * @brief Whether a stored manifest has not been installed yet (interrupted download).
+ */
+bool isOTAPending();
+
+/**
+ * @brief SHA-256 of the running firmware image, the source a delta patch must be made against.
+ * @param hex Receives 64 lowercase hex characters and a terminator
+ * @return true on success, false if the partition could not be hashed
+ */
+bool getRunningImageSha256(char *hex);
+
 /**
  * @brief FreeRTOS task for OTA update process.
  * @param pvParameters Task parameters (not used)
- * 
+ *
  * This task triggers the OTA update and handles the result.
  * On success, device reboots automatically.
- * On failure or no update available, returns to CONNECTED_MQTT state.
+ * On an interrupted download the device restarts and resumes after reconnecting;
+ * on a rejected image it returns to CONNECTED_MQTT state.
  */
 void otaTask(void *pvParameters);
 
 /**
  * @brief Triggers the OTA update process.
  *
- * This function performs an HTTPS-based OTA update using the HTTPUpdate library.
- * It handles errors robustly and logs the outcome. On success, the device will reboot.
+ * Applies the delta patch when it fits the running image, otherwise downloads the full image in
+ * Range chunks into the inactive OTA partition, hashing it on the way, verifies the SHA-256 and
+ * the signature and switches the boot partition.
+ * Sets SYSTEM_STATE_ERROR when the download was interrupted (progress is kept for the resume).
  */
 void triggerOTAUpdate();
 
-#endif
\ No newline at end of file
+#endif
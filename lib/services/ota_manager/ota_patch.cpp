@@ -0,0 +1,138 @@
+// ota_patch.cpp
+// OTA Patch Module
+// Purpose: Apply an inflated delta patch as a stream, from a source image to a target writer
+// Architecture: Small state machine over the header, control records and their add/copy runs; input may
+//               be split anywhere (record fields are assembled across calls). Every length and source
+//               read is bounds-checked before it is used, so a corrupt patch fails instead of writing
+//               past the target or reading past the source.
+// Thread-Safety: Reentrant (state lives in the caller's decoder)
+// Dependencies: None
+
+#include "ota_patch.h"
+
+// System headers
+#include <string.h>
+
+// Internal Function Declarations
+static bool decodeField(OtaPatchDecoder &decoder);
+static void advance(OtaPatchDecoder &decoder);
+static uint32_t readLe32(const uint8_t *data);
+
+void otaPatchInit(OtaPatchDecoder &decoder, uint32_t targetSize, uint32_t sourceSize,
+                  OtaPatchSourceReader readSource, OtaPatchTargetWriter writeTarget, void *context) {
+    memset(&decoder, 0, sizeof(decoder));
+    decoder.readSource = readSource;
+    decoder.writeTarget = writeTarget;
+    decoder.context = context;
+    decoder.sourceSize = sourceSize;
+    decoder.targetSize = targetSize;
+    decoder.phase = OTA_PATCH_PHASE_HEADER;
+}
+
+bool otaPatchDecode(OtaPatchDecoder &decoder, const uint8_t *data, size_t length) {
+    if (decoder.error != NULL) {
+        return false;
+    }
+    while (length > 0) {
+        size_t take;
+        switch (decoder.phase) {
+            case OTA_PATCH_PHASE_HEADER:
+            case OTA_PATCH_PHASE_CONTROL: {
+                size_t fieldSize = (decoder.phase == OTA_PATCH_PHASE_HEADER) ? OTA_PATCH_HEADER_SIZE
+                                                                             : OTA_PATCH_RECORD_SIZE;
+                take = (length < fieldSize - decoder.fieldLength) ? length : fieldSize - decoder.fieldLength;
+                memcpy(decoder.field + decoder.fieldLength, data, take);
+                decoder.fieldLength += take;
+                if (decoder.fieldLength == fieldSize && !decodeField(decoder)) {
+                    return false;
+                }
+                break;
+            }
+
+            case OTA_PATCH_PHASE_ADD: {
+                // Target byte = source byte + patch byte (mod 256)
+                uint32_t run = (decoder.addRemaining < OTA_PATCH_SOURCE_CHUNK) ? decoder.addRemaining
+                                                                               : OTA_PATCH_SOURCE_CHUNK;
+                take = (length < run) ? length : run;
+                if (decoder.sourcePosition < 0 || decoder.sourcePosition + (int64_t)take > decoder.sourceSize) {
+                    decoder.error = "patch reads outside the source image";
+                    return false;
+                }
+                if (!decoder.readSource((uint32_t)decoder.sourcePosition, decoder.sourceBuffer, take, decoder.context)) {
+                    decoder.error = "source read failed";
+                    return false;
+                }
+                for (size_t i = 0; i < take; i++) {
+                    decoder.sourceBuffer[i] += data[i];
+                }
+                if (!decoder.writeTarget(decoder.sourceBuffer, take, decoder.context)) {
+                    decoder.error = "target write failed";
+                    return false;
+                }
+                decoder.sourcePosition += take;
+                decoder.addRemaining -= take;
+                decoder.written += take;
+                break;
+            }
+
+            case OTA_PATCH_PHASE_COPY:
+                take = (length < decoder.copyRemaining) ? length : decoder.copyRemaining;
+                if (!decoder.writeTarget(data, take, decoder.context)) {
+                    decoder.error = "target write failed";
+                    return false;
+                }
+                decoder.copyRemaining -= take;
+                decoder.written += take;
+                break;
+
+            default:
+                decoder.error = "data past the end of the target image";
+                return false;
+        }
+        data += take;
+        length -= take;
+        advance(decoder);
+    }
+    return true;
+}
+
+bool otaPatchComplete(const OtaPatchDecoder &decoder) {
+    return decoder.error == NULL && decoder.phase == OTA_PATCH_PHASE_DONE;
+}
+
+/** @brief Interprets a completed header or control record. */
+static bool decodeField(OtaPatchDecoder &decoder) {
+    decoder.fieldLength = 0;
+    if (decoder.phase == OTA_PATCH_PHASE_HEADER) {
+        if (memcmp(decoder.field, OTA_PATCH_MAGIC, 4) != 0 || readLe32(decoder.field + 4) != decoder.targetSize) {
+            decoder.error = "header does not match the manifest";
+            return false;
+        }
+        decoder.phase = (decoder.targetSize == 0) ? OTA_PATCH_PHASE_DONE : OTA_PATCH_PHASE_CONTROL;
+        return true;
+    }
+    decoder.addRemaining = readLe32(decoder.field);
+    decoder.copyRemaining = readLe32(decoder.field + 4);
+    decoder.seek = (int32_t)readLe32(decoder.field + 8);
+    if ((uint64_t)decoder.written + decoder.addRemaining + decoder.copyRemaining > decoder.targetSize) {
+        decoder.error = "record runs past the target image";
+        return false;
+    }
+    decoder.phase = OTA_PATCH_PHASE_ADD;
+    return true;
+}
+
+/** @brief Moves past finished add/copy runs (records may have empty ones). */
+static void advance(OtaPatchDecoder &decoder) {
+    if (decoder.phase == OTA_PATCH_PHASE_ADD && decoder.addRemaining == 0) {
+        decoder.phase = OTA_PATCH_PHASE_COPY;
+    }
+    if (decoder.phase == OTA_PATCH_PHASE_COPY && decoder.copyRemaining == 0) {
+        decoder.sourcePosition += decoder.seek;
+        decoder.phase = (decoder.written == decoder.targetSize) ? OTA_PATCH_PHASE_DONE : OTA_PATCH_PHASE_CONTROL;
+    }
+}
+
+static uint32_t readLe32(const uint8_t *data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
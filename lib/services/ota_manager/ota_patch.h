@@ -0,0 +1,82 @@
+// ota_patch.h
+#ifndef OTA_PATCH_H
+#define OTA_PATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// OTA Patch Module
+// Purpose:
+// Streaming decoder of the delta patch format (see ota_manager.h), after inflation. Free of Arduino
+// and ESP-IDF so the host tests check it against patches made by tools/ota_delta.py.
+//
+//   "MDLT" <target size:u32>
+//   records: <add:u32> <copy:u32> <seek:i32> <add bytes> <copy bytes>     (little-endian)
+// Each add byte is added (mod 256) to the source byte at the source position, which then advances;
+// copy bytes are literal; after the copy bytes the source position moves by seek.
+
+#define OTA_PATCH_MAGIC "MDLT"
+#define OTA_PATCH_HEADER_SIZE 8         // Magic, target size
+#define OTA_PATCH_RECORD_SIZE 12        // Add length, copy length, seek
+#define OTA_PATCH_SOURCE_CHUNK 256      // Source bytes read per add step
+
+/**
+ * @brief Reads length source bytes at offset; returns false on a read error.
+ */
+typedef bool (*OtaPatchSourceReader)(uint32_t offset, uint8_t *out, size_t length, void *context);
+
+/**
+ * @brief Consumes target bytes in order; returns false to abort the patch.
+ */
+typedef bool (*OtaPatchTargetWriter)(const uint8_t *data, size_t length, void *context);
+
+typedef enum {
+    OTA_PATCH_PHASE_HEADER,
+    OTA_PATCH_PHASE_CONTROL,
+    OTA_PATCH_PHASE_ADD,
+    OTA_PATCH_PHASE_COPY,
+    OTA_PATCH_PHASE_DONE
+} OtaPatchPhase;
+
+/**
+ * @brief Decoder state; fields are private to ota_patch.cpp.
+ */
+typedef struct {
+    OtaPatchSourceReader readSource;
+    OtaPatchTargetWriter writeTarget;
+    void *context;
+    uint32_t sourceSize;
+    uint32_t targetSize;
+    OtaPatchPhase phase;
+    uint8_t field[OTA_PATCH_RECORD_SIZE]; // Header or control record being assembled
+    size_t fieldLength;
+    uint32_t written;                   // Target bytes produced
+    uint32_t addRemaining;
+    uint32_t copyRemaining;
+    int32_t seek;
+    int64_t sourcePosition;
+    uint8_t sourceBuffer[OTA_PATCH_SOURCE_CHUNK];
+    const char *error;                  // Why decoding stopped, or NULL
+} OtaPatchDecoder;
+
+/**
+ * @brief Prepares a decoder for one patch.
+ * @param targetSize Expected size of the patched image (from the manifest)
+ * @param sourceSize Readable size of the source (patches never read past it)
+ * @param context Passed to readSource and writeTarget
+ */
+void otaPatchInit(OtaPatchDecoder &decoder, uint32_t targetSize, uint32_t sourceSize,
+                  OtaPatchSourceReader readSource, OtaPatchTargetWriter writeTarget, void *context);
+
+/**
+ * @brief Applies the next inflated patch bytes; may be called with any split of the stream.
+ * @return true to continue, false if the patch is invalid or a callback failed (see decoder.error)
+ */
+bool otaPatchDecode(OtaPatchDecoder &decoder, const uint8_t *data, size_t length);
+
+/**
+ * @brief Checks that the whole target image was produced.
+ */
+bool otaPatchComplete(const OtaPatchDecoder &decoder);
+
+#endif // OTA_PATCH_H
@@ -0,0 +1,158 @@
+// power_manager.cpp
+// Power Manager Module
+// Purpose: Applies power profiles (modem sleep, DFS, automatic light sleep) and measures sleep behavior
+// Architecture: Profiles are a constant table; the stored profile comes from eeprom_config. Light
+//               sleep needs a build with power management and tickless idle: when esp_pm_configure()
+//               refuses it, the profile falls back to frequency scaling only. Wakes are counted by a
+//               FreeRTOS idle hook; idle time comes from the FreeRTOS run-time stats when available.
+// Thread-Safety: Profile index is a single byte; counters are 32-bit and reset by the reader
+// Dependencies: esp_pm, esp_wifi, WiFi library, eeprom_config
+
+#include "power_manager.h"
+
+// Project headers (alphabetically)
+#include "eeprom_config.h"
+
+// Third-party libraries
+#include <Arduino.h>
+#include <Log.h>
+#include <WiFi.h>
+
+// System headers
+#include <esp_freertos_hooks.h>
+#include <esp_pm.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const PowerProfileInfo PROFILES[POWER_PROFILE_COUNT] = {
+    // name           modem sleep        max  min  light  idle  keepalive
+    {"standard",      WIFI_PS_MIN_MODEM, 160, 160, false, 100,  15},
+    {"performance",   WIFI_PS_NONE,      160, 160, false, 100,  15},
+    {"balanced",      WIFI_PS_MIN_MODEM, 160, 80,  true,  250,  60},
+    {"low-power",     WIFI_PS_MAX_MODEM, 80,  40,  true,  1000, 120},
+};
+
+// Internal Variables
+static volatile uint8_t currentProfile = POWER_PROFILE_STANDARD;
+static volatile bool benchmarkEnabled = false;
+static volatile uint32_t idleWakes = 0;
+static uint32_t windowStartMs = 0;
+#if configGENERATE_RUN_TIME_STATS
+static uint32_t windowStartIdle = 0;
+#endif
+
+// Internal Function Declarations
+static bool applyProfile(PowerProfile profile);
+static bool countIdleWake();
+
+bool initializePowerManager() {
+    DeviceConfig config;
+    PowerProfile profile = POWER_PROFILE_STANDARD;
+    if (loadConfig(config) && config.powerProfile < POWER_PROFILE_COUNT) {
+        profile = (PowerProfile)config.powerProfile;
+    }
+    // The hook runs on every idle loop iteration, i.e. once per return to sleep
+    if (esp_register_freertos_idle_hook(countIdleWake) != ESP_OK) {
+        Log::warn("Could not register power idle hook; wake counts unavailable.");
+    }
+    return applyProfile(profile);
+}
+
+bool setPowerProfile(PowerProfile profile) {
+    if (profile >= POWER_PROFILE_COUNT) {
+        return false;
+    }
+    if (profile == currentProfile) {
+        return true;
+    }
+    return applyProfile(profile);
+}
+
+PowerProfile getPowerProfile() {
+    return (PowerProfile)currentProfile;
+}
+
+const PowerProfileInfo &getPowerProfileInfo() {
+    return PROFILES[currentProfile];
+}
+
+bool parsePowerProfile(const char *name, PowerProfile &profile) {
+    if (name == NULL) {
+        return false;
+    }
+    for (int p = 0; p < POWER_PROFILE_COUNT; p++) {
+        if (strcmp(name, PROFILES[p].name) == 0) {
+            profile = (PowerProfile)p;
+            return true;
+        }
+    }
+    return false;
+}
+
+void setPowerBenchmark(bool enabled) {
+    if (enabled && !benchmarkEnabled) {
+        PowerStats discard;
+        takePowerStats(discard); // Start a clean window
+    }
+    benchmarkEnabled = enabled;
+    Log::info("Power benchmark %s.", enabled ? "started" : "stopped");
+}
+
+bool isPowerBenchmarkEnabled() {
+    return benchmarkEnabled;
+}
+
+void takePowerStats(PowerStats &stats) {
+    uint32_t now = millis();
+    stats.windowMs = now - windowStartMs;
+    stats.wakes = idleWakes;
+    idleWakes = 0;
+    windowStartMs = now;
+#if configGENERATE_RUN_TIME_STATS
+    // The run-time counter of ESP-IDF counts microseconds
+    uint32_t idle = ulTaskGetIdleRunTimeCounter();
+    stats.idleMs = (int32_t)((idle - windowStartIdle) / 1000);
+    windowStartIdle = idle;
+#else
+    stats.idleMs = -1;
+#endif
+}
+
+/** @brief Configures the radio and the CPU for a profile. */
+static bool applyProfile(PowerProfile profile) {
+    const PowerProfileInfo &info = PROFILES[profile];
+
+    // Through the WiFi library so the mode is re-applied after WiFi.mode() changes
+    if (!WiFi.setSleep((wifi_ps_type_t)info.modemSleep)) {
+        Log::warn("Failed to set WiFi modem sleep.");
+    }
+
+    esp_pm_config_esp32c3_t pm;
+    pm.max_freq_mhz = info.maxFreqMhz;
+    pm.min_freq_mhz = info.minFreqMhz;
+    pm.light_sleep_enable = info.lightSleep;
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err != ESP_OK && info.lightSleep) {
+        // Light sleep needs tickless idle in the build; keep at least the frequency scaling
+        Log::warn("Light sleep unavailable (%s); using frequency scaling only.", esp_err_to_name(err));
+        pm.light_sleep_enable = false;
+        err = esp_pm_configure(&pm);
+    }
+    if (err == ESP_ERR_NOT_SUPPORTED) {
+        Log::warn("Power management not enabled in this build; only modem sleep applies.");
+    } else if (err != ESP_OK) {
+        Log::error("Failed to configure power management: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    currentProfile = profile;
+    Log::info("Power profile '%s' applied.", info.name);
+    return true;
+}
+
+/** @brief Idle hook: returning true lets the idle task wait for an interrupt (or light sleep). */
+static bool countIdleWake() {
+    idleWakes++;
+    return true;
+}
@@ -0,0 +1,96 @@
+// power_manager.h
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+
+// Power Manager Module
+// Purpose:
+// Power profiles trading inbound command latency (relay ON/OFF over MQTT) against current draw:
+// WiFi modem sleep, CPU frequency scaling, automatic light sleep when every task is blocked,
+// the idle wait of polling tasks and the MQTT keepalive. A benchmark mode reports wake counts
+// and time asleep for bench current measurements.
+//
+// Inbound latency is roughly idleWaitMs plus the beacon wake period of the modem sleep mode:
+// one DTIM (MIN_MODEM, typically 100-300 ms) or the listen interval (MAX_MODEM, 3 DTIMs by default).
+
+/**
+ * @brief Power profiles, stored in the config record (0 = current default behavior).
+ */
+typedef enum {
+    POWER_PROFILE_STANDARD = 0,     // Modem sleep (DTIM), fixed CPU clock, no light sleep
+    POWER_PROFILE_PERFORMANCE,      // Radio always on: lowest latency, highest draw
+    POWER_PROFILE_BALANCED,         // Modem sleep (DTIM), frequency scaling, light sleep
+    POWER_PROFILE_LOW_POWER,        // Modem sleep (listen interval), low clocks, light sleep
+    POWER_PROFILE_COUNT
+} PowerProfile;
+
+/**
+ * @brief Settings applied by a profile.
+ */
+typedef struct {
+    const char *name;               // Name used in config documents
+    uint8_t modemSleep;             // wifi_ps_type_t
+    uint16_t maxFreqMhz;
+    uint16_t minFreqMhz;            // Equal to maxFreqMhz disables frequency scaling
+    bool lightSleep;
+    uint16_t idleWaitMs;            // Blocking timeout of polling task loops
+    uint16_t mqttKeepAliveSeconds;  // Applied at the next MQTT connection
+} PowerProfileInfo;
+
+/**
+ * @brief Wake/sleep counters of the current benchmark window.
+ */
+typedef struct {
+    uint32_t windowMs;              // Length of the window
+    uint32_t wakes;                 // Idle task entries, i.e. returns to sleep after some work
+    int32_t idleMs;                 // Time in the idle task (WFI/light sleep), -1 if not measurable
+} PowerStats;
+
+/**
+ * @brief Applies the stored profile. Must be called after the WiFi driver is started.
+ * @return true if the profile was applied (possibly without light sleep), false otherwise
+ */
+bool initializePowerManager();
+
+/**
+ * @brief Applies a profile at runtime (does not store it; the config record does).
+ * @return true if applied, false for an invalid profile
+ */
+bool setPowerProfile(PowerProfile profile);
+
+/**
+ * @brief Currently applied profile.
+ * @note Thread-safe: Single byte read
+ */
+PowerProfile getPowerProfile();
+
+/**
+ * @brief Settings of the current profile.
+ * @note Thread-safe: Points to constant data
+ */
+const PowerProfileInfo &getPowerProfileInfo();
+
+/**
+ * @brief Looks up a profile by name.
+ * @return true if found, false otherwise
+ */
+bool parsePowerProfile(const char *name, PowerProfile &profile);
+
+/**
+ * @brief Enables or disables the benchmark mode (status LED off, stats in the healthcheck).
+ * Starting it resets the counters.
+ */
+void setPowerBenchmark(bool enabled);
+
+/**
+ * @brief Whether the benchmark mode is on.
+ */
+bool isPowerBenchmarkEnabled();
+
+/**
+ * @brief Returns the counters since the last call (or the benchmark start) and starts a new window.
+ */
+void takePowerStats(PowerStats &stats);
+
+#endif // POWER_MANAGER_H
@@ -1,9 +1,17 @@
 // wifi_config_mode.cpp
 // WiFi Configuration Mode Module
 // Purpose: Provides AP mode with web interface for WiFi credential configuration
-// Architecture: AsyncWebServer with network scanning and credential saving to EEPROM
-// Thread-Safety: FreeRTOS task manages AP lifecycle, web server runs async
-// Dependencies: ESPAsyncWebServer, eeprom_config, system_state
+// Architecture: The AP comes up immediately in AP+STA mode; a DNS server answers every name with the
+//               AP address so phones open the portal on their own (unknown URLs redirect to /).
+//               Networks are found by periodic async scans whose results are kept in a small fixed
+//               table. The page is a PROGMEM template streamed in chunks with the options injected.
+//               Submitted credentials are tried on the station interface while the AP stays up; the
+//               browser polls /status for the outcome. Only credentials that connect are saved, then
+//               the AP is torn down and the system moves to CONNECTING without a restart.
+// Thread-Safety: FreeRTOS task manages AP lifecycle, DNS, scans and connection attempts; web handlers
+//                run in the async TCP task and share the scan table and the attempt with it under
+//                portalMutex
+// Dependencies: ESPAsyncWebServer, DNSServer, ArduinoJson, eeprom_config, wifi_connect, system_state
 
 #include "wifi_config_mode.h"
 
@@ -11,46 +19,177 @@
 #include "config.h"
 #include "eeprom_config.h"
 #include "system_state.h"
+#include "wifi_connect.h"
 
 // Third-party libraries
 #include <Arduino.h>
+#include <ArduinoJson.h>
+#include <DNSServer.h>
 #include <ESPAsyncWebServer.h>
 #include <Log.h>
 #include <WiFi.h>
 
 // System headers
 #include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <freertos/task.h>
+#include <string.h>
+
+#define CONFIG_DNS_PORT 53
+#define CONFIG_LOOP_INTERVAL_MS 20          // DNS polling period while the portal is up
+#define CONFIG_SCAN_INTERVAL_MS 30000       // Between async scans
+#define CONFIG_SCAN_MAX_NETWORKS 20         // Strongest unique SSIDs kept for the page
+#define CONFIG_CONNECT_TIMEOUT_MS 15000     // Association + DHCP with submitted credentials
+#define CONFIG_RESULT_FLUSH_MS 2000         // AP kept up after the browser fetched a success
+#define CONFIG_RESULT_HOLD_MS 15000         // AP kept up at most after a success
+
+/**
+ * @brief Progress of a credentials submission.
+ */
+typedef enum {
+    PROVISION_IDLE = 0,
+    PROVISION_PENDING,      // Submitted, waiting for the config task
+    PROVISION_CONNECTING,   // Association in progress
+    PROVISION_CONNECTED,    // Connected and saved; config mode ends shortly
+    PROVISION_FAILED        // Not saved; the form can be submitted again
+} ProvisionState;
+
+/**
+ * @brief One network offered in the portal's list.
+ */
+typedef struct {
+    char ssid[WIFI_SSID_LENGTH + 1];
+    int8_t rssi;
+    bool secured;
+} ScannedNetwork;
+
+// Page template, split where the network options are injected
+static const char CONFIG_PAGE_HEAD[] PROGMEM = R"rawliteral(<!DOCTYPE html>
+<html lang="en">
+<head>
+<meta charset="UTF-8">
+<meta name="viewport" content="width=device-width, initial-scale=1.0">
+<title>MICA Gateway WiFi Config</title>
+<style>
+body { font-family: Arial, sans-serif; text-align: center; margin: 40px; }
+h1 { color: #333; }
+form { display: flex; flex-direction: column; align-items: center; }
+label { font-size: 18px; margin: 10px 0; }
+select, input { width: 80%; max-width: 300px; padding: 10px; margin: 10px 0; font-size: 16px; }
+.button { width: 80%; max-width: 320px; padding: 15px; font-size: 18px; margin: 10px 0; border: none; cursor: pointer; border-radius: 8px; text-decoration: none; }
+.save-button { background-color: #28a745; color: white; }
+.refresh-button { background-color: #007bff; color: white; }
+</style>
+<script>
+function toggleSSIDInput() {
+  var manual = document.getElementById("ssid").value === "manual";
+  document.getElementById("ssid_manual").style.display = manual ? "block" : "none";
+}
+</script>
+</head>
+<body>
+<h1>WiFi Config Mode</h1>
+<form action="/save" method="POST">
+<label for="ssid">Select WiFi Network:</label>
+<select id="ssid" name="ssid" onchange="toggleSSIDInput()">
+<option value='manual'>Enter SSID manually</option>
+)rawliteral";
+
+static const char CONFIG_PAGE_TAIL[] PROGMEM = R"rawliteral(</select>
+<input type="text" id="ssid_manual" name="ssid_manual" placeholder="Enter SSID" style="display:none;">
+<label for="password">Enter WiFi Password:</label>
+<input type="password" id="password" name="password" placeholder="Enter WiFi Password">
+<button type="submit" class="button save-button">💾 Save Configuration</button>
+</form>
+<a href="/" class="button refresh-button">🔄 Refresh Networks</a>
+</body>
+</html>
+)rawliteral";
+
+// Shown after a submission; polls /status until the attempt has an outcome
+static const char CONFIG_RESULT_PAGE[] PROGMEM = R"rawliteral(<!DOCTYPE html>
+<html lang="en">
+<head>
+<meta charset="UTF-8">
+<meta name="viewport" content="width=device-width, initial-scale=1.0">
+<title>MICA Gateway WiFi Config</title>
+<style>
+body { font-family: Arial, sans-serif; text-align: center; margin: 40px; }
+h1 { color: #333; }
+</style>
+<script>
+function poll() {
+  fetch("/status").then(function (r) { return r.json(); }).then(function (s) {
+    var msg = document.getElementById("msg");
+    if (s.state === "connected") {
+      msg.textContent = "✅ Connected to " + s.ssid + " (IP " + s.ip + "). The device is leaving config mode.";
+    } else if (s.state === "failed") {
+      msg.textContent = "❌ Could not connect to " + s.ssid + ": " + s.error + ".";
+      document.getElementById("back").style.display = "block";
+    } else {
+      setTimeout(poll, 1000);
+    }
+  }).catch(function () { setTimeout(poll, 1000); }); // The AP may briefly drop while it changes channel
+}
+window.onload = poll;
+</script>
+</head>
+<body>
+<h1>WiFi Config Mode</h1>
+<p id="msg">Connecting...</p>
+<p id="back" style="display:none;"><a href="/">Try again</a></p>
+</body>
+</html>
+)rawliteral";
 
 AsyncWebServer server(80);
-String g_wifiOptions = ""; // Global variable to store detected SSIDs
+
+// Internal Variables
+static DNSServer dnsServer;
+static SemaphoreHandle_t portalMutex = NULL;
+static ScannedNetwork scannedNetworks[CONFIG_SCAN_MAX_NETWORKS];
+static int scannedCount = -1;               // -1 until the first scan completes
+static bool routesRegistered = false;
+static wifi_event_id_t provisionEventId = 0;
+
+// Current credentials submission (guarded by portalMutex)
+static volatile ProvisionState provisionState = PROVISION_IDLE;
+static char provisionSsid[WIFI_SSID_LENGTH + 1];
+static char provisionPassword[MAX_CRED_LENGTH + 1];
+static const char *provisionError = "";
+static unsigned long provisionTimeMs = 0;   // Start of the attempt, then time of the success
+static volatile bool provisionResultSeen = false;
+static volatile uint8_t provisionDisconnectReason = 0;
+
+// Internal Function Declarations
+static void registerRoutes();
+static void handleRoot(AsyncWebServerRequest *request);
+static void handleSave(AsyncWebServerRequest *request);
+static void handleStatus(AsyncWebServerRequest *request);
+static void handleCaptiveRedirect(AsyncWebServerRequest *request);
+static void collectScanResults();
+static bool serviceProvisioning();
+static void setProvisionState(ProvisionState state, const char *error);
+static const char *describeDisconnectReason(uint8_t reason);
+static void onProvisionWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
+static void printHtmlEscaped(Print &out, const char *text);
 
 // Initialize WiFi Config Mode
 void initializeWiFiConfigMode() {
     Log::info("Entering initializeWiFiConfigMode()...");
 
-    // 1️⃣ First, scan networks in STA mode before activating the AP
-    WiFi.mode(WIFI_STA);
-    WiFi.disconnect();
-    Log::info("Scanning available WiFi networks...");
-
-    int n = WiFi.scanNetworks();
-    if (n > 0) {
-        Log::info("Found %d networks.", n);
-        g_wifiOptions = "<option value='manual'>Enter SSID manually</option>";
-        for (int i = 0; i < n; ++i) {
-            g_wifiOptions += "<option value='" + WiFi.SSID(i) + "'>";
-            g_wifiOptions += WiFi.SSID(i);
-            g_wifiOptions += "</option>";
+    if (portalMutex == NULL) {
+        portalMutex = xSemaphoreCreateMutex();
+        if (portalMutex == NULL) {
+            Log::error("Failed to create config mode mutex.");
+            notifySystemState(EVENT_WIFI_CONFIG_FAILED);
+            return;
         }
-    } else {
-        Log::warn("No Wi-Fi networks found.");
-        g_wifiOptions = "<option value='manual'>Enter SSID manually</option>";
-        g_wifiOptions += "<option value=''>No networks found</option>";
     }
 
-    // 2️⃣ Second, start the AP
-    WiFi.mode(WIFI_AP);
+    // 1️⃣ Start the AP right away; the station interface stays up (idle) for scanning
+    WiFi.mode(WIFI_AP_STA);
+    WiFi.disconnect(false);
     if (WiFi.softAP(AP_SSID, AP_PASSWORD)) {
         Log::info("AP started: %s (IP: %s)", AP_SSID, WiFi.softAPIP().toString().c_str());
         notifySystemState(EVENT_WIFI_CONFIG_STARTED);
@@ -60,98 +199,28 @@ void initializeWiFiConfigMode() {
         return;
     }
 
-    // 3️⃣ Third, configure the web server routes
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-        Log::debug("HTTP request at /");
-
-        String html = R"rawliteral(
-            <!DOCTYPE html>
-            <html lang="en">
-            <head>
-                <meta charset="UTF-8">
-                <meta name="viewport" content="width=device-width, initial-scale=1.0">
-                <title>MICA Gateway WiFi Config</title>
-                <style>
-                    body { font-family: Arial, sans-serif; text-align: center; margin: 40px; }
-                    h1 { color: #333; }
-                    form { display: flex; flex-direction: column; align-items: center; }
-                    label { font-size: 18px; margin: 10px 0; }
-                    select, input { width: 80%; max-width: 300px; padding: 10px; margin: 10px 0; font-size: 16px; }
-                    .button { width: 80%; max-width: 320px; padding: 15px; font-size: 18px; margin: 10px 0; border: none; cursor: pointer; border-radius: 8px; }
-                    .save-button { background-color: #28a745; color: white; }
-                    .refresh-button { background-color: #007bff; color: white; }
-                </style>
-                <script>
-                    function toggleSSIDInput() {
-                        var ssidSelect = document.getElementById("ssid");
-                        var ssidInput = document.getElementById("ssid_manual");
-                        if (ssidSelect.value === "manual") {
-                            ssidInput.style.display = "block";
-                        } else {
-                            ssidInput.style.display = "none";
-                        }
-                    }
-                </script>
-            </head>
-            <body>
-                <h1>WiFi Config Mode</h1>
-                <form action="/save" method="POST">
-                    <label for="ssid">Select WiFi Network:</label>
-                    <select id="ssid" name="ssid" onchange="toggleSSIDInput()">
-        )rawliteral";
-
-        html += g_wifiOptions;  // Add detected SSIDs
-
-        html += R"rawliteral(
-                    </select>
-                    <input type="text" id="ssid_manual" name="ssid_manual" placeholder="Enter SSID" style="display:none;">
-                    <label for="password">Enter WiFi Password:</label>
-                    <input type="password" id="password" name="password" placeholder="Enter WiFi Password">
-                    
-                    <button type="submit" class="button save-button">💾 Save Configuration</button>
-                </form>
-            </body>
-            </html>
-        )rawliteral";
-
-        request->send(200, "text/html", html);
-    });
-
-    server.on("/save", HTTP_POST, [](AsyncWebServerRequest *request) {
-        String ssid, password;
-
-        if (request->hasParam("ssid", true)) {
-            ssid = request->getParam("ssid", true)->value();
-        }
-        if (request->hasParam("ssid_manual", true) && !request->getParam("ssid_manual", true)->value().isEmpty()) {
-            ssid = request->getParam("ssid_manual", true)->value();
-        }
-        if (request->hasParam("password", true)) {
-            password = request->getParam("password", true)->value();
-        }
-
-        if (ssid.isEmpty() || password.length() < 8) {
-            request->send(400, "text/html", "<h1>Invalid credentials. Please try again.</h1>");
-            Log::warn("Invalid credentials received via web interface.");
-            notifySystemState(EVENT_WIFI_CONFIG_FAILED);
-            return;
-        }
+    // 2️⃣ Captive portal: resolve every name to the AP
+    if (!dnsServer.start(CONFIG_DNS_PORT, "*", WiFi.softAPIP())) {
+        Log::warn("Failed to start captive portal DNS; the page is still at http://%s",
+                  WiFi.softAPIP().toString().c_str());
+    }
 
-        if (saveCredentials(ssid, password)) {
-            Log::info("Credentials saved in EEPROM.");
-            request->send(200, "text/html", "<h1>Configuration Saved. Restarting...</h1>");
-            notifySystemState(EVENT_WIFI_CONFIG_SAVED);
-            deactivateWiFiConfigMode();
-        } else {
-            Log::error("Failed to save credentials in EEPROM.");
-            request->send(500, "text/html", "<h1>Failed to save credentials. Please try again.</h1>");
-            notifySystemState(EVENT_WIFI_CONFIG_FAILED);
-        }
-    });
+    // 3️⃣ Web server routes (registered once; the server object outlives config mode)
+    if (!routesRegistered) {
+        registerRoutes();
+        routesRegistered = true;
+    }
 
-    // 4️⃣ Fourth, start the web server
-    Log::info("Web server started: http://192.168.4.1");
+    // 4️⃣ Start the web server; the first scan runs in the background
+    if (xSemaphoreTake(portalMutex, portMAX_DELAY) == pdTRUE) {
+        scannedCount = -1;
+        provisionState = PROVISION_IDLE;
+        xSemaphoreGive(portalMutex);
+    }
+    provisionEventId = WiFi.onEvent(onProvisionWiFiEvent, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+    WiFi.scanNetworks(true);
     server.begin();
+    Log::info("Web server started: http://%s", WiFi.softAPIP().toString().c_str());
 }
 
 void wifiConfigModeTask(void *pvParameters) {
@@ -169,14 +238,35 @@ void wifiConfigModeTask(void *pvParameters) {
                 isAPActive = true;
             }
 
-            // Wait until the system state is no longer CONFIG_MODE
+            // Serve DNS, refresh the network list and run submitted attempts until config mode ends
+            unsigned long lastScanStart = millis();
             while (getSystemState() == SYSTEM_STATE_CONFIG_MODE) {
-                vTaskDelay(pdMS_TO_TICKS(500)); // Reduced to avoid overloading the CPU
+                dnsServer.processNextRequest();
+                collectScanResults();
+                if (serviceProvisioning()) {
+                    // New credentials work: leave config mode in-process, already associated
+                    deactivateWiFiConfigMode();
+                    isAPActive = false;
+                    notifySystemState(EVENT_WIFI_CONFIG_SAVED);
+                    while (getSystemState() == SYSTEM_STATE_CONFIG_MODE) {
+                        vTaskDelay(pdMS_TO_TICKS(100));
+                    }
+                    break;
+                }
+                bool attemptRunning = provisionState == PROVISION_PENDING || provisionState == PROVISION_CONNECTING;
+                if (!attemptRunning && millis() - lastScanStart >= CONFIG_SCAN_INTERVAL_MS &&
+                    WiFi.scanComplete() != WIFI_SCAN_RUNNING) {
+                    WiFi.scanNetworks(true);
+                    lastScanStart = millis();
+                }
+                vTaskDelay(pdMS_TO_TICKS(CONFIG_LOOP_INTERVAL_MS));
             }
 
-            Log::info("Exiting CONFIG_MODE. Cleaning up WiFi Config.");
-            deactivateWiFiConfigMode();
-            isAPActive = false;  // Allow reactivation in the future
+            if (isAPActive) {
+                Log::info("Exiting CONFIG_MODE. Cleaning up WiFi Config.");
+                deactivateWiFiConfigMode();
+                isAPActive = false;  // Allow reactivation in the future
+            }
         }
 
         vTaskDelay(pdMS_TO_TICKS(100)); // State check without overloading the CPU
@@ -186,10 +276,280 @@ void wifiConfigModeTask(void *pvParameters) {
 // Deactivate WiFi Config Mode
 void deactivateWiFiConfigMode() {
     Log::info("Deactivating WiFi Config Mode...");
+    dnsServer.stop();
     server.end();
+    if (provisionEventId != 0) {
+        WiFi.removeEvent(provisionEventId);
+        provisionEventId = 0;
+    }
+    WiFi.scanDelete();
     WiFi.softAPdisconnect(true);
+    WiFi.mode(WIFI_STA); // Back to station only; an association made in config mode is kept
     Log::info("Web server stopped and AP disabled.");
     notifySystemState(EVENT_WIFI_CONFIG_STOPPED); // Notify that the configuration mode stopped
-    vTaskDelay(pdMS_TO_TICKS(2000)); // Ensure the AP is disabled
-    ESP.restart();
-}
\ No newline at end of file
+}
+
+/** @brief Portal routes; OS connectivity checks (generate_204, hotspot-detect...) fall to the redirect. */
+static void registerRoutes() {
+    server.on("/", HTTP_GET, handleRoot);
+    server.on("/save", HTTP_POST, handleSave);
+    server.on("/status", HTTP_GET, handleStatus);
+    server.onNotFound(handleCaptiveRedirect);
+}
+
+/** @brief Streams the page: template head, one option per scanned network, template tail. */
+static void handleRoot(AsyncWebServerRequest *request) {
+    Log::debug("HTTP request at /");
+
+    AsyncResponseStream *response = request->beginResponseStream("text/html");
+    response->print(CONFIG_PAGE_HEAD);
+
+    if (xSemaphoreTake(portalMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        if (scannedCount < 0) {
+            response->print("<option value=''>Scanning... refresh in a few seconds</option>\n");
+        } else if (scannedCount == 0) {
+            response->print("<option value=''>No networks found</option>\n");
+        }
+        for (int i = 0; i < scannedCount; i++) {
+            response->print("<option value='");
+            printHtmlEscaped(*response, scannedNetworks[i].ssid);
+            response->print("'>");
+            printHtmlEscaped(*response, scannedNetworks[i].ssid);
+            response->printf(" (%d dBm%s)</option>\n", scannedNetworks[i].rssi, scannedNetworks[i].secured ? "" : ", open");
+        }
+        xSemaphoreGive(portalMutex);
+    }
+
+    response->print(CONFIG_PAGE_TAIL);
+    request->send(response);
+}
+
+static void handleSave(AsyncWebServerRequest *request) {
+    String ssid, password;
+
+    if (request->hasParam("ssid", true)) {
+        ssid = request->getParam("ssid", true)->value();
+    }
+    if (ssid == "manual") {
+        ssid = "";
+    }
+    if (request->hasParam("ssid_manual", true) && !request->getParam("ssid_manual", true)->value().isEmpty()) {
+        ssid = request->getParam("ssid_manual", true)->value();
+    }
+    if (request->hasParam("password", true)) {
+        password = request->getParam("password", true)->value();
+    }
+
+    if (ssid.isEmpty() || ssid.length() > WIFI_SSID_LENGTH || password.length() < 8 || password.length() > MAX_CRED_LENGTH) {
+        request->send(400, "text/html", "<h1>Invalid credentials. Please try again.</h1>");
+        Log::warn("Invalid credentials received via web interface.");
+        notifySystemState(EVENT_WIFI_CONFIG_FAILED);
+        return;
+    }
+
+    // Hand the attempt to the config task; the result page polls /status
+    bool accepted = false;
+    if (xSemaphoreTake(portalMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        if (provisionState != PROVISION_PENDING && provisionState != PROVISION_CONNECTING &&
+            provisionState != PROVISION_CONNECTED) {
+            strncpy(provisionSsid, ssid.c_str(), WIFI_SSID_LENGTH);
+            provisionSsid[WIFI_SSID_LENGTH] = '\0';
+            strncpy(provisionPassword, password.c_str(), MAX_CRED_LENGTH);
+            provisionPassword[MAX_CRED_LENGTH] = '\0';
+            provisionError = "";
+            provisionResultSeen = false;
+            provisionState = PROVISION_PENDING;
+            accepted = true;
+        }
+        xSemaphoreGive(portalMutex);
+    }
+    if (!accepted) {
+        request->send(409, "text/html", "<h1>A connection attempt is already running.</h1>");
+        return;
+    }
+    request->send_P(200, "text/html", CONFIG_RESULT_PAGE);
+}
+
+/** @brief Outcome of the last submission: {"state":"connecting","ssid":"...","error":"...","ip":"..."} */
+static void handleStatus(AsyncWebServerRequest *request) {
+    static const char *const STATE_NAMES[] = {"idle", "connecting", "connecting", "connected", "failed"};
+    StaticJsonDocument<256> doc;
+    if (xSemaphoreTake(portalMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        ProvisionState state = provisionState;
+        doc["state"] = STATE_NAMES[state];
+        doc["ssid"] = (const char*)provisionSsid;
+        if (state == PROVISION_FAILED) {
+            doc["error"] = provisionError;
+        }
+        if (state == PROVISION_CONNECTED) {
+            doc["ip"] = WiFi.localIP().toString();
+            provisionResultSeen = true;
+        }
+        xSemaphoreGive(portalMutex);
+    } else {
+        doc["state"] = "connecting";
+    }
+
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    serializeJson(doc, *response);
+    request->send(response);
+}
+
+/** @brief Any other URL (including OS captive portal probes) is sent to the portal page. */
+static void handleCaptiveRedirect(AsyncWebServerRequest *request) {
+    request->redirect("http://" + WiFi.softAPIP().toString() + "/");
+}
+
+/**
+ * @brief Copies a finished async scan into the table: unique SSIDs, strongest first.
+ * Hidden networks are skipped (they can still be typed in manually).
+ */
+static void collectScanResults() {
+    int16_t n = WiFi.scanComplete();
+    if (n == WIFI_SCAN_RUNNING) {
+        return;
+    }
+    if (n < 0) {
+        // No scan started, or it failed: show an empty list rather than "scanning" forever
+        if (n == WIFI_SCAN_FAILED && xSemaphoreTake(portalMutex, portMAX_DELAY) == pdTRUE) {
+            if (scannedCount < 0) scannedCount = 0;
+            xSemaphoreGive(portalMutex);
+        }
+        return;
+    }
+
+    if (xSemaphoreTake(portalMutex, portMAX_DELAY) == pdTRUE) {
+        int count = 0;
+        for (int i = 0; i < n; i++) {
+            String ssid = WiFi.SSID(i);
+            if (ssid.isEmpty() || ssid.length() > WIFI_SSID_LENGTH) {
+                continue;
+            }
+            int8_t rssi = (int8_t)WiFi.RSSI(i);
+
+            // Keep the strongest AP of each SSID
+            int existing = -1;
+            for (int j = 0; j < count; j++) {
+                if (strcmp(scannedNetworks[j].ssid, ssid.c_str()) == 0) existing = j;
+            }
+            if (existing >= 0) {
+                if (rssi <= scannedNetworks[existing].rssi) continue;
+                // Remove it and reinsert at its new rank
+                memmove(&scannedNetworks[existing], &scannedNetworks[existing + 1],
+                        (count - existing - 1) * sizeof(ScannedNetwork));
+                count--;
+            }
+
+            // Insertion by RSSI; the weakest entry drops off when full
+            int pos = count;
+            while (pos > 0 && scannedNetworks[pos - 1].rssi < rssi) pos--;
+            if (pos >= CONFIG_SCAN_MAX_NETWORKS) {
+                continue;
+            }
+            int last = (count < CONFIG_SCAN_MAX_NETWORKS) ? count : CONFIG_SCAN_MAX_NETWORKS - 1;
+            memmove(&scannedNetworks[pos + 1], &scannedNetworks[pos], (last - pos) * sizeof(ScannedNetwork));
+            strncpy(scannedNetworks[pos].ssid, ssid.c_str(), WIFI_SSID_LENGTH);
+            scannedNetworks[pos].ssid[WIFI_SSID_LENGTH] = '\0';
+            scannedNetworks[pos].rssi = rssi;
+            scannedNetworks[pos].secured = WiFi.encryptionType(i) != WIFI_AUTH_OPEN;
+            if (count < CONFIG_SCAN_MAX_NETWORKS) count++;
+        }
+        scannedCount = count;
+        xSemaphoreGive(portalMutex);
+        Log::info("Config mode scan found %d networks.", count);
+    }
+    WiFi.scanDelete();
+}
+
+/**
+ * @brief Runs a submitted attempt on the station interface (AP stays up) and saves what connects.
+ * @return true once a success has been shown to the browser (or held long enough): config mode can end
+ */
+static bool serviceProvisioning() {
+    switch (provisionState) {
+        case PROVISION_PENDING:
+            Log::info("Trying submitted credentials for SSID: %s", provisionSsid);
+            WiFi.scanDelete(); // A running scan would delay the association
+            provisionDisconnectReason = 0;
+            provisionTimeMs = millis();
+            setProvisionState(PROVISION_CONNECTING, "");
+            WiFi.begin(provisionSsid, provisionPassword);
+            return false;
+
+        case PROVISION_CONNECTING:
+            if (isWiFiConnected()) {
+                if (saveCredentials(String(provisionSsid), String(provisionPassword))) {
+                    Log::info("Connected with submitted credentials; saved in EEPROM.");
+                    provisionTimeMs = millis();
+                    setProvisionState(PROVISION_CONNECTED, "");
+                } else {
+                    Log::error("Failed to save credentials in EEPROM.");
+                    WiFi.disconnect(false);
+                    setProvisionState(PROVISION_FAILED, "storage error");
+                    notifySystemState(EVENT_WIFI_CONFIG_FAILED);
+                }
+            } else if (provisionDisconnectReason != 0 || millis() - provisionTimeMs >= CONFIG_CONNECT_TIMEOUT_MS) {
+                const char *error = provisionDisconnectReason != 0
+                    ? describeDisconnectReason(provisionDisconnectReason) : "timed out";
+                Log::warn("Submitted credentials for %s failed: %s (reason %u)", provisionSsid, error,
+                          provisionDisconnectReason);
+                WiFi.disconnect(false); // Stop the attempt; the AP keeps running
+                setProvisionState(PROVISION_FAILED, error);
+                notifySystemState(EVENT_WIFI_CONFIG_FAILED);
+            }
+            return false;
+
+        case PROVISION_CONNECTED: {
+            unsigned long held = millis() - provisionTimeMs;
+            return (provisionResultSeen && held >= CONFIG_RESULT_FLUSH_MS) || held >= CONFIG_RESULT_HOLD_MS;
+        }
+
+        default:
+            return false;
+    }
+}
+
+static void setProvisionState(ProvisionState state, const char *error) {
+    if (xSemaphoreTake(portalMutex, portMAX_DELAY) == pdTRUE) {
+        provisionState = state;
+        provisionError = error;
+        xSemaphoreGive(portalMutex);
+    }
+}
+
+/** @brief Browser-facing text for a station disconnect reason. */
+static const char *describeDisconnectReason(uint8_t reason) {
+    switch (reason) {
+        case WIFI_REASON_AUTH_FAIL:
+        case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+        case WIFI_REASON_HANDSHAKE_TIMEOUT:
+            return "wrong password";
+        case WIFI_REASON_NO_AP_FOUND:
+            return "network not found";
+        default:
+            return "connection refused by the network";
+    }
+}
+
+/** @brief WiFi event task callback: records why a submitted attempt failed (first reason only). */
+static void onProvisionWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    uint8_t reason = info.wifi_sta_disconnected.reason;
+    // Our own disconnect() before an attempt is not a failure of it
+    if (provisionState == PROVISION_CONNECTING && provisionDisconnectReason == 0 && reason != WIFI_REASON_ASSOC_LEAVE) {
+        provisionDisconnectReason = reason;
+    }
+}
+
+/** @brief Writes SSID text safely into attribute values and element content. */
+static void printHtmlEscaped(Print &out, const char *text) {
+    for (const char *c = text; *c != '\0'; c++) {
+        switch (*c) {
+            case '&':  out.print("&amp;"); break;
+            case '<':  out.print("&lt;"); break;
+            case '>':  out.print("&gt;"); break;
+            case '\'': out.print("&#39;"); break;
+            case '"':  out.print("&quot;"); break;
+            default:   out.print(*c); break;
+        }
+    }
+}
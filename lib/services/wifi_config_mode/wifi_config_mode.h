@@ -7,6 +7,10 @@
 // WiFi Configuration Mode Module
 // Purpose:
 // Manages the AP mode and web server to collect Wi-Fi credentials and store them in EEPROM.
+// The AP starts without waiting for a scan; a DNS captive portal makes phones open the page
+// automatically, and the network list is refreshed by background scans. Submitted credentials are
+// tested while the AP stays up and only saved if they connect; the browser gets the outcome and the
+// device continues to CONNECTING without a restart (EVENT_WIFI_CONFIG_SAVED).
 
 /**
  * @brief Initializes the WiFi configuration mode by setting up the AP and web server.
@@ -14,7 +18,8 @@
 void initializeWiFiConfigMode();
 
 /**
- * @brief Deactivates the WiFi configuration mode by stopping the AP and web server.
+ * @brief Deactivates the WiFi configuration mode by stopping the AP, DNS and web server.
+ * Returns the radio to station mode without restarting; an association made in config mode is kept.
  */
 void deactivateWiFiConfigMode();
 
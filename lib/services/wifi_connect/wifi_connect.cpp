@@ -1,38 +1,131 @@
 // wifi_connect.cpp
 // WiFi Connection Module
 // Purpose: Manages WiFi station mode connection with auto-reconnect
-// Architecture: FreeRTOS task monitors connection status, loads credentials from EEPROM
-// Thread-Safety: Uses wifiMutex (currently unused but reserved)
-// Dependencies: WiFi library, eeprom_config, system_state
+// Architecture: Event-driven. WiFi.onEvent() handlers (GOT_IP, DISCONNECTED) update an event group,
+//               the stats block and the system state; wifiConnectTask sleeps on the event group while
+//               connected and reconnects as soon as a disconnect is reported.
+//               The last good association (BSSID, channel, optionally the DHCP lease) is cached in
+//               RTC memory (survives soft resets) and NVS (survives power loss); reconnects try a
+//               directed association with it first and fall back to a scan on failure.
+//               Several network profiles are supported: scans rank the visible APs of all profiles by
+//               RSSI plus a priority bonus, and a sustained weak signal triggers a roaming scan.
+// Thread-Safety: Event handlers run in the WiFi event task; stats are guarded by wifiMutex; the
+//                connect cache is only touched by wifiConnectTask
+// Dependencies: WiFi library, Preferences, eeprom_config, system_state
 
 #include "wifi_connect.h"
 
 // Project headers (alphabetically)
+#include "config.h"
 #include "eeprom_config.h"
 #include "system_state.h"
 
 // Third-party libraries
 #include <Arduino.h>
 #include <Log.h>
+#include <Preferences.h>
 #include <WiFi.h>
 
 // System headers
 #include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
+#include <rom/crc.h>
+#include <string.h>
+
+#define WIFI_CACHE_MAGIC 0x57494649          // "WIFI"
+#define WIFI_DIRECTED_CONNECT_TIMEOUT_MS 3000 // Association + DHCP with a known BSSID/channel
+#define WIFI_FULL_CONNECT_TIMEOUT_MS 15000   // Driver scan + association + DHCP
+#define WIFI_RETRY_DELAY_MS 5000             // Pause after a failed attempt
+#define WIFI_SCAN_DWELL_MS 120               // Active scan time per channel
+#define WIFI_MIN_USABLE_RSSI -88             // APs weaker than this are not tried (dBm)
+#define WIFI_PRIORITY_WEIGHT_DB 5            // Each profile priority step is worth 5 dB
+#define WIFI_MAX_CANDIDATES 4                // APs tried per scan, best first
+
+// Roaming: re-evaluate after WIFI_ROAM_LOW_SAMPLES consecutive checks below the threshold
+#define WIFI_ROAM_CHECK_INTERVAL_MS 10000
+#define WIFI_ROAM_RSSI_THRESHOLD -75         // dBm
+#define WIFI_ROAM_LOW_SAMPLES 3
+#define WIFI_ROAM_HYSTERESIS_DB 8            // A new AP must be this much better to move
+#define WIFI_ROAM_MIN_INTERVAL_MS 300000     // Between roaming scans
+
+// wifiEvents bits
+#define WIFI_BIT_CONNECTED (1 << 0)     // Associated and got an IP
+#define WIFI_BIT_DISCONNECTED (1 << 1)  // Disconnect reported (not one we asked for while idle)
+
+/**
+ * @brief Last successful association, valid only for the credentials it was made with.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t credentialsHash;   // CRC32 of the profile's SSID and password
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t hasLease;           // ip/gateway/subnet/dns are valid
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t crc;               // CRC32 of the fields above
+} WiFiConnectCache;
+
+/**
+ * @brief A visible AP belonging to a configured profile.
+ */
+typedef struct {
+    int profile;                // Profile slot
+    uint8_t bssid[6];
+    uint8_t channel;
+    int8_t rssi;
+    int32_t score;              // RSSI + priority bonus
+} WiFiCandidate;
 
 // Internal Variables
-static SemaphoreHandle_t wifiMutex = NULL;
+static SemaphoreHandle_t wifiMutex = NULL;       // Guards wifiStats
+static EventGroupHandle_t wifiEvents = NULL;
+static WiFiStats wifiStats;
+static uint32_t disconnectedAtMs = 0;             // Start of the current outage (0 = none)
+RTC_NOINIT_ATTR static WiFiConnectCache rtcCache; // Not cleared by software resets
+static WiFiConnectCache connectCache;             // Working copy, validated at init
+static bool connectCacheValid = false;
+static int currentProfile = -1;                   // Profile slot of the current connection
+static uint8_t lowRssiSamples = 0;                // Consecutive roaming checks below the threshold
+static uint32_t lastRoamScanMs = 0;
+
+// Internal Function Declarations
+static uint32_t cacheCrc(const WiFiConnectCache &cache);
+static bool isCacheIntact(const WiFiConnectCache &cache);
+static void loadConnectCache();
+static void storeConnectCache(uint32_t credentialsHash);
+static void invalidateConnectCache();
+static uint32_t profileHash(const WiFiProfile &profile);
+static int findCachedProfile(const WiFiProfile *profiles);
+static size_t scanCandidates(const WiFiProfile *profiles, uint8_t channel, WiFiCandidate *out, size_t maxCount);
+static void checkRoaming();
+static bool connectTo(const WiFiProfile &profile, const uint8_t *bssid, uint8_t channel, bool useLease);
+static uint8_t getLastDisconnectReason();
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
 
 // Initialize WiFi Connection
 bool initializeWiFiConnection() {
+    WiFi.persistent(false);       // Credentials live in eeprom_config; don't rewrite them to NVS on every begin()
+    WiFi.setAutoReconnect(false); // wifiConnectTask owns reconnection (cache, fallback, stats)
     WiFi.mode(WIFI_STA);
-    //WiFi.setSleep(true); // Optional power saving
+    // Modem sleep is set by power_manager from the power profile
     wifiMutex = xSemaphoreCreateMutex();
     if (wifiMutex == NULL) {
         Log::error("Failed to create WiFi mutex.");
         return false;
     }
+    wifiEvents = xEventGroupCreate();
+    if (wifiEvents == NULL) {
+        Log::error("Failed to create WiFi event group.");
+        return false;
+    }
+    memset(&wifiStats, 0, sizeof(WiFiStats));
+    WiFi.onEvent(onWiFiEvent);
+    loadConnectCache();
     Log::info("WiFi hardware initialized in station mode.");
     return true;
 }
@@ -40,63 +133,395 @@ bool initializeWiFiConnection() {
 // WiFi Connect Task
 void wifiConnectTask(void *pvParameters) {
     while (true) {
-        // Check if already connected
-        if (WiFi.status() == WL_CONNECTED) {
-            notifySystemState(EVENT_WIFI_CONNECTED);
-            vTaskDelay(pdMS_TO_TICKS(5000)); // Pause before checking again
+        // Connected: sleep until the event handler reports a disconnect, checking the signal now and then
+        if (xEventGroupGetBits(wifiEvents) & WIFI_BIT_CONNECTED) {
+            EventBits_t bits = xEventGroupWaitBits(wifiEvents, WIFI_BIT_DISCONNECTED, pdFALSE, pdFALSE,
+                                                   pdMS_TO_TICKS(WIFI_ROAM_CHECK_INTERVAL_MS));
+            if (!(bits & WIFI_BIT_DISCONNECTED)) {
+                checkRoaming();
+            }
             continue;
         }
 
-        Log::warn("Wi-Fi disconnected. Attempting to reconnect...");
+        WiFiProfile profiles[WIFI_MAX_PROFILES];
+        if (loadWiFiProfiles(profiles) == 0) {
+            Log::warn("No Wi-Fi credentials found in EEPROM.");
+            notifySystemState(EVENT_NO_PARAMETERS_EEPROM);
+            vTaskDelay(pdMS_TO_TICKS(WIFI_RETRY_DELAY_MS));
+            continue;
+        }
 
-        String ssid, password;
+        bool connected = false;
+        unsigned long startTime = millis();
 
-        if (loadCredentials(ssid, password)) {
-            if (ssid.isEmpty() || password.isEmpty()) {
-                Log::warn("No Wi-Fi credentials found in EEPROM.");
-                notifySystemState(EVENT_NO_PARAMETERS_EEPROM);
-                vTaskDelay(pdMS_TO_TICKS(5000));
-                continue;
+        // 1. Directed association with the last good AP, no scan
+        int cached = findCachedProfile(profiles);
+        if (cached >= 0) {
+            Log::info("Fast connect to SSID: %s (channel %u)", profiles[cached].ssid, connectCache.channel);
+            connected = connectTo(profiles[cached], connectCache.bssid, connectCache.channel, true);
+            if (connected) {
+                currentProfile = cached;
+            } else {
+                Log::warn("Fast connect failed (reason %u). Falling back to scan.", getLastDisconnectReason());
+                invalidateConnectCache();
+                WiFi.disconnect(false); // Abort the directed attempt; keep the radio on
+                if (connectCache.hasLease) {
+                    WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0)); // Back to DHCP
+                }
             }
+        }
 
-            Log::info("Attempting to connect to SSID: %s", ssid.c_str());
-            WiFi.disconnect(true);
-            vTaskDelay(pdMS_TO_TICKS(100));
-            WiFi.begin(ssid.c_str(), password.c_str());
-
-            unsigned long startTime = millis();
-            const unsigned long timeout = 15000;
-
-            // Wait for connection
-            while (WiFi.status() != WL_CONNECTED && (millis() - startTime) < timeout) {
-                wl_status_t status = WiFi.status();
-                const char* statusStr = "UNKNOWN";
-                switch(status) {
-                    case WL_IDLE_STATUS: statusStr = "IDLE"; break;
-                    case WL_NO_SSID_AVAIL: statusStr = "NO_SSID_AVAILABLE"; break;
-                    case WL_SCAN_COMPLETED: statusStr = "SCAN_COMPLETED"; break;
-                    case WL_CONNECTED: statusStr = "CONNECTED"; break;
-                    case WL_CONNECT_FAILED: statusStr = "CONNECT_FAILED"; break;
-                    case WL_CONNECTION_LOST: statusStr = "CONNECTION_LOST"; break;
-                    case WL_DISCONNECTED: statusStr = "DISCONNECTED"; break;
+        // 2. Scan and try the visible networks from best to worst
+        if (!connected) {
+            WiFiCandidate candidates[WIFI_MAX_CANDIDATES];
+            size_t count = scanCandidates(profiles, 0, candidates, WIFI_MAX_CANDIDATES);
+            for (size_t i = 0; i < count && !connected; i++) {
+                const WiFiCandidate &candidate = candidates[i];
+                Log::info("Attempting to connect to SSID: %s (RSSI %d dBm, channel %u)",
+                          profiles[candidate.profile].ssid, candidate.rssi, candidate.channel);
+                connected = connectTo(profiles[candidate.profile], candidate.bssid, candidate.channel, false);
+                if (connected) {
+                    currentProfile = candidate.profile;
                 }
-                Log::debug("Connecting... Status: %s (%d)", statusStr, status);
-                vTaskDelay(pdMS_TO_TICKS(1000));
             }
+            // 3. Nothing matched the scan (e.g. hidden SSID): let the driver search for the first profile
+            if (count == 0) {
+                int first = 0;
+                while (profiles[first].ssid[0] == '\0') first++;
+                Log::info("Attempting to connect to SSID: %s", profiles[first].ssid);
+                connected = connectTo(profiles[first], NULL, 0, false);
+                if (connected) {
+                    currentProfile = first;
+                }
+            }
+        }
 
-            // Check the result
-            if (WiFi.status() == WL_CONNECTED) {
-                Log::info("Connected to Wi-Fi! IP Address: %s", WiFi.localIP().toString().c_str());
-                notifySystemState(EVENT_WIFI_CONNECTED);
-            } else {
-                Log::error("Failed to connect to Wi-Fi.");
-                notifySystemState(EVENT_WIFI_FAIL_CONNECT);
+        // Check the result (EVENT_WIFI_CONNECTED is sent by the GOT_IP handler)
+        uint32_t durationMs = millis() - startTime;
+        if (connected) {
+            Log::info("Connected to Wi-Fi in %lu ms! IP Address: %s",
+                      (unsigned long)durationMs, WiFi.localIP().toString().c_str());
+            if (xSemaphoreTake(wifiMutex, portMAX_DELAY) == pdTRUE) {
+                wifiStats.lastConnectDurationMs = durationMs;
+                xSemaphoreGive(wifiMutex);
             }
+            storeConnectCache(profileHash(profiles[currentProfile]));
         } else {
-            Log::warn("No credentials found in EEPROM.");
-            notifySystemState(EVENT_NO_PARAMETERS_EEPROM); // TODO: Se usa la misma que en ssid y password empty, comprobar que se quiera hacer así
+            Log::error("Failed to connect to Wi-Fi (reason %u).", getLastDisconnectReason());
+            if (xSemaphoreTake(wifiMutex, portMAX_DELAY) == pdTRUE) {
+                wifiStats.failedAttempts++;
+                xSemaphoreGive(wifiMutex);
+            }
+            notifySystemState(EVENT_WIFI_FAIL_CONNECT);
+            vTaskDelay(pdMS_TO_TICKS(WIFI_RETRY_DELAY_MS)); // Pause before next attempt
+        }
+    }
+}
+
+bool isWiFiConnected() {
+    return wifiEvents != NULL && (xEventGroupGetBits(wifiEvents) & WIFI_BIT_CONNECTED);
+}
+
+void getWiFiStats(WiFiStats &stats) {
+    if (wifiMutex == NULL) {
+        memset(&stats, 0, sizeof(WiFiStats));
+        return;
+    }
+    bool connected = isWiFiConnected();
+    int8_t rssi = connected ? WiFi.RSSI() : 0;
+    if (xSemaphoreTake(wifiMutex, portMAX_DELAY) == pdTRUE) {
+        if (connected) {
+            wifiStats.rssi = rssi; // The last sample before a drop becomes lastDisconnectRssi
         }
+        memcpy(&stats, &wifiStats, sizeof(WiFiStats));
+        xSemaphoreGive(wifiMutex);
+    }
+}
+
+static uint32_t cacheCrc(const WiFiConnectCache &cache) {
+    return crc32_le(0, (const uint8_t*)&cache, offsetof(WiFiConnectCache, crc));
+}
+
+static bool isCacheIntact(const WiFiConnectCache &cache) {
+    return cache.magic == WIFI_CACHE_MAGIC && cache.channel >= 1 && cache.channel <= 14 && cache.crc == cacheCrc(cache);
+}
+
+/** @brief Picks the RTC copy after a soft reset, otherwise the NVS copy from the last power cycle. */
+static void loadConnectCache() {
+    if (isCacheIntact(rtcCache)) {
+        memcpy(&connectCache, &rtcCache, sizeof(WiFiConnectCache));
+        connectCacheValid = true;
+        return;
+    }
+
+    Preferences prefs;
+    prefs.begin("wifi", true);
+    size_t loaded = prefs.getBytes("connect", &connectCache, sizeof(WiFiConnectCache));
+    prefs.end();
+    connectCacheValid = (loaded == sizeof(WiFiConnectCache)) && isCacheIntact(connectCache);
+    if (connectCacheValid) {
+        memcpy(&rtcCache, &connectCache, sizeof(WiFiConnectCache));
+    }
+}
+
+/** @brief Records the current association; NVS is only written when it changed (flash wear). */
+static void storeConnectCache(uint32_t credentialsHash) {
+    WiFiConnectCache cache;
+    memset(&cache, 0, sizeof(WiFiConnectCache));
+    cache.magic = WIFI_CACHE_MAGIC;
+    cache.credentialsHash = credentialsHash;
+    const uint8_t *bssid = WiFi.BSSID();
+    if (bssid == NULL) return;
+    memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+    cache.channel = (uint8_t)WiFi.channel();
+    if (WIFI_REUSE_DHCP_LEASE) {
+        cache.hasLease = 1;
+        cache.ip = (uint32_t)WiFi.localIP();
+        cache.gateway = (uint32_t)WiFi.gatewayIP();
+        cache.subnet = (uint32_t)WiFi.subnetMask();
+        cache.dns = (uint32_t)WiFi.dnsIP(0);
+    }
+    cache.crc = cacheCrc(cache);
+
+    memcpy(&rtcCache, &cache, sizeof(WiFiConnectCache));
+    if (connectCacheValid && memcmp(&cache, &connectCache, sizeof(WiFiConnectCache)) == 0) {
+        return;
+    }
+    memcpy(&connectCache, &cache, sizeof(WiFiConnectCache));
+    connectCacheValid = true;
+
+    Preferences prefs;
+    prefs.begin("wifi", false);
+    prefs.putBytes("connect", &cache, sizeof(WiFiConnectCache));
+    prefs.end();
+    Log::info("WiFi connect cache updated (channel %u).", cache.channel);
+}
 
-        vTaskDelay(pdMS_TO_TICKS(5000)); // Pause before next attempt
+/** @brief Drops the cache from RAM and RTC; NVS is overwritten on the next successful connect. */
+static void invalidateConnectCache() {
+    connectCacheValid = false;
+    rtcCache.magic = 0;
+}
+
+/** @brief Identifies a profile's credentials in the connect cache. */
+static uint32_t profileHash(const WiFiProfile &profile) {
+    uint32_t hash = crc32_le(0, (const uint8_t*)profile.ssid, strlen(profile.ssid));
+    return crc32_le(hash, (const uint8_t*)profile.password, strlen(profile.password));
+}
+
+/** @brief Profile slot the connect cache was recorded with, or -1. */
+static int findCachedProfile(const WiFiProfile *profiles) {
+    if (!connectCacheValid) {
+        return -1;
+    }
+    for (int p = 0; p < WIFI_MAX_PROFILES; p++) {
+        if (profiles[p].ssid[0] != '\0' && profileHash(profiles[p]) == connectCache.credentialsHash) {
+            return p;
+        }
     }
-}
\ No newline at end of file
+    return -1;
+}
+
+/**
+ * @brief Scans and ranks the APs of configured profiles by RSSI plus a priority bonus.
+ * @param channel Channel to scan, or 0 for all channels
+ * @param out Candidates sorted best first
+ * @return Number of candidates (at most maxCount)
+ */
+static size_t scanCandidates(const WiFiProfile *profiles, uint8_t channel, WiFiCandidate *out, size_t maxCount) {
+    int16_t found = WiFi.scanNetworks(false, false, false, WIFI_SCAN_DWELL_MS, channel);
+    if (found < 0) {
+        Log::warn("WiFi scan failed (%d).", found);
+        return 0;
+    }
+
+    size_t count = 0;
+    for (int16_t i = 0; i < found; i++) {
+        int32_t rssi = WiFi.RSSI(i);
+        if (rssi < WIFI_MIN_USABLE_RSSI) {
+            continue;
+        }
+        String ssid = WiFi.SSID(i);
+        for (int p = 0; p < WIFI_MAX_PROFILES; p++) {
+            if (profiles[p].ssid[0] == '\0' || strcmp(ssid.c_str(), profiles[p].ssid) != 0) {
+                continue;
+            }
+            WiFiCandidate candidate;
+            candidate.profile = p;
+            memcpy(candidate.bssid, WiFi.BSSID(i), sizeof(candidate.bssid));
+            candidate.channel = (uint8_t)WiFi.channel(i);
+            candidate.rssi = (int8_t)rssi;
+            candidate.score = rssi + WIFI_PRIORITY_WEIGHT_DB * profiles[p].priority;
+
+            // Insertion into the sorted, bounded list
+            size_t pos = count;
+            while (pos > 0 && out[pos - 1].score < candidate.score) pos--;
+            if (pos < maxCount) {
+                size_t last = (count < maxCount) ? count : maxCount - 1;
+                for (size_t k = last; k > pos; k--) out[k] = out[k - 1];
+                out[pos] = candidate;
+                if (count < maxCount) count++;
+            }
+            break;
+        }
+    }
+    WiFi.scanDelete();
+    return count;
+}
+
+/**
+ * @brief Roaming: after a sustained weak signal, looks for a clearly better AP (same channel first,
+ *        where mesh nodes usually are, then all channels) and moves to it.
+ */
+static void checkRoaming() {
+    int8_t rssi = WiFi.RSSI();
+    if (xSemaphoreTake(wifiMutex, portMAX_DELAY) == pdTRUE) {
+        wifiStats.rssi = rssi;
+        xSemaphoreGive(wifiMutex);
+    }
+    if (rssi == 0 || rssi >= WIFI_ROAM_RSSI_THRESHOLD) {
+        lowRssiSamples = 0;
+        return;
+    }
+    if (++lowRssiSamples < WIFI_ROAM_LOW_SAMPLES) {
+        return;
+    }
+    lowRssiSamples = 0;
+    if (lastRoamScanMs != 0 && millis() - lastRoamScanMs < WIFI_ROAM_MIN_INTERVAL_MS) {
+        return;
+    }
+    lastRoamScanMs = millis();
+
+    WiFiProfile profiles[WIFI_MAX_PROFILES];
+    if (loadWiFiProfiles(profiles) == 0 || currentProfile < 0) {
+        return;
+    }
+    uint8_t currentBssid[6];
+    const uint8_t *bssid = WiFi.BSSID();
+    if (bssid == NULL) return;
+    memcpy(currentBssid, bssid, sizeof(currentBssid));
+    int32_t currentScore = rssi + WIFI_PRIORITY_WEIGHT_DB * profiles[currentProfile].priority;
+
+    Log::info("Weak Wi-Fi signal (%d dBm). Looking for a better AP...", rssi);
+    WiFiCandidate candidates[WIFI_MAX_CANDIDATES];
+    const WiFiCandidate *best = NULL;
+    for (int pass = 0; pass < 2 && best == NULL; pass++) {
+        uint8_t channel = (pass == 0) ? (uint8_t)WiFi.channel() : 0;
+        size_t count = scanCandidates(profiles, channel, candidates, WIFI_MAX_CANDIDATES);
+        for (size_t i = 0; i < count; i++) {
+            if (memcmp(candidates[i].bssid, currentBssid, sizeof(currentBssid)) == 0) continue;
+            if (candidates[i].score >= currentScore + WIFI_ROAM_HYSTERESIS_DB) best = &candidates[i];
+            break; // Sorted: only the best other AP matters
+        }
+    }
+    if (best == NULL) {
+        Log::info("No better AP found; staying connected.");
+        return;
+    }
+
+    Log::info("Roaming to SSID: %s (RSSI %d dBm, channel %u).", profiles[best->profile].ssid, best->rssi, best->channel);
+    WiFi.disconnect(false);
+    xEventGroupWaitBits(wifiEvents, WIFI_BIT_DISCONNECTED, pdFALSE, pdFALSE, pdMS_TO_TICKS(1000));
+    if (connectTo(profiles[best->profile], best->bssid, best->channel, false)) {
+        currentProfile = best->profile;
+        if (xSemaphoreTake(wifiMutex, portMAX_DELAY) == pdTRUE) {
+            wifiStats.roamCount++;
+            xSemaphoreGive(wifiMutex);
+        }
+        storeConnectCache(profileHash(profiles[currentProfile]));
+    }
+    // On failure the main loop reconnects through the normal path
+}
+
+/**
+ * @brief Starts an association and waits for its outcome from the event handler.
+ * @param bssid AP to join (with its channel), or NULL to let the driver pick
+ * @param useLease Apply the cached DHCP lease as a static configuration
+ * @return true once an IP is assigned; false on a reported failure or timeout (the attempt is aborted,
+ *         for the next candidate, the hidden-SSID fallback and roaming alike)
+ */
+static bool connectTo(const WiFiProfile &profile, const uint8_t *bssid, uint8_t channel, bool useLease) {
+    xEventGroupClearBits(wifiEvents, WIFI_BIT_CONNECTED | WIFI_BIT_DISCONNECTED);
+    if (useLease && connectCache.hasLease) {
+        WiFi.config(IPAddress(connectCache.ip), IPAddress(connectCache.gateway),
+                    IPAddress(connectCache.subnet), IPAddress(connectCache.dns));
+    }
+    const char *password = (profile.password[0] != '\0') ? profile.password : NULL;
+    if (bssid != NULL) {
+        WiFi.begin(profile.ssid, password, channel, bssid);
+    } else {
+        WiFi.begin(profile.ssid, password);
+    }
+
+    // A known AP only needs to associate; a driver search includes the scan
+    uint32_t timeoutMs = (bssid != NULL) ? WIFI_DIRECTED_CONNECT_TIMEOUT_MS : WIFI_FULL_CONNECT_TIMEOUT_MS;
+    EventBits_t bits = xEventGroupWaitBits(wifiEvents, WIFI_BIT_CONNECTED | WIFI_BIT_DISCONNECTED,
+                                           pdFALSE, pdFALSE, pdMS_TO_TICKS(timeoutMs));
+    if (!(bits & (WIFI_BIT_CONNECTED | WIFI_BIT_DISCONNECTED))) {
+        // Timed out: abort the pending association so a late event cannot end the next attempt's wait
+        WiFi.disconnect(false);
+        xEventGroupClearBits(wifiEvents, WIFI_BIT_CONNECTED | WIFI_BIT_DISCONNECTED);
+    }
+    return (bits & WIFI_BIT_CONNECTED) != 0;
+}
+
+/** @brief Reason of the last disconnect event (written by the WiFi event task). */
+static uint8_t getLastDisconnectReason() {
+    uint8_t reason = 0;
+    if (xSemaphoreTake(wifiMutex, portMAX_DELAY) == pdTRUE) {
+        reason = wifiStats.lastDisconnectReason;
+        xSemaphoreGive(wifiMutex);
+    }
+    return reason;
+}
+
+/** @brief WiFi event task callback: keeps the event group, stats and system state current. */
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP: {
+            uint32_t now = millis();
+            if (xSemaphoreTake(wifiMutex, portMAX_DELAY) == pdTRUE) {
+                wifiStats.connectCount++;
+                wifiStats.connectedSinceMs = now;
+                if (disconnectedAtMs != 0) {
+                    wifiStats.lastOutageMs = now - disconnectedAtMs;
+                    disconnectedAtMs = 0;
+                }
+                xSemaphoreGive(wifiMutex);
+            }
+            xEventGroupClearBits(wifiEvents, WIFI_BIT_DISCONNECTED);
+            xEventGroupSetBits(wifiEvents, WIFI_BIT_CONNECTED);
+            notifySystemState(EVENT_WIFI_CONNECTED);
+            break;
+        }
+
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED: {
+            uint8_t reason = info.wifi_sta_disconnected.reason;
+            bool wasConnected = (xEventGroupGetBits(wifiEvents) & WIFI_BIT_CONNECTED) != 0;
+            if (xSemaphoreTake(wifiMutex, portMAX_DELAY) == pdTRUE) {
+                wifiStats.lastDisconnectReason = reason;
+                if (wasConnected) {
+                    wifiStats.disconnectCount++;
+                    wifiStats.lastDisconnectRssi = wifiStats.rssi;
+                    wifiStats.rssi = 0;
+                    wifiStats.connectedSinceMs = 0;
+                    disconnectedAtMs = millis();
+                }
+                xSemaphoreGive(wifiMutex);
+            }
+            xEventGroupClearBits(wifiEvents, WIFI_BIT_CONNECTED);
+            // Our own WiFi.disconnect() while not connected is not a failure of the current attempt
+            if (wasConnected || reason != WIFI_REASON_ASSOC_LEAVE) {
+                xEventGroupSetBits(wifiEvents, WIFI_BIT_DISCONNECTED);
+            }
+            if (wasConnected) {
+                Log::warn("Wi-Fi connection lost (reason %u). Reconnecting...", reason);
+                notifySystemState(EVENT_WIFI_DISCONNECTED);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
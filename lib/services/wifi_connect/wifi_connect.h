@@ -2,9 +2,29 @@
 #ifndef WIFI_CONNECT_H
 #define WIFI_CONNECT_H
 
+#include <stdint.h>
+
 // WiFi Connect Module
 // Purpose:
 // Manages the connection to a WiFi network using credentials stored in EEPROM.
+// Picks the best visible network among the stored profiles and roams away from a weak AP.
+// Reacts to WiFi driver events (got IP, disconnect) instead of polling the link status.
+
+/**
+ * @brief Connection statistics since boot.
+ */
+typedef struct {
+    uint32_t connectCount;          // Associations that obtained an IP
+    uint32_t disconnectCount;       // Established connections that were lost
+    uint32_t failedAttempts;        // Connection attempts that failed or timed out
+    uint32_t roamCount;             // Moves to a better AP triggered by a weak signal
+    uint32_t lastConnectDurationMs; // Attempt start to IP of the last successful connect
+    uint32_t lastOutageMs;          // Duration of the last outage (loss to IP)
+    uint32_t connectedSinceMs;      // millis() of the current connection (0 while disconnected)
+    uint8_t lastDisconnectReason;   // wifi_err_reason_t of the last disconnect event
+    int8_t lastDisconnectRssi;      // Last RSSI sampled before the last loss (dBm)
+    int8_t rssi;                    // Last sampled RSSI (dBm, 0 while disconnected)
+} WiFiStats;
 
 /**
  * @brief Initializes the WiFi connection in station mode.
@@ -18,4 +38,17 @@ bool initializeWiFiConnection();
  */
 void wifiConnectTask(void *pvParameters);
 
+/**
+ * @brief Whether the station is associated and has an IP (event-driven, no driver query).
+ * @note Thread-safe: Can be called from any task
+ */
+bool isWiFiConnected();
+
+/**
+ * @brief Copies the connection statistics, sampling the current RSSI.
+ * @param stats Destination
+ * @note Thread-safe: Uses wifiMutex
+ */
+void getWiFiStats(WiFiStats &stats);
+
 #endif
\ No newline at end of file
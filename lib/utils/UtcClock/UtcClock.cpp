@@ -2,7 +2,8 @@
 // UTC Clock Module
 // Purpose: Manages NTP time synchronization with drift compensation
 // Architecture: Periodic sync with validation, fallback to uptime estimate
-// Thread-Safety: Read-only after sync (atomic operations on ESP32)
+// Thread-Safety: The sync point (flag, millis and 64-bit Unix time) is copied and updated under a
+//                portMUX critical section, so concurrent readers never see a torn timestamp
 // Dependencies: esp_sntp, Arduino
 
 #include "UtcClock.h"
@@ -33,20 +34,36 @@ uint64_t UtcClock::getTime(uint64_t millisTimestamp) {
     synchronize();
     uint64_t currentMillis = (millisTimestamp > 0) ? millisTimestamp : millis();
 
-    if (isSynchronized) {
-        return lastSyncUnixMs + (currentMillis - lastSyncMillis);
+    portENTER_CRITICAL(&syncMux);
+    bool synchronized = isSynchronized;
+    uint64_t syncMillis = lastSyncMillis;
+    uint64_t syncUnixMs = lastSyncUnixMs;
+    portEXIT_CRITICAL(&syncMux);
+
+    if (synchronized) {
+        return syncUnixMs + (currentMillis - syncMillis);
     }
     Log::warn("NTP not synchronized, using uptime estimate");
     return currentMillis;
 }
 
-bool UtcClock::hasLastSyncExpired() const {
-    return millis() - lastSyncMillis > SYNC_INTERVAL || !isSynchronized;
+bool UtcClock::isTimeValid() {
+    synchronize();
+    portENTER_CRITICAL(&syncMux);
+    bool synchronized = isSynchronized;
+    portEXIT_CRITICAL(&syncMux);
+    return synchronized;
 }
 
 void UtcClock::synchronize() {
     Log::debug("Time sync: %lu", millis());
-    if (!hasLastSyncExpired()) {
+    portENTER_CRITICAL(&syncMux);
+    bool wasSynchronized = isSynchronized;
+    uint64_t previousSyncMillis = lastSyncMillis;
+    uint64_t previousSyncUnixMs = lastSyncUnixMs;
+    portEXIT_CRITICAL(&syncMux);
+
+    if (wasSynchronized && millis() - previousSyncMillis <= SYNC_INTERVAL) {
         return;
     }
 
@@ -64,22 +81,22 @@ void UtcClock::synchronize() {
         return;
     }
 
-    if (!isSynchronized) {
+    uint64_t actual = (uint64_t)newTime * 1000L;
+    if (!wasSynchronized) {
         Log::debug("Initial sync");
-        lastSyncMillis = syncMillis;
-        lastSyncUnixMs = (uint64_t)newTime * 1000L;
-        Log::debug("Sync value %llu", lastSyncUnixMs);
+        Log::debug("Sync value %llu", actual);
     } else {
-        uint64_t expected = lastSyncUnixMs + (syncMillis - lastSyncMillis);
-        uint64_t actual = (uint64_t)newTime * 1000L;
-        sntp_sync_status_t sync_status = sntp_get_sync_status();
-        Log::debug("Last sync %llu", lastSyncUnixMs);
-        Log::debug("Elapsed %llu", syncMillis - lastSyncMillis);
+        uint64_t expected = previousSyncUnixMs + (syncMillis - previousSyncMillis);
+        Log::debug("Last sync %llu", previousSyncUnixMs);
+        Log::debug("Elapsed %llu", syncMillis - previousSyncMillis);
         Log::debug("Expected %llu", expected);
         Log::debug("Actual %llu", actual);
         Log::debug("Drifted %lld ms", (int64_t)actual - (int64_t)expected);
-        lastSyncMillis = syncMillis;
-        lastSyncUnixMs = actual;
     }
+
+    portENTER_CRITICAL(&syncMux);
+    lastSyncMillis = syncMillis;
+    lastSyncUnixMs = actual;
     isSynchronized = true;
+    portEXIT_CRITICAL(&syncMux);
 }
\ No newline at end of file
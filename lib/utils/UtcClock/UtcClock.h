@@ -2,7 +2,9 @@
 #ifndef UTCCLOCK_H
 #define UTCCLOCK_H
 
+// System headers
 #include <cstdint>
+#include <freertos/FreeRTOS.h>
 
 const long gmtOffsetSeconds = 0;
 const int daylightOffsetSeconds = 0;
@@ -12,14 +14,16 @@ class UtcClock {
         UtcClock(const char *ntpServerMain, const char *ntpServerBackup);
         void init();
         uint64_t getTime(uint64_t millisTimestamp);
+        bool isTimeValid();
         
     private:
-        bool hasLastSyncExpired() const;
         void synchronize();
 
         const char *ntpServerMain;
         const char *ntpServerBackup;
 
+        // Shared by several tasks: the sync point is read and written as a whole under syncMux
+        portMUX_TYPE syncMux = portMUX_INITIALIZER_UNLOCKED;
         bool isSynchronized = false;
         uint64_t lastSyncMillis = 0;
         uint64_t lastSyncUnixMs = 0;
@@ -0,0 +1,14 @@
+// Log.h (host test stub)
+// Drops all messages; the firmware logger writes to the serial port from its own task.
+#ifndef LOG_H
+#define LOG_H
+
+class Log {
+    public:
+        template<typename... Args> static void error(const char *, Args&&...) {}
+        template<typename... Args> static void warn(const char *, Args&&...) {}
+        template<typename... Args> static void info(const char *, Args&&...) {}
+        template<typename... Args> static void debug(const char *, Args&&...) {}
+};
+
+#endif // LOG_H
@@ -0,0 +1,16 @@
+// FreeRTOS.h (host test stub)
+// Single-threaded stand-ins for the few FreeRTOS types the host-tested modules use.
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif // FREERTOS_H
@@ -0,0 +1,57 @@
+// test_button_gesture.cpp
+// Replays press/release sequences through the button gesture detector at buttonTask's 50 ms poll
+// rate and checks which gestures come out, and in which order.
+
+#include "button_gesture.h"
+#include "test_support.h"
+
+#include <string>
+
+static const unsigned long POLL_MS = 50;
+
+/**
+ * @brief Polls a sequence of alternating press/release durations (starting pressed), then stays
+ *        released for a second so pending presses resolve.
+ * @return Gestures in order, S (short), D (double), L (long)
+ */
+static std::string replay(std::initializer_list<unsigned long> durationsMs) {
+    ButtonGestureState state = {0, 0, false};
+    std::string gestures;
+    unsigned long now = 1000;
+    bool pressed = true;
+    auto poll = [&](unsigned long durationMs) {
+        for (unsigned long end = now + durationMs; now < end; now += POLL_MS) {
+            uint8_t bits = buttonGestureUpdate(state, pressed, now);
+            if (bits & BUTTON_GESTURE_SHORT) gestures += 'S';
+            if (bits & BUTTON_GESTURE_DOUBLE) gestures += 'D';
+            if (bits & BUTTON_GESTURE_LONG) gestures += 'L';
+        }
+    };
+    for (unsigned long duration : durationsMs) {
+        poll(duration);
+        pressed = !pressed;
+    }
+    pressed = false;
+    poll(1000);
+    return gestures;
+}
+
+static void check(std::initializer_list<unsigned long> durationsMs, const char *expected) {
+    std::string gestures = replay(durationsMs);
+    if (gestures != expected) {
+        printf("sequence gave \"%s\", expected \"%s\"\n", gestures.c_str(), expected);
+    }
+    CHECK(gestures == expected);
+}
+
+int main() {
+    check({200}, "S");                          // Short press, reported once the window expires
+    check({200, 150, 200}, "D");                // Second press inside the window
+    check({200, 500, 200}, "SS");               // Second press after the window
+    check({6000}, "L");                         // Long press, once however long it is held
+    check({12000}, "L");
+    check({200, 150, 6000}, "SL");              // Held short press is reported before the long press
+    check({6000, 150, 200}, "LS");              // A long press never pairs with a following short one
+    check({200, 150, 200, 150, 200}, "DS");     // Third press starts a new gesture
+    return TEST_RESULT();
+}
@@ -0,0 +1,138 @@
+// test_lan_frame.cpp
+// Round-trips LAN control frames through build, parse and verify, and checks the known-answer
+// vector that tools/lan_client.py --self-test uses, so the device and the reference client agree.
+
+#include "lan_frame.h"
+#include "test_support.h"
+
+#include <string.h>
+
+static const char KNOWN_REQUEST[] =
+    "MICA1 0badf00d 7 power-state 642b775b2232e9167d6065315104187f1672605285d9d26565d44e1bae9b776a\nON";
+
+static void makeKey(uint8_t key[LAN_FRAME_KEY_LENGTH]) {
+    for (int i = 0; i < LAN_FRAME_KEY_LENGTH; i++) {
+        key[i] = (uint8_t)i;
+    }
+}
+
+static void testKnownAnswer() {
+    uint8_t key[LAN_FRAME_KEY_LENGTH];
+    makeKey(key);
+    char frame[LAN_FRAME_MAX_LENGTH];
+    int length = lanFrameBuild(key, "0badf00d", 7, "power-state", "ON", 2, frame, sizeof(frame));
+    CHECK(length == (int)strlen(KNOWN_REQUEST));
+    CHECK(length > 0 && memcmp(frame, KNOWN_REQUEST, length) == 0);
+}
+
+static void testRoundTrip() {
+    uint8_t key[LAN_FRAME_KEY_LENGTH];
+    makeKey(key);
+    // MessagePack bodies may contain NUL and newline bytes
+    const char body[] = {'\x81', '\xa7', 'v', 'e', 'r', 's', 'i', 'o', 'n', '\x01', '\0', '\n'};
+    char frame[LAN_FRAME_MAX_LENGTH];
+    int length = lanFrameBuild(key, "12345678", 4294967295UL, "config", body, sizeof(body), frame, sizeof(frame));
+    CHECK(length > 0);
+
+    LanFrame parsed;
+    CHECK(lanFrameParse(frame, length, parsed));
+    CHECK(strcmp(parsed.nonce, "12345678") == 0);
+    CHECK(parsed.sequence == 4294967295UL);
+    CHECK(strcmp(parsed.field, "config") == 0);
+    CHECK(parsed.bodyLength == sizeof(body) && memcmp(parsed.body, body, sizeof(body)) == 0);
+    CHECK(lanFrameVerify(key, parsed));
+
+    // Uppercase MAC hex is accepted
+    char upper[LAN_FRAME_MAX_LENGTH];
+    memcpy(upper, frame, length);
+    for (char *c = upper + parsed.headerLength + 1; *c != '\n'; c++) {
+        if (*c >= 'a' && *c <= 'f') *c -= 'a' - 'A';
+    }
+    CHECK(lanFrameParse(upper, length, parsed) && lanFrameVerify(key, parsed));
+}
+
+static void testTamperingDetected() {
+    uint8_t key[LAN_FRAME_KEY_LENGTH];
+    makeKey(key);
+    char frame[LAN_FRAME_MAX_LENGTH];
+    int length = lanFrameBuild(key, "0badf00d", 8, "power-state", "ON", 2, frame, sizeof(frame));
+    LanFrame parsed;
+
+    frame[length - 1] = 'F'; // Body
+    CHECK(lanFrameParse(frame, length, parsed) && !lanFrameVerify(key, parsed));
+    frame[length - 1] = 'N';
+
+    frame[7] = 'c'; // Nonce
+    CHECK(lanFrameParse(frame, length, parsed) && !lanFrameVerify(key, parsed));
+    frame[7] = 'b';
+
+    CHECK(lanFrameParse(frame, length, parsed) && lanFrameVerify(key, parsed));
+    key[0] ^= 1; // Other key
+    CHECK(!lanFrameVerify(key, parsed));
+}
+
+static void testUnsignedReply() {
+    char frame[160];
+    int length = lanFrameBuild(NULL, "0badf00d", 9, "ERR", "no key provisioned", 18, frame, sizeof(frame));
+    const char expected[] = "MICA1 0badf00d 9 ERR -\nno key provisioned";
+    CHECK(length == (int)strlen(expected) && memcmp(frame, expected, length) == 0);
+
+    uint8_t key[LAN_FRAME_KEY_LENGTH];
+    makeKey(key);
+    LanFrame parsed;
+    CHECK(lanFrameParse(frame, length, parsed));
+    CHECK(strcmp(parsed.field, "ERR") == 0 && !lanFrameVerify(key, parsed));
+}
+
+static void testMalformedRejected() {
+    LanFrame parsed;
+    const char *mac = "642b775b2232e9167d6065315104187f1672605285d9d26565d44e1bae9b776a";
+    char frame[LAN_FRAME_MAX_LENGTH + 8];
+    const char *headers[] = {
+        "MICA2 0badf00d 7 power-state %s",       // Magic
+        "MICA1 0badf00 7 power-state %s",        // Short nonce
+        "MICA1 0badf00d 07 power-state %s",      // Leading zero
+        "MICA1 0badf00d 4294967296 power-state %s", // Sequence overflow
+        "MICA1 0badf00d -7 power-state %s",      // Sign
+        "MICA1 0badf00d  7 power-state %s",      // Double space
+        "MICA1 0badf00d 7 power-state %s extra", // Trailing field
+        "MICA1 0badf00d 7 power-state %.63s",    // Short MAC
+    };
+    for (const char *header : headers) {
+        int length = snprintf(frame, sizeof(frame), header, mac);
+        frame[length++] = '\n';
+        CHECK(!lanFrameParse(frame, length, parsed));
+    }
+
+    // No newline, empty and oversized datagrams
+    int length = snprintf(frame, sizeof(frame), "MICA1 0badf00d 7 power-state %s", mac);
+    CHECK(!lanFrameParse(frame, length, parsed));
+    CHECK(!lanFrameParse(frame, 0, parsed));
+    frame[length] = '\n';
+    memset(frame + length + 1, 'x', sizeof(frame) - length - 1);
+    CHECK(lanFrameParse(frame, LAN_FRAME_MAX_LENGTH, parsed));
+    CHECK(!lanFrameParse(frame, LAN_FRAME_MAX_LENGTH + 1, parsed));
+
+    // Build refuses what does not fit
+    uint8_t key[LAN_FRAME_KEY_LENGTH];
+    makeKey(key);
+    CHECK(lanFrameBuild(key, "0badf00d", 7, "power-state", "ON", 2, frame, strlen(KNOWN_REQUEST) - 1) == -1);
+}
+
+static void testParseKey() {
+    uint8_t key[LAN_FRAME_KEY_LENGTH];
+    CHECK(lanFrameParseKey("000102030405060708090A0B0C0D0E0F101112131415161718191a1b1c1d1e1f", key));
+    CHECK(key[0] == 0x00 && key[10] == 0x0A && key[31] == 0x1F);
+    CHECK(!lanFrameParseKey("000102", key));
+    CHECK(!lanFrameParseKey("g00102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", key));
+}
+
+int main() {
+    testKnownAnswer();
+    testRoundTrip();
+    testTamperingDetected();
+    testUnsignedReply();
+    testMalformedRejected();
+    testParseKey();
+    return TEST_RESULT();
+}
@@ -0,0 +1,193 @@
+// test_ota_patch.cpp
+// Decodes delta patches built from two buffers, fed whole and in every split, and checks that
+// truncated and corrupt patches are rejected. With arguments (source, inflated patch, expected
+// target) it decodes one patch instead: tools/ota_delta.py --self-test runs it on generated patches.
+
+#include "ota_patch.h"
+#include "test_support.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Images {
+    const Bytes *source;
+    Bytes target;
+    size_t failWriteAt; // Target offset at which the writer fails (SIZE_MAX: never)
+};
+
+static bool readSource(uint32_t offset, uint8_t *out, size_t length, void *context) {
+    const Images *images = (const Images *)context;
+    if (offset + length > images->source->size()) {
+        return false;
+    }
+    memcpy(out, images->source->data() + offset, length);
+    return true;
+}
+
+static bool writeTarget(const uint8_t *data, size_t length, void *context) {
+    Images *images = (Images *)context;
+    if (images->target.size() + length > images->failWriteAt) {
+        return false;
+    }
+    images->target.insert(images->target.end(), data, data + length);
+    return true;
+}
+
+static void putLe32(Bytes &out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+static Bytes header(uint32_t targetSize) {
+    Bytes out = {'M', 'D', 'L', 'T'};
+    putLe32(out, targetSize);
+    return out;
+}
+
+/** Appends a record taking add bytes of target from source at sourceOffset, then copy literal bytes. */
+static void addRecord(Bytes &patch, const Bytes &source, uint32_t sourceOffset, const Bytes &target,
+                      uint32_t targetOffset, uint32_t add, uint32_t copy, int32_t seek) {
+    putLe32(patch, add);
+    putLe32(patch, copy);
+    putLe32(patch, (uint32_t)seek);
+    for (uint32_t i = 0; i < add; i++) {
+        patch.push_back((uint8_t)(target[targetOffset + i] - source[sourceOffset + i]));
+    }
+    patch.insert(patch.end(), target.begin() + targetOffset + add, target.begin() + targetOffset + add + copy);
+}
+
+/** Decodes patch in pieces of at most step bytes; returns whether the whole target was produced. */
+static bool decode(const Bytes &source, const Bytes &patch, uint32_t targetSize, size_t step, Bytes &target,
+                   size_t failWriteAt = SIZE_MAX) {
+    Images images = {&source, Bytes(), failWriteAt};
+    OtaPatchDecoder decoder;
+    otaPatchInit(decoder, targetSize, (uint32_t)source.size(), readSource, writeTarget, &images);
+    for (size_t offset = 0; offset < patch.size(); offset += step) {
+        size_t length = (patch.size() - offset < step) ? patch.size() - offset : step;
+        if (!otaPatchDecode(decoder, patch.data() + offset, length)) {
+            CHECK(decoder.error != NULL);
+            return false;
+        }
+    }
+    target = images.target;
+    return otaPatchComplete(decoder);
+}
+
+static Bytes makeBuffer(size_t size, uint32_t seed) {
+    Bytes out(size);
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        out[i] = (uint8_t)(seed >> 16);
+    }
+    return out;
+}
+
+// Target: source[100, 700) with a few changed bytes, 50 new bytes, then source[0, 300)
+static void makePair(Bytes &source, Bytes &target, Bytes &patch) {
+    source = makeBuffer(1000, 1);
+    target.assign(source.begin() + 100, source.begin() + 700);
+    target[10] ^= 0x5a;
+    target[400] += 3;
+    Bytes inserted = makeBuffer(50, 2);
+    target.insert(target.end(), inserted.begin(), inserted.end());
+    target.insert(target.end(), source.begin(), source.begin() + 300);
+
+    patch = header((uint32_t)target.size());
+    addRecord(patch, source, 0, target, 0, 0, 0, 100);        // Seek to the first aligned run
+    addRecord(patch, source, 100, target, 0, 600, 50, -700);  // Changed run, new bytes, back to 0
+    addRecord(patch, source, 0, target, 650, 300, 0, 0);
+}
+
+static void testRoundTrip() {
+    Bytes source, target, patch, out;
+    makePair(source, target, patch);
+    for (size_t step : {patch.size(), (size_t)1, (size_t)5, (size_t)12, (size_t)300}) {
+        CHECK(decode(source, patch, (uint32_t)target.size(), step, out));
+        CHECK(out == target);
+    }
+}
+
+static void testEmptyTarget() {
+    Bytes source = makeBuffer(10, 3), out;
+    CHECK(decode(source, header(0), 0, 8, out));
+    CHECK(out.empty());
+}
+
+static void testTruncatedPatch() {
+    Bytes source, target, patch, out;
+    makePair(source, target, patch);
+    // Every proper prefix decodes without error but leaves the target incomplete
+    for (size_t length = 0; length < patch.size(); length += 7) {
+        Bytes prefix(patch.begin(), patch.begin() + length);
+        CHECK(!decode(source, prefix, (uint32_t)target.size(), 64, out));
+    }
+}
+
+static void testCorruptPatch() {
+    Bytes source, target, patch, out;
+    makePair(source, target, patch);
+    uint32_t size = (uint32_t)target.size();
+
+    Bytes bad = patch;
+    bad[0] = 'X';                                       // Magic
+    CHECK(!decode(source, bad, size, 64, out));
+    CHECK(!decode(source, patch, size + 1, 64, out));   // Size disagrees with the manifest
+
+    bad = patch;
+    bad[8 + 12 + 3] = 0x01;                             // Second record's add length past the target
+    CHECK(!decode(source, bad, size, 64, out));
+
+    bad = patch;
+    bad[8 + 9] = 0x03;                                  // Seek leaves the second run past the source end
+    CHECK(!decode(source, bad, size, 64, out));
+
+    bad = header(10);
+    putLe32(bad, 0);
+    putLe32(bad, 0);
+    putLe32(bad, (uint32_t)-1);                         // Seek before the source start
+    putLe32(bad, 10);
+    putLe32(bad, 0);
+    putLe32(bad, 0);
+    bad.resize(bad.size() + 10);
+    CHECK(!decode(source, bad, 10, 64, out));
+
+    bad = patch;
+    bad.push_back(0);                                   // Data past the end of the target
+    CHECK(!decode(source, bad, size, 64, out));
+
+    CHECK(!decode(source, patch, size, 64, out, 200));  // Writer failure aborts
+}
+
+static Bytes readFile(const char *path) {
+    Bytes out;
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("cannot read %s\n", path);
+        exit(2);
+    }
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out.insert(out.end(), buffer, buffer + length);
+    }
+    fclose(file);
+    return out;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 4) {
+        Bytes source = readFile(argv[1]), patch = readFile(argv[2]), expected = readFile(argv[3]), out;
+        CHECK(decode(source, patch, (uint32_t)expected.size(), 1000, out));
+        CHECK(out == expected);
+        return TEST_RESULT();
+    }
+    testRoundTrip();
+    testEmptyTarget();
+    testTruncatedPatch();
+    testCorruptPatch();
+    return TEST_RESULT();
+}
@@ -0,0 +1,30 @@
+// test_support.h
+// Minimal assertions for the host tests: failures are counted and printed, main() returns the count.
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <math.h>
+#include <stdio.h>
+
+static int testFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            testFailures++; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { \
+        double a_ = (actual), e_ = (expected); \
+        if (fabs(a_ - e_) > (tolerance)) { \
+            printf("%s:%d: %s = %.3f, expected %.3f +/- %.3f\n", __FILE__, __LINE__, #actual, a_, e_, (double)(tolerance)); \
+            testFailures++; \
+        } \
+    } while (0)
+
+#define TEST_RESULT() (printf("%s\n", testFailures == 0 ? "OK" : "FAILED"), testFailures)
+
+#endif // TEST_SUPPORT_H
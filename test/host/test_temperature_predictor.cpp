@@ -0,0 +1,162 @@
+// test_temperature_predictor.cpp
+// Replays warm-up traces through the predictor with the relay controller's stop rule and checks
+// when the pump would stop and how far the projection is off.
+// Traces (traces/*.csv, time_ms,sensor_c,water_c) are 1 Hz DS18B20 readings at 12-bit resolution;
+// water_c is the water temperature at the probe, which the sensor reports with a lag.
+
+#include "temperature_predictor.h"
+#include "test_support.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Same constants as relayControllerTask()
+static const uint32_t SENSOR_LAG_MS = 10000;
+static const float PREDICTION_MAX_LEAD_C = 5.0f;
+
+struct TraceSample {
+    uint32_t timeMs;
+    float sensor;
+    float water;
+};
+
+struct ReplayResult {
+    int stopIndex;          // Sample at which the pump stops (-1: never)
+    bool predicted;         // Stopped by the projection rather than the threshold
+    float maxProjectionError; // Worst |projection - reading SENSOR_LAG_MS later| while the stop rule applies
+};
+
+static std::vector<TraceSample> loadTrace(const char *name) {
+    std::vector<TraceSample> trace;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", TRACE_DIR, name);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("cannot open %s\n", path);
+        testFailures++;
+        return trace;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        TraceSample sample;
+        if (line[0] != '#' && sscanf(line, "%u,%f,%f", &sample.timeMs, &sample.sensor, &sample.water) == 3) {
+            trace.push_back(sample);
+        }
+    }
+    fclose(file);
+    return trace;
+}
+
+/** @brief Feeds the trace one sample per second and applies the relay controller's stop rule. */
+static ReplayResult replay(const std::vector<TraceSample> &trace, float maxTemperature) {
+    ReplayResult result = {-1, false, 0.0f};
+    initializeTemperaturePredictor();
+    for (size_t i = 0; i < trace.size(); i++) {
+        const TraceSample &sample = trace[i];
+        recordTemperatureSample(sample.sensor, sample.timeMs);
+
+        TemperatureProjection projection;
+        if (!predictTemperature(sample.timeMs, SENSOR_LAG_MS, projection)) {
+            continue;
+        }
+        if (result.stopIndex >= 0) {
+            break;
+        }
+        bool inLead = (maxTemperature - sample.sensor) <= PREDICTION_MAX_LEAD_C;
+        size_t later = i + SENSOR_LAG_MS / 1000;
+        if (inLead && later < trace.size()) {
+            float error = fabsf(projection.projectedTemperature - trace[later].sensor);
+            if (error > result.maxProjectionError) result.maxProjectionError = error;
+        }
+        bool predictedStop = inLead && projection.projectedTemperature > maxTemperature;
+        if (sample.sensor > maxTemperature || predictedStop) {
+            result.stopIndex = (int)i;
+            result.predicted = predictedStop;
+        }
+    }
+    return result;
+}
+
+/** @brief First sample at which a column exceeds the limit (-1: never). */
+static int firstAbove(const std::vector<TraceSample> &trace, float limit, bool water) {
+    for (size_t i = 0; i < trace.size(); i++) {
+        if ((water ? trace[i].water : trace[i].sensor) > limit) return (int)i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Checks the stop of one heating trace.
+ * @param minSavedS The stop comes at least this long before the plain threshold would trip
+ * @param maxEarlyS The stop comes at most this long before the water itself crosses the limit
+ * @param maxErrorC Bound on the projection error near the limit
+ */
+static void testTrace(const char *name, float maxTemperature, int minSavedS, int maxEarlyS, float maxErrorC) {
+    std::vector<TraceSample> trace = loadTrace(name);
+    if (trace.empty()) return;
+    ReplayResult result = replay(trace, maxTemperature);
+    int sensorCrossing = firstAbove(trace, maxTemperature, false);
+    int waterCrossing = firstAbove(trace, maxTemperature, true);
+    printf("%s: stop %d s (%s), water above %.0f C at %d s, sensor at %d s, max error %.2f C\n", name,
+           result.stopIndex, result.predicted ? "predicted" : "threshold", maxTemperature, waterCrossing,
+           sensorCrossing, result.maxProjectionError);
+
+    // The projection stops the pump before the lagging sensor crosses the limit, close to the moment
+    // the water itself does
+    CHECK(result.predicted);
+    CHECK(result.stopIndex >= 0);
+    CHECK(result.stopIndex <= sensorCrossing - minSavedS);
+    CHECK(result.stopIndex >= waterCrossing - maxEarlyS);
+    CHECK(result.maxProjectionError <= maxErrorC);
+}
+
+/** @brief Water that levels off below the limit must not be cut by an over-eager projection. */
+static void testLukewarmNeverStops() {
+    std::vector<TraceSample> trace = loadTrace("lukewarm.csv");
+    if (trace.empty()) return;
+    ReplayResult result = replay(trace, 40.0f);
+    printf("lukewarm.csv: stop %d s, max error %.2f C\n", result.stopIndex, result.maxProjectionError);
+    CHECK(result.stopIndex < 0);
+}
+
+static void testNeedsEnoughRecentSamples() {
+    initializeTemperaturePredictor();
+    TemperatureProjection projection;
+    CHECK(!predictTemperature(0, SENSOR_LAG_MS, projection));
+
+    recordTemperatureSample(30.0f, 0);
+    recordTemperatureSample(31.0f, 1000);
+    CHECK(!predictTemperature(1000, SENSOR_LAG_MS, projection));
+
+    recordTemperatureSample(32.0f, 2000);
+    CHECK(predictTemperature(2000, SENSOR_LAG_MS, projection));
+    CHECK_NEAR(projection.slopePerSecond, 1.0, 1e-4);
+    CHECK_NEAR(projection.projectedTemperature, 42.0, 1e-3);
+    CHECK(projection.samplesUsed == 3);
+
+    // Samples older than PREDICTOR_WINDOW_MS no longer count
+    CHECK(!predictTemperature(2000 + PREDICTOR_WINDOW_MS + 1, SENSOR_LAG_MS, projection));
+}
+
+static void testFallingTrendNotExtrapolated() {
+    initializeTemperaturePredictor();
+    for (uint32_t s = 0; s < 10; s++) {
+        recordTemperatureSample(45.0f - 0.5f * s, s * 1000);
+    }
+    TemperatureProjection projection;
+    CHECK(predictTemperature(9000, SENSOR_LAG_MS, projection));
+    CHECK(projection.slopePerSecond < 0.0f);
+    CHECK_NEAR(projection.projectedTemperature, projection.latestTemperature, 1e-6);
+    CHECK_NEAR(projection.latestTemperature, 40.5, 1e-3);
+}
+
+int main() {
+    testNeedsEnoughRecentSamples();
+    testFallingTrendNotExtrapolated();
+    // A steep front right after the cold lead-in: the fit must follow it within the lag
+    testTrace("short_pipe.csv", 40.0f, 4, 0, 1.0f);
+    testTrace("long_pipe.csv", 40.0f, 10, 2, 2.5f);
+    testLukewarmNeverStops();
+    return TEST_RESULT();
+}
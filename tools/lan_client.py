@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Reference client for LAN control (UDP commands, see apps/recirculator/src/services/lan_control.h).
+
+Sends one command and prints the device reply:
+    tools/lan_client.py --key <64 hex> mica-abc123.local power-state ON
+    tools/lan_client.py --key <64 hex> 192.168.1.40 config '{"version":1,"maxTime":300}'
+
+The key is the one provisioned with the lan-control MQTT command (or $MICA_LAN_KEY). The boot nonce
+is learned from the stale-nonce reply unless --nonce is given. Sequence numbers default to the Unix
+time, so they keep increasing across runs; a "replayed" reply is retried once with the next free number.
+--self-test checks the frame format against the vector in test/host/test_lan_frame.cpp.
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import socket
+import sys
+import time
+
+MAGIC = "MICA1"
+DEFAULT_PORT = 4210
+
+
+def build_frame(key, nonce, sequence, field, body):
+    """MICA1 <nonce> <seq> <field> <mac>\\n<body>; key None gives an unsigned frame."""
+    header = f"{MAGIC} {nonce} {sequence} {field}".encode()
+    mac = hmac.new(key, header + b"\n" + body, hashlib.sha256).hexdigest() if key else "-"
+    return header + b" " + mac.encode() + b"\n" + body
+
+
+def parse_frame(data):
+    """Returns (nonce, sequence, field, mac, header, body) or raises ValueError."""
+    line, separator, body = data.partition(b"\n")
+    parts = line.decode().split(" ")
+    if not separator or len(parts) != 5 or parts[0] != MAGIC:
+        raise ValueError("malformed frame")
+    header = line[: line.rfind(b" ")]
+    return parts[1], int(parts[2]), parts[3], parts[4], header, body
+
+
+def verify_frame(key, data):
+    nonce, sequence, field, mac, header, body = parse_frame(data)
+    expected = hmac.new(key, header + b"\n" + body, hashlib.sha256).hexdigest()
+    return hmac.compare_digest(expected, mac.lower()), nonce, sequence, field, body
+
+
+def exchange(sock, address, frame, timeout):
+    sock.settimeout(timeout)
+    sock.sendto(frame, address)
+    data, _ = sock.recvfrom(2048)
+    return data
+
+
+def send_command(host, port, key, command, payload, nonce=None, sequence=None, timeout=2.0):
+    address = (socket.gethostbyname(host), port)
+    sequence = sequence or int(time.time())
+    nonce = nonce or "00000000"
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        for _ in range(3):
+            reply = exchange(sock, address, build_frame(key, nonce, sequence, command, payload), timeout)
+            authentic, reply_nonce, _, status, detail = verify_frame(key, reply)
+            detail = detail.decode(errors="replace")
+            if not authentic:
+                return False, f"unauthenticated reply: {status} {detail}"
+            if status == "ERR" and detail == "stale-nonce":
+                nonce = reply_nonce
+                continue
+            if status == "ERR" and detail.startswith("replayed "):
+                sequence = int(detail.split(" ")[1]) + 1
+                continue
+            return status == "OK", detail
+    return False, "gave up after retries"
+
+
+def self_test():
+    key = bytes(range(32))
+    frame = build_frame(key, "0badf00d", 7, "power-state", b"ON")
+    expected = (b"MICA1 0badf00d 7 power-state "
+                b"642b775b2232e9167d6065315104187f1672605285d9d26565d44e1bae9b776a\nON")
+    assert frame == expected, frame
+    authentic, nonce, sequence, field, body = verify_frame(key, frame)
+    assert authentic and (nonce, sequence, field, body) == ("0badf00d", 7, "power-state", b"ON")
+    assert not verify_frame(key, frame[:-1] + b"X")[0]
+    print("self-test passed")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", nargs="?")
+    parser.add_argument("command", nargs="?", help="command topic suffix, e.g. power-state")
+    parser.add_argument("payload", nargs="?", default="", help="same payload as the MQTT command")
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT)
+    parser.add_argument("--key", default=os.environ.get("MICA_LAN_KEY"), help="64 hex characters")
+    parser.add_argument("--nonce", help="boot nonce (mDNS TXT record); learned from the device if omitted")
+    parser.add_argument("--seq", type=int, help="sequence number (default: Unix time)")
+    parser.add_argument("--self-test", action="store_true")
+    args = parser.parse_args()
+
+    if args.self_test:
+        self_test()
+        return 0
+    if not args.host or not args.command or not args.key:
+        parser.error("host, command and --key are required")
+
+    ok, detail = send_command(args.host, args.port, bytes.fromhex(args.key), args.command,
+                              args.payload.encode(), args.nonce, args.seq)
+    print(("OK " if ok else "ERR ") + detail)
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
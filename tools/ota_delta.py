@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""Delta patch generator for OTA updates (format in lib/services/ota_manager/ota_patch.h).
+
+Makes a patch from the firmware the devices run to the new one and prints the manifest fields:
+    tools/ota_delta.py old.bin new.bin new.patch --url https://.../new.patch
+Applies a patch the way the device does, to check it before publishing:
+    tools/ota_delta.py --apply old.bin new.patch out.bin
+
+The patch is bsdiff-like: runs of the new image aligned with the old one are stored as byte
+differences (mostly zeros once inflated, so moved code with shifted addresses compresses well), the
+rest as literal bytes. The result is zlib-compressed, as the device inflates it with the ROM miniz.
+--self-test round-trips generated images through this module and, with --decoder, through the
+device decoder built by test/host (test_ota_patch <source> <inflated patch> <expected target>).
+"""
+
+import argparse
+import hashlib
+import json
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+import zlib
+
+MAGIC = b"MDLT"
+BLOCK = 16               # Exact match length that starts an aligned run
+EXACT_STEP = 64          # Bytes compared at once while a run matches exactly
+MISMATCH_SLACK = 32      # Mismatches beyond the best score tolerated before a run ends
+
+
+def build_index(source):
+    """First source offset of every BLOCK-byte substring."""
+    index = {}
+    for offset in range(len(source) - BLOCK, -1, -1):
+        index[source[offset:offset + BLOCK]] = offset
+    return index
+
+
+def extend_run(source, s, target, t):
+    """Length of the aligned run at (s, t): extends while matches outweigh mismatches (as bsdiff)."""
+    limit = min(len(source) - s, len(target) - t)
+    k = score = best_score = best_length = 0
+    while k < limit:
+        step = min(EXACT_STEP, limit - k)
+        if source[s + k:s + k + step] == target[t + k:t + k + step]:
+            k += step
+            score += step
+        else:
+            score += 1 if source[s + k] == target[t + k] else -1
+            k += 1
+        if score > best_score:
+            best_score, best_length = score, k
+        elif score < best_score - MISMATCH_SLACK:
+            break
+    return best_length
+
+
+def find_runs(source, target):
+    """Non-overlapping (target offset, source offset, length) runs in target order."""
+    index = build_index(source)
+    runs = []
+    t = 0
+    offset = 0  # Alignment of the previous run: tried first, keeps seeks small
+    while t + BLOCK <= len(target):
+        block = target[t:t + BLOCK]
+        s = t + offset
+        if not (0 <= s <= len(source) - BLOCK and source[s:s + BLOCK] == block):
+            s = index.get(block)
+        if s is None:
+            t += 1
+            continue
+        length = extend_run(source, s, target, t)
+        runs.append((t, s, length))
+        offset = s - t
+        t += length
+    return runs
+
+
+def make_patch(source, target, level=9):
+    """Compressed patch turning source into target."""
+    out = bytearray(MAGIC + struct.pack("<I", len(target)))
+    runs = find_runs(source, target)
+    position = 0  # Source position of the decoder
+    t = 0
+    if not runs or runs[0][0] > 0 or runs[0][1] > 0:
+        # Literal prefix before the first run, and the seek to it
+        end = runs[0][0] if runs else len(target)
+        seek = runs[0][1] if runs else 0
+        out += struct.pack("<IIi", 0, end, seek) + target[:end]
+        position, t = seek, end
+    for i, (t_start, s_start, length) in enumerate(runs):
+        assert t_start == t and s_start == position
+        following = runs[i + 1] if i + 1 < len(runs) else None
+        copy_end = following[0] if following else len(target)
+        seek = following[1] - (s_start + length) if following else 0
+        add = bytes((target[t_start + k] - source[s_start + k]) & 0xFF for k in range(length))
+        out += struct.pack("<IIi", length, copy_end - (t_start + length), seek)
+        out += add + target[t_start + length:copy_end]
+        position = s_start + length + seek
+        t = copy_end
+    return zlib.compress(bytes(out), level)
+
+
+def apply_patch(source, patch):
+    """Reference decoder (same checks as the device); raises ValueError on a bad patch."""
+    try:
+        data = zlib.decompress(patch)
+    except zlib.error as error:
+        raise ValueError(f"not a zlib stream: {error}")
+    if len(data) < 8 or data[:4] != MAGIC:
+        raise ValueError("bad header")
+    size = struct.unpack_from("<I", data, 4)[0]
+    target = bytearray()
+    pos = 8
+    position = 0
+    while len(target) < size:
+        if pos + 12 > len(data):
+            raise ValueError("truncated record")
+        add, copy, seek = struct.unpack_from("<IIi", data, pos)
+        pos += 12
+        if len(target) + add + copy > size or pos + add + copy > len(data):
+            raise ValueError("record runs past the target image or the patch")
+        if add and (position < 0 or position + add > len(source)):
+            raise ValueError("patch reads outside the source image")
+        target += bytes((source[position + k] + data[pos + k]) & 0xFF for k in range(add))
+        target += data[pos + add:pos + add + copy]
+        pos += add + copy
+        position += add + seek
+    if pos != len(data):
+        raise ValueError("data past the end of the target image")
+    return bytes(target)
+
+
+def image_sha256(image):
+    """Hash the device reports for a running image: the SHA-256 esptool appends, else the whole file."""
+    if len(image) > 56 and image[0] == 0xE9 and image[23] == 1 and hashlib.sha256(image[:-32]).digest() == image[-32:]:
+        return image[-32:].hex()
+    return hashlib.sha256(image).hexdigest()
+
+
+def run_decoder(decoder, source, stream, target):
+    """Runs the device decoder on an inflated patch stream; returns its exit code."""
+    with tempfile.TemporaryDirectory() as directory:
+        paths = []
+        for name, content in (("source", source), ("patch", stream), ("target", target)):
+            path = os.path.join(directory, name)
+            with open(path, "wb") as file:
+                file.write(content)
+            paths.append(path)
+        return subprocess.run([decoder] + paths, stdout=subprocess.DEVNULL).returncode
+
+
+def edited_image(rng, source):
+    """New image made from source the way a rebuild changes firmware: patched words, moves, new code."""
+    target = bytearray(source)
+    for _ in range(200):
+        offset = rng.randrange(len(target) - 4)
+        target[offset:offset + 4] = rng.randbytes(4)
+    start = rng.randrange(len(target) // 2)
+    del target[start:start + rng.randrange(1, 2000)]
+    start = rng.randrange(len(target))
+    target[start:start] = rng.randbytes(rng.randrange(1, 3000))
+    target += rng.randbytes(500)
+    return bytes(target)
+
+
+def self_test(decoder=None):
+    rng = random.Random(7)
+    base = rng.randbytes(60000)
+    source = base + base[:20000]  # Repeated content, as in real images
+    cases = [
+        ("edited", source, edited_image(rng, source)),
+        ("unrelated", source, rng.randbytes(5000)),
+        ("identical", source, source),
+        ("shorter", source, source[1000:30000]),
+        ("empty source", b"", rng.randbytes(300)),
+    ]
+    for name, old, new in cases:
+        patch = make_patch(old, new)
+        assert apply_patch(old, patch) == new, name
+        if decoder:
+            assert run_decoder(decoder, old, zlib.decompress(patch), new) == 0, f"device decoder: {name}"
+    edited = cases[0][2]
+    patch = make_patch(source, edited)
+    assert len(patch) < len(zlib.compress(edited, 9)) // 4, "delta is not smaller than the full image"
+
+    # Invalid patches must be rejected by both decoders
+    stream = zlib.decompress(patch)
+    corrupt = {
+        "truncated": zlib.decompressobj().decompress(patch[:len(patch) // 2]),
+        "header only": stream[:8],
+        "bad magic": b"MDLX" + stream[4:],
+        "wrong size": stream[:4] + struct.pack("<I", len(edited) + 1) + stream[8:],
+        "record past target": stream[:8] + struct.pack("<IIi", len(edited) + 1, 0, 0) + stream[20:],
+        "seek outside source": stream[:8] + struct.pack("<IIi", 0, 0, -1) + stream[8:],
+        "trailing data": stream + b"\0",
+    }
+    for name, bad in corrupt.items():
+        try:
+            apply_patch(source, zlib.compress(bad))
+            raise AssertionError(f"accepted {name} patch")
+        except ValueError:
+            pass
+        if decoder:
+            assert run_decoder(decoder, source, bad, edited) != 0, f"device decoder accepted {name} patch"
+    print("self-test passed" + (" (with device decoder)" if decoder else ""))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("files", nargs="*", help="old.bin new.bin patch (or with --apply: old.bin patch out.bin)")
+    parser.add_argument("--url", default="https://<host>/<patch>", help="patch URL for the printed manifest fields")
+    parser.add_argument("--apply", action="store_true")
+    parser.add_argument("--self-test", action="store_true")
+    parser.add_argument("--decoder", help="test_ota_patch binary used by --self-test")
+    args = parser.parse_args()
+
+    if args.self_test:
+        self_test(args.decoder)
+        return 0
+    if len(args.files) != 3:
+        parser.error("three files are required")
+
+    with open(args.files[0], "rb") as file:
+        source = file.read()
+    with open(args.files[1], "rb") as file:
+        second = file.read()
+    if args.apply:
+        try:
+            target = apply_patch(source, second)
+        except ValueError as error:
+            print(f"patch rejected: {error}", file=sys.stderr)
+            return 1
+        with open(args.files[2], "wb") as file:
+            file.write(target)
+        print(f"{len(target)} bytes, sha256 {hashlib.sha256(target).hexdigest()}")
+        return 0
+
+    patch = make_patch(source, second)
+    if apply_patch(source, patch) != second:
+        print("internal error: patch does not reproduce the new image", file=sys.stderr)
+        return 1
+    with open(args.files[2], "wb") as file:
+        file.write(patch)
+    manifest = {
+        "size": len(second),
+        "sha256": hashlib.sha256(second).hexdigest(),
+        "patch": {"url": args.url, "size": len(patch), "source": image_sha256(source)},
+    }
+    print(json.dumps(manifest, indent=2))
+    print(f"patch is {len(patch)} bytes ({100 * len(patch) / max(len(second), 1):.1f}% of the image)", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())